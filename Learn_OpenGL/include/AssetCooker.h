@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Settings of a "Learn_OpenGL.exe cook [--force] [--jobs N] [root]" run
+struct CookOptions
+{
+	std::string root = ".\\resources";
+	bool force = false;		// ignore the manifest and rebuild everything
+	unsigned int jobs = 0;	// worker threads, 0 = hardware concurrency
+};
+
+// Settings of a "Learn_OpenGL.exe pack [--lz4] [--output path] [dir...]" run
+struct PackOptions
+{
+	std::vector<std::string> roots = { ".\\resources", ".\\shaders" };
+	std::string output = ".\\assets.pack";
+	bool compress = false;	// LZ4 entries that shrink enough, the others stay zero-copy
+};
+
+// Offline asset pipeline: compresses textures to BC KTX2 files (with mips), packs cubemap faces in a
+// single KTX2, converts models to cooked ".mesh" files and compiles ".scene" sources to ".sceneb".
+// The runtime loaders pick these up next to their sources; outputs whose inputs and settings hash
+// didn't change since the last run are skipped
+class AssetCooker
+{
+public:
+	// args are the command line arguments following "cook"; returns the process exit code
+	static int Run(int argc, char** argv);
+	static int Cook(const CookOptions& options);
+
+	static int RunPack(int argc, char** argv);
+	// Packs every file of the roots, except sources superseded by their cooked output
+	static int Pack(const PackOptions& options);
+
+private:
+	enum class CookJobType
+	{
+		TEXTURE,
+		CUBEMAP,
+		MESH,
+		SCENE
+	};
+
+	struct CookJob
+	{
+		CookJobType type;
+		std::vector<std::string> inputs;	// cubemaps: the six faces in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+		std::string output;
+		unsigned long long hash = 0;
+	};
+
+	static void CollectJobs(const std::string& root, std::vector<CookJob>& outJobs);
+	static bool RunJob(const CookJob& job);
+	static bool CookTexture(const CookJob& job);
+	static bool CookCubemap(const CookJob& job);
+	static bool CookMesh(const CookJob& job);
+	static bool CookScene(const CookJob& job);
+
+	static bool IsSupersededByCookedFile(const std::string& path);
+
+	static unsigned long long HashJob(const CookJob& job);
+	static std::string GetManifestPath(const std::string& root);
+	static void LoadManifest(const std::string& path, std::vector<std::pair<std::string, unsigned long long>>& outEntries);
+	static bool SaveManifest(const std::string& path, const std::vector<std::pair<std::string, unsigned long long>>& entries);
+};
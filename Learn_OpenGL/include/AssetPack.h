@@ -0,0 +1,62 @@
+#pragma once
+
+#include <MappedFile.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Contents of a file: either a view into a mapping (zero-copy) or a buffer it owns.
+// Not copyable, since data may point into its own storage
+struct FileData
+{
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	std::vector<unsigned char> storage;
+	std::unique_ptr<MappedFile> mapping;	// a loose file mapped by VirtualFileSystem::Map
+
+	FileData() = default;
+	FileData(FileData&& other) noexcept;
+	FileData& operator=(FileData&& other) noexcept;
+	FileData(const FileData&) = delete;
+	FileData& operator=(const FileData&) = delete;
+
+	bool IsMapped() const { return data != nullptr && (storage.empty() || data != &storage[0]); }
+	// takes ownership of the bytes
+	void Assign(std::vector<unsigned char>&& bytes);
+	// copies a mapped view into storage so it can be modified in place
+	unsigned char* MakeWritable();
+};
+
+// Read-only archive memory-mapped once: a sorted table of contents followed by 16-byte aligned
+// blobs, each stored raw or LZ4 compressed. Built offline by "Learn_OpenGL.exe pack"
+class AssetPack
+{
+public:
+	AssetPack() = default;
+	~AssetPack();
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_data != nullptr; }
+
+	// name must be normalized (see VirtualFileSystem::NormalizePath)
+	bool Contains(std::string_view name) const;
+	bool Read(std::string_view name, FileData& outFile) const;
+
+	// names[i] is the normalized name stored for the file at paths[i]
+	static bool Write(const std::string& path, const std::vector<std::string>& paths, const std::vector<std::string>& names, bool compress);
+
+private:
+	struct Entry;
+	const Entry* Find(std::string_view name) const;
+
+	MappedFile m_file;
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+	const Entry* m_entries = nullptr;
+	unsigned int m_entryCount = 0;
+	const char* m_names = nullptr;
+};
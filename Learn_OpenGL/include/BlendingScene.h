@@ -4,6 +4,8 @@
 #include <Camera.h>
 #include <vector>
 #include <ICustomScene.h>
+#include <TextureArray.h>
+#include <SceneFile.h>
 
 class BlendingScene : public ICustomScene
 {
@@ -19,9 +21,14 @@ private:
 	unsigned int m_planeVAO = 0;
 	unsigned int m_transparentVAO = 0;
 
-	unsigned int m_cubeTexture = 0;
-	unsigned int m_floorTexture = 0;
-	unsigned int m_transparentTexture = 0;
+	TextureArray m_textures;
+	int m_cubeLayer = 0;
+	int m_floorLayer = 0;
+	int m_transparentLayer = 0;
 
+	// laid out by resources\scenes\blending.scene
+	SceneFile m_sceneFile;
+	std::vector<glm::mat4> m_cubeModels;
+	std::vector<glm::mat4> m_floorModels;
 	std::vector<glm::vec3> windowsPos;
 };
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <Frustum.h>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+// Node of the flattened tree, 32 bytes. Nodes are stored depth first: an interior node's left child is
+// the next node and rightOrFirst is its right child, a leaf's primitives are count entries from
+// rightOrFirst in the leaf order array.
+struct BvhNode
+{
+	glm::vec3 boundsMin;
+	unsigned int rightOrFirst;
+	glm::vec3 boundsMax;
+	unsigned int count;	// 0 for interior nodes
+};
+
+struct BvhRayHit
+{
+	unsigned int primitive = 0;
+	float distance = 0.0f;	// in units of the ray direction's length
+};
+
+// Bounding volume hierarchy over axis aligned boxes, built top down with a binned surface area
+// heuristic. The tree keeps the primitive indices of the caller: moving primitives only need a Refit,
+// which keeps the topology and recomputes the bounds, until they moved so far that a new Build pays off.
+class Bvh
+{
+public:
+	static const unsigned int MAX_LEAF_PRIMITIVES = 4;
+	// deeper nodes become leaves whatever their size, it bounds the traversal stacks
+	static const unsigned int MAX_DEPTH = 48;
+
+	Bvh();
+
+	void Build(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax);
+	// same primitives, new boxes
+	void Refit(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax);
+
+	// primitives whose box touches the frustum, in no particular order
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& outPrimitives) const;
+	// primitives whose box the ray crosses before maxDistance
+	void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<unsigned int>& outPrimitives) const;
+	// closest primitive box along the ray
+	bool RaycastNearest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& outHit) const;
+	// closest primitive along the ray for an exact test: intersect(primitive, distance) returns true and
+	// lowers distance when the primitive is hit closer than it, the boxes only prune the traversal
+	template<typename Intersect>
+	bool RaycastNearest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Intersect intersect, BvhRayHit& outHit) const;
+
+	size_t GetPrimitiveCount() const { return m_boxMin.size(); }
+	const std::vector<BvhNode>& GetNodes() const { return m_nodes; }
+	unsigned int GetDepth() const { return m_depth; }
+
+	// slab test, outDistance is where the ray enters the box (0 when it starts inside)
+	static bool IntersectRayBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boxMin, const glm::vec3& boxMax,
+		float maxDistance, float& outDistance);
+	// box around a transformed box
+	static void TransformBox(const glm::mat4& transform, const glm::vec3& boxMin, const glm::vec3& boxMax, glm::vec3& outMin, glm::vec3& outMax);
+
+private:
+	unsigned int BuildNode(unsigned int first, unsigned int count, unsigned int depth, std::vector<glm::vec3>& centroids);
+	void UpdateBounds(BvhNode& node, unsigned int index) const;
+
+	std::vector<BvhNode> m_nodes;
+	std::vector<unsigned int> m_primitives;	// leaf order
+	std::vector<glm::vec3> m_boxMin;		// per primitive, in the caller's order
+	std::vector<glm::vec3> m_boxMax;
+	unsigned int m_depth = 0;
+};
+
+// Hierarchy over the triangles of an indexed mesh, for ray picking against the exact geometry
+class TriangleBvh
+{
+public:
+	TriangleBvh();
+
+	void Build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+	// the vertices moved, the triangles stay the same
+	void Refit(const std::vector<glm::vec3>& positions);
+
+	// hit.primitive is the triangle, indices[3 * primitive] its first index
+	bool RaycastNearest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& outHit) const;
+
+	bool IsBuilt() const { return !m_triangles.empty(); }
+	size_t GetTriangleCount() const { return m_triangles.size(); }
+	const Bvh& GetBvh() const { return m_bvh; }
+
+private:
+	// first vertex and the two edges from it, what the ray test needs
+	struct Triangle
+	{
+		glm::vec3 vertex;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	void SetupTriangles(const std::vector<glm::vec3>& positions, std::vector<glm::vec3>& outMin, std::vector<glm::vec3>& outMax);
+
+	Bvh m_bvh;
+	std::vector<unsigned int> m_indices;
+	std::vector<Triangle> m_triangles;
+};
+
+template<typename Intersect>
+bool Bvh::RaycastNearest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Intersect intersect, BvhRayHit& outHit) const
+{
+	float distance;
+	glm::vec3 inverseDirection = 1.0f / direction;
+	if (m_nodes.empty() || !IntersectRayBox(origin, inverseDirection, m_nodes[0].boundsMin, m_nodes[0].boundsMax, maxDistance, distance))
+		return false;
+
+	// the farther child waits on the stack with its entry distance, skipped once something closer was hit
+	unsigned int stack[MAX_DEPTH + 1];
+	float stackDistances[MAX_DEPTH + 1];
+	int stackSize = 0;
+	unsigned int nodeIndex = 0;
+	float nearest = maxDistance;
+	bool hit = false;
+	while (true)
+	{
+		const BvhNode& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++)
+			{
+				if (intersect(m_primitives[i], nearest))
+				{
+					outHit.primitive = m_primitives[i];
+					hit = true;
+				}
+			}
+		}
+		else
+		{
+			unsigned int left = nodeIndex + 1;
+			unsigned int right = node.rightOrFirst;
+			float leftDistance, rightDistance;
+			bool hitLeft = IntersectRayBox(origin, inverseDirection, m_nodes[left].boundsMin, m_nodes[left].boundsMax, nearest, leftDistance);
+			bool hitRight = IntersectRayBox(origin, inverseDirection, m_nodes[right].boundsMin, m_nodes[right].boundsMax, nearest, rightDistance);
+			if (hitLeft && hitRight)
+			{
+				if (rightDistance < leftDistance)
+				{
+					std::swap(left, right);
+					std::swap(leftDistance, rightDistance);
+				}
+				stack[stackSize] = right;
+				stackDistances[stackSize++] = rightDistance;
+				nodeIndex = left;
+				continue;
+			}
+			if (hitLeft || hitRight)
+			{
+				nodeIndex = hitLeft ? left : right;
+				continue;
+			}
+		}
+
+		while (stackSize > 0 && stackDistances[stackSize - 1] >= nearest)
+			stackSize--;
+		if (stackSize == 0)
+			break;
+		nodeIndex = stack[--stackSize];
+	}
+
+	outHit.distance = nearest;
+	return hit;
+}
@@ -19,6 +19,7 @@ const float PITCH = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ASPECT_RATIO = 800.0f / 600.0f;
 
 // Custom option
 const float FPS_MODE = false;
@@ -40,9 +41,11 @@ public:
     float MovementSpeed;
     float MouseSensitivity;
     float Zoom;
+    // width over height of the viewport, kept up to date by the main loop
+    float AspectRatio;
 
     // constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), AspectRatio(ASPECT_RATIO)
     {
         Position = position;
         WorldUp = up;
@@ -51,7 +54,7 @@ public:
         updateCameraVectors();
     }
     // constructor with scalar values
-    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), AspectRatio(ASPECT_RATIO)
     {
         Position = glm::vec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
@@ -60,22 +63,8 @@ public:
         updateCameraVectors();
     }
 
-    // copy constructor
-    Camera(const Camera& copy)
-    {
-        Position = copy.Position;
-        Front = copy.Front;
-        Up = copy.Up;
-        Right = copy.Right;
-        WorldUp = copy.WorldUp;
-
-        Yaw = copy.Yaw;
-        Pitch = copy.Pitch;
-
-        MovementSpeed = copy.MovementSpeed;
-        MouseSensitivity = copy.MouseSensitivity;
-        Zoom = copy.Zoom;
-    }
+    Camera(const Camera&) = default;
+    Camera& operator=(const Camera&) = default;
 
     glm::mat4 CustomLookAt(const glm::vec3& pos, const glm::vec3& target, const glm::vec3& up) const
     {
@@ -109,7 +98,18 @@ public:
 
     glm::mat4 GetPerspectiveProj() const
     {
-        return glm::perspective(glm::radians(Zoom), 800.0f / 600.0f, 0.1f, 100.f);
+        return glm::perspective(glm::radians(Zoom), AspectRatio, 0.1f, 100.f);
+    }
+
+    // radius in pixels of a world-space sphere once projected, meshes pick their LOD from it
+    float GetProjectedSphereRadius(const glm::vec3& center, float radius, float viewportHeight = 600.0f) const
+    {
+        float distanceSq = glm::dot(center - Position, center - Position);
+        if (distanceSq <= radius * radius)
+            return viewportHeight;
+
+        float projScale = 0.5f * viewportHeight / tan(glm::radians(Zoom) * 0.5f);
+        return radius * projScale / sqrt(distanceSq - radius * radius);
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Shader.h>
+#include <Camera.h>
+#include <glm/glm.hpp>
+
+// Directional light shadows split in cascades along the camera's view distance.
+// Static casters are rendered into a cache layer that's only redrawn when its cascade moves, the light
+// changes or the static set is invalidated; each frame the cache is copied into the sampled map and the
+// dynamic casters are drawn on top. Cascades are fitted with bounding spheres, whose radius rotating the
+// camera doesn't change; their centers follow the view direction but snap to a coarse grid, so moving or
+// turning the camera only invalidates a cascade once its center crosses a grid cell.
+class CascadedShadowMap
+{
+public:
+	static const int CASCADE_COUNT = 3;
+	// texture unit the shadow map is bound to by Bind, kept away from the material textures
+	static const int TEXTURE_UNIT = 3;
+
+	CascadedShadowMap();
+	void Setup(int resolution, float shadowDistance);
+
+	// bounds of every caster, they decide the depth range of the light projections
+	void SetSceneBounds(const glm::vec3& center, float radius);
+	void SetLightDirection(const glm::vec3& direction);
+	// call when a static caster moved, was added or removed
+	void InvalidateStatic();
+
+	// without caching the static casters are drawn every frame, for comparison
+	void SetCachingEnabled(bool enabled);
+	bool IsCachingEnabled() const { return m_cachingEnabled; }
+
+	// fits the cascades to the camera, call once per frame before the passes
+	void Update(const Camera& camera);
+
+	// Binds the target for the static casters of a cascade, returns false when its cache is still valid
+	// and nothing needs to be drawn
+	bool BeginStaticPass(int cascade);
+	// Binds the sampled map of a cascade with the static casters already in it, draw the dynamic ones after
+	void BeginDynamicPass(int cascade);
+	void EndPasses();
+
+	const glm::mat4& GetLightSpaceMatrix(int cascade) const { return m_lightSpaceMatrices[cascade]; }
+	int GetStaticRenderCount() const { return m_staticRenderCount; }
+
+	// sets the shadow uniforms of litShader and binds the map on TEXTURE_UNIT
+	void Bind(Shader& shader) const;
+
+private:
+	static unsigned int CreateDepthArray(int resolution);
+	void AttachLayer(unsigned int framebuffer, unsigned int texture, int cascade);
+
+	int m_resolution = 0;
+	float m_shadowDistance = 0.0f;
+	bool m_cachingEnabled = true;
+
+	glm::vec3 m_sceneCenter = glm::vec3(0.0f);
+	float m_sceneRadius = 1.0f;
+	glm::vec3 m_lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::mat4 m_lightView = glm::mat4(1.0f);
+
+	float m_splits[CASCADE_COUNT] = {};
+	glm::mat4 m_lightSpaceMatrices[CASCADE_COUNT];
+	// projection the static layer was rendered with, the cache is valid while it matches
+	glm::mat4 m_cachedMatrices[CASCADE_COUNT];
+	bool m_cacheValid[CASCADE_COUNT] = {};
+	int m_staticRenderCount = 0;
+
+	unsigned int m_framebuffer = 0;
+	unsigned int m_cacheFramebuffer = 0;
+	unsigned int m_shadowMap = 0;
+	unsigned int m_staticCache = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Shader.h>
+#include <Camera.h>
+#include <ICustomScene.h>
+#include <HiZBuffer.h>
+#include <OcclusionCuller.h>
+#include <OcclusionRasterizer.h>
+#include <GpuTimer.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Occlusion culling stress scene: a grid of a few thousand buildings drawn with one instanced call per
+// culling phase, where from street level most of them are hidden behind the closest blocks. Culling runs
+// either on the GPU against a Hi-Z pyramid of the scene's own depth, or on the CPU with the closest
+// buildings rasterized as occluders before anything is submitted.
+class CityScene : public ICustomScene
+{
+public:
+	enum CullingMode
+	{
+		CULLING_NONE,
+		CULLING_GPU,
+		CULLING_CPU,
+		CULLING_MODE_COUNT
+	};
+
+	CityScene();
+	virtual void Setup() override;
+	virtual void Draw(const Camera& camera) override;
+
+	// O cycles the culling mode (none, GPU Hi-Z, CPU rasterizer), P prints how many objects passed the
+	// last test, B times the scene pass in each mode
+	virtual void OnKeyPressed(int key) override;
+
+private:
+	void SetupCity();
+	void SetupFramebuffer();
+	// reallocates the offscreen target and the Hi-Z pyramid to the viewport's size
+	void ResizeFramebuffer(int width, int height);
+	void DrawBuildings(const glm::mat4& viewProj, int cullPhase);
+	void CullOnCpu(const Camera& camera, const glm::mat4& viewProj);
+	void SetCullingMode(CullingMode mode);
+	void UpdateBenchmark();
+
+	Shader m_cityShader;
+	unsigned int m_cubeVAO = 0;
+	unsigned int m_instanceVBO = 0;
+	size_t m_objectCount = 0;
+
+	// CPU side copies for the software rasterizer, instance 0 is the ground
+	std::vector<glm::mat4> m_models;
+	std::vector<glm::vec3> m_boxMin;
+	std::vector<glm::vec3> m_boxMax;
+
+	unsigned int m_framebuffer = 0;
+	unsigned int m_colorbuffer = 0;
+	unsigned int m_depthbuffer = 0;
+	int m_width = 0;
+	int m_height = 0;
+
+	HiZBuffer m_hiZ;
+	OcclusionCuller m_culler;
+	OcclusionRasterizer m_rasterizer;
+	std::vector<unsigned char> m_cpuVisibility;
+	std::vector<size_t> m_occluders;
+	float m_cpuCullMs = 0.0f;
+	CullingMode m_cullingMode = CULLING_GPU;
+
+	GpuTimer m_frameTimer;
+	int m_benchmarkFrame = -1;	// -1 when no benchmark is running
+	float m_benchmarkResults[CULLING_MODE_COUNT] = {};
+	float m_benchmarkCpuMs = 0.0f;
+	unsigned int m_benchmarkVisible[CULLING_MODE_COUNT] = {};
+};
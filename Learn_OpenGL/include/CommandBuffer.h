@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Shader.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+// CPU side recording of GL calls: every command is a header word (type and size) followed by its
+// arguments in a flat stream of words, so recording is a few copies that any thread can do, and only
+// Execute, on the GL thread, calls into the driver. Uniforms are set by location since looking one up
+// is a GL call. Clear keeps the storage, a buffer recorded every frame stops allocating after the first
+class CommandBuffer
+{
+public:
+	void Clear();
+	bool IsEmpty() const { return m_words.empty(); }
+	size_t GetCommandCount() const { return m_commandCount; }
+	size_t GetSize() const { return m_words.size() * sizeof(unsigned int); }
+
+	void BindVertexArray(unsigned int vao);
+	void UseProgram(unsigned int program);
+	void BindTexture(unsigned int unit, GLenum target, unsigned int texture);
+
+	void SetInt(int location, int value);
+	void SetFloat(int location, float value);
+	void SetVec3(int location, const glm::vec3& value);
+	void SetMat3(int location, const glm::mat3& value);
+	void SetMat4(int location, const glm::mat4& value);
+	// the three matrices of Shader::SetObjectMatrices as a single command
+	void SetObjectMatrices(const ObjectMatrixLocations& locations, const glm::mat4& model, const glm::mat4& mvp, const glm::mat3& normalMatrix);
+
+	void DrawArrays(GLenum mode, int first, int count);
+	void DrawElements(GLenum mode, int count, GLenum type, unsigned int offset);
+
+	// GL thread only; binds that repeat the previous one are skipped
+	void Execute() const;
+
+	// Records [0, count) into one buffer per batch of batchSize objects (0 spreads them over the
+	// JobSystem threads) with record(buffer, begin, end) running on the workers; the ranges are disjoint
+	// so no buffer is shared. Replaying the buffers in order gives the same stream as a single recording
+	static void RecordParallel(std::vector<CommandBuffer>& buffers, size_t count, size_t batchSize,
+		const std::function<void(CommandBuffer&, size_t, size_t)>& record);
+	static void ExecuteAll(const std::vector<CommandBuffer>& buffers);
+
+private:
+	enum class CommandType : unsigned int
+	{
+		BIND_VERTEX_ARRAY,
+		USE_PROGRAM,
+		BIND_TEXTURE,
+		SET_INT,
+		SET_FLOAT,
+		SET_VEC3,
+		SET_MAT3,
+		SET_MAT4,
+		SET_OBJECT_MATRICES,
+		DRAW_ARRAYS,
+		DRAW_ELEMENTS
+	};
+
+	// what the replay last bound, shared by the buffers of one ExecuteAll
+	struct ReplayState;
+
+	void Replay(ReplayState& state) const;
+	// appends the header and returns where the argumentWords arguments go
+	unsigned int* Append(CommandType type, size_t argumentWords);
+	static unsigned int* WriteFloats(unsigned int* out, const float* values, size_t count);
+
+	std::vector<unsigned int> m_words;
+	size_t m_commandCount = 0;
+};
@@ -4,6 +4,7 @@
 #include <Camera.h>
 #include <vector>
 #include <ICustomScene.h>
+#include <ReflectionProbe.h>
 
 class CubemapScene : public ICustomScene
 {
@@ -12,11 +13,21 @@ public:
 	virtual void Setup() override;
 	virtual void Draw(const Camera& camera) override;
 
+	// +/- change how many probe faces are re-rendered per frame
+	virtual void OnKeyPressed(int key) override;
+
+	// skybox faces from resources/textures/skybox, shared with the scenes that reflect it
+	static unsigned int LoadSkybox();
+	static unsigned int LoadCubemap(const std::vector<std::string>& faces);
+
 private:
 	void SetupFramebuffer();
-	unsigned int LoadCubemap(const std::vector<std::string>& faces);
 	void DrawScreenQuad(Shader& shader, unsigned int quadVAO, unsigned int texture);
-	void DrawCubes(Shader& shader, unsigned int cubeVAO, unsigned int cubeTexture);
+	void DrawCubes(Shader& shader, unsigned int cubeVAO, unsigned int cubeTexture, const glm::mat4& viewProj);
+	void DrawOrbiter(const glm::mat4& view, const glm::mat4& projection);
+	// re-renders the faces of each probe due this frame, a probe sees everything but its own cube
+	void UpdateProbes();
+	glm::mat4 GetOrbiterModel() const;
 	void DrawSkybox(Shader& shader, unsigned int skyboxVAO, unsigned int cubemapTexture, const Camera& camera);
 
 private:
@@ -24,6 +35,8 @@ private:
 	Shader m_screenShader;
 	Shader m_borderShader;
 	Shader m_skyboxShader;
+	Shader m_texturedShader;
+	Shader m_probeShader;
 
 	unsigned int m_cubeVAO = 0;
 	unsigned int m_planeVAO = 0;
@@ -31,6 +44,11 @@ private:
 	unsigned int m_screenQuadVAO = 0;
 	unsigned int m_skyboxVAO = 0;
 	unsigned int m_cubeReflectionVAO = 0;
+	unsigned int m_texturedCubeVAO = 0;
+
+	// one probe per reflective cube, centered on it
+	std::vector<glm::vec3> m_reflectiveCubePositions;
+	std::vector<ReflectionProbe> m_probes;
 
 	unsigned int m_cubeTexture = 0;
 	unsigned int m_cubemapTexture = 0;
@@ -9,6 +9,9 @@
 #include <MirrorFramebufferScene.h>
 #include <CubemapScene.h>
 #include <TestScene.h>
+#include <CityScene.h>
+#include <FileScene.h>
+#include <StressScene.h>
 #include <memory>
 
 enum CustomSceneType
@@ -21,7 +24,9 @@ enum CustomSceneType
 	FRAMEBUFFER_SCENE,
 	MIRRORFRAMEBUFFER_SCENE,
 	CUBEMAP_SCENE,
-	TEST_SCENE
+	TEST_SCENE,
+	CITY_SCENE,
+	STRESS_SCENE
 };
 
 class CustomSceneBuilder
@@ -47,8 +52,24 @@ public:
 				return std::shared_ptr<CubemapScene>(new CubemapScene);
 			case CustomSceneType::TEST_SCENE:
 				return std::shared_ptr<TestScene>(new TestScene);
+			case CustomSceneType::CITY_SCENE:
+				return std::shared_ptr<CityScene>(new CityScene);
+			case CustomSceneType::STRESS_SCENE:
+				return std::shared_ptr<StressScene>(new StressScene);
 			default:
 				return std::shared_ptr<ICustomScene>();
 		}
 	}
+
+	// generic scene laid out by a ".scene" file (or its compiled ".sceneb")
+	static std::shared_ptr<ICustomScene> BuildSceneFromFile(const std::string& path)
+	{
+		return std::shared_ptr<FileScene>(new FileScene(path));
+	}
+
+	// generated scene of the given size, see StressScene
+	static std::shared_ptr<ICustomScene> BuildStressScene(const StressSceneSettings& settings)
+	{
+		return std::shared_ptr<StressScene>(new StressScene(settings));
+	}
 };
\ No newline at end of file
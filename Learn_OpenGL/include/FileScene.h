@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Shader.h>
+#include <Camera.h>
+#include <ICustomScene.h>
+#include <SceneFile.h>
+#include <Model.h>
+#include <TextureArray.h>
+#include <TransformBatch.h>
+#include <Bvh.h>
+#include <StreamBuffer.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Generic scene drawn from a SceneFile: cubes and models go through the lit shader with the file's
+// lights (the first directional and spot lights, and the four point lights closest to the camera),
+// planes and quads are unlit and the quads are blended back to front. Entities sharing a mesh and a
+// material are drawn together, those outside the view are culled with a BVH over the entity boxes.
+// Culling, the light selection, the quad sort and the matrices run in Update, Render only draws the
+// snapshot, so the render thread gets none of that work. Cube groups are drawn instanced, their
+// matrices streamed through a StreamBuffer every frame instead of set as uniforms one object at a time.
+class FileScene : public ICustomScene
+{
+public:
+	FileScene(const std::string& path);
+	// a scene built in code, name only shows up in the messages
+	FileScene(const SceneData& scene, const std::string& name);
+	// releases the GL objects, so it runs on the GL thread like Setup
+	virtual ~FileScene();
+	virtual void Setup() override;
+	// Update and Render back to back
+	virtual void Draw(const Camera& camera) override;
+	virtual bool HasUpdate() const override { return true; }
+	virtual void Update(FrameSnapshot& snapshot) override;
+	virtual void Render(const FrameSnapshot& snapshot) override;
+	// goes to the file's first camera
+	virtual void SetupCamera(Camera& camera) override;
+
+	// P prints what was loaded and how long it took, C toggles the culling, K picks the entity in the
+	// middle of the screen, I toggles the instanced cubes
+	virtual void OnKeyPressed(int key) override;
+
+	// entity whose geometry the ray hits first, -1 when there is none
+	int Pick(const glm::vec3& origin, const glm::vec3& direction, float& outDistance);
+
+	// mesh space box of the built-in shapes, models get the unit cube's
+	static void GetShapeBox(unsigned int meshType, glm::vec3& outMin, glm::vec3& outMax);
+
+	const SceneFile& GetScene() const { return m_scene; }
+
+private:
+	struct DrawGroup
+	{
+		unsigned int mesh;
+		unsigned int material;
+		std::vector<unsigned int> entities;
+		TransformBatch transforms;
+	};
+
+	void SetupMaterials();
+	void SetupLights();
+	// indices in m_pointLights of the ones the shader gets
+	void SelectPointLights(const glm::vec3& viewPos, std::vector<unsigned int>& outLights) const;
+	void ApplyPointLights(const std::vector<unsigned int>& lights);
+	void SetupGroups();
+	void SetupBvh();
+	void GetLocalBox(unsigned int entity, glm::vec3& outMin, glm::vec3& outMax) const;
+	void CullEntities(const glm::mat4& viewProj);
+	void AddDrawList(FrameSnapshot& snapshot, unsigned int batch, const std::vector<unsigned int>& entities,
+		const TransformBatch* transforms, bool withMVP) const;
+	void DrawLitGroups(const FrameSnapshot& snapshot);
+	// false when the stream is full, the cubes are then drawn one by one
+	bool DrawCubesInstanced(const SnapshotObject* objects, unsigned int count);
+	void SetInstanceAttributes(size_t offset);
+	void DrawPlanes(const FrameSnapshot& snapshot);
+	void DrawQuads(const FrameSnapshot& snapshot);
+	void SelectMaterial(Shader& shader, unsigned int material, bool lit) const;
+
+	std::string m_path;
+	std::vector<unsigned char> m_bytes;	// the scene built in code, until Setup loads it
+	SceneFile m_scene;
+	float m_loadMs = 0.0f;
+
+	Shader m_litShader;
+	Shader m_unlitShader;
+	TextureArray m_textures;
+	std::vector<int> m_diffuseLayers;	// per material
+	std::vector<int> m_specularLayers;
+
+	unsigned int m_cubeVAO = 0;
+	unsigned int m_instancedCubeVAO = 0;	// the cube's attributes and the per instance ones of the stream
+	unsigned int m_planeVAO = 0;
+	unsigned int m_quadVAO = 0;
+	std::vector<std::unique_ptr<Model>> m_models;	// per mesh, null for the built-in shapes
+
+	std::vector<const SceneLight*> m_pointLights;
+
+	std::vector<DrawGroup> m_groups;
+	std::vector<unsigned int> m_quads;	// entities, sorted every frame
+
+	// update side
+	Bvh m_bvh;
+	bool m_cullingEnabled = true;
+	bool m_instancingEnabled = true;	// goes to the render thread with the snapshot's renderFlags
+	std::vector<unsigned char> m_entityVisible;
+	std::vector<unsigned int> m_visibleEntities;
+	size_t m_drawnEntityCount = 0;
+	glm::vec3 m_viewPos = glm::vec3(0.0f);
+	glm::vec3 m_viewFront = glm::vec3(0.0f, 0.0f, -1.0f);
+	FrameSnapshot m_drawSnapshot;	// Draw's, the render thread brings its own
+	// copied from the stream by Setup for P, the stream itself is the render thread's
+	bool m_instanceStreamPersistent = false;
+	size_t m_instanceStreamSize = 0;
+
+	// render side
+	StreamBuffer m_instanceStream;
+	std::vector<unsigned int> m_closestPointLights;	// the ones in the shader
+	std::vector<ModelLodState> m_modelLods;	// per entity, only the models' are used
+	MeshletStats m_modelStats;
+};
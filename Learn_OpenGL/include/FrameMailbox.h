@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+// Triple buffer between one producer and one consumer. The producer writes its own slot while the
+// consumer reads its own, publishing or taking a snapshot only swaps indices with the third slot, so
+// neither side ever copies a snapshot or waits on the other to finish with one. A snapshot that is
+// published before the previous one was taken replaces it, the consumer always gets the latest
+template<typename T>
+class FrameMailbox
+{
+public:
+	FrameMailbox() : m_write(0), m_ready(1), m_read(2) {}
+
+	// only the producer touches this slot until it publishes it
+	T& GetWriteSlot() { return m_slots[m_write]; }
+
+	void Publish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::swap(m_write, m_ready);
+			m_hasNew = true;
+		}
+		m_condition.notify_all();
+	}
+
+	// blocks until the last published snapshot was taken, the producer paces itself on the consumer
+	// with it instead of building frames nobody will see
+	void WaitUntilTaken()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait(lock, [this]() { return !m_hasNew || m_closed; });
+	}
+
+	// blocks until there is a snapshot the consumer hasn't seen yet, nullptr once the mailbox is closed.
+	// The snapshot stays valid until the next Take
+	const T* Take()
+	{
+		const T* snapshot = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_hasNew || m_closed; });
+			if (m_closed)
+				return nullptr;
+
+			std::swap(m_read, m_ready);
+			m_hasNew = false;
+			snapshot = &m_slots[m_read];
+		}
+		m_condition.notify_all();
+		return snapshot;
+	}
+
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+		}
+		m_condition.notify_all();
+	}
+
+private:
+	FrameMailbox(const FrameMailbox&) = delete;
+	FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+	T m_slots[3];
+	int m_write;
+	int m_ready;
+	int m_read;
+	bool m_hasNew = false;
+	bool m_closed = false;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Camera.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// One object of a snapshot draw list, with the matrices the lit shader needs already computed
+struct SnapshotObject
+{
+	glm::mat4 model;
+	glm::mat4 mvp;
+	glm::mat3 normalMatrix;
+	unsigned int entity;
+};
+
+// A run of snapshot objects drawn with the same state, batch is whatever the scene groups them by
+struct SnapshotDrawList
+{
+	unsigned int batch;
+	unsigned int first;
+	unsigned int count;
+};
+
+// Everything the render thread needs to draw a frame. The update thread fills it and doesn't touch it
+// again once it is published; the mailbox reuses its slots, so the vectors keep their capacity from one
+// frame to the next
+struct FrameSnapshot
+{
+	unsigned long long frame = 0;
+	float time = 0.0f;
+	float deltaTime = 0.0f;
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+
+	Camera camera;
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+
+	// pressed since the previous snapshot, for the scenes that handle them on the render thread
+	std::vector<int> keys;
+
+	// filled by the scene's Update; renderFlags are switches for its Render, what they mean is up to the scene
+	unsigned int renderFlags = 0;
+	std::vector<SnapshotObject> objects;
+	std::vector<SnapshotDrawList> drawLists;
+	std::vector<unsigned int> lights;
+};
@@ -4,6 +4,7 @@
 #include <Camera.h>
 #include <vector>
 #include <ICustomScene.h>
+#include <PostProcessStack.h>
 
 class FramebufferScene : public ICustomScene
 {
@@ -12,20 +13,27 @@ public:
 	virtual void Setup() override;
 	virtual void Draw(const Camera& camera) override;
 
+	// 1-4 toggle the blur/edge detect/grayscale/sharpen passes, +/- change the blur radius
+	virtual void OnKeyPressed(int key) override;
+
 private:
 	void SetupFramebuffer();
+	// (re)allocates the attachments, the offscreen frame follows the window's viewport
+	void ResizeFramebuffer(int width, int height);
 
 private:
 	Shader m_shader;
-	Shader m_screenShader;
+	PostProcessStack m_postProcess;
 
 	unsigned int m_cubeVAO = 0;
 	unsigned int m_planeVAO = 0;
-	unsigned int m_quadVAO = 0;
 
 	unsigned int m_cubeTexture = 0;
 	unsigned int m_floorTexture = 0;
 
 	unsigned int m_framebuffer = 0;
 	unsigned int m_textureColorbuffer = 0;
+	unsigned int m_renderbuffer = 0;
+	int m_width = 0;
+	int m_height = 0;
 };
\ No newline at end of file
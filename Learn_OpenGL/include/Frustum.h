@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward-facing planes (xyz normal, w distance) extracted from a view-projection matrix
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	// ndcMin/ndcMax narrow the side planes to a sub-rectangle of the screen, e.g. the part a mirror covers
+	static Frustum FromMatrix(const glm::mat4& viewProj, const glm::vec2& ndcMin = glm::vec2(-1.0f), const glm::vec2& ndcMax = glm::vec2(1.0f));
+
+	bool IntersectsSphere(const glm::vec3& center, float radius) const;
+};
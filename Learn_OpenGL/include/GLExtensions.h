@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+typedef void (APIENTRYP PFNTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP PFNBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// GL_ARB_buffer_storage flags, glad's 3.3 header doesn't have them
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+// Optional entry points above the 3.3 core profile glad was generated for. They stay null when the
+// driver doesn't expose the extension, callers keep a 3.3 code path for that case
+class GLExtensions
+{
+public:
+	// call once the context is current, right after gladLoadGLLoader
+	static void Load(GLADloadproc loader);
+	static bool HasExtension(const char* name);
+
+	// GL_ARB_texture_storage (core in 4.2): immutable textures, every level allocated at once
+	static PFNTEXSTORAGE2DPROC TexStorage2D;
+	// GL_ARB_buffer_storage (core in 4.4): immutable buffers that can stay mapped while the GPU reads them
+	static PFNBUFFERSTORAGEPROC BufferStorage;
+
+private:
+	static std::vector<std::string> s_extensions;
+	static bool s_extensionsRead;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Measures the GPU time spent between Begin and End with GL_TIME_ELAPSED queries. Each query is read
+// back a few frames after it was issued so the CPU doesn't wait on the GPU. Timers can't be nested.
+class GpuTimer
+{
+public:
+	void Begin();
+	void End();
+
+	// average of the samples collected since the last Reset, in milliseconds
+	float GetAverageMs() const { return m_sampleCount > 0 ? (float)(m_totalMs / m_sampleCount) : 0.0f; }
+	int GetSampleCount() const { return m_sampleCount; }
+	void Reset();
+
+private:
+	void CollectResult(int index);
+
+	static const int QUERY_COUNT = 4;
+
+	unsigned int m_queries[QUERY_COUNT] = {};
+	bool m_pending[QUERY_COUNT] = {};
+	int m_current = 0;
+
+	double m_totalMs = 0.0;
+	int m_sampleCount = 0;
+};
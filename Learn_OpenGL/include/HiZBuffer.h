@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Shader.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Hierarchical depth buffer: level 0 is a copy of a depth texture and every following level keeps the
+// farthest depth of the texels it covers, so a single fetch at the right level tells whether anything
+// in a screen rectangle is nearer than a given depth. The levels are reduced with fragment passes.
+class HiZBuffer
+{
+public:
+	HiZBuffer();
+	void Setup(int width, int height);
+	// reallocates the pyramid for a new depth size, a no-op when it doesn't change
+	void Resize(int width, int height);
+
+	// leaves its own framebuffer bound, the caller restores its target and viewport
+	void Build(unsigned int depthTexture);
+
+	unsigned int GetTexture() const { return m_texture; }
+	int GetMipCount() const { return (int)m_mipSizes.size(); }
+	int GetWidth() const { return m_mipSizes.empty() ? 0 : m_mipSizes[0].x; }
+	int GetHeight() const { return m_mipSizes.empty() ? 0 : m_mipSizes[0].y; }
+
+private:
+	Shader m_copyShader;
+	Shader m_reduceShader;
+
+	unsigned int m_texture = 0;
+	unsigned int m_framebuffer = 0;
+	unsigned int m_quadVAO = 0;
+	std::vector<glm::ivec2> m_mipSizes;
+};
@@ -1,10 +1,26 @@
 #pragma once
 
 #include <Camera.h>
+#include <FrameSnapshot.h>
 
 class ICustomScene
 {
 public:
+	virtual ~ICustomScene() {}
 	virtual void Setup() = 0;
 	virtual void Draw(const Camera& camera) = 0;
+
+	// called once per key press (GLFW key code), scenes override it to expose runtime settings
+	virtual void OnKeyPressed(int /*key*/) {}
+
+	// called once after Setup, scenes with their own viewpoint move the camera there
+	virtual void SetupCamera(Camera& /*camera*/) {}
+
+	// With the render thread a frame is split in two. Scenes that return true here do their CPU work in
+	// Update, on the update thread and without GL calls, and draw the snapshot it filled in Render; they
+	// also get OnKeyPressed on the update thread. Every call of the other scenes, keys included, happens
+	// on the render thread and Render just draws the snapshot's camera
+	virtual bool HasUpdate() const { return false; }
+	virtual void Update(FrameSnapshot& /*snapshot*/) {}
+	virtual void Render(const FrameSnapshot& snapshot) { Draw(snapshot.camera); }
 };
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+// Settings of a "Learn_OpenGL.exe bench-jobs [--threads N] [--jobs N]" run
+struct JobBenchmarkOptions
+{
+	unsigned int maxThreads = 0;	// the scaling test goes from 1 to this many threads, 0 = hardware concurrency
+	unsigned int jobCount = 100000;	// empty jobs of the spawn test
+};
+
+// Microbenchmarks of the JobSystem: the cost of an empty job next to a std::thread and a std::async,
+// nested spawning that only stealing spreads, and the speedup of a ParallelFor and of recording draws in
+// CommandBuffers from one thread to all of them. Results are printed as CSV
+class JobBenchmark
+{
+public:
+	// args are the command line arguments following "bench-jobs"; returns the process exit code
+	static int Run(int argc, char** argv);
+	static int Run(const JobBenchmarkOptions& options);
+
+private:
+	static void BenchmarkSpawn(unsigned int jobCount);
+	static void BenchmarkNested();
+	static void BenchmarkScaling(unsigned int maxThreads);
+	static void BenchmarkCommandRecording(unsigned int maxThreads);
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the jobs started with it that haven't finished yet. Jobs queued with RunAfter start once it
+// drops to zero, that is how jobs depend on each other. A counter must outlive its jobs: Wait on it
+// before it goes out of scope.
+class JobCounter
+{
+public:
+	JobCounter() : m_pending(0) {}
+
+	bool IsDone() const { return m_pending.load() == 0; }
+
+private:
+	friend class JobSystem;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	std::atomic<int> m_pending;
+	std::mutex m_mutex;
+	std::vector<std::pair<std::function<void()>, JobCounter*>> m_continuations;
+};
+
+// Work-stealing job system shared by the engine. Every worker owns a deque: it pushes and pops its own
+// jobs at the back, so the most recent (and cache-warm) job runs first, while idle workers steal the
+// oldest ones from the front of the others. Threads outside the pool (the GL thread) push to a deque of
+// their own and run jobs too while they Wait, so nothing blocks as long as there is work left; with no
+// worker threads at all (a single core) every job simply runs in Wait.
+// Jobs must not make GL calls, only the GL thread has a context.
+class JobSystem
+{
+public:
+	// threadCount includes the calling thread, 0 is one per core and 1 runs every job in Wait; called on
+	// first use otherwise
+	static void Setup(unsigned int threadCount = 0);
+	// joins the workers, to call before main returns: static destruction can't stop them
+	static void Shutdown();
+
+	// worker threads, without the threads that only Wait
+	static unsigned int GetWorkerCount();
+
+	static void Run(JobCounter& counter, std::function<void()> job);
+	// job starts once dependency is done, counter covers it from now on
+	static void RunAfter(JobCounter& dependency, JobCounter& counter, std::function<void()> job);
+	// runs other jobs until the counter's are all finished; jobs can Wait on the jobs they started
+	static void Wait(JobCounter& counter);
+
+	// job(begin, end) over [0, count) in batches of batchSize (0 spreads them over the workers), returns
+	// once every batch is done
+	static void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& job);
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	// the queue of one thread, a spin lock is enough since it is only held for a push or a pop
+	struct WorkQueue
+	{
+		std::atomic_flag lock = ATOMIC_FLAG_INIT;
+		std::deque<Job> jobs;
+	};
+
+	static void EnsureSetup();
+	static void Submit(Job job);
+	static bool RunOneJob(unsigned int queue);
+	static bool PopOrSteal(unsigned int queue, Job& outJob);
+	static void FinishJob(JobCounter& counter);
+	static void WorkerLoop(unsigned int queue);
+	static unsigned int GetThreadQueue();
+
+	static std::vector<std::unique_ptr<WorkQueue>> s_queues;	// one per worker, then the shared external one
+	static std::vector<std::thread> s_workers;
+	static std::atomic<int> s_queuedJobs;
+	static std::atomic<int> s_sleepingWorkers;
+	static std::mutex s_sleepMutex;
+	static std::condition_variable s_wakeCondition;
+	static bool s_stopping;
+	static std::mutex s_setupMutex;
+	static std::atomic<bool> s_ready;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <AssetPack.h>
+#include <string>
+#include <vector>
+
+// Subset of VkFormat values used by KTX2 files
+enum KtxFormat
+{
+	VK_FORMAT_R8_UNORM = 9,
+	VK_FORMAT_R8G8_UNORM = 16,
+	VK_FORMAT_R8G8B8_UNORM = 23,
+	VK_FORMAT_R8G8B8_SRGB = 29,
+	VK_FORMAT_R8G8B8A8_UNORM = 37,
+	VK_FORMAT_R8G8B8A8_SRGB = 43,
+	VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+	VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+	VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133,
+	VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134,
+	VK_FORMAT_BC2_UNORM_BLOCK = 135,
+	VK_FORMAT_BC2_SRGB_BLOCK = 136,
+	VK_FORMAT_BC3_UNORM_BLOCK = 137,
+	VK_FORMAT_BC3_SRGB_BLOCK = 138,
+	VK_FORMAT_BC4_UNORM_BLOCK = 139,
+	VK_FORMAT_BC5_UNORM_BLOCK = 141,
+	VK_FORMAT_BC7_UNORM_BLOCK = 145,
+	VK_FORMAT_BC7_SRGB_BLOCK = 146,
+	VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK = 147,
+	VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK = 148,
+	VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK = 149,
+	VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK = 150,
+	VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK = 151,
+	VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK = 152,
+	VK_FORMAT_EAC_R11_UNORM_BLOCK = 153,
+	VK_FORMAT_EAC_R11G11_UNORM_BLOCK = 155
+};
+
+// Byte range of one mip level inside KtxData::file (all faces of that level, face after face)
+struct KtxLevel
+{
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+// CPU-side content of a KTX2 container, as read from disk
+struct KtxData
+{
+	unsigned int vkFormat = 0;
+	GLenum internalFormat = 0;
+	GLenum format = 0;		// pixel format, only used by uncompressed textures
+	bool compressed = false;
+	bool hasAlpha = false;
+	unsigned int blockBytes = 0;	// bytes of a 4x4 block when compressed, of a texel otherwise
+
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int faceCount = 1;
+	unsigned int levelCount = 1;
+	bool topDown = true;	// KTXorientation: first row of each image is the top one
+
+	std::vector<KtxLevel> levels;
+	FileData file;	// the KTX2 file as read (or the bare level data being written), levels index into it
+
+	size_t GetFaceSize(unsigned int level) const { return levels[level].size / faceCount; }
+	const unsigned char* GetFaceData(unsigned int level, unsigned int face) const { return file.data + levels[level].offset + face * GetFaceSize(level); }
+};
+
+// Loads GPU-compressed textures (BC1-BC5, BC7, ETC2/EAC) from KTX2 containers with their pre-generated mip chain
+class KtxLoader
+{
+public:
+	// Returns a 2D texture, or 0 if the file is missing, invalid or in a format the driver can't sample
+	static unsigned int LoadTexture(const std::string& path);
+	// Reads a 2D texture the driver can sample, oriented like stb_image would load it, without uploading it
+	static bool LoadTextureData(const std::string& path, KtxData& outData);
+	// One KTX2 file per face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+	static unsigned int LoadCubemap(const std::vector<std::string>& facePaths);
+	// Single file holding all six faces (faceCount == 6), as written by the cooker
+	static unsigned int LoadCubemap(const std::string& path);
+
+	// "dir/marble.jpg" -> "dir/marble.ktx2" (or the given suffix)
+	static std::string GetSiblingPath(const std::string& imagePath, const char* suffix = ".ktx2");
+
+	static bool ReadFile(const std::string& path, KtxData& outData);
+	// Writes BC1/BC3/BC4/BC5 data (levels are offsets into data.file) as a spec-conforming KTX2 file
+	static bool WriteFile(const std::string& path, const KtxData& data);
+	static bool IsFormatSupported(GLenum internalFormat);
+
+	// mirrors stbi_set_flip_vertically_on_load so both loaders agree on the image orientation
+	static void SetFlipVerticallyOnLoad(bool flip);
+	static bool GetFlipVerticallyOnLoad();
+
+private:
+	static bool ReadHeader(KtxData& data);
+	static bool SetupFormat(KtxData& data);
+	static bool MatchOrientation(KtxData& data);
+	static void FlipBlockRows(unsigned char* block, const KtxData& data, unsigned int rows);
+	// Immutable storage for every level (and face) at once, when GL_ARB_texture_storage is available
+	static bool AllocateStorage(GLenum bindTarget, const KtxData& data);
+	static void UploadLevels(GLenum target, const KtxData& data, unsigned int face, bool allocated);
+
+	static bool s_flipVertically;
+};
@@ -4,6 +4,13 @@
 #include <Camera.h>
 #include <vector>
 #include <ICustomScene.h>
+#include <TransformBatch.h>
+#include <TextureArray.h>
+#include <CascadedShadowMap.h>
+#include <PointShadowMaps.h>
+#include <GpuTimer.h>
+#include <SceneFile.h>
+#include <CommandBuffer.h>
 
 class LightScene : public ICustomScene
 {
@@ -12,23 +19,54 @@ public:
 	virtual void Setup() override;
 	virtual void Draw(const Camera& camera) override;
 
+	// C toggles the static shadow cache, B times the shadow pass with and without it,
+	// P prints the point shadow draw calls
+	virtual void OnKeyPressed(int key) override;
+
 private:
 	void SetupMaterial(Shader& shader);
 	void SetupDirectionalLight(Shader& shader);
 	void SetupPointLights(Shader& shader);
 	void UpdateSpotLight(Shader& shader, const Camera& camera);
 
+	void SetupTransforms();
+	void UpdateDynamicTransforms();
+
+	void DrawShadows(const Camera& camera);
+	void DrawShadowCasters(const TransformBatch& transforms, Shader& shader);
+	void DrawPointShadows(const Camera& camera);
+	void UpdateBenchmark();
+
 	void DrawLitCubes(unsigned int cubeVAO, const Camera& camera, Shader& shader);
 	void DrawSourceLightCubes(unsigned int VAO, const Camera& camera, Shader& shader);
 
 private:
 	Shader m_litShader;
 	Shader m_lightSourceShader;
-	unsigned int m_diffuseMap = 0;
-	unsigned int m_specularMap = 0;
+	Shader m_shadowDepthShader;
+	Shader m_pointShadowShader;
+	TextureArray m_textures;
+	int m_diffuseLayer = 0;
+	int m_specularLayer = 0;
 
 	unsigned int m_cubeVAO = 0;
 	unsigned int m_sourceVAO = 0;
-	std::vector<glm::vec3> m_cubePositions;
+	// the cubes and the lights come from resources\scenes\lights.scene
+	SceneFile m_sceneFile;
+	glm::vec3 m_lightDirection;
 	std::vector<glm::vec3> m_sourceLightPositions;
+
+	TransformBatch m_litCubeTransforms;
+	// the lit cubes' draws, recorded on the JobSystem threads and replayed in order
+	std::vector<CommandBuffer> m_litCubeCommands;
+	TransformBatch m_sourceLightTransforms;
+	// cubes circling the scene, their shadows are redrawn every frame
+	TransformBatch m_dynamicCubeTransforms;
+
+	CascadedShadowMap m_shadowMap;
+	PointShadowMaps m_pointShadows;
+	int m_pointShadowDrawCalls[PointShadowMaps::MAX_SHADOWED_LIGHTS] = {};
+	GpuTimer m_shadowTimer;
+	int m_benchmarkFrame = -1;	// -1 when no benchmark is running
+	float m_benchmarkResults[2] = {};
 };
\ No newline at end of file
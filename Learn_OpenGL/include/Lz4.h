@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// LZ4 block format (no frame header): fast enough to decompress at load time that packed entries
+// still beat reading loose files. The compressor is the simple greedy single-hash variant
+class Lz4
+{
+public:
+	static void Compress(const unsigned char* source, size_t sourceSize, std::vector<unsigned char>& outCompressed);
+	// destSize is the exact decompressed size; returns false on corrupted input
+	static bool Decompress(const unsigned char* source, size_t sourceSize, unsigned char* dest, size_t destSize);
+};
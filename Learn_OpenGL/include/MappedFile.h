@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+// Read-only memory mapping of a whole file, the pages are only read from disk when touched
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false without a message when the file doesn't exist, empty files can't be mapped
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_data != nullptr; }
+
+	const unsigned char* GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+};
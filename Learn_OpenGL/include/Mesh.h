@@ -2,6 +2,9 @@
 
 #include <glm/glm.hpp>
 #include <Shader.h>
+#include <Frustum.h>
+#include <MeshletCuller.h>
+#include <Bvh.h>
 #include <string>
 #include <vector>
 
@@ -17,27 +20,61 @@ struct Vertex
 
 struct Texture 
 {
-	unsigned int id;
+	unsigned int id;	// the texture array holding the layer
 	string type;
 	string path;
+	int layer = 0;
+};
+
+// Range of the index buffer drawn for one level of detail, the levels share the vertex buffer
+struct MeshLod
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	float error;	// largest distance to the full mesh, in mesh units
+};
+
+struct MeshBounds
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
 };
 
 class Mesh
 {
 public:
+	// without lods the whole index buffer is the only level
 	Mesh(vector<Vertex> vertices, vector<unsigned int> indices,
-		vector<Texture> textures);
+		vector<Texture> textures, vector<MeshLod> lods = vector<MeshLod>(), MeshBounds bounds = MeshBounds(),
+		vector<Meshlet> meshlets = vector<Meshlet>());
 
-	void Draw(Shader& shader);
+	void Draw(Shader& shader, unsigned int lod = 0);
+	// draws the full detail level minus the meshlets outside the frustum or facing away, both given in mesh space
+	void DrawMeshlets(Shader& shader, const Frustum& frustum, const glm::vec3& cameraPosition, MeshletStats& stats);
+	// closest triangle of the full detail level along a mesh space ray, the triangle BVH is built on the first call
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& outHit);
+	// meshes are copied around by value, the owner deletes the GL buffers explicitly
+	void Release();
 
 public:
 	vector<Vertex> vertices;
 	vector<unsigned int> indices;
 	vector<Texture> textures;
+	vector<MeshLod> lods;
+	MeshBounds bounds;
+	vector<Meshlet> meshlets;
 
 private:
 	void setupMesh();
+	void setMaterial(Shader& shader);
 
 private:
 	unsigned int VAO, VBO, EBO;
+	int diffuseLayer = 0;
+	int specularLayer = -1;
+
+	MeshletCuller meshletCuller;
+	TriangleBvh triangleBvh;
+	vector<GLsizei> rangeCounts;
+	vector<const void*> rangeOffsets;
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Mesh.h>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+
+// Texture referenced by a mesh material, resolved to a GL texture when the model is loaded
+struct MeshTextureRef
+{
+	string type;
+	string path;
+};
+
+// CPU-side mesh as produced by the importer, before any GL object is created
+struct MeshData
+{
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;	// every level of detail, back to back
+	vector<MeshTextureRef> textures;
+	vector<MeshLod> lods;
+	MeshBounds bounds;
+	vector<Meshlet> meshlets;	// clusters of the full detail level
+	int node = 0;	// ModelNode the mesh hangs from
+};
+
+// Node of the imported scene graph, in depth-first order so a parent always comes before its children
+struct ModelNode
+{
+	int parent;	// -1 for the root
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+// Binary ".mesh" files written by the asset cooker: the vertex and index buffers are stored
+// exactly as Mesh uploads them, so loading is a couple of reads instead of an Assimp import
+class MeshFile
+{
+public:
+	static const unsigned int VERSION = 4;
+
+	static bool Read(const string& path, vector<MeshData>& outMeshes, vector<ModelNode>& outNodes);
+	static bool Write(const string& path, const vector<MeshData>& meshes, const vector<ModelNode>& nodes);
+
+	// "models\backpack\backpack.obj" -> "models\backpack\backpack.mesh"
+	static string GetCookedPath(const string& modelPath);
+
+	// Renumbers the vertices in the order the (cache-optimized) index buffer first uses them
+	static void OptimizeVertexFetch(MeshData& mesh);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <MeshFile.h>
+#include <vector>
+
+// Quadric error edge-collapse simplification (Garland & Heckbert). A vertex is only ever collapsed onto
+// one of its neighbours, so every LOD indexes the vertex buffer of the full mesh. Vertices on uv/normal
+// seams and on open borders never move, and the collapse cost also weighs the uv and normal change,
+// which keeps textures and shading attached to the surface.
+class MeshSimplifier
+{
+public:
+	// Collapses edges of the cheapest cost first until the index buffer is down to targetIndexCount or no
+	// collapse stays under maxError (in mesh units). outError receives the largest error accepted.
+	static vector<unsigned int> Simplify(const vector<Vertex>& vertices, const vector<unsigned int>& indices,
+		size_t targetIndexCount, float maxError, float& outError);
+
+	// Fills mesh.bounds and appends the simplified levels after the full index buffer, described by mesh.lods
+	static void GenerateLods(MeshData& mesh);
+
+	static MeshBounds ComputeBounds(const vector<Vertex>& vertices);
+
+	static const unsigned int MAX_LODS = 5;
+};
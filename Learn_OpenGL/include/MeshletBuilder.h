@@ -0,0 +1,16 @@
+#pragma once
+
+#include <MeshFile.h>
+
+// Splits the index buffer of a mesh into meshlets: each one grows from a seed triangle by adding the
+// neighbour that brings the fewest new vertices, until it holds MAX_VERTICES vertices or MAX_TRIANGLES
+// triangles. The triangles are reordered so every meshlet is a contiguous index range.
+class MeshletBuilder
+{
+public:
+	static const unsigned int MAX_VERTICES = 64;
+	static const unsigned int MAX_TRIANGLES = 124;
+
+	// runs on the full detail index buffer, before the LODs are appended to it
+	static void Build(MeshData& mesh);
+};
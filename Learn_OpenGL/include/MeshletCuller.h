@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <Frustum.h>
+#include <vector>
+
+// Small cluster of triangles of the full detail level, culled as a whole before drawing
+struct Meshlet
+{
+	unsigned int indexOffset;
+	unsigned int triangleCount;
+	glm::vec3 center;
+	float radius;
+	glm::vec3 coneAxis;	// average facing of the triangles
+	float coneCutoff;	// sine of the normal cone's half angle, 1 when the cone is too wide to ever cull
+};
+
+// Meshlets and triangles before and after culling, summed over the draws of a frame
+struct MeshletStats
+{
+	unsigned int meshletCount = 0;
+	unsigned int visibleMeshletCount = 0;
+	unsigned int triangleCount = 0;
+	unsigned int visibleTriangleCount = 0;
+	unsigned int drawRangeCount = 0;
+};
+
+// Keeps the meshlet bounds and cones of a mesh as separate arrays so four meshlets are tested per SSE
+// instruction, then turns the survivors into index ranges for glMultiDrawElements.
+class MeshletCuller
+{
+public:
+	void Setup(const std::vector<Meshlet>& meshlets);
+
+	// frustum and camera position in mesh space; runs of consecutive visible meshlets become a single range
+	void Cull(const Frustum& frustum, const glm::vec3& cameraPosition,
+		std::vector<GLsizei>& outCounts, std::vector<const void*>& outOffsets, MeshletStats& stats) const;
+
+	size_t Size() const { return m_indexOffsets.size(); }
+
+private:
+	// bit i of the result is set when meshlet first + i survives
+	unsigned int CullBlock(size_t first, const Frustum& frustum, const glm::vec3& cameraPosition) const;
+
+	// padded to a multiple of four
+	std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+	std::vector<float> m_axisX, m_axisY, m_axisZ, m_cutoff;
+
+	std::vector<unsigned int> m_indexOffsets;
+	std::vector<unsigned int> m_triangleCounts;
+};
@@ -4,6 +4,9 @@
 #include <Camera.h>
 #include <vector>
 #include <ICustomScene.h>
+#include <TextureArray.h>
+#include <Frustum.h>
+#include <GpuTimer.h>
 
 class MirrorFramebufferScene : public ICustomScene
 {
@@ -12,20 +15,51 @@ public:
 	virtual void Setup() override;
 	virtual void Draw(const Camera& camera) override;
 
+	// +/- change the resolution scale of the reflection, M switches between re-rendering and SSR,
+	// B times both modes and prints the comparison
+	virtual void OnKeyPressed(int key) override;
+
 private:
-	void SetupFramebuffer(unsigned int& fbo, unsigned int& texColorBuffer);
-	void DrawQuadArray(Shader& shader, unsigned int quadVAO, unsigned int texture, const std::vector<glm::vec3>& quadArray, const Camera& camera);
-	void DrawCubes(Shader& shader, unsigned int cubeVAO, unsigned int cubeTexture);
-	void DrawFloor(Shader& shader, unsigned int planeVAO, unsigned int floorTexture);
+	enum class ReflectionMode
+	{
+		RERENDER,
+		SCREEN_SPACE
+	};
+
+	void SetupFramebuffer(unsigned int& fbo, unsigned int& texColorBuffer, unsigned int& rbo, int width, int height);
+	// (re)creates every target sized after the window, Draw calls it when the viewport changes
+	void SetupScreenTargets(int width, int height);
+	void SetupReflectionTarget();
+	void SetupMirror(const glm::mat4& model);
+
+	// Renders the reflected scene into the mirror framebuffer, returns false when the mirror isn't visible
+	bool DrawReflection(const Camera& camera, const glm::mat4& view, const glm::mat4& projection);
+	void DrawMirror(const glm::mat4& view, const glm::mat4& projection, bool hasReflection);
+	// Copies the opaque pass and draws the mirror by ray-marching its depth, misses show the skybox
+	void DrawScreenSpaceMirror(const glm::mat4& view, const glm::mat4& projection);
+	void SetupScreenSpaceSource();
+	void UpdateBenchmark();
+	static const char* GetModeName(ReflectionMode mode);
+
+	// the frustum culls objects outside of the pass, nullptr draws everything
+	void DrawQuadArray(Shader& shader, unsigned int quadVAO, int layer, const std::vector<glm::vec3>& quadArray, const glm::vec3& viewPosition, const Frustum* frustum);
+	void DrawCubes(Shader& shader, unsigned int cubeVAO, int cubeLayer, const Frustum* frustum);
+	void DrawFloor(Shader& shader, unsigned int planeVAO, int floorLayer, const Frustum* frustum);
 	void DrawScreenQuad(Shader& shader, unsigned int quadVAO, unsigned int texture);
-	glm::mat4 GetInvertedView(const Camera& camera);
+
+	static glm::mat4 GetReflectionMatrix(const glm::vec4& plane);
+	static glm::mat4 GetObliqueProjection(const glm::mat4& projection, const glm::mat4& view, const glm::vec4& plane);
+	bool GetMirrorScreenBounds(const glm::mat4& viewProj, glm::vec2& ndcMin, glm::vec2& ndcMax) const;
 
 private:
 	std::vector<glm::vec3> m_quadArrayPos;
+	std::vector<glm::vec3> m_cubePositions;
 
 	Shader m_shader;
 	Shader m_borderShader;
 	Shader m_screenShader;
+	Shader m_mirrorShader;
+	Shader m_ssrShader;
 
 	unsigned int m_cubeVAO = 0;
 	unsigned int m_planeVAO = 0;
@@ -33,13 +67,39 @@ private:
 	unsigned int m_screenQuadVAO = 0;
 	unsigned int m_mirrorQuadVAO = 0;
 
-	unsigned int m_cubeTexture = 0;
-	unsigned int m_floorTexture = 0;
-	unsigned int m_windowTexture = 0;
+	TextureArray m_textures;
+	int m_cubeLayer = 0;
+	int m_floorLayer = 0;
+	int m_windowLayer = 0;
 
+	int m_screenWidth = 0;
+	int m_screenHeight = 0;
 	unsigned int m_framebuffer = 0;
 	unsigned int m_texColorbuffer = 0;
+	unsigned int m_depthStencilbuffer = 0;
 
+	// mirror quad in world space and the plane it lies on (xyz normal, w distance)
+	glm::mat4 m_mirrorModel = glm::mat4(1.0f);
+	glm::vec4 m_mirrorPlane = glm::vec4(0.0f);
+	glm::vec3 m_mirrorCorners[4];
+
+	// the reflection target is a scaled copy of the screen, only the mirror's rectangle is rendered
+	float m_reflectionScale = 0.5f;
+	int m_reflectionWidth = 0;
+	int m_reflectionHeight = 0;
 	unsigned int m_mirrorFramebuffer = 0;
 	unsigned int m_mirrorTexColorbuffer = 0;
+	unsigned int m_mirrorDepthStencilbuffer = 0;
+
+	ReflectionMode m_reflectionMode = ReflectionMode::RERENDER;
+	unsigned int m_skyboxTexture = 0;
+
+	// color and depth of the opaque pass, sampled by the SSR shader
+	unsigned int m_ssrFramebuffer = 0;
+	unsigned int m_ssrColorbuffer = 0;
+	unsigned int m_ssrDepthbuffer = 0;
+
+	GpuTimer m_reflectionTimer;
+	int m_benchmarkFrame = -1;	// -1 when no benchmark is running
+	float m_benchmarkResults[2] = {};
 };
\ No newline at end of file
@@ -2,6 +2,11 @@
 
 #include <Shader.h>
 #include <Mesh.h>
+#include <MeshFile.h>
+#include <TextureArray.h>
+#include <Camera.h>
+#include <OcclusionQueryManager.h>
+#include <TransformHierarchy.h>
 #include <assimp/scene.h>
 
 #include <vector>
@@ -9,23 +14,70 @@
 
 using namespace std;
 
+// LOD picked for every mesh of one drawn instance, kept by the caller so the hysteresis works when a
+// Model is drawn many times per frame
+struct ModelLodState
+{
+	vector<int> meshLods;
+	vector<int> occlusionObjects;	// OcclusionQueryManager id of every mesh, filled on the first tested draw
+};
+
 class Model
 {
 public:
 	Model();
 	Model(const char* path);
 	void LoadModel(string path);
+	// every mesh with the matrices the caller set, without the node transforms
 	void Draw(Shader& shader);
+	// picks each mesh's LOD from its projected size and culls the meshlets of the full detail ones
+	// meshes are placed by their node's transform under model and get their own object matrices when
+	// the nodes aren't all identities; with occlusion queries, each mesh is drawn only if its bounding box was visible the frame before and
+	// the box is queued for this frame's test, the caller issues the queries once the scene is drawn
+	void Draw(Shader& shader, const Camera& camera, const glm::mat4& model, ModelLodState& lodState, MeshletStats& stats,
+		OcclusionQueryManager* occlusionQueries = nullptr);
+
+	unsigned int GetTriangleCount() const;
+	// deletes the meshes' buffers and the texture array, the model can't be drawn afterwards
+	void Release();
+	unsigned int GetMeshCount() const { return (unsigned int)meshes.size(); }
+	// the Assimp node tree, nodes can be moved and the next Draw picks it up
+	TransformHierarchy& GetNodes() { return nodes; }
+	void GetMeshBox(unsigned int mesh, glm::vec3& outMin, glm::vec3& outMax) const;
+	// GetBounds and Raycast place the meshes with the node matrices of the load or of the last Draw and
+	// never update the hierarchy, so another thread can call them while Draw runs on the GL thread
+	// box around every mesh placed by its node
+	void GetBounds(glm::vec3& outMin, glm::vec3& outMax) const;
+	// closest triangle along a world space ray for an instance placed by model, inOutDistance is lowered
+	// when a triangle is hit before it
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, const glm::mat4& model, float& inOutDistance);
+
+	void SetLodEnabled(bool enabled) { lodEnabled = enabled; }
+	bool IsLodEnabled() const { return lodEnabled; }
+	void SetMeshletCullingEnabled(bool enabled) { meshletCullingEnabled = enabled; }
+	bool IsMeshletCullingEnabled() const { return meshletCullingEnabled; }
+
+	// Assimp import without any GL call, used by LoadModel and by the asset cooker
+	static bool ImportMeshData(const string& path, vector<MeshData>& outMeshes, vector<ModelNode>& outNodes, bool optimize = false);
 
 	static unsigned int TextureFromFile(const char* path, const string& directory);
+	static void SetFlipVerticallyOnLoad(bool flip);
 
 private:
 	vector<Texture> textures_loaded;
 	vector<Mesh> meshes;
+	TextureArray textureArray;
 	string directory;
+	TransformHierarchy nodes;
+	vector<int> meshNodes;
+	bool nodesAreIdentity = true;
+	bool lodEnabled = true;
+	bool meshletCullingEnabled = true;
 
 private:
-	void processNode(aiNode* node, const aiScene* scene);
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-	vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName);
+	void updateNodes();
+	static void processNode(aiNode* node, int parent, const aiScene* scene, vector<MeshData>& outMeshes, vector<ModelNode>& outNodes);
+	static MeshData processMesh(aiMesh* mesh, const aiScene* scene);
+	static void getMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName, vector<MeshTextureRef>& outTextures);
+	vector<Texture> loadMaterialTextures(const vector<MeshTextureRef>& textureRefs);
 };
\ No newline at end of file
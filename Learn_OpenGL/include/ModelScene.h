@@ -3,6 +3,9 @@
 #include <Shader.h>
 #include <Camera.h>
 #include <Model.h>
+#include <GpuTimer.h>
+#include <OcclusionQueryManager.h>
+#include <TransformHierarchy.h>
 #include <vector>
 #include <ICustomScene.h>
 
@@ -12,8 +15,17 @@ public:
 	ModelScene();
 	virtual void Setup() override;
 	virtual void Draw(const Camera& camera) override;
+	// G shows the backpack crowd, R spins it, L toggles LODs, M meshlet culling and O occlusion queries,
+	// P prints the draw stats, B times the crowd with each of them added in turn
+	virtual void OnKeyPressed(int key) override;
 
 private:
+	void PrintOcclusionStats() const;
+
+	void SetupCrowd();
+	void DrawCrowd(const Camera& camera);
+	void UpdateBenchmark();
+
 	void SetupMaterial(Shader& shader);
 	void SetupDirectionalLight(Shader& shader);
 	void SetupPointLights(Shader& shader);
@@ -21,5 +33,24 @@ private:
 
 	Shader m_modelShader;
 	Model m_model;
+	ModelLodState m_modelLod;
 	std::vector<glm::vec3> m_sourceLightPositions;
+
+	// backpacks spread up to the far plane, to see the LODs at work, all under one root node
+	TransformHierarchy m_crowd;
+	int m_crowdRoot = 0;
+	std::vector<int> m_crowdNodes;
+	bool m_spinCrowd = false;
+	std::vector<ModelLodState> m_crowdLods;
+	bool m_showCrowd = false;
+	MeshletStats m_drawStats;
+
+	OcclusionQueryManager m_occlusionQueries;
+	bool m_occlusionQueriesEnabled = false;
+
+	GpuTimer m_drawTimer;
+	int m_benchmarkFrame = -1;	// -1 when no benchmark is running
+	int m_benchmarkMode = 0;
+	float m_benchmarkResults[3] = {};
+	unsigned int m_benchmarkTriangles[3] = {};
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Shader.h>
+#include <HiZBuffer.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Tests bounding spheres against a HiZBuffer on the GPU. Every object is one point of the test pass
+// (hiz_test.vs) writing its visibility to one texel of a small texture; instanced draws read that texel
+// in their vertex shader and drop the culled instances, so the results never go through the CPU.
+// The previous test is kept for the two-phase scheme: draw what was visible last frame, build the
+// pyramid from that depth, test everything, then draw what the test found visible on top.
+class OcclusionCuller
+{
+public:
+	// objects per row of the visibility textures
+	static const int VISIBILITY_WIDTH = 256;
+
+	OcclusionCuller();
+
+	// world space spheres, xyz center and w radius
+	void Setup(const std::vector<glm::vec4>& spheres);
+	// marks every object visible in both textures, the next first phase draws everything
+	void ResetVisibility();
+
+	// leaves its own framebuffer bound, the caller restores its target and viewport
+	void Test(const HiZBuffer& hiZ, const glm::mat4& viewProj);
+	// the test that just ran becomes the previous one
+	void Swap() { m_current = 1 - m_current; }
+	// replaces the previous test with one done elsewhere, e.g. on the CPU, one byte per object and nonzero when visible
+	void SetVisibility(const std::vector<unsigned char>& visibility);
+
+	// "previousVisibility" goes to firstUnit and "currentVisibility" to the next one
+	void Bind(Shader& shader, int firstUnit) const;
+
+	// visible objects in the last test, after Swap; reading it back stalls so it's meant for stats
+	unsigned int CountVisible() const;
+	size_t Size() const { return m_objectCount; }
+
+private:
+	Shader m_testShader;
+	unsigned int m_pointVAO = 0;
+	unsigned int m_pointVBO = 0;
+
+	unsigned int m_framebuffers[2] = {};
+	unsigned int m_textures[2] = {};
+	int m_current = 0;	// written by the next test
+
+	size_t m_objectCount = 0;
+	int m_height = 0;
+};
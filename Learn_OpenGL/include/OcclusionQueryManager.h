@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Shader.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <deque>
+
+// Hit counts of one tested object, a hit is a test where some of its box was visible
+struct OcclusionQueryStats
+{
+	unsigned int testCount = 0;
+	unsigned int hitCount = 0;
+
+	float GetHitRate() const { return testCount > 0 ? (float)hitCount / testCount : 1.0f; }
+};
+
+// Occlusion queries on bounding boxes for meshes that are expensive to draw. Each frame the real draw
+// of an object is made conditional on the query its box issued the frame before, so the GPU skips it
+// when nothing of the box passed the depth test and the CPU never waits for a result. The boxes are
+// drawn after the scene, without color or depth writes, each inside a query taken from a pool; the
+// results are still read back once available, a few frames late, but only for the statistics.
+// An object hidden last frame shows up one frame late when it comes into view.
+class OcclusionQueryManager
+{
+public:
+	OcclusionQueryManager();
+	void Setup();
+
+	// box in the object's own space, returns the id the other calls take
+	int AddObject(const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	// starts a conditional render on the object's last query when there is one; localCamera is the
+	// camera in object space, from inside the box its faces can't be trusted and the draw is left alone
+	void BeginConditionalRender(int object, const glm::vec3& localCamera);
+	void EndConditionalRender();
+
+	// the object's box gets a query in the next IssueQueries
+	void QueueTest(int object, const glm::mat4& model);
+	// draws the queued boxes against the current depth buffer and collects the finished results
+	void IssueQueries(const glm::mat4& viewProj);
+
+	const OcclusionQueryStats& GetStats(int object) const { return m_objects[object].stats; }
+	void ResetStats();
+
+	size_t GetPoolSize() const { return m_queryCount; }
+	size_t GetPendingCount() const { return m_pending.size(); }
+	bool IsConservative() const { return m_target != GL_ANY_SAMPLES_PASSED; }
+
+private:
+	struct ObjectState
+	{
+		glm::mat4 boxTransform;	// unit cube to the box in object space
+		glm::mat4 model;
+		unsigned int query = 0;	// the last one issued, 0 before the first
+		unsigned long long queryFrame = 0;
+		bool queryCollected = false;
+		bool queued = false;
+		OcclusionQueryStats stats;
+	};
+
+	struct PendingQuery
+	{
+		unsigned int query;
+		int object;
+	};
+
+	unsigned int AcquireQuery();
+	void CollectResults();
+
+	Shader m_proxyShader;
+	unsigned int m_cubeVAO = 0;
+	GLenum m_target = GL_ANY_SAMPLES_PASSED;
+
+	std::vector<ObjectState> m_objects;
+	std::vector<int> m_queued;
+	std::vector<unsigned int> m_freeQueries;
+	std::deque<PendingQuery> m_pending;	// in issue order, which is the order results become available
+	size_t m_queryCount = 0;
+	bool m_conditionalActive = false;
+	unsigned long long m_frame = 1;	// IssueQueries calls so far, plus one
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Depth-only software rasterizer for occlusion culling on the CPU. A few large occluders are transformed,
+// clipped to the near plane and binned into screen tiles, then the tiles are rasterized four pixels at a
+// time with SSE, spread over the JobSystem. Occludee boxes are tested against the result before
+// their draws are submitted, so nothing waits on the GPU and the answer is the same on every driver.
+// There is no GL call in here.
+class OcclusionRasterizer
+{
+public:
+	static const int TILE_WIDTH = 32;
+	static const int TILE_HEIGHT = 16;
+
+	OcclusionRasterizer();
+
+	// width is rounded up to a multiple of TILE_WIDTH
+	void Setup(int width, int height);
+
+	// clears the depth and the bins
+	void BeginFrame(const glm::mat4& viewProj);
+
+	// object space triangles, counter-clockwise when seen from the outside
+	void AddOccluder(const glm::vec3* positions, const unsigned int* indices, size_t indexCount, const glm::mat4& model);
+	// the unit cube VertexArrayInitializer::SetupCube draws, under model
+	void AddBoxOccluder(const glm::mat4& model);
+
+	void Rasterize();
+
+	// false when every pixel the box covers already holds something nearer than the box's nearest point
+	bool IsVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	const float* GetDepth() const { return m_depth.empty() ? nullptr : &m_depth[0]; }
+	size_t GetTriangleCount() const { return m_triangles.size(); }
+
+private:
+	// screen space edge functions (inside when all three are >= 0) and depth plane
+	struct RasterTriangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int minX, minY, maxX, maxY;
+	};
+
+	void AddClippedTriangle(const glm::vec4* clip);
+	void SetupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+	void RasterizeTile(int tile);
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_tilesX = 0;
+	int m_tilesY = 0;
+	glm::mat4 m_viewProj = glm::mat4(1.0f);
+
+	std::vector<float> m_depth;
+	std::vector<RasterTriangle> m_triangles;
+	std::vector<std::vector<unsigned int>> m_bins;
+};
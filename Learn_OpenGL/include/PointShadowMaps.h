@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Shader.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Omnidirectional shadows for the point lights closest to the camera. Each shadowed light gets a depth
+// cubemap rendered in a single layered pass: the geometry shader (point_shadow_depth.gs) sends every
+// caster only to the faces its bounding sphere touches, the mask being computed on the CPU per draw.
+// Lights past the budget or too far from the camera are lit without shadows.
+class PointShadowMaps
+{
+public:
+	// litShader samples the cubemaps through one sampler per slot
+	static const int MAX_SHADOWED_LIGHTS = 2;
+	static const int FIRST_TEXTURE_UNIT = 4;
+	static const int FACE_COUNT = 6;
+
+	PointShadowMaps();
+	void Setup(int resolution, float farPlane, float maxViewDistance);
+
+	// gives the slots to the closest lights in range, call once per frame before the passes
+	void AssignSlots(const std::vector<glm::vec3>& lightPositions, const glm::vec3& viewPosition);
+	int GetSlotCount() const { return m_slotCount; }
+	int GetSlotLight(int slot) const { return m_slotLights[slot]; }
+
+	// Binds the cubemap of a slot and sets the light uniforms of the depth shader
+	void BeginPass(int slot, Shader& depthShader);
+	// Faces of the slot's light a bounding sphere touches as a bit mask, 0 when it's out of range
+	int GetFaceMask(int slot, const glm::vec3& center, float radius) const;
+	void EndPass();
+
+	// sets the shadow uniforms of litShader and binds the cubemaps
+	void Bind(Shader& shader, int lightCount) const;
+
+private:
+	int m_resolution = 0;
+	float m_farPlane = 0.0f;
+	float m_maxViewDistance = 0.0f;
+	glm::mat4 m_projection = glm::mat4(1.0f);
+
+	int m_slotCount = 0;
+	int m_slotLights[MAX_SHADOWED_LIGHTS] = {};
+	glm::vec3 m_slotPositions[MAX_SHADOWED_LIGHTS];
+
+	unsigned int m_framebuffer = 0;
+	unsigned int m_cubemaps[MAX_SHADOWED_LIGHTS] = {};
+};
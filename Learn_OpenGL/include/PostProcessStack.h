@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Shader.h>
+#include <RenderTargetPool.h>
+#include <vector>
+
+enum class PostEffectType
+{
+	GAUSSIAN_BLUR,
+	EDGE_DETECT,
+	GRAYSCALE,
+	SHARPEN
+};
+
+struct PostEffect
+{
+	PostEffectType type;
+	bool enabled = true;
+	float radius = 4.0f;	// gaussian blur only, in pixels
+};
+
+// Chain of full-screen effects applied to a rendered frame. Passes ping-pong between two pooled
+// render targets, the last one writes straight into the destination framebuffer
+class PostProcessStack
+{
+public:
+	// blurs take (radius / 2 + 1) fetches per pass, two passes per blur
+	static const int MAX_BLUR_RADIUS = 64;
+
+	PostProcessStack();
+	void Setup();
+
+	// Runs the enabled effects on sourceTexture and writes the result to targetFramebuffer (0 = default)
+	void Apply(unsigned int sourceTexture, int width, int height, unsigned int targetFramebuffer);
+
+	// effects run in order, they can be added, reordered or toggled between frames
+	std::vector<PostEffect>& GetEffects() { return m_effects; }
+	void AddEffect(PostEffectType type, float radius = 4.0f);
+
+	static const char* GetEffectName(PostEffectType type);
+	void PrintEffects() const;
+
+private:
+	struct Pass
+	{
+		Shader* shader;
+		float radius;		// blur passes
+		bool vertical;		// blur passes
+		const float* kernel;	// 3x3 kernel passes
+	};
+
+	void SetupPass(const Pass& pass, int width, int height);
+	void SetBlurRadius(float radius);
+
+private:
+	Shader m_blurShader;
+	Shader m_kernelShader;
+	Shader m_grayscaleShader;
+
+	unsigned int m_quadVAO = 0;
+	float m_blurRadius = -1.0f;
+	int m_width = 0;	// size of the last Apply, the pooled targets have it
+	int m_height = 0;
+
+	std::vector<PostEffect> m_effects;
+	RenderTargetPool m_targetPool;
+};
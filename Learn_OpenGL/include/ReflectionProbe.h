@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Shader.h>
+#include <glm/glm.hpp>
+
+// Environment cubemap rendered from a point in the scene. The six faces are spread over several frames:
+// each frame renders the next few faces into a back cubemap in a single layered pass (the geometry shader
+// sends every triangle to the faces due), and the back cubemap is swapped in once all six are done, so
+// shading always samples a complete cube.
+class ReflectionProbe
+{
+public:
+	static const int FACE_COUNT = 6;
+
+	ReflectionProbe();
+	void Setup(const glm::vec3& position, int size);
+
+	// Binds the probe for the faces due this frame and sets the layered shader uniforms (see probe.gs);
+	// the caller then draws the scene with that shader and calls End
+	void Begin(Shader& layeredShader);
+	void End();
+
+	// faces rendered per frame, a full refresh takes 6 / budget frames
+	void SetFaceBudget(int budget);
+	int GetFaceBudget() const { return m_faceBudget; }
+
+	const glm::vec3& GetPosition() const { return m_position; }
+	unsigned int GetCubemap() const { return m_cubemaps[m_front]; }
+
+private:
+	static unsigned int CreateCubemap(int size, GLenum internalFormat, GLenum format, GLenum type);
+
+	glm::vec3 m_position = glm::vec3(0.0f);
+	int m_size = 0;
+	glm::mat4 m_faceViewProj[FACE_COUNT];
+
+	unsigned int m_framebuffer = 0;
+	unsigned int m_cubemaps[2] = {};
+	unsigned int m_depthCubemap = 0;
+	int m_front = 0;
+
+	int m_faceBudget = 1;
+	int m_nextFace = 0;
+	int m_facesThisFrame = 0;
+	// the first cycle renders every face so the probe is usable right away
+	bool m_initialized = false;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+// Color-only framebuffer with its texture attachment
+struct RenderTarget
+{
+	unsigned int framebuffer = 0;
+	unsigned int texture = 0;
+	int width = 0;
+	int height = 0;
+	GLenum internalFormat = GL_RGBA8;
+};
+
+// Keeps released render targets around so passes that run every frame reuse them instead of
+// creating framebuffers and textures each time
+class RenderTargetPool
+{
+public:
+	RenderTarget Acquire(int width, int height, GLenum internalFormat = GL_RGBA8);
+	void Release(const RenderTarget& target);
+	// deletes every pooled target (the acquired ones stay valid)
+	void Clear();
+
+private:
+	static RenderTarget Create(int width, int height, GLenum internalFormat);
+
+	std::vector<RenderTarget> m_freeTargets;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <AssetPack.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The records below are stored as they are in the compiled file, every table is used in place
+
+enum SceneMeshType
+{
+	SCENE_MESH_CUBE,	// VertexArrayInitializer::SetupCube, lit
+	SCENE_MESH_PLANE,	// VertexArrayInitializer::SetupPlane, unlit
+	SCENE_MESH_QUAD,	// VertexArrayInitializer::SetupTransparent, unlit and sorted back to front
+	SCENE_MESH_MODEL	// a Model file, lit
+};
+
+enum SceneLightType
+{
+	SCENE_LIGHT_DIRECTIONAL,
+	SCENE_LIGHT_POINT,
+	SCENE_LIGHT_SPOT
+};
+
+// string offset of a missing value
+const unsigned int SCENE_NO_STRING = 0xFFFFFFFF;
+
+struct SceneMesh
+{
+	unsigned int name;	// string offset
+	unsigned int type;	// SceneMeshType
+	unsigned int path;	// models only
+};
+
+struct SceneMaterial
+{
+	unsigned int name;
+	unsigned int diffuse;	// texture paths
+	unsigned int specular;
+	float shininess;
+};
+
+struct SceneEntity
+{
+	unsigned int mesh;
+	unsigned int material;
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+struct SceneLight
+{
+	unsigned int type;	// SceneLightType
+	glm::vec3 position;
+	glm::vec3 direction;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	float cutOff;	// cosines of the spot angles
+	float outerCutOff;
+};
+
+struct SceneCamera
+{
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+// Scene being assembled, by the text compiler or by code, before SceneFile::Write turns it into a file
+struct SceneData
+{
+	std::vector<SceneMesh> meshes;
+	std::vector<SceneMaterial> materials;
+	std::vector<SceneEntity> entities;
+	std::vector<SceneLight> lights;
+	std::vector<SceneCamera> cameras;
+	std::string strings;	// zero terminated, back to back
+
+	// offset of the string, stored once however many records use it
+	unsigned int AddString(const std::string& value);
+
+private:
+	std::unordered_map<std::string, unsigned int> m_stringOffsets;
+};
+
+// Scenes as data: a text source (".scene") lists meshes, materials, entities, lights and cameras, and is
+// compiled to a binary file (".sceneb") by the asset cooker. The binary is a header followed by one
+// table per record type and the strings; it is memory-mapped and read in place, so loading doesn't
+// depend on the entity count beyond the pages the caller touches.
+//
+// Source syntax, one record per line, '#' starts a comment:
+//   camera x y z [yaw degrees] [pitch degrees]
+//   mesh name cube|plane|quad|model [path]
+//   material name [diffuse path] [specular path] [shininess value]
+//   entity mesh material [position x y z] [rotation degrees x y z] [scale s | scale x y z]
+//   light directional|point|spot [position x y z] [direction x y z] [ambient r g b] [diffuse r g b]
+//         [specular r g b] [attenuation constant linear quadratic] [cutoff inner outer]
+// Names and paths can't contain spaces.
+class SceneFile
+{
+public:
+	static const unsigned int VERSION = 1;
+
+	SceneFile();
+
+	// the compiled file next to path when there is one and it is newer than the source, else the source
+	// compiled in memory
+	bool Load(const std::string& path);
+	// bytes as produced by Write
+	bool Load(std::vector<unsigned char>&& bytes);
+
+	const SceneMesh* GetMeshes() const { return m_meshes; }
+	const SceneMaterial* GetMaterials() const { return m_materials; }
+	const SceneEntity* GetEntities() const { return m_entities; }
+	const SceneLight* GetLights() const { return m_lights; }
+	const SceneCamera* GetCameras() const { return m_cameras; }
+	unsigned int GetMeshCount() const { return m_meshCount; }
+	unsigned int GetMaterialCount() const { return m_materialCount; }
+	unsigned int GetEntityCount() const { return m_entityCount; }
+	unsigned int GetLightCount() const { return m_lightCount; }
+	unsigned int GetCameraCount() const { return m_cameraCount; }
+
+	// "" for SCENE_NO_STRING
+	const char* GetString(unsigned int offset) const;
+	// index of the mesh with that name, -1 when there is none
+	int FindMesh(const std::string& name) const;
+
+	static bool Compile(const std::string& source, SceneData& outScene, std::string& outError);
+	static void Write(const SceneData& scene, std::vector<unsigned char>& outBytes);
+	static bool WriteFile(const std::string& path, const SceneData& scene);
+
+	// translation * rotation * scale
+	static glm::mat4 GetEntityMatrix(const SceneEntity& entity);
+
+	// "scenes\lights.scene" -> "scenes\lights.sceneb"
+	static std::string GetCompiledPath(const std::string& sourcePath);
+
+private:
+	bool ReadTables(const std::string& name);
+
+	FileData m_file;
+	const SceneMesh* m_meshes = nullptr;
+	const SceneMaterial* m_materials = nullptr;
+	const SceneEntity* m_entities = nullptr;
+	const SceneLight* m_lights = nullptr;
+	const SceneCamera* m_cameras = nullptr;
+	const char* m_strings = nullptr;
+	unsigned int m_meshCount = 0;
+	unsigned int m_materialCount = 0;
+	unsigned int m_entityCount = 0;
+	unsigned int m_lightCount = 0;
+	unsigned int m_cameraCount = 0;
+	unsigned int m_stringsSize = 0;
+};
@@ -8,6 +8,14 @@
 #include <sstream>
 #include <iostream>
 
+// Uniform locations of the per-object matrices of a lit shader, for the calls that can't look them up
+struct ObjectMatrixLocations
+{
+	int model = -1;
+	int mvp = -1;
+	int normalMatrix = -1;
+};
+
 class Shader
 {
 public:
@@ -17,24 +25,34 @@ public:
 	// Base constructor with no logic
 	Shader();
 
-	// constructor reads and builds the shader
-	Shader(const char* vertexPath, const char* fragmentPath);
+	// constructor reads and builds the shader, the geometry stage is optional
+	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
 
 	// use/activate the shader
 	void Use();
 
-	void LoadShader(const char* vertexPath, const char* fragmentPath);
+	void LoadShader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
 
 	void SetBool(const std::string& name, bool value) const;
 	void SetInt(const std::string& name, int value) const;
 	void SetFloat(const std::string& name, float value) const;
+	void SetFloatArray(const std::string& name, const float* values, int count) const;
+	void SetMat3(const std::string& name, const glm::mat3& value) const;
 	void SetMat4(const std::string& name, const glm::mat4& value) const;
+	void SetVec2(const std::string& name, const glm::vec2& value) const;
 	void SetVec3(const std::string& name, const glm::vec3& value) const;
 
 	void SetMVPMatrix(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const;
 
+	// lit shaders take precomputed matrices instead of inverting the model matrix per vertex
+	void SetObjectMatrices(const glm::mat4& model, const glm::mat4& mvp, const glm::mat3& normalMatrix) const;
+
+	// -1 when the program has no such active uniform
+	int GetUniformLocation(const std::string& name) const;
+	ObjectMatrixLocations GetObjectMatrixLocations() const;
+
 private:
 	std::string GetCodeFromFile(const char* filePath);
 	int CompileShader(const char* shaderSource, GLenum shaderType, unsigned int& outShader);
-	int SetupProgram(unsigned int vertexShader, unsigned int fragmentShader);
+	int SetupProgram(unsigned int vertexShader, unsigned int fragmentShader, unsigned int geometryShader);
 };
\ No newline at end of file
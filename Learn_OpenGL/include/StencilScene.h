@@ -4,6 +4,7 @@
 #include <Camera.h>
 #include <vector>
 #include <ICustomScene.h>
+#include <TextureArray.h>
 
 class StencilScene : public ICustomScene
 {
@@ -19,8 +20,9 @@ private:
 	unsigned int m_cubeVAO = 0;
 	unsigned int m_planeVAO = 0;
 
-	unsigned int m_cubeTexture = 0;
-	unsigned int m_floorTexture = 0;
+	TextureArray m_textures;
+	int m_cubeLayer = 0;
+	int m_floorLayer = 0;
 
 	std::vector<float> m_cubeVertices;
 	std::vector<float> m_planeVertices;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Space handed out by a StreamBuffer: data is where the CPU writes, buffer and offset where the GL
+// reads it (attribute pointers, glBindBufferRange, draw offsets). Valid until the frame's EndFrame
+struct StreamAllocation
+{
+	void* data = nullptr;
+	unsigned int buffer = 0;
+	size_t offset = 0;
+	size_t size = 0;
+
+	bool IsValid() const { return data != nullptr; }
+};
+
+// Ring buffer for data rewritten every frame: uniforms, instance attributes, transient geometry. With
+// GL_ARB_buffer_storage the buffer is mapped once, persistent and coherent, and split in
+// FRAMES_IN_FLIGHT partitions; a frame bump allocates in its own and fences it when it ends, so by the
+// time the ring comes back to a partition the GPU is almost always done with it and BeginFrame doesn't
+// wait. Without the extension allocations go to a CPU copy, Flush uploads them with glBufferSubData
+// and every frame orphans the buffer with glBufferData, the driver keeps the old storage alive for the
+// draws still reading it.
+class StreamBuffer
+{
+public:
+	static const int FRAMES_IN_FLIGHT = 3;
+
+	StreamBuffer() = default;
+	// GL thread only, like Setup
+	~StreamBuffer();
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// frameSize is the most a single frame can allocate, target is the binding used for the uploads
+	void Setup(size_t frameSize, GLenum target = GL_ARRAY_BUFFER);
+
+	// frames bracket every allocation, BeginFrame waits if the GPU still reads the partition it reuses
+	void BeginFrame();
+	void EndFrame();
+
+	// alignment is a power of two; an invalid allocation means the frame is full, the caller then falls
+	// back to its unbuffered path
+	StreamAllocation Allocate(size_t size, size_t alignment = 16);
+	// aligned for glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+	StreamAllocation AllocateUniforms(size_t size);
+	// Allocate and copy in one go
+	StreamAllocation Upload(const void* data, size_t size, size_t alignment = 16);
+
+	// makes what was written since the last Flush visible to the GL, before the draws that read it
+	void Flush();
+
+	unsigned int GetBuffer() const { return m_buffer; }
+	bool IsPersistent() const { return m_mapped != nullptr; }
+	size_t GetFrameSize() const { return m_frameSize; }
+	// bytes allocated in the current frame
+	size_t GetFrameUsed() const { return m_head; }
+	// frames BeginFrame had to wait for the GPU since Setup
+	int GetWaitCount() const { return m_waitCount; }
+
+private:
+	unsigned int m_buffer = 0;
+	GLenum m_target = GL_ARRAY_BUFFER;
+	size_t m_frameSize = 0;
+	size_t m_uniformAlignment = 256;
+
+	// persistent path
+	unsigned char* m_mapped = nullptr;
+	GLsync m_fences[FRAMES_IN_FLIGHT] = {};
+	int m_frame = 0;
+
+	// orphaning path
+	std::vector<unsigned char> m_staging;
+	size_t m_flushed = 0;
+
+	size_t m_head = 0;
+	bool m_inFrame = false;
+	bool m_overflowReported = false;
+	int m_waitCount = 0;
+};
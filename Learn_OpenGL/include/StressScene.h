@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Camera.h>
+#include <ICustomScene.h>
+#include <FileScene.h>
+#include <SceneFile.h>
+#include <GpuTimer.h>
+#include <memory>
+#include <vector>
+
+// Size of a generated stress scene, the same settings and seed always give the same scene
+struct StressSceneSettings
+{
+	unsigned int objects = 2000;	// cubes, with some planes and backpacks among them
+	unsigned int lights = 4;		// point lights, on top of one directional light
+	unsigned int textures = 4;		// materials, each with its own diffuse texture while there are files left
+	unsigned int quads = 64;		// transparent, sorted every frame
+	unsigned int seed = 1;
+};
+
+// Procedurally generated FileScene, to see how the renderer scales with each dimension of a scene.
+// The benchmark sweeps the dimensions one at a time from the current settings and prints a CSV line
+// per step (dimension, value, CPU submit time, GPU time), measured from the scene's own camera.
+// The BVH benchmark runs on the CPU alone, over generated scenes of growing size and the backpack's
+// triangles.
+class StressScene : public ICustomScene
+{
+public:
+	StressScene(const StressSceneSettings& settings = StressSceneSettings());
+	virtual void Setup() override;
+	virtual void Draw(const Camera& camera) override;
+	virtual void SetupCamera(Camera& camera) override;
+
+	// B runs the sweep, H the BVH benchmark, P prints the scene stats and C, K, I are the FileScene ones
+	virtual void OnKeyPressed(int key) override;
+
+	static void Generate(const StressSceneSettings& settings, SceneData& outScene);
+
+private:
+	struct BenchmarkStep
+	{
+		const char* dimension;
+		unsigned int value;
+		StressSceneSettings settings;
+	};
+
+	void BuildScene(const StressSceneSettings& settings);
+	void StartBenchmark();
+	void UpdateBenchmark(float cpuMs);
+	void RunBvhBenchmark() const;
+	void RunTriangleBvhBenchmark() const;
+
+	StressSceneSettings m_settings;
+	std::unique_ptr<FileScene> m_scene;
+	Camera m_sceneCamera;
+
+	GpuTimer m_frameTimer;
+	std::vector<BenchmarkStep> m_benchmarkSteps;
+	size_t m_benchmarkStep = 0;
+	int m_benchmarkFrame = -1;	// -1 when no benchmark is running
+	float m_benchmarkCpuMs = 0.0f;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Shader.h>
+#include <KtxLoader.h>
+#include <string>
+#include <vector>
+
+// Packs textures into the layers of a single GL_TEXTURE_2D_ARRAY: a scene (or a model) binds it once
+// and only changes the "layer" uniform between draws instead of rebinding a GL_TEXTURE_2D per object
+class TextureArray
+{
+public:
+	TextureArray();
+
+	// 0 keeps the size of the first texture, textures of another size are resampled to the layer size
+	void SetLayerSize(int width, int height);
+
+	// Returns the layer the texture will occupy; the image itself is only read by Build
+	int AddTexture(const char* path, const std::string& directory);
+
+	// Uploads every layer: compressed when all of them have matching cooked KTX2 siblings, RGBA8 otherwise
+	unsigned int Build();
+
+	// deletes the GL texture, the layers stay so Build can upload them again
+	void Release();
+
+	void Bind(unsigned int unit) const;
+	// Sets the "layer" and "clampToEdge" uniforms of the shader's texture1 lookup
+	void SelectLayer(const Shader& shader, int layer) const;
+
+	unsigned int GetID() const { return m_id; }
+	int GetLayerCount() const { return (int)m_layers.size(); }
+
+private:
+	struct Layer
+	{
+		std::string path;
+		bool clampToEdge = false;	// layers with alpha, which would bleed top-bottom when repeated
+	};
+
+	bool BuildCompressed();
+	void BuildUncompressed();
+
+	std::vector<Layer> m_layers;
+	int m_width = 0;
+	int m_height = 0;
+	unsigned int m_id = 0;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <KtxLoader.h>
+#include <vector>
+
+// Offline block compression used by the asset cooker: builds the full mip chain of an image and
+// encodes it to BC1 (RGB), BC3 (RGBA) or BC4 (single channel). Grey + alpha images are encoded as RGBA
+class TextureCompressor
+{
+public:
+	// faces are tightly packed 8 bit images of the same size, top row first; 1 face for 2D textures, 6 for cubemaps
+	static bool Compress(const std::vector<const unsigned char*>& faces, int width, int height, int channels, KtxData& outData);
+
+	static void EncodeBC1Block(const unsigned char rgba[64], unsigned char outBlock[8]);
+	static void EncodeBC4Block(const unsigned char values[16], unsigned char outBlock[8]);
+
+private:
+	static std::vector<unsigned char> Downsample(const std::vector<unsigned char>& image, int width, int height, int channels);
+	static void EncodeImage(const std::vector<unsigned char>& image, int width, int height, int channels, unsigned int vkFormat, std::vector<unsigned char>& out);
+};
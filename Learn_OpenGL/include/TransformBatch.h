@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Holds the per-object matrices a lit shader needs (model, MVP and normal matrix) for a set of objects.
+// Normal matrices only depend on the model matrix so they are computed once when the models are set,
+// MVPs are recomputed in a single SIMD batch whenever the camera changes.
+class TransformBatch
+{
+public:
+	TransformBatch();
+
+	void SetModels(const std::vector<glm::mat4>& models);
+	void SetModel(size_t index, const glm::mat4& model);
+	void Update(const glm::mat4& viewProj);
+
+	size_t Size() const { return m_models.size(); }
+	const glm::mat4& GetModel(size_t index) const { return m_models[index]; }
+	const glm::mat4& GetMVP(size_t index) const { return m_mvps[index]; }
+	const glm::mat3& GetNormalMatrix(size_t index) const { return m_normalMatrices[index]; }
+
+	// transpose(inverse(mat3(model))) computed from the cofactors of the upper 3x3
+	static glm::mat3 ComputeNormalMatrix(const glm::mat4& model);
+
+	// out[i] = lhs * rhs[i]
+	static void MultiplyBatch(const glm::mat4& lhs, const glm::mat4* rhs, glm::mat4* out, size_t count);
+
+private:
+	std::vector<glm::mat4> m_models;
+	std::vector<glm::mat4> m_mvps;
+	std::vector<glm::mat3> m_normalMatrices;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+// Scene graph of local translation/rotation/scale transforms stored as parallel arrays. Nodes are kept in
+// depth-first order, a parent before its children and every subtree contiguous, so one forward pass
+// computes all the world matrices. Setting a transform marks the node dirty and Update only recomputes
+// the dirty nodes and their descendants; a hierarchy that didn't change costs a single test.
+// Large updates are split into jobs at the boundaries between root subtrees, which share nothing.
+class TransformHierarchy
+{
+public:
+	static const int NO_PARENT = -1;
+
+	TransformHierarchy();
+
+	// the parent has to be the last node added or one of its ancestors, which keeps the depth-first order
+	int AddNode(int parent, const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		const glm::vec3& scale = glm::vec3(1.0f));
+	void Clear();
+
+	void SetLocal(int node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	void SetPosition(int node, const glm::vec3& position);
+	void SetRotation(int node, const glm::quat& rotation);
+	void SetScale(int node, const glm::vec3& scale);
+
+	const glm::vec3& GetPosition(int node) const { return m_positions[node]; }
+	const glm::quat& GetRotation(int node) const { return m_rotations[node]; }
+	const glm::vec3& GetScale(int node) const { return m_scales[node]; }
+	int GetParent(int node) const { return m_parents[node]; }
+	size_t Size() const { return m_parents.size(); }
+
+	// false when nothing was dirty
+	bool Update();
+	// valid after the Update following the last change
+	const glm::mat4& GetWorld(int node) const { return m_worlds[node]; }
+
+	// world matrices recomputed by the last Update
+	size_t GetLastUpdateCount() const { return m_lastUpdateCount; }
+	// 0 uses every JobSystem thread, 1 always updates on the calling thread
+	void SetThreadCount(unsigned int threadCount) { m_threadCount = threadCount; }
+
+private:
+	void MarkDirty(int node);
+	size_t UpdateRange(size_t begin, size_t end);
+
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::quat> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	std::vector<int> m_parents;
+	std::vector<int> m_subtreeEnds;	// one past the last descendant
+	std::vector<unsigned char> m_dirty;
+	std::vector<glm::mat4> m_worlds;
+
+	size_t m_firstDirty;	// Size() when nothing is dirty
+	size_t m_lastUpdateCount = 0;
+	unsigned int m_threadCount = 0;
+};
@@ -15,6 +15,9 @@ public:
 	static void SetupScreenQuad(unsigned int& VAO);
 	static void SetupTransparent(unsigned int& VAO);
 
+	// deletes a VAO made by one of the above along with its vertex and index buffers
+	static void Release(unsigned int& VAO);
+
 private:
 	static unsigned int setupEBO(const unsigned int* indices, unsigned int size);
 	static unsigned int setupVBO(const float* vertices, unsigned int size);
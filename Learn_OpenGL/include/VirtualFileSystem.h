@@ -0,0 +1,29 @@
+#pragma once
+
+#include <AssetPack.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Single entry point for asset reads: paths are looked up in the mounted packs (last mounted
+// first) and fall back to loose files on disk, so ".\\resources\\..." paths work either way
+class VirtualFileSystem
+{
+public:
+	static bool Mount(const std::string& packPath);
+	static void UnmountAll();
+
+	static bool Exists(const std::string& path);
+	static bool Read(const std::string& path, FileData& outFile);
+	// like Read, but a loose file is memory-mapped instead of copied, for large files read in place
+	static bool Map(const std::string& path, FileData& outFile);
+	static bool ReadText(const std::string& path, std::string& outText);
+
+	// ".\\resources\\textures\\..\\textures\\Marble.jpg" -> "resources/textures/marble.jpg"
+	static std::string NormalizePath(const std::string& path);
+
+private:
+	static bool ReadLooseFile(const std::string& path, FileData& outFile);
+
+	static std::vector<std::unique_ptr<AssetPack>> s_packs;
+};
@@ -0,0 +1,13 @@
+#version 330 core
+in vec3 Normal;
+in vec3 Color;
+
+out vec4 FragColor;
+
+uniform vec3 lightDirection;
+
+void main()
+{
+    float diffuse = max(dot(normalize(Normal), -lightDirection), 0.0);
+    FragColor = vec4(Color * (0.3 + 0.7 * diffuse), 1.0);
+}
\ No newline at end of file
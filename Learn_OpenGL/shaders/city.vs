@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec3 aColor;
+
+out vec3 Normal;
+out vec3 Color;
+
+uniform mat4 viewProj;
+
+// 0 draws every instance, 1 the ones visible in the previous test, 2 the ones only the current test found
+uniform int cullPhase;
+uniform sampler2D previousVisibility;
+uniform sampler2D currentVisibility;
+uniform int visibilityWidth;
+
+void main()
+{
+    ivec2 cell = ivec2(gl_InstanceID % visibilityWidth, gl_InstanceID / visibilityWidth);
+    bool wasVisible = texelFetch(previousVisibility, cell, 0).r > 0.5;
+    bool drawn = cullPhase == 0
+        || (cullPhase == 1 && wasVisible)
+        || (cullPhase == 2 && !wasVisible && texelFetch(currentVisibility, cell, 0).r > 0.5);
+
+    // the boxes are only scaled along their axes, the model matrix keeps their normals
+    Normal = mat3(aModel) * aNormal;
+    Color = aColor;
+
+    // culled instances end up past the far plane, the whole triangle is clipped before rasterization
+    gl_Position = drawn ? viewProj * aModel * vec4(aPos, 1.0) : vec4(0.0, 0.0, 2.0, 1.0);
+}
\ No newline at end of file
@@ -3,7 +3,20 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D texture1;
+uniform sampler2DArray texture1;
+uniform float layer;
+uniform bool clampToEdge;
+
+vec4 SampleLayer(vec2 texCoords)
+{
+    // layers with alpha are clamped half a texel in, the array itself repeats
+    if (clampToEdge)
+    {
+        vec2 halfTexel = 0.5 / vec2(textureSize(texture1, 0).xy);
+        texCoords = clamp(texCoords, halfTexel, 1.0 - halfTexel);
+    }
+    return texture(texture1, vec3(texCoords, layer));
+}
 
 float near = 0.1;
 float far = 100.0;
@@ -16,7 +29,7 @@ float LinearizeDepth(float depth)
 
 void main()
 {   
-    vec4 texColor = texture(texture1, TexCoords);
+    vec4 texColor = SampleLayer(TexCoords);
     //if (texColor.a < 0.1)
     //{
     //    discard;
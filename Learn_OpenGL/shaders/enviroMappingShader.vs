@@ -6,12 +6,12 @@ out vec3 Normal;
 out vec3 Position;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 mvp;
+uniform mat3 normalMatrix;
 
 void main()
 {
-	Normal = mat3(transpose(inverse(model))) * aNormal;
+	Normal = normalMatrix * aNormal;
 	Position = vec3(model * vec4(aPos, 1.0));
-	gl_Position = projection * view * vec4(Position, 1.0);
+	gl_Position = mvp * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 330 core
+out float FragDepth;
+
+uniform sampler2D depthTexture;
+
+void main()
+{
+    FragDepth = texelFetch(depthTexture, ivec2(gl_FragCoord.xy), 0).r;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 330 core
+out float FragDepth;
+
+// the sampler only sees the previous level, texelFetch level 0 is that level
+uniform sampler2D previousLevel;
+uniform vec2 previousSize;
+
+float Fetch(ivec2 coord)
+{
+    // clamped for the levels that are already one texel wide or tall
+    return texelFetch(previousLevel, min(coord, ivec2(previousSize) - 1), 0).r;
+}
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy) * 2;
+    float depth = max(max(Fetch(coord), Fetch(coord + ivec2(1, 0))), max(Fetch(coord + ivec2(0, 1)), Fetch(coord + ivec2(1, 1))));
+
+    // an odd sized level loses its last column/row when halved, the last texel of this level covers it
+    ivec2 size = ivec2(previousSize);
+    bool extraColumn = (size.x & 1) != 0 && coord.x + 3 == size.x;
+    bool extraRow = (size.y & 1) != 0 && coord.y + 3 == size.y;
+    if (extraColumn)
+        depth = max(depth, max(Fetch(coord + ivec2(2, 0)), Fetch(coord + ivec2(2, 1))));
+    if (extraRow)
+        depth = max(depth, max(Fetch(coord + ivec2(0, 2)), Fetch(coord + ivec2(1, 2))));
+    if (extraColumn && extraRow)
+        depth = max(depth, Fetch(coord + ivec2(2, 2)));
+
+    FragDepth = depth;
+}
\ No newline at end of file
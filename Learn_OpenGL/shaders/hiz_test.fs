@@ -0,0 +1,9 @@
+#version 330 core
+flat in float Visible;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(Visible);
+}
\ No newline at end of file
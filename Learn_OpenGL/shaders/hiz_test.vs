@@ -0,0 +1,61 @@
+#version 330 core
+layout (location = 0) in vec4 aSphere;
+
+flat out float Visible;
+
+uniform mat4 viewProj;
+uniform sampler2D hiZ;
+uniform int mipCount;
+uniform int outputWidth;
+uniform vec2 outputSize;
+
+void main()
+{
+    // one texel of the visibility texture per object
+    vec2 cell = vec2(gl_VertexID % outputWidth, gl_VertexID / outputWidth);
+    gl_Position = vec4((cell + 0.5) / outputSize * 2.0 - 1.0, 0.0, 1.0);
+
+    // screen rectangle and nearest depth of the box around the sphere
+    vec3 minNdc = vec3(1.0e9);
+    vec3 maxNdc = vec3(-1.0e9);
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = aSphere.xyz + aSphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProj * vec4(corner, 1.0);
+
+        // a box crossing the near plane has no usable rectangle, it is kept
+        if (clip.w <= 0.0 || clip.z < -clip.w)
+        {
+            Visible = 1.0;
+            return;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        minNdc = min(minNdc, ndc);
+        maxNdc = max(maxNdc, ndc);
+    }
+
+    // outside the frustum
+    if (any(greaterThan(minNdc, vec3(1.0))) || any(lessThan(maxNdc.xy, vec2(-1.0))))
+    {
+        Visible = 0.0;
+        return;
+    }
+
+    // the level where the rectangle covers at most two texels each way
+    vec2 baseSize = vec2(textureSize(hiZ, 0));
+    vec2 minPixel = clamp(minNdc.xy * 0.5 + 0.5, 0.0, 1.0) * baseSize;
+    vec2 maxPixel = min(clamp(maxNdc.xy * 0.5 + 0.5, 0.0, 1.0) * baseSize, baseSize - 1.0);
+    vec2 extent = maxPixel - minPixel;
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, mipCount - 1);
+
+    ivec2 levelMax = textureSize(hiZ, level) - 1;
+    ivec2 minTexel = min(ivec2(minPixel) >> level, levelMax);
+    ivec2 maxTexel = min(ivec2(maxPixel) >> level, levelMax);
+    float farthest = max(
+        max(texelFetch(hiZ, minTexel, level).r, texelFetch(hiZ, ivec2(maxTexel.x, minTexel.y), level).r),
+        max(texelFetch(hiZ, ivec2(minTexel.x, maxTexel.y), level).r, texelFetch(hiZ, maxTexel, level).r));
+
+    // visible when its nearest point is in front of the farthest depth drawn over that area
+    Visible = minNdc.z * 0.5 + 0.5 <= farthest ? 1.0 : 0.0;
+}
\ No newline at end of file
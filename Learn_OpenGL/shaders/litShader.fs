@@ -3,8 +3,10 @@
 out vec4 FragColor;
 
 struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
+    // diffuse and specular maps are layers of one array, a negative specular layer means no specular map
+    sampler2DArray textures;
+    float diffuseLayer;
+    float specularLayer;
     float shininess;
 };
 
@@ -41,6 +43,8 @@ struct SpotLight {
 };
 
 #define NR_POINT_LIGHTS 4
+#define CASCADE_COUNT 3
+#define MAX_POINT_SHADOWS 2
 
 in vec3 Normal;
 in vec3 FragPos;
@@ -53,14 +57,35 @@ uniform DirLight dirLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform SpotLight spotLight;
 
+// directional light shadows, see CascadedShadowMap
+uniform bool shadowsEnabled;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 lightSpaceMatrices[CASCADE_COUNT];
+uniform float cascadeSplits[CASCADE_COUNT];
+uniform vec3 cameraFront;
+
+// point light shadows, see PointShadowMaps. Slot -1 means the light has no shadow this frame
+uniform samplerCubeShadow pointShadowMaps[MAX_POINT_SHADOWS];
+uniform int pointShadowSlots[NR_POINT_LIGHTS];
+uniform float pointShadowFar;
+
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 fragPos);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 fragPos, float lit);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 viewDir, vec3 fragPos);
+float CalcDirShadow(vec3 normal, vec3 lightDir, vec3 fragPos);
+float CalcPointShadow(int slot, vec3 lightPos, vec3 fragPos);
+
+// sampled once per fragment and shared by every light
+vec3 diffuseColor;
+vec3 specularColor;
 
 void main()
 {
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
+
+    diffuseColor = texture(material.textures, vec3(TexCoords, material.diffuseLayer)).rgb;
+    specularColor = material.specularLayer < 0.0 ? vec3(0.0) : texture(material.textures, vec3(TexCoords, material.specularLayer)).rgb;
     
     // phase 1: Directional lighting
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
@@ -68,7 +93,8 @@ void main()
     // phase 2: Point lights
     for (int i = 0; i < NR_POINT_LIGHTS; i++)
     {
-        result += CalcPointLight(pointLights[i], norm, viewDir, FragPos);
+        float lit = CalcPointShadow(pointShadowSlots[i], pointLights[i].position, FragPos);
+        result += CalcPointLight(pointLights[i], norm, viewDir, FragPos, lit);
     }
     
     // phase 3: Spotlight
@@ -88,15 +114,49 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
+    // shadowing
+    float lit = CalcDirShadow(normal, lightDir, FragPos);
+
     // combine results
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
 
-    return (ambient + diffuse + specular);
+    return (ambient + lit * (diffuse + specular));
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 fragPos)
+float CalcDirShadow(vec3 normal, vec3 lightDir, vec3 fragPos)
+{
+    if (!shadowsEnabled)
+        return 1.0;
+
+    // the cascades are split along the view depth
+    float depth = dot(fragPos - viewPos, cameraFront);
+    if (depth >= cascadeSplits[CASCADE_COUNT - 1])
+        return 1.0;
+
+    int cascade = 0;
+    while (depth >= cascadeSplits[cascade])
+        cascade++;
+
+    // orthographic projection, no divide needed
+    vec3 coords = (lightSpaceMatrices[cascade] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+    float bias = max(0.004 * (1.0 - dot(normal, lightDir)), 0.0008);
+
+    // 3x3 taps of hardware filtered comparisons
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z - bias));
+        }
+    }
+    return lit / 9.0;
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 fragPos, float lit)
 {
     vec3 lightDir = normalize(light.position - fragPos);
 
@@ -112,15 +172,29 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 fragPos)
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
     // combine results
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
 
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
 
-    return (ambient + diffuse + specular);
+    return (ambient + lit * (diffuse + specular));
+}
+
+float CalcPointShadow(int slot, vec3 lightPos, vec3 fragPos)
+{
+    if (slot < 0)
+        return 1.0;
+
+    vec3 toFrag = fragPos - lightPos;
+    float reference = length(toFrag) / pointShadowFar - 0.005;
+
+    // GLSL 3.30 only allows constant indices into sampler arrays
+    if (slot == 0)
+        return texture(pointShadowMaps[0], vec4(toFrag, reference));
+    return texture(pointShadowMaps[1], vec4(toFrag, reference));
 }
 
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 viewDir, vec3 fragPos)
@@ -140,9 +214,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 viewDir, vec3 fragPos)
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
 
     // combine results
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
 
     ambient *= intensity;
     diffuse *= intensity;
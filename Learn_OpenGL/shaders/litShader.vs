@@ -3,10 +3,17 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance, only read by instanced draws
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in mat3 aNormalMatrix;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 mvp;
+uniform mat3 normalMatrix;
+
+// instanced draws take their matrices from the attributes and only share viewProj
+uniform bool instanced;
+uniform mat4 viewProj;
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -14,9 +21,10 @@ out vec2 TexCoords;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    mat4 objectModel = instanced ? aModel : model;
+    FragPos = vec3(objectModel * vec4(aPos, 1.0));
+    Normal = (instanced ? aNormalMatrix : normalMatrix) * aNormal;
     TexCoords = aTexCoords;
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = instanced ? viewProj * vec4(FragPos, 1.0) : mvp * vec4(aPos, 1.0);
 }
\ No newline at end of file
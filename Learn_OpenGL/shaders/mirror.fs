@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+// the reflection is rendered with the same screen mapping as the scene, only at a lower resolution
+uniform sampler2D reflection;
+uniform vec2 screenSize;
+uniform bool hasReflection;
+
+void main()
+{
+    if (!hasReflection)
+    {
+        // back of the mirror
+        FragColor = vec4(0.2, 0.2, 0.2, 1.0);
+        return;
+    }
+    vec3 col = texture(reflection, gl_FragCoord.xy / screenSize).rgb;
+    FragColor = vec4(col * vec3(0.9, 0.95, 1.0), 1.0);
+}
\ No newline at end of file
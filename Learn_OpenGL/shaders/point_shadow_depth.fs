@@ -0,0 +1,11 @@
+#version 330 core
+in vec3 FragPos;
+
+uniform vec3 lightPos;
+uniform float farPlane;
+
+void main()
+{
+    // linear distance to the light, the same in every direction of the cube
+    gl_FragDepth = length(FragPos - lightPos) / farPlane;
+}
\ No newline at end of file
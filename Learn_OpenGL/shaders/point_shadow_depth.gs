@@ -0,0 +1,27 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+out vec3 FragPos;
+
+// faces the current caster touches, one bit per cubemap face
+uniform int faceMask;
+uniform mat4 faceViewProj[6];
+
+void main()
+{
+    for (int face = 0; face < 6; face++)
+    {
+        if ((faceMask & (1 << face)) == 0)
+            continue;
+
+        gl_Layer = face;
+        for (int v = 0; v < 3; v++)
+        {
+            FragPos = gl_in[v].gl_Position.xyz;
+            gl_Position = faceViewProj[face] * gl_in[v].gl_Position;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
\ No newline at end of file
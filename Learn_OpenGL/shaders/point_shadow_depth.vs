@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+// the face projections are applied per layer in point_shadow_depth.gs
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// must match PostProcessStack::MAX_BLUR_RADIUS / 2 + 1
+#define MAX_BLUR_TAPS 33
+
+uniform sampler2D screenTexture;
+
+// one texel along the blur axis
+uniform vec2 direction;
+
+// tap 0 is the center texel, every other tap sits between two texels so the bilinear
+// filter fetches both with their combined gaussian weight
+uniform int tapCount;
+uniform float offsets[MAX_BLUR_TAPS];
+uniform float weights[MAX_BLUR_TAPS];
+
+void main()
+{
+    vec3 col = texture(screenTexture, TexCoords).rgb * weights[0];
+    for (int i = 1; i < tapCount; i++)
+    {
+        vec2 offset = direction * offsets[i];
+        col += texture(screenTexture, TexCoords + offset).rgb * weights[i];
+        col += texture(screenTexture, TexCoords - offset).rgb * weights[i];
+    }
+    FragColor = vec4(col, 1.0);
+}
\ No newline at end of file
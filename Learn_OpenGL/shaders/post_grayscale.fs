@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+
+void main()
+{
+    vec3 col = texture(screenTexture, TexCoords).rgb;
+    float average = dot(col, vec3(0.2126, 0.7152, 0.0722));
+    FragColor = vec4(average, average, average, 1.0);
+}
\ No newline at end of file
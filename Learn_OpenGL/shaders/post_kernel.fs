@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+
+// 3x3 kernel, row by row from the top-left texel
+uniform float kernel[9];
+
+void main()
+{
+    vec3 col =
+        textureOffset(screenTexture, TexCoords, ivec2(-1,  1)).rgb * kernel[0] +
+        textureOffset(screenTexture, TexCoords, ivec2( 0,  1)).rgb * kernel[1] +
+        textureOffset(screenTexture, TexCoords, ivec2( 1,  1)).rgb * kernel[2] +
+        textureOffset(screenTexture, TexCoords, ivec2(-1,  0)).rgb * kernel[3] +
+        texture(screenTexture, TexCoords).rgb * kernel[4] +
+        textureOffset(screenTexture, TexCoords, ivec2( 1,  0)).rgb * kernel[5] +
+        textureOffset(screenTexture, TexCoords, ivec2(-1, -1)).rgb * kernel[6] +
+        textureOffset(screenTexture, TexCoords, ivec2( 0, -1)).rgb * kernel[7] +
+        textureOffset(screenTexture, TexCoords, ivec2( 1, -1)).rgb * kernel[8];
+    FragColor = vec4(col, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 LocalPos;
+
+uniform sampler2D texture1;
+uniform samplerCube skybox;
+uniform bool drawSkybox;
+
+void main()
+{
+    if (drawSkybox)
+        FragColor = texture(skybox, LocalPos);
+    else
+        FragColor = texture(texture1, TexCoords);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+in vec2 vTexCoords[];
+in vec3 vLocalPos[];
+
+out vec2 TexCoords;
+out vec3 LocalPos;
+
+// faces rendered this frame, set by ReflectionProbe::Begin
+uniform int faceCount;
+uniform int faces[6];
+uniform mat4 faceViewProj[6];
+
+void main()
+{
+    for (int i = 0; i < faceCount; i++)
+    {
+        gl_Layer = faces[i];
+        for (int v = 0; v < 3; v++)
+        {
+            TexCoords = vTexCoords[v];
+            LocalPos = vLocalPos[v];
+            gl_Position = faceViewProj[i] * gl_in[v].gl_Position;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
\ No newline at end of file
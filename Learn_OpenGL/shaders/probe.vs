@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 vTexCoords;
+out vec3 vLocalPos;
+
+uniform mat4 model;
+
+// the face projections are applied per layer in probe.gs
+void main()
+{
+    vTexCoords = aTexCoords;
+    vLocalPos = aPos;
+    gl_Position = model * vec4(aPos, 1.0);
+}
\ No newline at end of file
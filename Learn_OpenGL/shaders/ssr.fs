@@ -0,0 +1,85 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 ViewPos;
+
+// copy of the opaque pass, the surface itself is drawn on top of it
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+uniform samplerCube skybox;
+
+uniform mat4 projection;
+uniform mat3 inverseView;	// rotation part only, for the skybox lookup
+uniform vec3 viewNormal;	// the reflective surface is flat
+
+uniform int maxSteps;
+uniform float stepSize;
+uniform float thickness;
+
+float GetViewDepth(vec2 uv)
+{
+    // inverse of the perspective depth mapping, negative like view space z
+    float ndcDepth = texture(sceneDepth, uv).r * 2.0 - 1.0;
+    return -projection[3][2] / (ndcDepth + projection[2][2]);
+}
+
+vec2 ProjectToScreen(vec3 viewPos)
+{
+    vec4 clip = projection * vec4(viewPos, 1.0);
+    return clip.xy / clip.w * 0.5 + 0.5;
+}
+
+bool IsOnScreen(vec2 uv)
+{
+    return all(greaterThanEqual(uv, vec2(0.0))) && all(lessThanEqual(uv, vec2(1.0)));
+}
+
+void main()
+{
+    vec3 dir = normalize(reflect(normalize(ViewPos), viewNormal));
+    vec3 fallback = texture(skybox, inverseView * dir).rgb;
+
+    // march along the reflected ray until it goes behind the depth buffer
+    vec3 pos = ViewPos;
+    vec3 step = dir * stepSize;
+    vec2 hitUV = vec2(-1.0);
+    for (int i = 0; i < maxSteps; i++)
+    {
+        pos += step;
+        if (pos.z >= 0.0)
+            break;
+
+        vec2 uv = ProjectToScreen(pos);
+        if (!IsOnScreen(uv))
+            break;
+
+        float delta = GetViewDepth(uv) - pos.z;
+        if (delta > 0.0 && delta < thickness)
+        {
+            // binary search between the last two samples for the crossing point
+            vec3 lo = pos - step;
+            vec3 hi = pos;
+            for (int j = 0; j < 5; j++)
+            {
+                vec3 mid = (lo + hi) * 0.5;
+                if (GetViewDepth(ProjectToScreen(mid)) - mid.z > 0.0)
+                    hi = mid;
+                else
+                    lo = mid;
+            }
+            hitUV = ProjectToScreen(hi);
+            break;
+        }
+        step *= 1.05;
+    }
+
+    vec3 col = fallback;
+    if (hitUV.x >= 0.0)
+    {
+        // fade to the skybox near the screen borders where the ray data runs out
+        vec2 edge = min(hitUV, 1.0 - hitUV);
+        float fade = clamp(min(edge.x, edge.y) * 10.0, 0.0, 1.0);
+        col = mix(fallback, texture(sceneColor, hitUV).rgb, fade);
+    }
+    FragColor = vec4(col * vec3(0.9, 0.95, 1.0), 1.0);
+}
\ No newline at end of file
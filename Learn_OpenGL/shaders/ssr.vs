@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+out vec3 ViewPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 viewPos = view * model * vec4(aPos, 1.0);
+    ViewPos = viewPos.xyz;
+    gl_Position = projection * viewPos;
+}
\ No newline at end of file
@@ -3,9 +3,22 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D texture1;
+uniform sampler2DArray texture1;
+uniform float layer;
+uniform bool clampToEdge;
+
+vec4 SampleLayer(vec2 texCoords)
+{
+    // layers with alpha are clamped half a texel in, the array itself repeats
+    if (clampToEdge)
+    {
+        vec2 halfTexel = 0.5 / vec2(textureSize(texture1, 0).xy);
+        texCoords = clamp(texCoords, halfTexel, 1.0 - halfTexel);
+    }
+    return texture(texture1, vec3(texCoords, layer));
+}
 
 void main()
 {    
-    FragColor = texture(texture1, TexCoords);
+    FragColor = SampleLayer(TexCoords);
 }
\ No newline at end of file
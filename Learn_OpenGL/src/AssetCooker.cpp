@@ -0,0 +1,484 @@
+#include "AssetCooker.h"
+#include <KtxLoader.h>
+#include <TextureCompressor.h>
+#include <MeshFile.h>
+#include <Model.h>
+#include <SceneFile.h>
+#include <AssetPack.h>
+#include <VirtualFileSystem.h>
+#include <JobSystem.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// bump when an encoder or a cooked format changes, it invalidates every manifest entry
+	const char* COOK_SETTINGS = "cook-v1 bc1/bc3/bc4/bc5 boxmips mesh-v4 joinvertices cachelocality quadriclods meshlets64x124 nodes scene-v1";
+
+	const char* CUBEMAP_FACES[6] = { "right", "left", "top", "bottom", "front", "back" };
+
+	const unsigned long long FNV_OFFSET = 14695981039346656037ull;
+	const unsigned long long FNV_PRIME = 1099511628211ull;
+
+	void HashBytes(unsigned long long& hash, const char* bytes, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= (unsigned char)bytes[i];
+			hash *= FNV_PRIME;
+		}
+	}
+
+	bool HashFile(unsigned long long& hash, const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		char buffer[64 * 1024];
+		while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+		{
+			HashBytes(hash, buffer, (size_t)file.gcount());
+		}
+		return true;
+	}
+
+	std::string ToLower(std::string value)
+	{
+		std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return value;
+	}
+
+	bool IsImage(const std::string& extension)
+	{
+		return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+	}
+
+	bool IsModel(const std::string& extension)
+	{
+		return extension == ".obj" || extension == ".blobj" || extension == ".fbx" || extension == ".gltf" || extension == ".glb" || extension == ".dae";
+	}
+
+	// "dir\skybox" holding right/left/top/bottom/front/back images, same extension for all six
+	bool FindCubemapFaces(const fs::path& directory, std::vector<std::string>& outFaces)
+	{
+		for (const char* extension : { ".jpg", ".png" })
+		{
+			outFaces.clear();
+			for (const char* face : CUBEMAP_FACES)
+			{
+				fs::path facePath = directory / (std::string(face) + extension);
+				if (!fs::is_regular_file(facePath))
+					break;
+				outFaces.push_back(facePath.string());
+			}
+			if (outFaces.size() == 6)
+				return true;
+		}
+		return false;
+	}
+}
+
+int AssetCooker::Run(int argc, char** argv)
+{
+	CookOptions options;
+	for (int i = 0; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--force")
+			options.force = true;
+		else if (arg == "--jobs" && i + 1 < argc)
+			options.jobs = (unsigned int)std::max(0, std::atoi(argv[++i]));
+		else if (!arg.empty() && arg[0] != '-')
+			options.root = arg;
+		else
+		{
+			std::cout << "usage: cook [--force] [--jobs N] [root]" << std::endl;
+			return 1;
+		}
+	}
+	return Cook(options);
+}
+
+int AssetCooker::Cook(const CookOptions& options)
+{
+	if (!fs::is_directory(options.root))
+	{
+		std::cout << "ERROR::COOK::ROOT_NOT_FOUND: " << options.root << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// cooked data is stored top row first, whatever the runtime flip setting is
+	stbi_set_flip_vertically_on_load(false);
+
+	std::vector<CookJob> jobs;
+	CollectJobs(options.root, jobs);
+
+	std::string manifestPath = GetManifestPath(options.root);
+	std::vector<std::pair<std::string, unsigned long long>> manifestEntries;
+	if (!options.force)
+		LoadManifest(manifestPath, manifestEntries);
+	std::map<std::string, unsigned long long> manifest(manifestEntries.begin(), manifestEntries.end());
+
+	// hashing reads every input, it runs on the workers along with the cooking itself
+	std::vector<char> results(jobs.size(), 0);	// 0 failed, 1 cooked, 2 up to date
+	std::mutex logMutex;
+
+	// the run is the only user of the job system, it can size it
+	if (options.jobs > 0)
+		JobSystem::Setup(options.jobs);
+	unsigned int threadCount = JobSystem::GetWorkerCount() + 1;
+
+	JobSystem::ParallelFor(jobs.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			CookJob& job = jobs[i];
+			job.hash = HashJob(job);
+
+			auto entry = manifest.find(job.output);
+			if (entry != manifest.end() && entry->second == job.hash && fs::exists(job.output))
+			{
+				results[i] = 2;
+				continue;
+			}
+
+			bool cooked = RunJob(job);
+			results[i] = cooked ? 1 : 0;
+
+			std::lock_guard<std::mutex> lock(logMutex);
+			std::cout << (cooked ? "cooked " : "FAILED ") << job.output << std::endl;
+		}
+	});
+
+	unsigned int cookedCount = 0, upToDateCount = 0, failedCount = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (results[i] == 0)
+		{
+			// a failed output is rebuilt next time
+			manifest.erase(jobs[i].output);
+			failedCount++;
+			continue;
+		}
+
+		manifest[jobs[i].output] = jobs[i].hash;
+		if (results[i] == 1)
+			cookedCount++;
+		else
+			upToDateCount++;
+	}
+
+	SaveManifest(manifestPath, std::vector<std::pair<std::string, unsigned long long>>(manifest.begin(), manifest.end()));
+
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "cook: " << cookedCount << " cooked, " << upToDateCount << " up to date, " << failedCount << " failed ("
+		<< threadCount << " threads, " << seconds << "s)" << std::endl;
+
+	return failedCount == 0 ? 0 : 1;
+}
+
+int AssetCooker::RunPack(int argc, char** argv)
+{
+	PackOptions options;
+	std::vector<std::string> roots;
+	for (int i = 0; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--lz4")
+			options.compress = true;
+		else if (arg == "--output" && i + 1 < argc)
+			options.output = argv[++i];
+		else if (!arg.empty() && arg[0] != '-')
+			roots.push_back(arg);
+		else
+		{
+			std::cout << "usage: pack [--lz4] [--output path] [dir...]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (!roots.empty())
+		options.roots = roots;
+	return Pack(options);
+}
+
+int AssetCooker::Pack(const PackOptions& options)
+{
+	std::vector<std::string> paths;
+	std::vector<std::string> names;
+	size_t totalSize = 0;
+
+	for (const std::string& root : options.roots)
+	{
+		if (!fs::is_directory(root))
+		{
+			std::cout << "ERROR::COOK::ROOT_NOT_FOUND: " << root << std::endl;
+			return 1;
+		}
+
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+		{
+			if (!entry.is_regular_file() || entry.path().filename() == "cook_manifest.txt" || IsSupersededByCookedFile(entry.path().string()))
+				continue;
+
+			// names match what the runtime asks for, e.g. ".\\resources\\textures/marble.jpg"
+			paths.push_back(entry.path().string());
+			names.push_back(VirtualFileSystem::NormalizePath(paths.back()));
+			totalSize += (size_t)entry.file_size();
+		}
+	}
+
+	if (!AssetPack::Write(options.output, paths, names, options.compress))
+		return 1;
+
+	std::cout << "pack: " << paths.size() << " files, " << totalSize / 1024 << " KB -> " << fs::file_size(options.output) / 1024
+		<< " KB in " << options.output << std::endl;
+	return 0;
+}
+
+bool AssetCooker::IsSupersededByCookedFile(const std::string& path)
+{
+	// the runtime loaders never open a source once its cooked file exists
+	fs::path source(path);
+	std::string extension = ToLower(source.extension().string());
+
+	if (IsImage(extension))
+	{
+		std::vector<std::string> faces;
+		fs::path directory = source.parent_path();
+		if (FindCubemapFaces(directory, faces) && fs::exists(directory.string() + ".ktx2"))
+			return true;
+
+		return fs::exists(KtxLoader::GetSiblingPath(path));
+	}
+	if (IsModel(extension) || extension == ".mtl")
+		return fs::exists(MeshFile::GetCookedPath(path));
+	if (extension == ".scene")
+		return fs::exists(SceneFile::GetCompiledPath(path));
+
+	return false;
+}
+
+void AssetCooker::CollectJobs(const std::string& root, std::vector<CookJob>& outJobs)
+{
+	std::vector<fs::path> cubemapDirectories;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+	{
+		std::vector<std::string> faces;
+		if (entry.is_directory() && FindCubemapFaces(entry.path(), faces))
+		{
+			CookJob job;
+			job.type = CookJobType::CUBEMAP;
+			job.inputs = faces;
+			job.output = entry.path().string() + ".ktx2";
+			outJobs.push_back(job);
+			cubemapDirectories.push_back(entry.path());
+		}
+	}
+
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		const fs::path& path = entry.path();
+		std::string extension = ToLower(path.extension().string());
+
+		if (IsImage(extension))
+		{
+			// faces are only used through the packed cubemap
+			if (std::find(cubemapDirectories.begin(), cubemapDirectories.end(), path.parent_path()) != cubemapDirectories.end())
+				continue;
+
+			CookJob job;
+			job.type = CookJobType::TEXTURE;
+			job.inputs.push_back(path.string());
+			job.output = KtxLoader::GetSiblingPath(path.string());
+			outJobs.push_back(job);
+		}
+		else if (IsModel(extension))
+		{
+			CookJob job;
+			job.type = CookJobType::MESH;
+			job.inputs.push_back(path.string());
+
+			// material library of .obj files, its texture list ends up in the cooked mesh
+			fs::path materials = fs::path(path).replace_extension(".mtl");
+			if (fs::is_regular_file(materials))
+				job.inputs.push_back(materials.string());
+
+			job.output = MeshFile::GetCookedPath(path.string());
+			outJobs.push_back(job);
+		}
+		else if (extension == ".scene")
+		{
+			CookJob job;
+			job.type = CookJobType::SCENE;
+			job.inputs.push_back(path.string());
+			job.output = SceneFile::GetCompiledPath(path.string());
+			outJobs.push_back(job);
+		}
+	}
+}
+
+bool AssetCooker::RunJob(const CookJob& job)
+{
+	switch (job.type)
+	{
+		case CookJobType::TEXTURE:
+			return CookTexture(job);
+		case CookJobType::CUBEMAP:
+			return CookCubemap(job);
+		case CookJobType::MESH:
+			return CookMesh(job);
+		case CookJobType::SCENE:
+			return CookScene(job);
+		default:
+			return false;
+	}
+}
+
+bool AssetCooker::CookTexture(const CookJob& job)
+{
+	int width, height, channels;
+	unsigned char* image = stbi_load(job.inputs[0].c_str(), &width, &height, &channels, 0);
+	if (!image)
+	{
+		std::cout << "ERROR::COOK::TEXTURE_NOT_LOADED: " << job.inputs[0] << std::endl;
+		return false;
+	}
+
+	KtxData data;
+	bool compressed = TextureCompressor::Compress({ image }, width, height, channels, data);
+	stbi_image_free(image);
+
+	return compressed && KtxLoader::WriteFile(job.output, data);
+}
+
+bool AssetCooker::CookCubemap(const CookJob& job)
+{
+	std::vector<unsigned char*> images;
+	int width = 0, height = 0, channels = 0;
+	bool loaded = true;
+
+	for (const std::string& face : job.inputs)
+	{
+		int faceWidth, faceHeight, faceChannels;
+		unsigned char* image = stbi_load(face.c_str(), &faceWidth, &faceHeight, &faceChannels, 0);
+		if (!image)
+		{
+			std::cout << "ERROR::COOK::TEXTURE_NOT_LOADED: " << face << std::endl;
+			loaded = false;
+			break;
+		}
+
+		images.push_back(image);
+		if (images.size() == 1)
+		{
+			width = faceWidth;
+			height = faceHeight;
+			channels = faceChannels;
+		}
+		else if (faceWidth != width || faceHeight != height || faceChannels != channels)
+		{
+			std::cout << "ERROR::COOK::CUBEMAP_FACES_MISMATCH: " << face << std::endl;
+			loaded = false;
+			break;
+		}
+	}
+
+	KtxData data;
+	bool cooked = loaded && TextureCompressor::Compress(std::vector<const unsigned char*>(images.begin(), images.end()), width, height, channels, data)
+		&& KtxLoader::WriteFile(job.output, data);
+
+	for (unsigned char* image : images)
+	{
+		stbi_image_free(image);
+	}
+	return cooked;
+}
+
+bool AssetCooker::CookMesh(const CookJob& job)
+{
+	std::vector<MeshData> meshes;
+	std::vector<ModelNode> nodes;
+	return Model::ImportMeshData(job.inputs[0], meshes, nodes, true) && MeshFile::Write(job.output, meshes, nodes);
+}
+
+bool AssetCooker::CookScene(const CookJob& job)
+{
+	std::string source, error;
+	SceneData scene;
+	if (!VirtualFileSystem::ReadText(job.inputs[0], source))
+	{
+		std::cout << "ERROR::COOK::SCENE_NOT_LOADED: " << job.inputs[0] << std::endl;
+		return false;
+	}
+	if (!SceneFile::Compile(source, scene, error))
+	{
+		std::cout << "ERROR::COOK::SCENE_NOT_COMPILED: " << job.inputs[0] << ": " << error << std::endl;
+		return false;
+	}
+	return SceneFile::WriteFile(job.output, scene);
+}
+
+unsigned long long AssetCooker::HashJob(const CookJob& job)
+{
+	unsigned long long hash = FNV_OFFSET;
+	HashBytes(hash, COOK_SETTINGS, std::strlen(COOK_SETTINGS));
+	for (const std::string& input : job.inputs)
+	{
+		HashBytes(hash, input.c_str(), input.size() + 1);
+		HashFile(hash, input);
+	}
+	return hash;
+}
+
+std::string AssetCooker::GetManifestPath(const std::string& root)
+{
+	return (fs::path(root) / "cook_manifest.txt").string();
+}
+
+void AssetCooker::LoadManifest(const std::string& path, std::vector<std::pair<std::string, unsigned long long>>& outEntries)
+{
+	// one "<hash> <output path>" line per cooked file
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		size_t separator = line.find(' ');
+		if (separator == std::string::npos)
+			continue;
+
+		outEntries.push_back(std::make_pair(line.substr(separator + 1), std::strtoull(line.substr(0, separator).c_str(), nullptr, 16)));
+	}
+}
+
+bool AssetCooker::SaveManifest(const std::string& path, const std::vector<std::pair<std::string, unsigned long long>>& entries)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::COOK::MANIFEST_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+
+	for (const auto& entry : entries)
+	{
+		file << std::hex << entry.second << std::dec << ' ' << entry.first << '\n';
+	}
+	return true;
+}
@@ -0,0 +1,275 @@
+#include "AssetPack.h"
+#include <Lz4.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+
+namespace
+{
+	const char PACK_MAGIC[4] = { 'L', 'P', 'A', 'K' };
+	const unsigned int PACK_VERSION = 1;
+	const size_t PACK_ALIGNMENT = 16;
+	const unsigned int ENTRY_LZ4 = 1;
+
+	struct PackHeader
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int entryCount;
+		unsigned int namesSize;
+	};
+
+	size_t Align(size_t value)
+	{
+		return (value + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+	}
+
+	// written so that offset + length can't wrap around
+	bool IsRangeInFile(unsigned long long offset, unsigned long long length, size_t fileSize)
+	{
+		return offset <= fileSize && length <= fileSize - offset;
+	}
+}
+
+// Table of contents entry, read in place from the mapping
+struct AssetPack::Entry
+{
+	unsigned long long offset;		// from the start of the pack
+	unsigned long long size;		// decompressed size
+	unsigned long long storedSize;
+	unsigned int nameOffset;		// into the names block
+	unsigned int nameLength;
+	unsigned int flags;
+	unsigned int reserved;
+};
+
+FileData::FileData(FileData&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+FileData& FileData::operator=(FileData&& other) noexcept
+{
+	bool owned = !other.IsMapped();
+	storage = std::move(other.storage);
+	mapping = std::move(other.mapping);
+	data = owned && !storage.empty() ? &storage[0] : other.data;
+	size = other.size;
+	other.data = nullptr;
+	other.size = 0;
+	return *this;
+}
+
+void FileData::Assign(std::vector<unsigned char>&& bytes)
+{
+	mapping.reset();
+	storage = std::move(bytes);
+	data = storage.empty() ? nullptr : &storage[0];
+	size = storage.size();
+}
+
+unsigned char* FileData::MakeWritable()
+{
+	if (IsMapped())
+		Assign(std::vector<unsigned char>(data, data + size));
+
+	return storage.empty() ? nullptr : &storage[0];
+}
+
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+bool AssetPack::Open(const std::string& path)
+{
+	Close();
+
+	if (!m_file.Open(path))
+		return false;
+	m_data = m_file.GetData();
+	m_size = m_file.GetSize();
+
+	PackHeader header;
+	if (m_size < sizeof(PackHeader))
+	{
+		Close();
+		std::cout << "ERROR::PACK::INVALID_FILE: " << path << std::endl;
+		return false;
+	}
+
+	// the entry table is checked against the file before the names block is placed after it
+	std::memcpy(&header, m_data, sizeof(PackHeader));
+	unsigned long long tableSize = (unsigned long long)header.entryCount * sizeof(Entry);
+	unsigned long long namesOffset = sizeof(PackHeader) + tableSize;
+	if (std::memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version != PACK_VERSION || !IsRangeInFile(sizeof(PackHeader), tableSize, m_size)
+		|| !IsRangeInFile(namesOffset, header.namesSize, m_size))
+	{
+		Close();
+		std::cout << "ERROR::PACK::INVALID_FILE: " << path << std::endl;
+		return false;
+	}
+
+	m_entries = (const Entry*)(m_data + sizeof(PackHeader));
+	m_entryCount = header.entryCount;
+	m_names = (const char*)(m_data + (size_t)namesOffset);
+
+	for (unsigned int i = 0; i < m_entryCount; i++)
+	{
+		const Entry& entry = m_entries[i];
+		if (!IsRangeInFile(entry.offset, entry.storedSize, m_size) || !IsRangeInFile(entry.nameOffset, entry.nameLength, header.namesSize)
+			|| (!(entry.flags & ENTRY_LZ4) && entry.storedSize != entry.size))
+		{
+			Close();
+			std::cout << "ERROR::PACK::INVALID_FILE: " << path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void AssetPack::Close()
+{
+	if (!m_data)
+		return;
+
+	m_file.Close();
+
+	m_data = nullptr;
+	m_size = 0;
+	m_entries = nullptr;
+	m_entryCount = 0;
+	m_names = nullptr;
+}
+
+const AssetPack::Entry* AssetPack::Find(std::string_view name) const
+{
+	// entries are sorted by name when the pack is written
+	const Entry* end = m_entries + m_entryCount;
+	const Entry* entry = std::lower_bound(m_entries, end, name, [this](const Entry& e, std::string_view value)
+	{
+		return std::string_view(m_names + e.nameOffset, e.nameLength) < value;
+	});
+
+	if (entry == end || std::string_view(m_names + entry->nameOffset, entry->nameLength) != name)
+		return nullptr;
+	return entry;
+}
+
+bool AssetPack::Contains(std::string_view name) const
+{
+	return Find(name) != nullptr;
+}
+
+bool AssetPack::Read(std::string_view name, FileData& outFile) const
+{
+	const Entry* entry = Find(name);
+	if (!entry)
+		return false;
+
+	const unsigned char* stored = m_data + entry->offset;
+	if (!(entry->flags & ENTRY_LZ4))
+	{
+		outFile.storage.clear();
+		outFile.mapping.reset();
+		outFile.data = stored;
+		outFile.size = (size_t)entry->size;
+		return true;
+	}
+
+	std::vector<unsigned char> bytes((size_t)entry->size);
+	if (!Lz4::Decompress(stored, (size_t)entry->storedSize, bytes.empty() ? nullptr : &bytes[0], bytes.size()))
+	{
+		std::cout << "ERROR::PACK::CORRUPTED_ENTRY: " << name << std::endl;
+		return false;
+	}
+	outFile.Assign(std::move(bytes));
+	return true;
+}
+
+bool AssetPack::Write(const std::string& path, const std::vector<std::string>& paths, const std::vector<std::string>& names, bool compress)
+{
+	std::vector<size_t> order(paths.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&names](size_t a, size_t b) { return names[a] < names[b]; });
+
+	std::vector<Entry> entries(paths.size());
+	std::string namesBlock;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		entries[i].nameOffset = (unsigned int)namesBlock.size();
+		entries[i].nameLength = (unsigned int)names[order[i]].size();
+		entries[i].flags = 0;
+		entries[i].reserved = 0;
+		namesBlock += names[order[i]];
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::PACK::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+
+	PackHeader header;
+	std::memcpy(header.magic, PACK_MAGIC, 4);
+	header.version = PACK_VERSION;
+	header.entryCount = (unsigned int)entries.size();
+	header.namesSize = (unsigned int)namesBlock.size();
+
+	// the table of contents is written last, once the blob offsets are known
+	size_t offset = Align(sizeof(PackHeader) + entries.size() * sizeof(Entry) + namesBlock.size());
+	file.seekp((std::streamoff)offset);
+
+	std::vector<unsigned char> compressed;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		std::ifstream input(paths[order[i]], std::ios::binary);
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+		if (!input.is_open())
+		{
+			std::cout << "ERROR::PACK::FILE_NOT_SUCCESSFULLY_READ: " << paths[order[i]] << std::endl;
+			return false;
+		}
+
+		entries[i].offset = offset;
+		entries[i].size = bytes.size();
+
+		// only keep the compressed blob when it saves something worth the decompression
+		const std::vector<unsigned char>* stored = &bytes;
+		if (compress && !bytes.empty())
+		{
+			Lz4::Compress(&bytes[0], bytes.size(), compressed);
+			if (compressed.size() < bytes.size() - bytes.size() / 8)
+			{
+				stored = &compressed;
+				entries[i].flags |= ENTRY_LZ4;
+			}
+		}
+
+		entries[i].storedSize = stored->size();
+		file.write((const char*)stored->data(), (std::streamsize)stored->size());
+
+		size_t end = offset + stored->size();
+		offset = Align(end);
+		for (; end < offset; end++)
+			file.put(0);
+	}
+
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(PackHeader));
+	if (!entries.empty())
+		file.write((const char*)&entries[0], (std::streamsize)(entries.size() * sizeof(Entry)));
+	file.write(namesBlock.data(), (std::streamsize)namesBlock.size());
+
+	if (!file)
+	{
+		std::cout << "ERROR::PACK::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
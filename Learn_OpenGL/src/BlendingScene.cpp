@@ -15,22 +15,35 @@ void BlendingScene::Setup()
 
     m_shader.LoadShader(".\\shaders\\blending.vs", ".\\shaders\\blending.fs");
 
-    m_cubeTexture = Model::TextureFromFile("marble.jpg", ".\\resources\\textures");
-    m_floorTexture = Model::TextureFromFile("metal.png", ".\\resources\\textures");
-    m_transparentTexture = Model::TextureFromFile("blending_transparent_window.png", ".\\resources\\textures");
+    m_cubeLayer = m_textures.AddTexture("marble.jpg", ".\\resources\\textures");
+    m_floorLayer = m_textures.AddTexture("metal.png", ".\\resources\\textures");
+    m_transparentLayer = m_textures.AddTexture("blending_transparent_window.png", ".\\resources\\textures");
+    m_textures.Build();
 
     VertexArrayInitializer::SetupCubeNoNormal(m_cubeVAO);
     VertexArrayInitializer::SetupPlane(m_planeVAO);
     VertexArrayInitializer::SetupTransparent(m_transparentVAO);
 
-    windowsPos = vector<glm::vec3>
+    if (!m_sceneFile.Load(".\\resources\\scenes\\blending.scene"))
+        std::cout << "ERROR::BLENDING_SCENE::SCENE_NOT_LOADED" << std::endl;
+
+    // the textures stay the scene's own, only the layout comes from the file
+    for (unsigned int i = 0; i < m_sceneFile.GetEntityCount(); i++)
     {
-        glm::vec3(-1.5f, 0.0f, -0.48f),
-        glm::vec3(1.5f, 0.0f, 0.51f),
-        glm::vec3(0.0f, 0.0f, 0.7f),
-        glm::vec3(-0.3f, 0.0f, -2.3f),
-        glm::vec3(0.5f, 0.0f, -0.6f)
-    };
+        const SceneEntity& entity = m_sceneFile.GetEntities()[i];
+        switch (m_sceneFile.GetMeshes()[entity.mesh].type)
+        {
+            case SCENE_MESH_PLANE:
+                m_floorModels.push_back(SceneFile::GetEntityMatrix(entity));
+                break;
+            case SCENE_MESH_QUAD:
+                windowsPos.push_back(entity.position);
+                break;
+            default:
+                m_cubeModels.push_back(SceneFile::GetEntityMatrix(entity));
+                break;
+        }
+    }
 
     m_shader.Use();
     m_shader.SetInt("texture1", 0);
@@ -50,29 +63,30 @@ void BlendingScene::Draw(const Camera& camera)
     glm::mat4 model = glm::mat4(1.0f);
 
     m_shader.Use();
+    m_textures.Bind(0);
+    m_shader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
 
     // cubes
     glBindVertexArray(m_cubeVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_cubeTexture);
-    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-    m_shader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-    m_shader.SetMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    m_textures.SelectLayer(m_shader, m_cubeLayer);
+    for (const glm::mat4& cubeModel : m_cubeModels)
+    {
+        m_shader.SetMat4("model", cubeModel);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
 
     // floor
     glBindVertexArray(m_planeVAO);
-    glBindTexture(GL_TEXTURE_2D, m_floorTexture);
-    model = glm::mat4(1.0f);
-    m_shader.SetMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    m_textures.SelectLayer(m_shader, m_floorLayer);
+    for (const glm::mat4& floorModel : m_floorModels)
+    {
+        m_shader.SetMat4("model", floorModel);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
 
     // windows (from furthest to nearest)
     glBindVertexArray(m_transparentVAO);
-    glBindTexture(GL_TEXTURE_2D, m_transparentTexture);
+    m_textures.SelectLayer(m_shader, m_transparentLayer);
     for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it)
     {
         model = glm::mat4(1.0f);
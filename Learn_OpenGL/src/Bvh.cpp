@@ -0,0 +1,388 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+namespace
+{
+	// bins per axis for the surface area heuristic
+	const int BIN_COUNT = 12;
+	// cost of visiting a node, relative to testing a primitive
+	const float TRAVERSAL_COST = 1.0f;
+
+	// set on the stack entries of subtrees entirely inside the frustum
+	const unsigned int INSIDE_FLAG = 0x80000000u;
+
+	enum BoxClassification
+	{
+		BOX_OUTSIDE,
+		BOX_INTERSECTING,
+		BOX_INSIDE
+	};
+
+	float HalfArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		glm::vec3 size = glm::max(boxMax - boxMin, glm::vec3(0.0f));
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	BoxClassification ClassifyBox(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		BoxClassification result = BOX_INSIDE;
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			// corners furthest along and against the plane normal
+			glm::vec3 normal(plane);
+			glm::vec3 positive(normal.x >= 0.0f ? boxMax.x : boxMin.x, normal.y >= 0.0f ? boxMax.y : boxMin.y, normal.z >= 0.0f ? boxMax.z : boxMin.z);
+			glm::vec3 negative(normal.x >= 0.0f ? boxMin.x : boxMax.x, normal.y >= 0.0f ? boxMin.y : boxMax.y, normal.z >= 0.0f ? boxMin.z : boxMax.z);
+			if (glm::dot(normal, positive) + plane.w < 0.0f)
+				return BOX_OUTSIDE;
+			if (glm::dot(normal, negative) + plane.w < 0.0f)
+				result = BOX_INTERSECTING;
+		}
+		return result;
+	}
+
+	struct Bin
+	{
+		glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+		glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+		unsigned int count = 0;
+	};
+}
+
+Bvh::Bvh()
+{
+}
+
+void Bvh::Build(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax)
+{
+	m_boxMin = boxMin;
+	m_boxMax = boxMax;
+	m_nodes.clear();
+	m_primitives.resize(boxMin.size());
+	std::iota(m_primitives.begin(), m_primitives.end(), 0u);
+	m_depth = 0;
+	if (boxMin.empty())
+		return;
+
+	std::vector<glm::vec3> centroids(boxMin.size());
+	for (size_t i = 0; i < boxMin.size(); i++)
+		centroids[i] = 0.5f * (boxMin[i] + boxMax[i]);
+
+	// a binary tree with a primitive per leaf at most
+	m_nodes.reserve(2 * boxMin.size() - 1);
+	BuildNode(0, (unsigned int)boxMin.size(), 0, centroids);
+}
+
+unsigned int Bvh::BuildNode(unsigned int first, unsigned int count, unsigned int depth, std::vector<glm::vec3>& centroids)
+{
+	unsigned int index = (unsigned int)m_nodes.size();
+	m_nodes.push_back(BvhNode());
+	m_depth = std::max(m_depth, depth);
+
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		unsigned int primitive = m_primitives[i];
+		boundsMin = glm::min(boundsMin, m_boxMin[primitive]);
+		boundsMax = glm::max(boundsMax, m_boxMax[primitive]);
+		centroidMin = glm::min(centroidMin, centroids[primitive]);
+		centroidMax = glm::max(centroidMax, centroids[primitive]);
+	}
+	m_nodes[index].boundsMin = boundsMin;
+	m_nodes[index].boundsMax = boundsMax;
+	m_nodes[index].rightOrFirst = first;
+	m_nodes[index].count = count;
+	if (count == 1 || depth >= MAX_DEPTH)
+		return index;
+
+	// cheapest split over every axis, as leaf tests saved per unit of parent area
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	glm::vec3 centroidExtent = centroidMax - centroidMin;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (centroidExtent[axis] <= 0.0f)
+			continue;
+
+		Bin bins[BIN_COUNT];
+		float binScale = BIN_COUNT / centroidExtent[axis];
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			unsigned int primitive = m_primitives[i];
+			int bin = std::min((int)((centroids[primitive][axis] - centroidMin[axis]) * binScale), BIN_COUNT - 1);
+			bins[bin].boundsMin = glm::min(bins[bin].boundsMin, m_boxMin[primitive]);
+			bins[bin].boundsMax = glm::max(bins[bin].boundsMax, m_boxMax[primitive]);
+			bins[bin].count++;
+		}
+
+		// right side costs swept from the end, then the left side from the start
+		float rightCosts[BIN_COUNT];
+		Bin right;
+		for (int split = BIN_COUNT - 1; split > 0; split--)
+		{
+			right.boundsMin = glm::min(right.boundsMin, bins[split].boundsMin);
+			right.boundsMax = glm::max(right.boundsMax, bins[split].boundsMax);
+			right.count += bins[split].count;
+			rightCosts[split] = right.count > 0 ? right.count * HalfArea(right.boundsMin, right.boundsMax) : 0.0f;
+		}
+		Bin left;
+		for (int split = 1; split < BIN_COUNT; split++)
+		{
+			left.boundsMin = glm::min(left.boundsMin, bins[split - 1].boundsMin);
+			left.boundsMax = glm::max(left.boundsMax, bins[split - 1].boundsMax);
+			left.count += bins[split - 1].count;
+			if (left.count == 0 || left.count == count)
+				continue;
+
+			float cost = left.count * HalfArea(left.boundsMin, left.boundsMax) + rightCosts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	unsigned int middle = first + count / 2;
+	if (bestAxis >= 0)
+	{
+		// small nodes stay leaves when splitting them doesn't pay off
+		float parentArea = HalfArea(boundsMin, boundsMax);
+		float splitCost = TRAVERSAL_COST + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+		if (count <= MAX_LEAF_PRIMITIVES && (float)count <= splitCost)
+			return index;
+
+		float binScale = BIN_COUNT / centroidExtent[bestAxis];
+		float axisMin = centroidMin[bestAxis];
+		unsigned int* split = std::partition(&m_primitives[first], &m_primitives[first] + count, [&](unsigned int primitive)
+		{
+			return std::min((int)((centroids[primitive][bestAxis] - axisMin) * binScale), BIN_COUNT - 1) < bestSplit;
+		});
+		middle = (unsigned int)(split - &m_primitives[0]);
+	}
+	else if (count <= MAX_LEAF_PRIMITIVES)
+	{
+		return index;
+	}
+	// else every centroid is the same point, any halves will do
+
+	// the left child lands right after this node
+	BuildNode(first, middle - first, depth + 1, centroids);
+	unsigned int rightChild = BuildNode(middle, first + count - middle, depth + 1, centroids);
+	m_nodes[index].rightOrFirst = rightChild;
+	m_nodes[index].count = 0;
+	return index;
+}
+
+void Bvh::Refit(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax)
+{
+	m_boxMin = boxMin;
+	m_boxMax = boxMax;
+
+	// children always come after their parent
+	for (size_t i = m_nodes.size(); i-- > 0;)
+		UpdateBounds(m_nodes[i], (unsigned int)i);
+}
+
+void Bvh::UpdateBounds(BvhNode& node, unsigned int index) const
+{
+	if (node.count == 0)
+	{
+		const BvhNode& left = m_nodes[index + 1];
+		const BvhNode& right = m_nodes[node.rightOrFirst];
+		node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+		node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		return;
+	}
+
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	for (unsigned int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++)
+	{
+		node.boundsMin = glm::min(node.boundsMin, m_boxMin[m_primitives[i]]);
+		node.boundsMax = glm::max(node.boundsMax, m_boxMax[m_primitives[i]]);
+	}
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& outPrimitives) const
+{
+	if (m_nodes.empty())
+		return;
+
+	unsigned int stack[MAX_DEPTH + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		unsigned int entry = stack[--stackSize];
+		const BvhNode& node = m_nodes[entry & ~INSIDE_FLAG];
+		bool inside = (entry & INSIDE_FLAG) != 0;
+		if (!inside)
+		{
+			BoxClassification classification = ClassifyBox(frustum, node.boundsMin, node.boundsMax);
+			if (classification == BOX_OUTSIDE)
+				continue;
+			inside = classification == BOX_INSIDE;
+		}
+
+		if (node.count == 0)
+		{
+			// the left child is visited next, depth first
+			unsigned int flag = inside ? INSIDE_FLAG : 0u;
+			stack[stackSize++] = node.rightOrFirst | flag;
+			stack[stackSize++] = ((entry & ~INSIDE_FLAG) + 1) | flag;
+			continue;
+		}
+
+		for (unsigned int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++)
+		{
+			unsigned int primitive = m_primitives[i];
+			if (inside || ClassifyBox(frustum, m_boxMin[primitive], m_boxMax[primitive]) != BOX_OUTSIDE)
+				outPrimitives.push_back(primitive);
+		}
+	}
+}
+
+void Bvh::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<unsigned int>& outPrimitives) const
+{
+	if (m_nodes.empty())
+		return;
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+	unsigned int stack[MAX_DEPTH + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		unsigned int nodeIndex = stack[--stackSize];
+		const BvhNode& node = m_nodes[nodeIndex];
+		float distance;
+		if (!IntersectRayBox(origin, inverseDirection, node.boundsMin, node.boundsMax, maxDistance, distance))
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[stackSize++] = node.rightOrFirst;
+			stack[stackSize++] = nodeIndex + 1;
+			continue;
+		}
+
+		for (unsigned int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++)
+		{
+			unsigned int primitive = m_primitives[i];
+			if (IntersectRayBox(origin, inverseDirection, m_boxMin[primitive], m_boxMax[primitive], maxDistance, distance))
+				outPrimitives.push_back(primitive);
+		}
+	}
+}
+
+bool Bvh::RaycastNearest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& outHit) const
+{
+	glm::vec3 inverseDirection = 1.0f / direction;
+	return RaycastNearest(origin, direction, maxDistance, [&](unsigned int primitive, float& distance)
+	{
+		float boxDistance;
+		if (!IntersectRayBox(origin, inverseDirection, m_boxMin[primitive], m_boxMax[primitive], distance, boxDistance) || boxDistance >= distance)
+			return false;
+
+		distance = boxDistance;
+		return true;
+	}, outHit);
+}
+
+bool Bvh::IntersectRayBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boxMin, const glm::vec3& boxMax,
+	float maxDistance, float& outDistance)
+{
+	glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+	glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+	glm::vec3 tMin = glm::min(t0, t1);
+	glm::vec3 tMax = glm::max(t0, t1);
+	float entry = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+	outDistance = entry;
+	return entry <= exit;
+}
+
+void Bvh::TransformBox(const glm::mat4& transform, const glm::vec3& boxMin, const glm::vec3& boxMax, glm::vec3& outMin, glm::vec3& outMax)
+{
+	glm::vec3 center = glm::vec3(transform * glm::vec4(0.5f * (boxMin + boxMax), 1.0f));
+	glm::vec3 halfSize = 0.5f * (boxMax - boxMin);
+	glm::vec3 extent = glm::abs(glm::vec3(transform[0])) * halfSize.x + glm::abs(glm::vec3(transform[1])) * halfSize.y
+		+ glm::abs(glm::vec3(transform[2])) * halfSize.z;
+	outMin = center - extent;
+	outMax = center + extent;
+}
+
+TriangleBvh::TriangleBvh()
+{
+}
+
+void TriangleBvh::Build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+	m_indices = indices;
+	std::vector<glm::vec3> boxMin, boxMax;
+	SetupTriangles(positions, boxMin, boxMax);
+	m_bvh.Build(boxMin, boxMax);
+}
+
+void TriangleBvh::Refit(const std::vector<glm::vec3>& positions)
+{
+	std::vector<glm::vec3> boxMin, boxMax;
+	SetupTriangles(positions, boxMin, boxMax);
+	m_bvh.Refit(boxMin, boxMax);
+}
+
+void TriangleBvh::SetupTriangles(const std::vector<glm::vec3>& positions, std::vector<glm::vec3>& outMin, std::vector<glm::vec3>& outMax)
+{
+	size_t triangleCount = m_indices.size() / 3;
+	m_triangles.resize(triangleCount);
+	outMin.resize(triangleCount);
+	outMax.resize(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		const glm::vec3& a = positions[m_indices[3 * i]];
+		const glm::vec3& b = positions[m_indices[3 * i + 1]];
+		const glm::vec3& c = positions[m_indices[3 * i + 2]];
+		m_triangles[i].vertex = a;
+		m_triangles[i].edge1 = b - a;
+		m_triangles[i].edge2 = c - a;
+		outMin[i] = glm::min(a, glm::min(b, c));
+		outMax[i] = glm::max(a, glm::max(b, c));
+	}
+}
+
+bool TriangleBvh::RaycastNearest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& outHit) const
+{
+	// Moller-Trumbore, both faces count
+	return m_bvh.RaycastNearest(origin, direction, maxDistance, [&](unsigned int primitive, float& distance)
+	{
+		const Triangle& triangle = m_triangles[primitive];
+		glm::vec3 p = glm::cross(direction, triangle.edge2);
+		float determinant = glm::dot(triangle.edge1, p);
+		if (determinant == 0.0f)
+			return false;
+
+		float inverseDeterminant = 1.0f / determinant;
+		glm::vec3 t = origin - triangle.vertex;
+		float u = glm::dot(t, p) * inverseDeterminant;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		glm::vec3 q = glm::cross(t, triangle.edge1);
+		float v = glm::dot(direction, q) * inverseDeterminant;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		float hitDistance = glm::dot(triangle.edge2, q) * inverseDeterminant;
+		if (hitDistance < 0.0f || hitDistance >= distance)
+			return false;
+
+		distance = hitDistance;
+		return true;
+	}, outHit);
+}
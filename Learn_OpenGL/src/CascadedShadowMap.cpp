@@ -0,0 +1,211 @@
+#include "CascadedShadowMap.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <string>
+
+namespace
+{
+	// blend between logarithmic (1) and uniform (0) split distances
+	const float SPLIT_LAMBDA = 0.6f;
+	const float CAMERA_NEAR = 0.1f;
+	// cascade centers move by steps of this fraction of their radius
+	const float SNAP_FRACTION = 0.25f;
+}
+
+CascadedShadowMap::CascadedShadowMap()
+{
+}
+
+void CascadedShadowMap::Setup(int resolution, float shadowDistance)
+{
+	m_resolution = resolution;
+	m_shadowDistance = shadowDistance;
+
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		float ratio = (float)(i + 1) / CASCADE_COUNT;
+		float logSplit = CAMERA_NEAR * std::pow(shadowDistance / CAMERA_NEAR, ratio);
+		float uniformSplit = CAMERA_NEAR + (shadowDistance - CAMERA_NEAR) * ratio;
+		m_splits[i] = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+	}
+
+	m_shadowMap = CreateDepthArray(resolution);
+	m_staticCache = CreateDepthArray(resolution);
+
+	// depth only framebuffers, the layer attached changes per pass
+	glGenFramebuffers(1, &m_framebuffer);
+	glGenFramebuffers(1, &m_cacheFramebuffer);
+	unsigned int framebuffers[2] = { m_framebuffer, m_cacheFramebuffer };
+	unsigned int textures[2] = { m_shadowMap, m_staticCache };
+	for (int i = 0; i < 2; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[i], 0, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::FRAMEBUFFER:: Shadow map framebuffer is not complete!" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CascadedShadowMap::SetSceneBounds(const glm::vec3& center, float radius)
+{
+	m_sceneCenter = center;
+	m_sceneRadius = radius;
+	InvalidateStatic();
+}
+
+void CascadedShadowMap::SetLightDirection(const glm::vec3& direction)
+{
+	m_lightDirection = glm::normalize(direction);
+	// rotation only, the cascades provide the translation
+	glm::vec3 up = std::abs(m_lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	m_lightView = glm::lookAt(glm::vec3(0.0f), m_lightDirection, up);
+	InvalidateStatic();
+}
+
+void CascadedShadowMap::InvalidateStatic()
+{
+	for (int i = 0; i < CASCADE_COUNT; i++)
+		m_cacheValid[i] = false;
+}
+
+void CascadedShadowMap::SetCachingEnabled(bool enabled)
+{
+	m_cachingEnabled = enabled;
+	InvalidateStatic();
+}
+
+void CascadedShadowMap::Update(const Camera& camera)
+{
+	const float tanHalfFov = std::tan(glm::radians(camera.Zoom) * 0.5f);
+
+	// every caster has to fit in the depth range, whatever the cascade
+	const glm::vec3 sceneCenter = glm::vec3(m_lightView * glm::vec4(m_sceneCenter, 1.0f));
+	const float nearPlane = -(sceneCenter.z + m_sceneRadius);
+	const float farPlane = -(sceneCenter.z - m_sceneRadius);
+
+	float sliceNear = CAMERA_NEAR;
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		float sliceFar = m_splits[i];
+
+		// bounding sphere of the frustum slice, its radius only depends on the projection
+		glm::vec3 corners[8];
+		int cornerCount = 0;
+		for (float depth : { sliceNear, sliceFar })
+		{
+			glm::vec3 center = camera.Position + camera.Front * depth;
+			glm::vec3 up = camera.Up * (depth * tanHalfFov);
+			glm::vec3 right = camera.Right * (depth * tanHalfFov * camera.AspectRatio);
+			corners[cornerCount++] = center - right - up;
+			corners[cornerCount++] = center + right - up;
+			corners[cornerCount++] = center - right + up;
+			corners[cornerCount++] = center + right + up;
+		}
+		glm::vec3 sphereCenter = glm::vec3(0.0f);
+		for (const glm::vec3& corner : corners)
+			sphereCenter += corner / 8.0f;
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+			radius = std::max(radius, glm::length(corner - sphereCenter));
+		radius = std::ceil(radius * 10.0f) / 10.0f;
+
+		// snap in light space and grow the extent by a cell so the slice stays covered
+		float step = radius * SNAP_FRACTION;
+		glm::vec3 lightCenter = glm::vec3(m_lightView * glm::vec4(sphereCenter, 1.0f));
+		lightCenter.x = std::floor(lightCenter.x / step) * step;
+		lightCenter.y = std::floor(lightCenter.y / step) * step;
+		float extent = radius + step;
+
+		glm::mat4 projection = glm::ortho(lightCenter.x - extent, lightCenter.x + extent,
+			lightCenter.y - extent, lightCenter.y + extent, nearPlane, farPlane);
+		m_lightSpaceMatrices[i] = projection * m_lightView;
+
+		if (m_cacheValid[i] && m_cachedMatrices[i] != m_lightSpaceMatrices[i])
+			m_cacheValid[i] = false;
+
+		sliceNear = sliceFar;
+	}
+	m_staticRenderCount = 0;
+}
+
+bool CascadedShadowMap::BeginStaticPass(int cascade)
+{
+	if (m_cachingEnabled && m_cacheValid[cascade])
+		return false;
+
+	// without caching the static casters go straight into the sampled map
+	if (m_cachingEnabled)
+		AttachLayer(m_cacheFramebuffer, m_staticCache, cascade);
+	else
+		AttachLayer(m_framebuffer, m_shadowMap, cascade);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	m_cachedMatrices[cascade] = m_lightSpaceMatrices[cascade];
+	m_cacheValid[cascade] = true;
+	m_staticRenderCount++;
+	return true;
+}
+
+void CascadedShadowMap::BeginDynamicPass(int cascade)
+{
+	AttachLayer(m_framebuffer, m_shadowMap, cascade);
+	if (!m_cachingEnabled)
+		return;
+
+	// a depth blit is a plain copy, much cheaper than drawing the static casters again
+	AttachLayer(m_cacheFramebuffer, m_staticCache, cascade);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_cacheFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glBlitFramebuffer(0, 0, m_resolution, m_resolution, 0, 0, m_resolution, m_resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void CascadedShadowMap::EndPasses()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CascadedShadowMap::Bind(Shader& shader) const
+{
+	shader.Use();
+	shader.SetBool("shadowsEnabled", true);
+	shader.SetInt("shadowMap", TEXTURE_UNIT);
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		std::string indexStr = std::to_string(i);
+		shader.SetMat4("lightSpaceMatrices[" + indexStr + "]", m_lightSpaceMatrices[i]);
+		shader.SetFloat("cascadeSplits[" + indexStr + "]", m_splits[i]);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+unsigned int CascadedShadowMap::CreateDepthArray(int resolution)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, CASCADE_COUNT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// linear filtering with depth comparison gives hardware 2x2 PCF
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	return textureID;
+}
+
+void CascadedShadowMap::AttachLayer(unsigned int framebuffer, unsigned int texture, int cascade)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+	glViewport(0, 0, m_resolution, m_resolution);
+}
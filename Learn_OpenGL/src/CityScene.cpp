@@ -0,0 +1,353 @@
+#include "CityScene.h"
+#include <VertexArrayInitializer.h>
+#include <Frustum.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// blocks per side, the camera starts on a street near the middle
+	const int CITY_SIZE = 64;
+	const float BLOCK_SPACING = 6.0f;
+	const float GROUND_HEIGHT = -1.0f;
+
+	// values of cullPhase in city.vs
+	const int CULL_PHASE_ALL = 0;
+	const int CULL_PHASE_PREVIOUS = 1;
+	const int CULL_PHASE_NEW = 2;
+
+	// the previous and current visibility textures go to these units
+	const int VISIBILITY_TEXTURE_UNIT = 1;
+
+	// the software depth buffer keeps the screen's aspect ratio
+	const int OCCLUSION_BUFFER_WIDTH = 256;
+	const int OCCLUSION_BUFFER_HEIGHT = 192;
+	// only buildings this close are rasterized, the far ones rarely hide much and cost as much
+	const float OCCLUDER_DISTANCE = 60.0f;
+	const size_t MAX_OCCLUDERS = 96;
+
+	const char* CULLING_MODE_NAMES[] = { "off", "GPU Hi-Z", "CPU rasterizer" };
+
+	// frames timed per mode when benchmarking
+	const int BENCHMARK_FRAMES = 300;
+
+	struct BuildingInstance
+	{
+		glm::mat4 model;
+		glm::vec3 color;
+	};
+
+	// sphere around a transformed unit cube
+	glm::vec4 GetCubeBounds(const glm::mat4& model)
+	{
+		glm::vec3 halfSize = 0.5f * glm::vec3(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+		return glm::vec4(glm::vec3(model[3]), glm::length(halfSize));
+	}
+
+	// half size of the world space box around a transformed unit cube
+	glm::vec3 GetCubeHalfExtent(const glm::mat4& model)
+	{
+		return 0.5f * (glm::abs(glm::vec3(model[0])) + glm::abs(glm::vec3(model[1])) + glm::abs(glm::vec3(model[2])));
+	}
+}
+
+CityScene::CityScene()
+{
+}
+
+void CityScene::Setup()
+{
+	m_cityShader.LoadShader(".\\shaders\\city.vs", ".\\shaders\\city.fs");
+	m_cityShader.Use();
+	m_cityShader.SetVec3("lightDirection", glm::normalize(glm::vec3(-0.4f, -1.0f, -0.25f)));
+
+	SetupCity();
+	// both start at the viewport's size, Draw resizes them together when it changes
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_hiZ.Setup(viewport[2], viewport[3]);
+	SetupFramebuffer();
+	m_rasterizer.Setup(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+
+	glEnable(GL_DEPTH_TEST);
+}
+
+void CityScene::SetupCity()
+{
+	std::vector<BuildingInstance> instances;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> footprint(3.0f, 4.5f);
+	std::uniform_real_distribution<float> height(2.0f, 14.0f);
+	std::uniform_real_distribution<float> shade(0.45f, 0.8f);
+
+	// the ground is an object like the others, it just always passes the test
+	float citySize = CITY_SIZE * BLOCK_SPACING;
+	BuildingInstance ground;
+	ground.model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, GROUND_HEIGHT - 0.5f, 0.0f)), glm::vec3(citySize, 1.0f, citySize));
+	ground.color = glm::vec3(0.3f, 0.32f, 0.3f);
+	instances.push_back(ground);
+
+	for (int x = 0; x < CITY_SIZE; x++)
+	{
+		for (int z = 0; z < CITY_SIZE; z++)
+		{
+			glm::vec3 size(footprint(random), height(random), footprint(random));
+			glm::vec3 position((x - 0.5f * (CITY_SIZE - 1)) * BLOCK_SPACING, GROUND_HEIGHT + 0.5f * size.y, (z - 0.5f * (CITY_SIZE - 1)) * BLOCK_SPACING);
+
+			BuildingInstance building;
+			building.model = glm::scale(glm::translate(glm::mat4(1.0f), position), size);
+			float tint = shade(random);
+			building.color = glm::vec3(tint, tint * 0.95f, tint * 0.85f);
+			instances.push_back(building);
+		}
+	}
+	m_objectCount = instances.size();
+
+	std::vector<glm::vec4> bounds;
+	for (const BuildingInstance& instance : instances)
+	{
+		bounds.push_back(GetCubeBounds(instance.model));
+
+		glm::vec3 halfExtent = GetCubeHalfExtent(instance.model);
+		m_models.push_back(instance.model);
+		m_boxMin.push_back(glm::vec3(instance.model[3]) - halfExtent);
+		m_boxMax.push_back(glm::vec3(instance.model[3]) + halfExtent);
+	}
+	m_culler.Setup(bounds);
+	m_cpuVisibility.assign(m_objectCount, 1);
+
+	// per instance model matrix (4 attributes) and color next to the cube's own attributes
+	VertexArrayInitializer::SetupCube(m_cubeVAO);
+	glBindVertexArray(m_cubeVAO);
+	glGenBuffers(1, &m_instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(BuildingInstance), &instances[0], GL_STATIC_DRAW);
+	for (int column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)(column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + column, 1);
+	}
+	glEnableVertexAttribArray(7);
+	glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(BuildingInstance), (void*)offsetof(BuildingInstance, color));
+	glVertexAttribDivisor(7, 1);
+	glBindVertexArray(0);
+}
+
+void CityScene::SetupFramebuffer()
+{
+	// the depth has to be a texture, the Hi-Z pyramid is built from it
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+	glGenTextures(1, &m_colorbuffer);
+	glBindTexture(GL_TEXTURE_2D, m_colorbuffer);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorbuffer, 0);
+
+	glGenTextures(1, &m_depthbuffer);
+	glBindTexture(GL_TEXTURE_2D, m_depthbuffer);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthbuffer, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	ResizeFramebuffer(viewport[2], viewport[3]);
+}
+
+void CityScene::ResizeFramebuffer(int width, int height)
+{
+	// a minimized window has an empty viewport, the attachments keep their last size
+	if (width <= 0 || height <= 0)
+		return;
+
+	m_width = width;
+	m_height = height;
+	glBindTexture(GL_TEXTURE_2D, m_colorbuffer);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, m_depthbuffer);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	// the pyramid is built from this depth, it has to match it texel for texel
+	m_hiZ.Resize(width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: City framebuffer is not complete!" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CityScene::Draw(const Camera& camera)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (viewport[2] != m_width || viewport[3] != m_height)
+		ResizeFramebuffer(viewport[2], viewport[3]);
+	// started minimized, there is nothing to draw into yet
+	if (m_width == 0)
+		return;
+
+	glm::mat4 viewProj = camera.GetPerspectiveProj() * camera.GetViewMatrix();
+
+	m_frameTimer.Begin();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+	glClearColor(0.55f, 0.65f, 0.8f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if (m_cullingMode == CULLING_NONE)
+	{
+		DrawBuildings(viewProj, CULL_PHASE_ALL);
+	}
+	else if (m_cullingMode == CULLING_CPU)
+	{
+		// the CPU result replaces the previous test, nothing is drawn that it didn't find visible
+		CullOnCpu(camera, viewProj);
+		m_culler.SetVisibility(m_cpuVisibility);
+		DrawBuildings(viewProj, CULL_PHASE_PREVIOUS);
+	}
+	else
+	{
+		// what was visible last frame goes first, its depth is what everything gets tested against
+		DrawBuildings(viewProj, CULL_PHASE_PREVIOUS);
+		m_hiZ.Build(m_depthbuffer);
+		m_culler.Test(m_hiZ, viewProj);
+
+		// then what the test found visible that the first phase skipped, like a building coming around a corner
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glViewport(0, 0, m_width, m_height);
+		DrawBuildings(viewProj, CULL_PHASE_NEW);
+		m_culler.Swap();
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	m_frameTimer.End();
+
+	UpdateBenchmark();
+}
+
+void CityScene::DrawBuildings(const glm::mat4& viewProj, int cullPhase)
+{
+	m_cityShader.Use();
+	m_cityShader.SetMat4("viewProj", viewProj);
+	m_cityShader.SetInt("cullPhase", cullPhase);
+	m_culler.Bind(m_cityShader, VISIBILITY_TEXTURE_UNIT);
+
+	// culled instances still run the vertex shader, but it sends them outside the clip volume
+	glBindVertexArray(m_cubeVAO);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)m_objectCount);
+	glBindVertexArray(0);
+}
+
+void CityScene::CullOnCpu(const Camera& camera, const glm::mat4& viewProj)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// the closest buildings in view are the occluders, nearest first in case there are too many
+	Frustum frustum = Frustum::FromMatrix(viewProj);
+	m_occluders.clear();
+	for (size_t i = 1; i < m_objectCount; i++)
+	{
+		glm::vec3 center = 0.5f * (m_boxMin[i] + m_boxMax[i]);
+		float radius = glm::length(m_boxMax[i] - center);
+		if (glm::distance(center, camera.Position) - radius < OCCLUDER_DISTANCE && frustum.IntersectsSphere(center, radius))
+			m_occluders.push_back(i);
+	}
+	auto closer = [&](size_t a, size_t b)
+	{
+		return glm::distance(0.5f * (m_boxMin[a] + m_boxMax[a]), camera.Position) < glm::distance(0.5f * (m_boxMin[b] + m_boxMax[b]), camera.Position);
+	};
+	if (m_occluders.size() > MAX_OCCLUDERS)
+	{
+		std::partial_sort(m_occluders.begin(), m_occluders.begin() + MAX_OCCLUDERS, m_occluders.end(), closer);
+		m_occluders.resize(MAX_OCCLUDERS);
+	}
+
+	m_rasterizer.BeginFrame(viewProj);
+	m_rasterizer.AddBoxOccluder(m_models[0]);
+	for (size_t occluder : m_occluders)
+		m_rasterizer.AddBoxOccluder(m_models[occluder]);
+	m_rasterizer.Rasterize();
+
+	// the ground always passes, like in the GPU test
+	m_cpuVisibility[0] = 1;
+	for (size_t i = 1; i < m_objectCount; i++)
+		m_cpuVisibility[i] = m_rasterizer.IsVisible(m_boxMin[i], m_boxMax[i]) ? 1 : 0;
+
+	m_cpuCullMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void CityScene::SetCullingMode(CullingMode mode)
+{
+	m_cullingMode = mode;
+	m_culler.ResetVisibility();
+}
+
+void CityScene::OnKeyPressed(int key)
+{
+	if (key == GLFW_KEY_O)
+	{
+		SetCullingMode((CullingMode)((m_cullingMode + 1) % CULLING_MODE_COUNT));
+		std::cout << "Occlusion culling: " << CULLING_MODE_NAMES[m_cullingMode] << std::endl;
+	}
+	else if (key == GLFW_KEY_P && m_cullingMode != CULLING_NONE)
+	{
+		unsigned int visible = m_culler.CountVisible();
+		std::cout << "Occlusion culling (" << CULLING_MODE_NAMES[m_cullingMode] << "): " << visible << " of " << m_objectCount
+			<< " objects drawn (" << 100.0f * (m_objectCount - visible) / m_objectCount << "% culled)" << std::endl;
+		if (m_cullingMode == CULLING_CPU)
+		{
+			std::cout << "  " << m_occluders.size() + 1 << " occluders, " << m_rasterizer.GetTriangleCount() << " triangles rasterized, "
+				<< m_cpuCullMs << " ms on the CPU" << std::endl;
+		}
+	}
+	else if (key == GLFW_KEY_B && m_benchmarkFrame < 0)
+	{
+		std::cout << "Benchmarking " << m_objectCount << " objects over " << BENCHMARK_FRAMES << " frames per mode..." << std::endl;
+		SetCullingMode(CULLING_NONE);
+		m_frameTimer.Reset();
+		m_benchmarkCpuMs = 0.0f;
+		m_benchmarkFrame = 0;
+	}
+}
+
+void CityScene::UpdateBenchmark()
+{
+	if (m_benchmarkFrame < 0)
+		return;
+
+	if (m_cullingMode == CULLING_CPU)
+		m_benchmarkCpuMs += m_cpuCullMs;
+	if (++m_benchmarkFrame < BENCHMARK_FRAMES)
+		return;
+
+	m_benchmarkResults[m_cullingMode] = m_frameTimer.GetAverageMs();
+	m_benchmarkVisible[m_cullingMode] = m_cullingMode == CULLING_NONE ? (unsigned int)m_objectCount : m_culler.CountVisible();
+	m_frameTimer.Reset();
+	m_benchmarkFrame = 0;
+	if (m_cullingMode + 1 < CULLING_MODE_COUNT)
+	{
+		SetCullingMode((CullingMode)(m_cullingMode + 1));
+		return;
+	}
+
+	std::cout << "Scene pass GPU time (" << m_objectCount << " objects):" << std::endl;
+	for (int mode = 0; mode < CULLING_MODE_COUNT; mode++)
+	{
+		std::cout << "  " << CULLING_MODE_NAMES[mode] << ": " << m_benchmarkResults[mode] << " ms, " << m_benchmarkVisible[mode] << " objects drawn ("
+			<< 100.0f * (m_objectCount - m_benchmarkVisible[mode]) / m_objectCount << "% culled)" << std::endl;
+	}
+	std::cout << "  CPU rasterizer time: " << m_benchmarkCpuMs / BENCHMARK_FRAMES << " ms" << std::endl;
+	SetCullingMode(CULLING_GPU);
+	m_benchmarkFrame = -1;
+}
@@ -0,0 +1,239 @@
+#include "CommandBuffer.h"
+#include <JobSystem.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// the header word keeps the type in its low byte and the size of the command, header included, above
+	const unsigned int TYPE_BITS = 8;
+	const unsigned int TYPE_MASK = (1u << TYPE_BITS) - 1;
+
+	// nothing was bound by the replay yet
+	const unsigned int UNKNOWN_BINDING = 0xffffffffu;
+
+	// batches per thread when RecordParallel picks the batch size
+	const size_t BATCHES_PER_THREAD = 4;
+
+	const unsigned int* ReadFloats(const unsigned int* in, float* values, size_t count)
+	{
+		std::memcpy(values, in, count * sizeof(float));
+		return in + count;
+	}
+}
+
+struct CommandBuffer::ReplayState
+{
+	unsigned int vao = UNKNOWN_BINDING;
+	unsigned int program = UNKNOWN_BINDING;
+};
+
+void CommandBuffer::Clear()
+{
+	m_words.clear();
+	m_commandCount = 0;
+}
+
+unsigned int* CommandBuffer::Append(CommandType type, size_t argumentWords)
+{
+	size_t offset = m_words.size();
+	m_words.resize(offset + 1 + argumentWords);
+	m_words[offset] = (unsigned int)type | (unsigned int)((1 + argumentWords) << TYPE_BITS);
+	m_commandCount++;
+	return &m_words[offset + 1];
+}
+
+unsigned int* CommandBuffer::WriteFloats(unsigned int* out, const float* values, size_t count)
+{
+	std::memcpy(out, values, count * sizeof(float));
+	return out + count;
+}
+
+void CommandBuffer::BindVertexArray(unsigned int vao)
+{
+	Append(CommandType::BIND_VERTEX_ARRAY, 1)[0] = vao;
+}
+
+void CommandBuffer::UseProgram(unsigned int program)
+{
+	Append(CommandType::USE_PROGRAM, 1)[0] = program;
+}
+
+void CommandBuffer::BindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+	unsigned int* arguments = Append(CommandType::BIND_TEXTURE, 3);
+	arguments[0] = unit;
+	arguments[1] = target;
+	arguments[2] = texture;
+}
+
+void CommandBuffer::SetInt(int location, int value)
+{
+	unsigned int* arguments = Append(CommandType::SET_INT, 2);
+	arguments[0] = (unsigned int)location;
+	arguments[1] = (unsigned int)value;
+}
+
+void CommandBuffer::SetFloat(int location, float value)
+{
+	unsigned int* arguments = Append(CommandType::SET_FLOAT, 2);
+	arguments[0] = (unsigned int)location;
+	WriteFloats(arguments + 1, &value, 1);
+}
+
+void CommandBuffer::SetVec3(int location, const glm::vec3& value)
+{
+	unsigned int* arguments = Append(CommandType::SET_VEC3, 4);
+	arguments[0] = (unsigned int)location;
+	WriteFloats(arguments + 1, glm::value_ptr(value), 3);
+}
+
+void CommandBuffer::SetMat3(int location, const glm::mat3& value)
+{
+	unsigned int* arguments = Append(CommandType::SET_MAT3, 10);
+	arguments[0] = (unsigned int)location;
+	WriteFloats(arguments + 1, glm::value_ptr(value), 9);
+}
+
+void CommandBuffer::SetMat4(int location, const glm::mat4& value)
+{
+	unsigned int* arguments = Append(CommandType::SET_MAT4, 17);
+	arguments[0] = (unsigned int)location;
+	WriteFloats(arguments + 1, glm::value_ptr(value), 16);
+}
+
+void CommandBuffer::SetObjectMatrices(const ObjectMatrixLocations& locations, const glm::mat4& model, const glm::mat4& mvp, const glm::mat3& normalMatrix)
+{
+	unsigned int* arguments = Append(CommandType::SET_OBJECT_MATRICES, 3 + 16 + 16 + 9);
+	arguments[0] = (unsigned int)locations.model;
+	arguments[1] = (unsigned int)locations.mvp;
+	arguments[2] = (unsigned int)locations.normalMatrix;
+	arguments = WriteFloats(arguments + 3, glm::value_ptr(model), 16);
+	arguments = WriteFloats(arguments, glm::value_ptr(mvp), 16);
+	WriteFloats(arguments, glm::value_ptr(normalMatrix), 9);
+}
+
+void CommandBuffer::DrawArrays(GLenum mode, int first, int count)
+{
+	unsigned int* arguments = Append(CommandType::DRAW_ARRAYS, 3);
+	arguments[0] = mode;
+	arguments[1] = (unsigned int)first;
+	arguments[2] = (unsigned int)count;
+}
+
+void CommandBuffer::DrawElements(GLenum mode, int count, GLenum type, unsigned int offset)
+{
+	unsigned int* arguments = Append(CommandType::DRAW_ELEMENTS, 4);
+	arguments[0] = mode;
+	arguments[1] = (unsigned int)count;
+	arguments[2] = type;
+	arguments[3] = offset;
+}
+
+void CommandBuffer::Execute() const
+{
+	ReplayState state;
+	Replay(state);
+}
+
+void CommandBuffer::ExecuteAll(const std::vector<CommandBuffer>& buffers)
+{
+	ReplayState state;
+	for (const CommandBuffer& buffer : buffers)
+		buffer.Replay(state);
+}
+
+void CommandBuffer::Replay(ReplayState& state) const
+{
+	// the floats were copied in as words, they are copied back out rather than read through a cast
+	float values[16 + 16 + 9];
+	const unsigned int* word = m_words.data();
+	const unsigned int* end = word + m_words.size();
+	while (word < end)
+	{
+		CommandType type = (CommandType)(word[0] & TYPE_MASK);
+		const unsigned int* arguments = word + 1;
+		word += word[0] >> TYPE_BITS;
+
+		switch (type)
+		{
+			case CommandType::BIND_VERTEX_ARRAY:
+				if (arguments[0] != state.vao)
+				{
+					glBindVertexArray(arguments[0]);
+					state.vao = arguments[0];
+				}
+				break;
+			case CommandType::USE_PROGRAM:
+				if (arguments[0] != state.program)
+				{
+					glUseProgram(arguments[0]);
+					state.program = arguments[0];
+				}
+				break;
+			case CommandType::BIND_TEXTURE:
+				glActiveTexture(GL_TEXTURE0 + arguments[0]);
+				glBindTexture(arguments[1], arguments[2]);
+				break;
+			case CommandType::SET_INT:
+				glUniform1i((int)arguments[0], (int)arguments[1]);
+				break;
+			case CommandType::SET_FLOAT:
+				ReadFloats(arguments + 1, values, 1);
+				glUniform1f((int)arguments[0], values[0]);
+				break;
+			case CommandType::SET_VEC3:
+				ReadFloats(arguments + 1, values, 3);
+				glUniform3fv((int)arguments[0], 1, values);
+				break;
+			case CommandType::SET_MAT3:
+				ReadFloats(arguments + 1, values, 9);
+				glUniformMatrix3fv((int)arguments[0], 1, GL_FALSE, values);
+				break;
+			case CommandType::SET_MAT4:
+				ReadFloats(arguments + 1, values, 16);
+				glUniformMatrix4fv((int)arguments[0], 1, GL_FALSE, values);
+				break;
+			case CommandType::SET_OBJECT_MATRICES:
+				ReadFloats(arguments + 3, values, 16 + 16 + 9);
+				glUniformMatrix4fv((int)arguments[0], 1, GL_FALSE, values);
+				glUniformMatrix4fv((int)arguments[1], 1, GL_FALSE, values + 16);
+				glUniformMatrix3fv((int)arguments[2], 1, GL_FALSE, values + 32);
+				break;
+			case CommandType::DRAW_ARRAYS:
+				glDrawArrays(arguments[0], (int)arguments[1], (int)arguments[2]);
+				break;
+			case CommandType::DRAW_ELEMENTS:
+				glDrawElements(arguments[0], (int)arguments[1], arguments[2], (const void*)(size_t)arguments[3]);
+				break;
+		}
+	}
+}
+
+void CommandBuffer::RecordParallel(std::vector<CommandBuffer>& buffers, size_t count, size_t batchSize,
+	const std::function<void(CommandBuffer&, size_t, size_t)>& record)
+{
+	if (batchSize == 0)
+	{
+		size_t batchCount = (JobSystem::GetWorkerCount() + 1) * BATCHES_PER_THREAD;
+		batchSize = std::max<size_t>(1, (count + batchCount - 1) / batchCount);
+	}
+
+	// the buffers of the last frame are reused, the extra ones stay empty
+	size_t batchCount = (count + batchSize - 1) / batchSize;
+	if (buffers.size() < batchCount)
+		buffers.resize(batchCount);
+	for (size_t i = batchCount; i < buffers.size(); i++)
+		buffers[i].Clear();
+
+	JobSystem::ParallelFor(batchCount, 1, [&](size_t firstBatch, size_t lastBatch)
+	{
+		for (size_t batch = firstBatch; batch < lastBatch; batch++)
+		{
+			CommandBuffer& buffer = buffers[batch];
+			buffer.Clear();
+			record(buffer, batch * batchSize, std::min(count, (batch + 1) * batchSize));
+		}
+	});
+}
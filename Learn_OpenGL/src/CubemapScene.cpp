@@ -1,7 +1,35 @@
 #include "CubemapScene.h"
 #include <VertexArrayInitializer.h>
 #include <Model.h>
+#include <TransformBatch.h>
 #include <stb_image.h>
+#include <KtxLoader.h>
+#include <VirtualFileSystem.h>
+#include <GLExtensions.h>
+#include <JobSystem.h>
+#include <algorithm>
+#include <chrono>
+#include <GLFW/glfw3.h>
+
+namespace
+{
+    struct DecodedFace
+    {
+        unsigned char* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+    };
+
+    DecodedFace DecodeFace(const std::string& path)
+    {
+        DecodedFace face;
+        FileData file;
+        if (VirtualFileSystem::Read(path, file))
+            face.pixels = stbi_load_from_memory(file.data, (int)file.size, &face.width, &face.height, &face.channels, 0);
+        return face;
+    }
+}
 
 CubemapScene::CubemapScene()
 {
@@ -17,27 +45,32 @@ void CubemapScene::Setup()
     VertexArrayInitializer::Setup3DQuad(m_quadVAO);
     VertexArrayInitializer::SetupScreenQuad(m_screenQuadVAO);
     VertexArrayInitializer::SetupCubeNoTexture(m_skyboxVAO);
+    VertexArrayInitializer::SetupCubeNoNormal(m_texturedCubeVAO);
 
     m_shader = Shader(".\\shaders\\enviroMappingShader.vs", ".\\shaders\\enviroMappingShader.fs");
     m_borderShader = Shader(".\\shaders\\depth_testing.vs", ".\\shaders\\shaderSingleColor.fs");
     m_screenShader = Shader(".\\shaders\\screenShader.vs", ".\\shaders\\screenShader.fs");
     m_skyboxShader = Shader(".\\shaders\\skyboxShader.vs", ".\\shaders\\skyboxShader.fs");
+    m_texturedShader = Shader(".\\shaders\\framebuffers.vs", ".\\shaders\\framebuffers.fs");
+    m_probeShader = Shader(".\\shaders\\probe.vs", ".\\shaders\\probe.fs", ".\\shaders\\probe.gs");
 
     m_cubeTexture = Model::TextureFromFile("marble.jpg", ".\\resources\\textures");
 
-    std::vector<std::string> faces
-    {
-        ".\\resources\\textures\\skybox\\right.jpg",
-        ".\\resources\\textures\\skybox\\left.jpg",
-        ".\\resources\\textures\\skybox\\top.jpg",
-        ".\\resources\\textures\\skybox\\bottom.jpg",
-        ".\\resources\\textures\\skybox\\front.jpg",
-        ".\\resources\\textures\\skybox\\back.jpg"
-    };
+    m_cubemapTexture = LoadSkybox();
 
-    m_cubemapTexture = LoadCubemap(faces);
+    m_probeShader.Use();
+    m_probeShader.SetInt("texture1", 0);
+    m_probeShader.SetInt("skybox", 1);
 
-    stbi_set_flip_vertically_on_load(true);
+    m_reflectiveCubePositions.push_back(glm::vec3(-1.0f, 0.0f, -1.0f));
+    m_reflectiveCubePositions.push_back(glm::vec3(2.0f, 0.0f, 0.0f));
+    m_probes.resize(m_reflectiveCubePositions.size());
+    for (size_t i = 0; i < m_probes.size(); i++)
+    {
+        m_probes[i].Setup(m_reflectiveCubePositions[i], 128);
+    }
+
+    Model::SetFlipVerticallyOnLoad(true);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -56,6 +89,12 @@ void CubemapScene::Setup()
 
 void CubemapScene::Draw(const Camera& camera)
 {
+    // the probes render at their own size, the window's viewport comes back after them
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    UpdateProbes();
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -74,11 +113,10 @@ void CubemapScene::Draw(const Camera& camera)
 
     // Draw scene
     glm::mat4 model = glm::mat4(1.0f);
-    m_shader.Use();
-    m_shader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
     m_borderShader.Use();
     m_borderShader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
-    DrawCubes(m_shader, m_cubeReflectionVAO, m_cubeTexture);
+    DrawCubes(m_shader, m_cubeReflectionVAO, m_cubeTexture, camera.GetPerspectiveProj() * camera.GetViewMatrix());
+    DrawOrbiter(camera.GetViewMatrix(), camera.GetPerspectiveProj());
 
     if (m_bEnableFramebuffer)
     {
@@ -118,31 +156,110 @@ void CubemapScene::SetupFramebuffer()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+unsigned int CubemapScene::LoadSkybox()
+{
+    std::vector<std::string> faces
+    {
+        ".\\resources\\textures\\skybox\\right.jpg",
+        ".\\resources\\textures\\skybox\\left.jpg",
+        ".\\resources\\textures\\skybox\\top.jpg",
+        ".\\resources\\textures\\skybox\\bottom.jpg",
+        ".\\resources\\textures\\skybox\\front.jpg",
+        ".\\resources\\textures\\skybox\\back.jpg"
+    };
+
+    auto loadStart = std::chrono::steady_clock::now();
+    unsigned int textureID = LoadCubemap(faces);
+    std::cout << "Skybox loaded in " << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << " ms" << std::endl;
+    return textureID;
+}
+
 unsigned int CubemapScene::LoadCubemap(const std::vector<string>& faces)
 {
+    // the cooker packs the six faces of "skybox/*.jpg" into a single "skybox.ktx2"
+    std::string facesDirectory = faces[0].substr(0, faces[0].find_last_of('\\'));
+    unsigned int cookedID = KtxLoader::LoadCubemap(facesDirectory + ".ktx2");
+    if (cookedID != 0)
+        return cookedID;
+
+    std::vector<std::string> compressedFaces;
+    for (const std::string& face : faces)
+    {
+        compressedFaces.push_back(KtxLoader::GetSiblingPath(face));
+    }
+
+    unsigned int compressedID = KtxLoader::LoadCubemap(compressedFaces);
+    if (compressedID != 0)
+        return compressedID;
+
+    // decode the faces concurrently, only the uploads have to stay on the GL thread
+    std::vector<DecodedFace> decoded(faces.size());
+    JobSystem::ParallelFor(faces.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            decoded[i] = DecodeFace(faces[i]);
+        }
+    });
+
+    int width = 0, height = 0;
+    for (const DecodedFace& face : decoded)
+    {
+        if (face.pixels)
+        {
+            width = face.width;
+            height = face.height;
+            break;
+        }
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
-    unsigned char* data;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    // every level of every face is allocated up front, immutable when the driver allows it
+    int levelCount = 1;
+    while ((std::max(width, height) >> levelCount) > 0)
+        levelCount++;
+
+    if (GLExtensions::TexStorage2D && width > 0)
+    {
+        GLExtensions::TexStorage2D(GL_TEXTURE_CUBE_MAP, levelCount, GL_RGB8, width, height);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < faces.size(); i++)
+        {
+            for (int level = 0; level < levelCount; level++)
+            {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_RGB8, std::max(1, width >> level),
+                    std::max(1, height >> level), 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+            }
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int i = 0; i < decoded.size(); i++)
     {
-        data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
+        if (decoded[i].pixels && decoded[i].width == width && decoded[i].height == height)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width,
-                height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            GLenum format = decoded[i].channels == 4 ? GL_RGBA : decoded[i].channels == 1 ? GL_RED : GL_RGB;
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, width,
+                height, format, GL_UNSIGNED_BYTE, decoded[i].pixels);
         }
         else
         {
             std::cout << "Cubemap failed to load at path: " << faces[i] << std::endl;
         }
-        stbi_image_free(data);
+        stbi_image_free(decoded[i].pixels);
     }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (width > 0)
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -159,23 +276,97 @@ void CubemapScene::DrawScreenQuad(Shader& shader, unsigned int quadVAO, unsigned
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
-void CubemapScene::DrawCubes(Shader& shader, unsigned int cubeVAO, unsigned int cubeTexture)
+void CubemapScene::DrawCubes(Shader& shader, unsigned int cubeVAO, unsigned int cubeTexture, const glm::mat4& viewProj)
 {
     glStencilFunc(GL_ALWAYS, 1, 0xFF);
     glStencilMask(0xFF);
 
     shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
     glBindVertexArray(cubeVAO);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, cubeTexture);
-    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-    shader.SetMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-    shader.SetMat4("model", model);
+    for (size_t i = 0; i < m_reflectiveCubePositions.size(); i++)
+    {
+        // each cube reflects the last complete cube of its own probe
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_probes[i].GetCubemap());
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), m_reflectiveCubePositions[i]);
+        shader.SetObjectMatrices(model, viewProj * model, TransformBatch::ComputeNormalMatrix(model));
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+}
+
+void CubemapScene::DrawOrbiter(const glm::mat4& view, const glm::mat4& projection)
+{
+    m_texturedShader.Use();
+    m_texturedShader.SetMVPMatrix(GetOrbiterModel(), view, projection);
+    glBindVertexArray(m_texturedCubeVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_cubeTexture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+}
+
+glm::mat4 CubemapScene::GetOrbiterModel() const
+{
+    // small cube circling both reflective cubes so the probes have something moving to capture
+    float angle = (float)glfwGetTime() * 0.8f;
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f + 3.0f * cos(angle), 0.5f, -0.5f + 3.0f * sin(angle)));
+    return glm::scale(model, glm::vec3(0.4f));
+}
+
+void CubemapScene::UpdateProbes()
+{
+    const glm::mat4 orbiterModel = GetOrbiterModel();
+    for (size_t i = 0; i < m_probes.size(); i++)
+    {
+        ReflectionProbe& probe = m_probes[i];
+        probe.Begin(m_probeShader);
+
+        // background first, it covers every texel of the faces being rendered
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        m_probeShader.SetBool("drawSkybox", true);
+        m_probeShader.SetMat4("model", glm::scale(glm::translate(glm::mat4(1.0f), probe.GetPosition()), glm::vec3(50.0f)));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemapTexture);
+        glBindVertexArray(m_skyboxVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+
+        // the other cubes are drawn plain, reflecting reflections isn't worth a second bounce
+        m_probeShader.SetBool("drawSkybox", false);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_cubeTexture);
+        glBindVertexArray(m_texturedCubeVAO);
+        for (size_t j = 0; j < m_reflectiveCubePositions.size(); j++)
+        {
+            if (j == i)
+                continue;
+            m_probeShader.SetMat4("model", glm::translate(glm::mat4(1.0f), m_reflectiveCubePositions[j]));
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+        m_probeShader.SetMat4("model", orbiterModel);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
+
+        probe.End();
+    }
+}
+
+void CubemapScene::OnKeyPressed(int key)
+{
+    if (key != GLFW_KEY_EQUAL && key != GLFW_KEY_MINUS)
+        return;
+
+    int budget = m_probes.empty() ? 1 : m_probes[0].GetFaceBudget() + (key == GLFW_KEY_EQUAL ? 1 : -1);
+    for (ReflectionProbe& probe : m_probes)
+    {
+        probe.SetFaceBudget(budget);
+    }
+    budget = m_probes.empty() ? 1 : m_probes[0].GetFaceBudget();
+    int framesPerRefresh = (ReflectionProbe::FACE_COUNT + budget - 1) / budget;
+    std::cout << "Probe face budget: " << budget << " per frame, full refresh every " << framesPerRefresh << " frames" << std::endl;
 }
 
 void CubemapScene::DrawSkybox(Shader& shader, unsigned int skyboxVAO, unsigned int cubemapTexture, const Camera& camera)
@@ -0,0 +1,678 @@
+#include "FileScene.h"
+#include <VertexArrayInitializer.h>
+#include <CascadedShadowMap.h>
+#include <PointShadowMaps.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+	const int POINT_LIGHT_SLOTS = 4;
+
+	// mesh space boxes of the VertexArrayInitializer shapes
+	const glm::vec3 CUBE_BOX_MIN = glm::vec3(-0.5f);
+	const glm::vec3 CUBE_BOX_MAX = glm::vec3(0.5f);
+	const glm::vec3 PLANE_BOX_MIN = glm::vec3(-5.0f, -0.5f, -5.0f);
+	const glm::vec3 PLANE_BOX_MAX = glm::vec3(5.0f, -0.5f, 5.0f);
+	const glm::vec3 QUAD_BOX_MIN = glm::vec3(0.0f, -0.5f, 0.0f);
+	const glm::vec3 QUAD_BOX_MAX = glm::vec3(1.0f, 0.5f, 0.0f);
+
+	// what the lit shader's aModel and aNormalMatrix attributes read for each instanced cube
+	struct CubeInstance
+	{
+		glm::mat4 model;
+		glm::mat3 normalMatrix;
+	};
+	const GLuint INSTANCE_MODEL_ATTRIBUTE = 3;
+	const GLuint INSTANCE_NORMAL_ATTRIBUTE = 7;
+
+	// FrameSnapshot::renderFlags
+	const unsigned int RENDER_INSTANCED_CUBES = 1;
+
+	// how far K picks
+	const float PICK_DISTANCE = 1000.0f;
+
+	// TextureArray takes the file and its directory apart
+	void SplitPath(const std::string& path, std::string& outDirectory, std::string& outFile)
+	{
+		size_t separator = path.find_last_of("\\/");
+		outDirectory = separator == std::string::npos ? "." : path.substr(0, separator);
+		outFile = separator == std::string::npos ? path : path.substr(separator + 1);
+	}
+
+	bool IsLit(unsigned int meshType)
+	{
+		return meshType == SCENE_MESH_CUBE || meshType == SCENE_MESH_MODEL;
+	}
+}
+
+FileScene::FileScene(const std::string& path) : m_path(path)
+{
+}
+
+FileScene::FileScene(const SceneData& scene, const std::string& name) : m_path(name)
+{
+	SceneFile::Write(scene, m_bytes);
+}
+
+FileScene::~FileScene()
+{
+	glDeleteProgram(m_litShader.ID);
+	glDeleteProgram(m_unlitShader.ID);
+	m_textures.Release();
+
+	VertexArrayInitializer::Release(m_cubeVAO);
+	VertexArrayInitializer::Release(m_instancedCubeVAO);
+	VertexArrayInitializer::Release(m_planeVAO);
+	VertexArrayInitializer::Release(m_quadVAO);
+
+	for (std::unique_ptr<Model>& model : m_models)
+	{
+		if (model)
+			model->Release();
+	}
+}
+
+void FileScene::Setup()
+{
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_litShader.LoadShader(".\\shaders\\litShader.vs", ".\\shaders\\litShader.fs");
+	m_unlitShader.LoadShader(".\\shaders\\blending.vs", ".\\shaders\\blending.fs");
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	bool loaded = m_bytes.empty() ? m_scene.Load(m_path) : m_scene.Load(std::move(m_bytes));
+	if (!loaded)
+	{
+		std::cout << "ERROR::FILE_SCENE::NOT_LOADED: " << m_path << std::endl;
+		return;
+	}
+	m_loadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	VertexArrayInitializer::SetupCube(m_cubeVAO);
+	VertexArrayInitializer::SetupCube(m_instancedCubeVAO);
+	VertexArrayInitializer::SetupPlane(m_planeVAO);
+	VertexArrayInitializer::SetupTransparent(m_quadVAO);
+
+	// only the models some entity uses are loaded
+	std::vector<bool> usedMeshes(m_scene.GetMeshCount(), false);
+	for (unsigned int i = 0; i < m_scene.GetEntityCount(); i++)
+		usedMeshes[m_scene.GetEntities()[i].mesh] = true;
+
+	Model::SetFlipVerticallyOnLoad(true);
+	m_models.resize(m_scene.GetMeshCount());
+	for (unsigned int i = 0; i < m_scene.GetMeshCount(); i++)
+	{
+		const SceneMesh& mesh = m_scene.GetMeshes()[i];
+		if (mesh.type == SCENE_MESH_MODEL && usedMeshes[i])
+			m_models[i].reset(new Model(m_scene.GetString(mesh.path)));
+	}
+
+	SetupMaterials();
+	SetupLights();
+	SetupGroups();
+	SetupBvh();
+
+	// room for every cube of the scene each frame
+	unsigned int cubeCount = 0;
+	for (unsigned int i = 0; i < m_scene.GetEntityCount(); i++)
+		cubeCount += m_scene.GetMeshes()[m_scene.GetEntities()[i].mesh].type == SCENE_MESH_CUBE ? 1 : 0;
+	m_instanceStream.Setup(cubeCount * sizeof(CubeInstance));
+	m_instanceStreamPersistent = m_instanceStream.IsPersistent();
+	m_instanceStreamSize = m_instanceStream.GetFrameSize();
+
+	glBindVertexArray(m_instancedCubeVAO);
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(INSTANCE_MODEL_ATTRIBUTE + i);
+		glVertexAttribDivisor(INSTANCE_MODEL_ATTRIBUTE + i, 1);
+	}
+	for (GLuint i = 0; i < 3; i++)
+	{
+		glEnableVertexAttribArray(INSTANCE_NORMAL_ATTRIBUTE + i);
+		glVertexAttribDivisor(INSTANCE_NORMAL_ATTRIBUTE + i, 1);
+	}
+	SetInstanceAttributes(0);
+	glBindVertexArray(0);
+}
+
+void FileScene::SetInstanceAttributes(size_t offset)
+{
+	// GL 3.3 has no separate vertex buffer bindings, every frame's offset means pointing the attributes again
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceStream.GetBuffer());
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glVertexAttribPointer(INSTANCE_MODEL_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+			(void*)(offset + offsetof(CubeInstance, model) + i * sizeof(glm::vec4)));
+	}
+	for (GLuint i = 0; i < 3; i++)
+	{
+		glVertexAttribPointer(INSTANCE_NORMAL_ATTRIBUTE + i, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+			(void*)(offset + offsetof(CubeInstance, normalMatrix) + i * sizeof(glm::vec3)));
+	}
+}
+
+void FileScene::SetupMaterials()
+{
+	// materials sharing a texture share its layer
+	std::unordered_map<std::string, int> layers;
+	auto addLayer = [&](unsigned int path) -> int
+	{
+		if (path == SCENE_NO_STRING)
+			return -1;
+
+		std::string fullPath = m_scene.GetString(path);
+		auto found = layers.find(fullPath);
+		if (found != layers.end())
+			return found->second;
+
+		std::string directory, file;
+		SplitPath(fullPath, directory, file);
+		int layer = m_textures.AddTexture(file.c_str(), directory);
+		layers[fullPath] = layer;
+		return layer;
+	};
+
+	for (unsigned int i = 0; i < m_scene.GetMaterialCount(); i++)
+	{
+		const SceneMaterial& material = m_scene.GetMaterials()[i];
+		m_diffuseLayers.push_back(addLayer(material.diffuse));
+		m_specularLayers.push_back(addLayer(material.specular));
+	}
+	m_textures.Build();
+
+	// without a diffuse map the material falls back to the first layer
+	for (int& layer : m_diffuseLayers)
+		layer = std::max(layer, 0);
+
+	m_litShader.Use();
+	m_litShader.SetInt("material.textures", 0);
+	m_unlitShader.Use();
+	m_unlitShader.SetInt("texture1", 0);
+}
+
+void FileScene::SetupLights()
+{
+	const SceneLight* directional = nullptr;
+	const SceneLight* spot = nullptr;
+	for (unsigned int i = 0; i < m_scene.GetLightCount(); i++)
+	{
+		const SceneLight& light = m_scene.GetLights()[i];
+		if (light.type == SCENE_LIGHT_DIRECTIONAL && !directional)
+			directional = &light;
+		else if (light.type == SCENE_LIGHT_SPOT && !spot)
+			spot = &light;
+		else if (light.type == SCENE_LIGHT_POINT)
+			m_pointLights.push_back(&light);
+	}
+
+	// missing lights stay in the shader with no color
+	SceneLight none = {};
+	none.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	none.constant = 1.0f;
+
+	Shader& shader = m_litShader;
+	shader.Use();
+	const SceneLight& dirLight = directional ? *directional : none;
+	shader.SetVec3("dirLight.direction", dirLight.direction);
+	shader.SetVec3("dirLight.ambient", dirLight.ambient);
+	shader.SetVec3("dirLight.diffuse", dirLight.diffuse);
+	shader.SetVec3("dirLight.specular", dirLight.specular);
+
+	for (int i = (int)m_pointLights.size(); i < POINT_LIGHT_SLOTS; i++)
+	{
+		std::string indexStr = std::to_string(i);
+		shader.SetVec3("pointLights[" + indexStr + "].ambient", none.ambient);
+		shader.SetVec3("pointLights[" + indexStr + "].diffuse", none.diffuse);
+		shader.SetVec3("pointLights[" + indexStr + "].specular", none.specular);
+		shader.SetFloat("pointLights[" + indexStr + "].constant", none.constant);
+	}
+	std::vector<unsigned int> closest;
+	SelectPointLights(glm::vec3(0.0f), closest);
+	ApplyPointLights(closest);
+
+	const SceneLight& spotLight = spot ? *spot : none;
+	shader.SetVec3("spotLight.position", spotLight.position);
+	shader.SetVec3("spotLight.direction", spotLight.direction);
+	shader.SetFloat("spotLight.cutOff", spotLight.cutOff);
+	shader.SetFloat("spotLight.outerCutOff", spotLight.outerCutOff);
+	shader.SetVec3("spotLight.ambient", spotLight.ambient);
+	shader.SetVec3("spotLight.diffuse", spotLight.diffuse);
+	shader.SetVec3("spotLight.specular", spotLight.specular);
+
+	// no shadows, the samplers still need their own units since their types differ from the material array
+	shader.SetBool("shadowsEnabled", false);
+	shader.SetInt("shadowMap", CascadedShadowMap::TEXTURE_UNIT);
+	for (int i = 0; i < POINT_LIGHT_SLOTS; i++)
+	{
+		shader.SetInt("pointShadowSlots[" + std::to_string(i) + "]", -1);
+	}
+	for (int i = 0; i < PointShadowMaps::MAX_SHADOWED_LIGHTS; i++)
+	{
+		shader.SetInt("pointShadowMaps[" + std::to_string(i) + "]", PointShadowMaps::FIRST_TEXTURE_UNIT + i);
+	}
+}
+
+void FileScene::SelectPointLights(const glm::vec3& viewPos, std::vector<unsigned int>& outLights) const
+{
+	// the shader has POINT_LIGHT_SLOTS of them, with more the closest ones are picked every frame
+	outLights.resize(m_pointLights.size());
+	for (unsigned int i = 0; i < m_pointLights.size(); i++)
+		outLights[i] = i;
+	if (m_pointLights.size() <= POINT_LIGHT_SLOTS)
+		return;
+
+	std::partial_sort(outLights.begin(), outLights.begin() + POINT_LIGHT_SLOTS, outLights.end(), [this, viewPos](unsigned int a, unsigned int b)
+	{
+		glm::vec3 toA = m_pointLights[a]->position - viewPos;
+		glm::vec3 toB = m_pointLights[b]->position - viewPos;
+		return glm::dot(toA, toA) < glm::dot(toB, toB);
+	});
+	outLights.resize(POINT_LIGHT_SLOTS);
+}
+
+void FileScene::ApplyPointLights(const std::vector<unsigned int>& lights)
+{
+	if (lights == m_closestPointLights)
+		return;
+
+	Shader& shader = m_litShader;
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		if (i < m_closestPointLights.size() && lights[i] == m_closestPointLights[i])
+			continue;
+
+		const SceneLight& light = *m_pointLights[lights[i]];
+		std::string indexStr = std::to_string(i);
+		shader.SetVec3("pointLights[" + indexStr + "].position", light.position);
+
+		shader.SetVec3("pointLights[" + indexStr + "].ambient", light.ambient);
+		shader.SetVec3("pointLights[" + indexStr + "].diffuse", light.diffuse);
+		shader.SetVec3("pointLights[" + indexStr + "].specular", light.specular);
+
+		shader.SetFloat("pointLights[" + indexStr + "].constant", light.constant);
+		shader.SetFloat("pointLights[" + indexStr + "].linear", light.linear);
+		shader.SetFloat("pointLights[" + indexStr + "].quadratic", light.quadratic);
+	}
+	m_closestPointLights = lights;
+}
+
+void FileScene::SetupGroups()
+{
+	// one group per (mesh, material) pair, in order of first use
+	std::unordered_map<unsigned long long, size_t> groupIndices;
+	std::vector<std::vector<glm::mat4>> groupModels;
+	for (unsigned int i = 0; i < m_scene.GetEntityCount(); i++)
+	{
+		const SceneEntity& entity = m_scene.GetEntities()[i];
+		if (m_scene.GetMeshes()[entity.mesh].type == SCENE_MESH_QUAD)
+		{
+			m_quads.push_back(i);
+			continue;
+		}
+
+		unsigned long long key = ((unsigned long long)entity.mesh << 32) | entity.material;
+		auto found = groupIndices.find(key);
+		if (found == groupIndices.end())
+		{
+			found = groupIndices.emplace(key, m_groups.size()).first;
+			m_groups.push_back(DrawGroup());
+			m_groups.back().mesh = entity.mesh;
+			m_groups.back().material = entity.material;
+			groupModels.push_back(std::vector<glm::mat4>());
+		}
+		groupModels[found->second].push_back(SceneFile::GetEntityMatrix(entity));
+		m_groups[found->second].entities.push_back(i);
+	}
+
+	for (size_t i = 0; i < m_groups.size(); i++)
+	{
+		m_groups[i].transforms.SetModels(groupModels[i]);
+	}
+	m_modelLods.resize(m_scene.GetEntityCount());
+}
+
+void FileScene::SetupBvh()
+{
+	std::vector<glm::vec3> boxMin(m_scene.GetEntityCount()), boxMax(m_scene.GetEntityCount());
+	for (unsigned int i = 0; i < m_scene.GetEntityCount(); i++)
+	{
+		glm::vec3 localMin, localMax;
+		GetLocalBox(i, localMin, localMax);
+		Bvh::TransformBox(SceneFile::GetEntityMatrix(m_scene.GetEntities()[i]), localMin, localMax, boxMin[i], boxMax[i]);
+	}
+	m_bvh.Build(boxMin, boxMax);
+	m_entityVisible.assign(m_scene.GetEntityCount(), 1);
+}
+
+void FileScene::GetLocalBox(unsigned int entity, glm::vec3& outMin, glm::vec3& outMax) const
+{
+	unsigned int mesh = m_scene.GetEntities()[entity].mesh;
+	if (m_models[mesh])
+		m_models[mesh]->GetBounds(outMin, outMax);
+	else
+		GetShapeBox(m_scene.GetMeshes()[mesh].type, outMin, outMax);
+}
+
+void FileScene::GetShapeBox(unsigned int meshType, glm::vec3& outMin, glm::vec3& outMax)
+{
+	switch (meshType)
+	{
+		case SCENE_MESH_PLANE:
+			outMin = PLANE_BOX_MIN;
+			outMax = PLANE_BOX_MAX;
+			break;
+		case SCENE_MESH_QUAD:
+			outMin = QUAD_BOX_MIN;
+			outMax = QUAD_BOX_MAX;
+			break;
+		default:
+			outMin = CUBE_BOX_MIN;
+			outMax = CUBE_BOX_MAX;
+			break;
+	}
+}
+
+void FileScene::CullEntities(const glm::mat4& viewProj)
+{
+	for (unsigned int entity : m_visibleEntities)
+		m_entityVisible[entity] = 0;
+	m_visibleEntities.clear();
+	m_bvh.QueryFrustum(Frustum::FromMatrix(viewProj), m_visibleEntities);
+	for (unsigned int entity : m_visibleEntities)
+		m_entityVisible[entity] = 1;
+}
+
+int FileScene::Pick(const glm::vec3& origin, const glm::vec3& direction, float& outDistance)
+{
+	// the boxes only narrow it down, the hit itself is tested in mesh space
+	BvhRayHit hit;
+	bool found = m_bvh.RaycastNearest(origin, direction, PICK_DISTANCE, [&](unsigned int entity, float& distance)
+	{
+		glm::mat4 model = SceneFile::GetEntityMatrix(m_scene.GetEntities()[entity]);
+		unsigned int mesh = m_scene.GetEntities()[entity].mesh;
+		if (m_models[mesh])
+			return m_models[mesh]->Raycast(origin, direction, model, distance);
+
+		glm::mat4 toMesh = glm::inverse(model);
+		glm::vec3 meshOrigin = glm::vec3(toMesh * glm::vec4(origin, 1.0f));
+		glm::vec3 meshDirection = glm::mat3(toMesh) * direction;
+		glm::vec3 localMin, localMax;
+		GetLocalBox(entity, localMin, localMax);
+		float boxDistance;
+		if (!Bvh::IntersectRayBox(meshOrigin, 1.0f / meshDirection, localMin, localMax, distance, boxDistance) || boxDistance >= distance)
+			return false;
+
+		distance = boxDistance;
+		return true;
+	}, hit);
+
+	outDistance = hit.distance;
+	return found ? (int)hit.primitive : -1;
+}
+
+void FileScene::SetupCamera(Camera& camera)
+{
+	if (m_scene.GetCameraCount() == 0)
+		return;
+
+	const SceneCamera& sceneCamera = m_scene.GetCameras()[0];
+	camera = Camera(sceneCamera.position, glm::vec3(0.0f, 1.0f, 0.0f), sceneCamera.yaw, sceneCamera.pitch);
+}
+
+void FileScene::Draw(const Camera& camera)
+{
+	m_drawSnapshot.camera = camera;
+	m_drawSnapshot.view = camera.GetViewMatrix();
+	m_drawSnapshot.projection = camera.GetPerspectiveProj();
+	Update(m_drawSnapshot);
+	Render(m_drawSnapshot);
+}
+
+void FileScene::Update(FrameSnapshot& snapshot)
+{
+	const glm::mat4 viewProj = snapshot.projection * snapshot.view;
+	m_viewPos = snapshot.camera.Position;
+	m_viewFront = snapshot.camera.Front;
+	if (m_cullingEnabled)
+		CullEntities(viewProj);
+
+	SelectPointLights(m_viewPos, snapshot.lights);
+	snapshot.renderFlags = m_instancingEnabled ? RENDER_INSTANCED_CUBES : 0;
+	snapshot.objects.clear();
+	snapshot.drawLists.clear();
+
+	// one draw list per group, the cubes are the only ones drawn with the batch's MVPs
+	for (unsigned int i = 0; i < m_groups.size(); i++)
+	{
+		DrawGroup& group = m_groups[i];
+		bool withMVP = m_scene.GetMeshes()[group.mesh].type == SCENE_MESH_CUBE;
+		if (withMVP)
+			group.transforms.Update(viewProj);
+		AddDrawList(snapshot, i, group.entities, &group.transforms, withMVP);
+	}
+
+	// then the quads from furthest to nearest, the list after the groups'
+	const SceneEntity* entities = m_scene.GetEntities();
+	glm::vec3 viewPos = m_viewPos;
+	std::sort(m_quads.begin(), m_quads.end(), [entities, viewPos](unsigned int a, unsigned int b)
+	{
+		glm::vec3 toA = entities[a].position - viewPos;
+		glm::vec3 toB = entities[b].position - viewPos;
+		return glm::dot(toA, toA) > glm::dot(toB, toB);
+	});
+	AddDrawList(snapshot, (unsigned int)m_groups.size(), m_quads, nullptr, false);
+
+	m_drawnEntityCount = snapshot.objects.size();
+}
+
+void FileScene::AddDrawList(FrameSnapshot& snapshot, unsigned int batch, const std::vector<unsigned int>& entities,
+	const TransformBatch* transforms, bool withMVP) const
+{
+	SnapshotDrawList list = { batch, (unsigned int)snapshot.objects.size(), 0 };
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		if (!m_entityVisible[entities[i]])
+			continue;
+
+		SnapshotObject object;
+		object.model = transforms ? transforms->GetModel(i) : SceneFile::GetEntityMatrix(m_scene.GetEntities()[entities[i]]);
+		object.mvp = withMVP ? transforms->GetMVP(i) : glm::mat4(1.0f);
+		object.normalMatrix = transforms ? transforms->GetNormalMatrix(i) : glm::mat3(1.0f);
+		object.entity = entities[i];
+		snapshot.objects.push_back(object);
+	}
+
+	list.count = (unsigned int)snapshot.objects.size() - list.first;
+	if (list.count > 0)
+		snapshot.drawLists.push_back(list);
+}
+
+void FileScene::Render(const FrameSnapshot& snapshot)
+{
+	m_instanceStream.BeginFrame();
+	m_textures.Bind(0);
+	DrawLitGroups(snapshot);
+
+	m_unlitShader.Use();
+	m_unlitShader.SetMat4("view", snapshot.view);
+	m_unlitShader.SetMat4("projection", snapshot.projection);
+	DrawPlanes(snapshot);
+	DrawQuads(snapshot);
+	m_instanceStream.EndFrame();
+}
+
+void FileScene::OnKeyPressed(int key)
+{
+	if (key == GLFW_KEY_P)
+	{
+		std::cout << "Scene " << m_path << " loaded in " << m_loadMs << " ms:" << std::endl;
+		std::cout << "  " << m_scene.GetEntityCount() << " entities in " << m_groups.size() << " groups and "
+			<< m_quads.size() << " sorted quads" << std::endl;
+		std::cout << "  " << m_scene.GetMeshCount() << " meshes, " << m_scene.GetMaterialCount() << " materials ("
+			<< m_textures.GetLayerCount() << " texture layers), " << m_scene.GetLightCount() << " lights" << std::endl;
+		std::cout << "  BVH: " << m_bvh.GetNodes().size() << " nodes, depth " << m_bvh.GetDepth() << ", "
+			<< m_drawnEntityCount << " entities drawn" << std::endl;
+		std::cout << "  instanced cubes: " << (m_instancingEnabled ? "on" : "off") << ", "
+			<< (m_instanceStreamPersistent ? "persistent mapped" : "orphaned") << " stream of "
+			<< m_instanceStreamSize / 1024 << " KB x " << (m_instanceStreamPersistent ? StreamBuffer::FRAMES_IN_FLIGHT : 1) << std::endl;
+	}
+	else if (key == GLFW_KEY_C)
+	{
+		m_cullingEnabled = !m_cullingEnabled;
+		if (!m_cullingEnabled)
+		{
+			m_entityVisible.assign(m_scene.GetEntityCount(), 1);
+			m_visibleEntities.clear();
+		}
+		std::cout << "BVH frustum culling: " << (m_cullingEnabled ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_I)
+	{
+		m_instancingEnabled = !m_instancingEnabled;
+		std::cout << "Instanced cubes: " << (m_instancingEnabled ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_K)
+	{
+		float distance;
+		int entity = Pick(m_viewPos, m_viewFront, distance);
+		if (entity < 0)
+		{
+			std::cout << "Nothing picked" << std::endl;
+			return;
+		}
+
+		const SceneEntity& picked = m_scene.GetEntities()[entity];
+		std::cout << "Picked entity " << entity << " (" << m_scene.GetString(m_scene.GetMeshes()[picked.mesh].name) << ", "
+			<< m_scene.GetString(m_scene.GetMaterials()[picked.material].name) << ") at " << distance << std::endl;
+	}
+}
+
+void FileScene::SelectMaterial(Shader& shader, unsigned int material, bool lit) const
+{
+	if (!lit)
+	{
+		m_textures.SelectLayer(shader, m_diffuseLayers[material]);
+		return;
+	}
+
+	shader.SetFloat("material.diffuseLayer", (float)m_diffuseLayers[material]);
+	shader.SetFloat("material.specularLayer", (float)m_specularLayers[material]);
+	shader.SetFloat("material.shininess", m_scene.GetMaterials()[material].shininess);
+}
+
+void FileScene::DrawLitGroups(const FrameSnapshot& snapshot)
+{
+	m_litShader.Use();
+	m_litShader.SetVec3("viewPos", snapshot.camera.Position);
+	m_litShader.SetVec3("cameraFront", snapshot.camera.Front);
+	m_litShader.SetMat4("viewProj", snapshot.projection * snapshot.view);
+	ApplyPointLights(snapshot.lights);
+
+	glBindVertexArray(m_cubeVAO);
+	for (const SnapshotDrawList& list : snapshot.drawLists)
+	{
+		if (list.batch >= m_groups.size())
+			continue;
+
+		const DrawGroup& group = m_groups[list.batch];
+		unsigned int meshType = m_scene.GetMeshes()[group.mesh].type;
+		if (!IsLit(meshType))
+			continue;
+
+		SelectMaterial(m_litShader, group.material, true);
+		const SnapshotObject* objects = &snapshot.objects[list.first];
+		if (meshType == SCENE_MESH_MODEL)
+		{
+			// models bind their own textures and pick their own layers
+			Model& model = *m_models[group.mesh];
+			for (unsigned int i = 0; i < list.count; i++)
+				model.Draw(m_litShader, snapshot.camera, objects[i].model, m_modelLods[objects[i].entity], m_modelStats);
+
+			m_textures.Bind(0);
+			glBindVertexArray(m_cubeVAO);
+			continue;
+		}
+
+		if ((snapshot.renderFlags & RENDER_INSTANCED_CUBES) && DrawCubesInstanced(objects, list.count))
+			continue;
+
+		for (unsigned int i = 0; i < list.count; i++)
+		{
+			m_litShader.SetObjectMatrices(objects[i].model, objects[i].mvp, objects[i].normalMatrix);
+			glDrawArrays(GL_TRIANGLES, 0, 36);
+		}
+	}
+}
+
+bool FileScene::DrawCubesInstanced(const SnapshotObject* objects, unsigned int count)
+{
+	StreamAllocation allocation = m_instanceStream.Allocate(count * sizeof(CubeInstance));
+	if (!allocation.IsValid())
+		return false;
+
+	// written in order, the mapping may be write-combined memory
+	CubeInstance* instances = (CubeInstance*)allocation.data;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		instances[i].model = objects[i].model;
+		instances[i].normalMatrix = objects[i].normalMatrix;
+	}
+	m_instanceStream.Flush();
+
+	glBindVertexArray(m_instancedCubeVAO);
+	SetInstanceAttributes(allocation.offset);
+	m_litShader.SetBool("instanced", true);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)count);
+	m_litShader.SetBool("instanced", false);
+	glBindVertexArray(m_cubeVAO);
+	return true;
+}
+
+void FileScene::DrawPlanes(const FrameSnapshot& snapshot)
+{
+	glBindVertexArray(m_planeVAO);
+	for (const SnapshotDrawList& list : snapshot.drawLists)
+	{
+		if (list.batch >= m_groups.size() || m_scene.GetMeshes()[m_groups[list.batch].mesh].type != SCENE_MESH_PLANE)
+			continue;
+
+		SelectMaterial(m_unlitShader, m_groups[list.batch].material, false);
+		for (unsigned int i = list.first; i < list.first + list.count; i++)
+		{
+			m_unlitShader.SetMat4("model", snapshot.objects[i].model);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+	}
+}
+
+void FileScene::DrawQuads(const FrameSnapshot& snapshot)
+{
+	// already sorted from furthest to nearest
+	const SceneEntity* entities = m_scene.GetEntities();
+	glBindVertexArray(m_quadVAO);
+	unsigned int material = m_scene.GetMaterialCount();	// none selected yet
+	for (const SnapshotDrawList& list : snapshot.drawLists)
+	{
+		if (list.batch != m_groups.size())
+			continue;
+
+		for (unsigned int i = list.first; i < list.first + list.count; i++)
+		{
+			const SceneEntity& entity = entities[snapshot.objects[i].entity];
+			if (entity.material != material)
+			{
+				material = entity.material;
+				SelectMaterial(m_unlitShader, material, false);
+			}
+			m_unlitShader.SetMat4("model", snapshot.objects[i].model);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+	}
+}
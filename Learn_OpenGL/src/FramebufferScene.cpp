@@ -1,6 +1,8 @@
 #include "FramebufferScene.h"
 #include <VertexArrayInitializer.h>
 #include <Model.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
 
 FramebufferScene::FramebufferScene()
 {
@@ -11,26 +13,36 @@ void FramebufferScene::Setup()
     glEnable(GL_DEPTH_TEST);
 
     m_shader.LoadShader(".\\shaders\\framebuffers.vs", ".\\shaders\\framebuffers.fs");
-    m_screenShader.LoadShader(".\\shaders\\framebuffers_screen.vs", ".\\shaders\\framebuffers_screen.fs");
 
     m_cubeTexture = Model::TextureFromFile("container.jpg", ".\\resources\\textures");
     m_floorTexture = Model::TextureFromFile("metal.png", ".\\resources\\textures");
 
     VertexArrayInitializer::SetupCubeNoNormal(m_cubeVAO);
     VertexArrayInitializer::SetupPlane(m_planeVAO);
-    VertexArrayInitializer::SetupScreenQuad(m_quadVAO);
 
     m_shader.Use();
     m_shader.SetInt("texture1", 0);
 
-    m_screenShader.Use();
-    m_screenShader.SetInt("screenTexture", 0);
+    // same edge detection the screen shader used to hard-code, the other effects start disabled
+    m_postProcess.Setup();
+    m_postProcess.AddEffect(PostEffectType::GAUSSIAN_BLUR, 8.0f);
+    m_postProcess.AddEffect(PostEffectType::EDGE_DETECT);
+    m_postProcess.AddEffect(PostEffectType::GRAYSCALE);
+    m_postProcess.AddEffect(PostEffectType::SHARPEN);
+    for (PostEffect& effect : m_postProcess.GetEffects())
+        effect.enabled = effect.type == PostEffectType::EDGE_DETECT;
+    m_postProcess.PrintEffects();
 
     SetupFramebuffer();
 }
 
 void FramebufferScene::Draw(const Camera& camera)
 {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] != m_width || viewport[3] != m_height)
+        ResizeFramebuffer(viewport[2], viewport[3]);
+
     // render
     // ------
     // bind to framebuffer and draw scene as we normally would to color texture 
@@ -62,17 +74,33 @@ void FramebufferScene::Draw(const Camera& camera)
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
 
-    // now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-    // clear all relevant buffers
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    m_screenShader.Use();
-    glBindVertexArray(m_quadVAO);
-    glBindTexture(GL_TEXTURE_2D, m_textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // now run the post-processing chain from the color texture into the default framebuffer
+    m_postProcess.Apply(m_textureColorbuffer, m_width, m_height, 0);
+}
+
+void FramebufferScene::OnKeyPressed(int key)
+{
+    std::vector<PostEffect>& effects = m_postProcess.GetEffects();
+    if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + (int)effects.size())
+    {
+        PostEffect& effect = effects[key - GLFW_KEY_1];
+        effect.enabled = !effect.enabled;
+    }
+    else if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_MINUS)
+    {
+        for (PostEffect& effect : effects)
+        {
+            if (effect.type != PostEffectType::GAUSSIAN_BLUR)
+                continue;
+            effect.radius += key == GLFW_KEY_EQUAL ? 2.0f : -2.0f;
+            effect.radius = std::min(std::max(effect.radius, 2.0f), (float)PostProcessStack::MAX_BLUR_RADIUS);
+        }
+    }
+    else
+    {
+        return;
+    }
+    m_postProcess.PrintEffects();
 }
 
 void FramebufferScene::SetupFramebuffer()
@@ -85,19 +113,36 @@ void FramebufferScene::SetupFramebuffer()
     // create a color attachment texture
     glGenTextures(1, &m_textureColorbuffer);
     glBindTexture(GL_TEXTURE_2D, m_textureColorbuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 800.0f, 600.0f, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureColorbuffer, 0);
 
     // create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 800.0f, 600.0f); // use a single renderbuffer object for both a depth AND stencil buffer.
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
-    
-    // now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
+    glGenRenderbuffers(1, &m_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffer); // now actually attach it
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    ResizeFramebuffer(viewport[2], viewport[3]);
+}
+
+void FramebufferScene::ResizeFramebuffer(int width, int height)
+{
+    // a minimized window has an empty viewport, the attachments keep their last size
+    if (width <= 0 || height <= 0)
+        return;
+
+    m_width = width;
+    m_height = height;
+    glBindTexture(GL_TEXTURE_2D, m_textureColorbuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height); // use a single renderbuffer object for both a depth AND stencil buffer.
+
+    // now that the attachments have storage we want to check if the framebuffer is actually complete
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
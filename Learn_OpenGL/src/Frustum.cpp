@@ -0,0 +1,32 @@
+#include "Frustum.h"
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProj, const glm::vec2& ndcMin, const glm::vec2& ndcMax)
+{
+	// glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+	// a clip space point is inside when ndcMin.x * w <= x <= ndcMax.x * w (same for y) and -w <= z <= w
+	Frustum frustum;
+	frustum.planes[0] = rows[0] - ndcMin.x * rows[3];
+	frustum.planes[1] = ndcMax.x * rows[3] - rows[0];
+	frustum.planes[2] = rows[1] - ndcMin.y * rows[3];
+	frustum.planes[3] = ndcMax.y * rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+
+	for (glm::vec4& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
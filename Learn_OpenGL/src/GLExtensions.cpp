@@ -0,0 +1,34 @@
+#include "GLExtensions.h"
+#include <algorithm>
+
+PFNTEXSTORAGE2DPROC GLExtensions::TexStorage2D = nullptr;
+PFNBUFFERSTORAGEPROC GLExtensions::BufferStorage = nullptr;
+
+std::vector<std::string> GLExtensions::s_extensions;
+bool GLExtensions::s_extensionsRead = false;
+
+void GLExtensions::Load(GLADloadproc loader)
+{
+	if (HasExtension("GL_ARB_texture_storage"))
+		TexStorage2D = (PFNTEXSTORAGE2DPROC)loader("glTexStorage2D");
+	if (HasExtension("GL_ARB_buffer_storage"))
+		BufferStorage = (PFNBUFFERSTORAGEPROC)loader("glBufferStorage");
+}
+
+bool GLExtensions::HasExtension(const char* name)
+{
+	// the list doesn't change for the lifetime of the context
+	if (!s_extensionsRead)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension)
+				s_extensions.push_back(extension);
+		}
+		s_extensionsRead = true;
+	}
+	return std::find(s_extensions.begin(), s_extensions.end(), name) != s_extensions.end();
+}
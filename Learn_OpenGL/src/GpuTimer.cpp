@@ -0,0 +1,47 @@
+#include "GpuTimer.h"
+
+void GpuTimer::Begin()
+{
+	if (m_queries[0] == 0)
+		glGenQueries(QUERY_COUNT, m_queries);
+
+	// the query issued QUERY_COUNT frames ago is almost always available by now
+	CollectResult(m_current);
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_current]);
+}
+
+void GpuTimer::End()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	m_pending[m_current] = true;
+	m_current = (m_current + 1) % QUERY_COUNT;
+}
+
+void GpuTimer::Reset()
+{
+	// results still in flight belong to the previous measurement
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (m_pending[i])
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(m_queries[i], GL_QUERY_RESULT, &elapsed);
+			m_pending[i] = false;
+		}
+	}
+	m_totalMs = 0.0;
+	m_sampleCount = 0;
+}
+
+void GpuTimer::CollectResult(int index)
+{
+	if (!m_pending[index])
+		return;
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &elapsed);
+	m_pending[index] = false;
+
+	m_totalMs += elapsed / 1000000.0;
+	m_sampleCount++;
+}
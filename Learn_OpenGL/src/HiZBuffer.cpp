@@ -0,0 +1,95 @@
+#include "HiZBuffer.h"
+#include <VertexArrayInitializer.h>
+#include <algorithm>
+
+HiZBuffer::HiZBuffer()
+{
+}
+
+void HiZBuffer::Setup(int width, int height)
+{
+	m_copyShader.LoadShader(".\\shaders\\framebuffers_screen.vs", ".\\shaders\\hiz_copy.fs");
+	m_reduceShader.LoadShader(".\\shaders\\framebuffers_screen.vs", ".\\shaders\\hiz_reduce.fs");
+	m_copyShader.Use();
+	m_copyShader.SetInt("depthTexture", 0);
+	m_reduceShader.Use();
+	m_reduceShader.SetInt("previousLevel", 0);
+	VertexArrayInitializer::SetupScreenQuad(m_quadVAO);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	Resize(width, height);
+}
+
+void HiZBuffer::Resize(int width, int height)
+{
+	// a minimized window has an empty viewport, the pyramid keeps its last size
+	if (width <= 0 || height <= 0 || (width == GetWidth() && height == GetHeight()))
+		return;
+
+	// the level count changes with the size, the texture is made again rather than respecified
+	if (m_texture)
+		glDeleteTextures(1, &m_texture);
+
+	// halving rounds down, the reduction folds the odd texel into the last one of the next level
+	m_mipSizes.clear();
+	glm::ivec2 size(width, height);
+	m_mipSizes.push_back(size);
+	while (size.x > 1 || size.y > 1)
+	{
+		size = glm::max(size / 2, glm::ivec2(1));
+		m_mipSizes.push_back(size);
+	}
+
+	glGenTextures(1, &m_texture);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	for (int level = 0; level < GetMipCount(); level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, m_mipSizes[level].x, m_mipSizes[level].y, 0, GL_RED, GL_FLOAT, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GetMipCount() - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Hi-Z framebuffer is not complete!" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HiZBuffer::Build(unsigned int depthTexture)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_quadVAO);
+	glActiveTexture(GL_TEXTURE0);
+
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+	glViewport(0, 0, m_mipSizes[0].x, m_mipSizes[0].y);
+	m_copyShader.Use();
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	// each pass reads the level above the one it writes, the base/max level range keeps the
+	// written level out of what the sampler can see so there is no feedback loop
+	m_reduceShader.Use();
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	for (int level = 1; level < GetMipCount(); level++)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, level);
+		glViewport(0, 0, m_mipSizes[level].x, m_mipSizes[level].y);
+		m_reduceShader.SetVec2("previousSize", glm::vec2(m_mipSizes[level - 1]));
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GetMipCount() - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,241 @@
+#include "JobBenchmark.h"
+#include <JobSystem.h>
+#include <CommandBuffer.h>
+#include <TransformBatch.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// every measure keeps the best of a few runs, the first one also warms the workers up
+	const int RUNS = 3;
+
+	// std::thread and std::async cost far more per task, they get fewer of them
+	const unsigned int MAX_THREAD_SPAWNS = 2000;
+
+	// the nested test spawns two children per job down to this depth
+	const int NESTED_DEPTH = 16;
+
+	// elements and iterations per element of the scaling workload
+	const size_t SCALING_ELEMENTS = 1 << 16;
+	const int WORK_ITERATIONS = 256;
+
+	// objects whose draws the recording test records
+	const size_t RECORDED_OBJECTS = 100000;
+
+	typedef std::chrono::steady_clock Clock;
+
+	template<typename F>
+	double BestMilliseconds(F run)
+	{
+		double best = 0.0;
+		for (int i = 0; i < RUNS; i++)
+		{
+			auto start = Clock::now();
+			run();
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			best = i == 0 ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+
+	// some arithmetic the compiler can't fold, its result is stored so it can't be dropped either
+	float Work(size_t element)
+	{
+		float x = (float)element;
+		for (int i = 0; i < WORK_ITERATIONS; i++)
+			x = x * 0.999f + std::sqrt(x + (float)i);
+		return x;
+	}
+
+	void SpawnTree(JobCounter& counter, int depth, std::vector<float>& leaves, size_t leaf)
+	{
+		if (depth == 0)
+		{
+			leaves[leaf] = Work(leaf);
+			return;
+		}
+
+		// the children go to this worker's own queue, the others only get them by stealing
+		for (size_t child = 0; child < 2; child++)
+		{
+			size_t childLeaf = leaf * 2 + child;
+			JobSystem::Run(counter, [&counter, depth, &leaves, childLeaf]() { SpawnTree(counter, depth - 1, leaves, childLeaf); });
+		}
+	}
+}
+
+int JobBenchmark::Run(int argc, char** argv)
+{
+	JobBenchmarkOptions options;
+	for (int i = 0; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc)
+			options.maxThreads = (unsigned int)std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--jobs" && i + 1 < argc)
+			options.jobCount = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		else
+		{
+			std::cout << "usage: bench-jobs [--threads N] [--jobs N]" << std::endl;
+			return 1;
+		}
+	}
+	return Run(options);
+}
+
+int JobBenchmark::Run(const JobBenchmarkOptions& options)
+{
+	unsigned int maxThreads = options.maxThreads > 0 ? options.maxThreads : std::max(1u, std::thread::hardware_concurrency());
+
+	JobSystem::Shutdown();
+	JobSystem::Setup(maxThreads);
+	std::cout << "job system: " << JobSystem::GetWorkerCount() << " workers + the calling thread" << std::endl;
+
+	BenchmarkSpawn(options.jobCount);
+	BenchmarkNested();
+	BenchmarkScaling(maxThreads);
+	BenchmarkCommandRecording(maxThreads);
+
+	JobSystem::Shutdown();
+	return 0;
+}
+
+void JobBenchmark::BenchmarkSpawn(unsigned int jobCount)
+{
+	std::cout << "spawn,tasks,total ms,ns per task" << std::endl;
+	auto print = [](const char* name, unsigned int count, double ms)
+	{
+		std::cout << name << "," << count << "," << ms << "," << ms * 1e6 / count << std::endl;
+	};
+
+	print("JobSystem::Run", jobCount, BestMilliseconds([jobCount]()
+	{
+		JobCounter counter;
+		for (unsigned int i = 0; i < jobCount; i++)
+			JobSystem::Run(counter, []() {});
+		JobSystem::Wait(counter);
+	}));
+
+	print("JobSystem::ParallelFor", jobCount, BestMilliseconds([jobCount]()
+	{
+		JobSystem::ParallelFor(jobCount, 1, [](size_t, size_t) {});
+	}));
+
+	unsigned int threadSpawns = std::min(jobCount, MAX_THREAD_SPAWNS);
+	print("std::async", threadSpawns, BestMilliseconds([threadSpawns]()
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(threadSpawns);
+		for (unsigned int i = 0; i < threadSpawns; i++)
+			futures.push_back(std::async(std::launch::async, []() {}));
+		for (std::future<void>& future : futures)
+			future.get();
+	}));
+
+	print("std::thread", threadSpawns, BestMilliseconds([threadSpawns]()
+	{
+		// joined right away, a few thousand live threads is more than some systems allow
+		for (unsigned int i = 0; i < threadSpawns; i++)
+			std::thread([]() {}).join();
+	}));
+}
+
+void JobBenchmark::BenchmarkNested()
+{
+	// a binary tree of jobs from a single root: every worker but the first starts with nothing to do
+	std::vector<float> leaves((size_t)1 << NESTED_DEPTH);
+	size_t jobCount = (leaves.size() - 1) * 2 + 1;
+
+	double ms = BestMilliseconds([&leaves]()
+	{
+		JobCounter counter;
+		JobSystem::Run(counter, [&counter, &leaves]() { SpawnTree(counter, NESTED_DEPTH, leaves, 0); });
+		JobSystem::Wait(counter);
+	});
+
+	std::cout << "nested,jobs,total ms,ns per job" << std::endl;
+	std::cout << "depth " << NESTED_DEPTH << "," << jobCount << "," << ms << "," << ms * 1e6 / jobCount << std::endl;
+}
+
+void JobBenchmark::BenchmarkScaling(unsigned int maxThreads)
+{
+	std::vector<float> results(SCALING_ELEMENTS);
+	auto parallelFor = [&results]()
+	{
+		JobSystem::ParallelFor(results.size(), 0, [&results](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				results[i] = Work(i);
+		});
+	};
+
+	std::cout << "scaling,threads,ms,speedup" << std::endl;
+	double singleThreadMs = 0.0;
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		JobSystem::Shutdown();
+		JobSystem::Setup(threads);
+
+		double ms = BestMilliseconds(parallelFor);
+		if (threads == 1)
+			singleThreadMs = ms;
+		std::cout << "ParallelFor," << threads << "," << ms << "," << singleThreadMs / ms << std::endl;
+	}
+}
+
+void JobBenchmark::BenchmarkCommandRecording(unsigned int maxThreads)
+{
+	// the stream LightScene records for its cubes, without a GL context to replay it
+	std::vector<glm::mat4> models(RECORDED_OBJECTS);
+	for (size_t i = 0; i < models.size(); i++)
+		models[i] = glm::mat4(1.0f + (float)(i % 7));
+	TransformBatch transforms;
+	transforms.SetModels(models);
+	transforms.Update(glm::mat4(2.0f));
+
+	ObjectMatrixLocations locations;
+	locations.model = 0;
+	locations.mvp = 1;
+	locations.normalMatrix = 2;
+
+	std::vector<CommandBuffer> buffers;
+	auto record = [&]()
+	{
+		CommandBuffer::RecordParallel(buffers, transforms.Size(), 0, [&](CommandBuffer& commands, size_t begin, size_t end)
+		{
+			commands.UseProgram(1);
+			commands.BindVertexArray(1);
+			for (size_t i = begin; i < end; i++)
+			{
+				commands.SetObjectMatrices(locations, transforms.GetModel(i), transforms.GetMVP(i), transforms.GetNormalMatrix(i));
+				commands.DrawArrays(GL_TRIANGLES, 0, 36);
+			}
+		});
+	};
+
+	std::cout << "recording,threads,objects,ms,speedup" << std::endl;
+	double singleThreadMs = 0.0;
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		JobSystem::Shutdown();
+		JobSystem::Setup(threads);
+
+		double ms = BestMilliseconds(record);
+		if (threads == 1)
+			singleThreadMs = ms;
+		std::cout << "CommandBuffer::RecordParallel," << threads << "," << transforms.Size() << "," << ms << "," << singleThreadMs / ms << std::endl;
+	}
+
+	size_t bytes = 0;
+	for (const CommandBuffer& buffer : buffers)
+		bytes += buffer.GetSize();
+	std::cout << "recorded " << bytes / (1024 * 1024) << " MB in " << buffers.size() << " buffers" << std::endl;
+}
@@ -0,0 +1,262 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace
+{
+	// rounds a worker spins through the queues before going to sleep
+	const int IDLE_SPINS = 64;
+
+	// batches per thread when ParallelFor picks the batch size, a few so the faster threads steal the rest
+	const size_t BATCHES_PER_THREAD = 4;
+
+	// queue of the calling thread, -1 outside the pool
+	thread_local int t_workerQueue = -1;
+
+	class SpinLock
+	{
+	public:
+		SpinLock(std::atomic_flag& flag) : m_flag(flag)
+		{
+			while (m_flag.test_and_set(std::memory_order_acquire))
+				std::this_thread::yield();
+		}
+		~SpinLock() { m_flag.clear(std::memory_order_release); }
+
+	private:
+		std::atomic_flag& m_flag;
+	};
+}
+
+std::vector<std::unique_ptr<JobSystem::WorkQueue>> JobSystem::s_queues;
+std::vector<std::thread> JobSystem::s_workers;
+std::atomic<int> JobSystem::s_queuedJobs(0);
+std::atomic<int> JobSystem::s_sleepingWorkers(0);
+std::mutex JobSystem::s_sleepMutex;
+std::condition_variable JobSystem::s_wakeCondition;
+bool JobSystem::s_stopping = false;
+std::mutex JobSystem::s_setupMutex;
+std::atomic<bool> JobSystem::s_ready(false);
+
+void JobSystem::Setup(unsigned int threadCount)
+{
+	std::lock_guard<std::mutex> setupLock(s_setupMutex);
+	if (s_ready)
+		return;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	// the queues of the workers and the one shared by the other threads
+	s_queues.clear();
+	for (unsigned int i = 0; i < threadCount; i++)
+		s_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+
+	s_stopping = false;
+	for (unsigned int i = 0; i + 1 < threadCount; i++)
+		s_workers.push_back(std::thread(&JobSystem::WorkerLoop, i));
+	s_ready = true;
+}
+
+void JobSystem::Shutdown()
+{
+	std::lock_guard<std::mutex> setupLock(s_setupMutex);
+	if (!s_ready)
+		return;
+
+	// whatever is still queued is dropped, callers Wait on their jobs before this
+	{
+		std::lock_guard<std::mutex> lock(s_sleepMutex);
+		s_stopping = true;
+	}
+	s_wakeCondition.notify_all();
+	for (std::thread& worker : s_workers)
+		worker.join();
+
+	s_workers.clear();
+	s_queues.clear();
+	s_queuedJobs = 0;
+	s_ready = false;
+}
+
+unsigned int JobSystem::GetWorkerCount()
+{
+	EnsureSetup();
+	return (unsigned int)s_workers.size();
+}
+
+void JobSystem::EnsureSetup()
+{
+	if (!s_ready)
+		Setup();
+}
+
+unsigned int JobSystem::GetThreadQueue()
+{
+	// threads outside the pool share the last queue
+	return t_workerQueue >= 0 ? (unsigned int)t_workerQueue : (unsigned int)s_queues.size() - 1;
+}
+
+void JobSystem::Run(JobCounter& counter, std::function<void()> job)
+{
+	EnsureSetup();
+	counter.m_pending++;
+	Submit(Job{ std::move(job), &counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobCounter& counter, std::function<void()> job)
+{
+	EnsureSetup();
+	counter.m_pending++;
+	{
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (dependency.m_pending.load() > 0)
+		{
+			dependency.m_continuations.push_back(std::make_pair(std::move(job), &counter));
+			return;
+		}
+	}
+	Submit(Job{ std::move(job), &counter });
+}
+
+void JobSystem::Submit(Job job)
+{
+	{
+		WorkQueue& queue = *s_queues[GetThreadQueue()];
+		SpinLock lock(queue.lock);
+		queue.jobs.push_back(std::move(job));
+	}
+
+	// a worker going to sleep counts itself before its last look at the queues, so either it sees this
+	// job or this sees it sleeping
+	s_queuedJobs++;
+	if (s_sleepingWorkers.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_sleepMutex);
+		}
+		s_wakeCondition.notify_one();
+	}
+}
+
+bool JobSystem::PopOrSteal(unsigned int queue, Job& outJob)
+{
+	// own jobs newest first
+	{
+		WorkQueue& own = *s_queues[queue];
+		SpinLock lock(own.lock);
+		if (!own.jobs.empty())
+		{
+			outJob = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			s_queuedJobs--;
+			return true;
+		}
+	}
+
+	// then the oldest job of another queue, starting from the next one so thieves spread out
+	size_t queueCount = s_queues.size();
+	for (size_t i = 1; i < queueCount; i++)
+	{
+		WorkQueue& victim = *s_queues[(queue + i) % queueCount];
+		SpinLock lock(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			outJob = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			s_queuedJobs--;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::RunOneJob(unsigned int queue)
+{
+	Job job;
+	if (!PopOrSteal(queue, job))
+		return false;
+
+	job.function();
+	FinishJob(*job.counter);
+	return true;
+}
+
+void JobSystem::FinishJob(JobCounter& counter)
+{
+	// the last job takes the continuations; the lock also keeps Wait from returning, and the counter
+	// from being destroyed, before this is done with it
+	std::vector<std::pair<std::function<void()>, JobCounter*>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter.m_mutex);
+		if (--counter.m_pending == 0)
+			continuations.swap(counter.m_continuations);
+	}
+
+	for (std::pair<std::function<void()>, JobCounter*>& continuation : continuations)
+		Submit(Job{ std::move(continuation.first), continuation.second });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	EnsureSetup();
+	unsigned int queue = GetThreadQueue();
+	while (counter.m_pending.load() > 0)
+	{
+		if (!RunOneJob(queue))
+			std::this_thread::yield();
+	}
+
+	// the last job may still hold the lock
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& job)
+{
+	if (count == 0)
+		return;
+
+	EnsureSetup();
+	if (batchSize == 0)
+	{
+		size_t batchCount = (s_workers.size() + 1) * BATCHES_PER_THREAD;
+		batchSize = std::max<size_t>(1, (count + batchCount - 1) / batchCount);
+	}
+
+	// the caller takes the first batch itself instead of queuing it
+	JobCounter counter;
+	for (size_t begin = batchSize; begin < count; begin += batchSize)
+	{
+		size_t end = std::min(begin + batchSize, count);
+		Run(counter, [&job, begin, end]() { job(begin, end); });
+	}
+	job(0, std::min(batchSize, count));
+	Wait(counter);
+}
+
+void JobSystem::WorkerLoop(unsigned int queue)
+{
+	t_workerQueue = (int)queue;
+	int idleSpins = 0;
+	while (true)
+	{
+		if (RunOneJob(queue))
+		{
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(s_sleepMutex);
+		s_sleepingWorkers++;
+		s_wakeCondition.wait(lock, []() { return s_stopping || s_queuedJobs.load() > 0; });
+		s_sleepingWorkers--;
+		if (s_stopping)
+			return;
+		idleSpins = 0;
+	}
+}
@@ -0,0 +1,642 @@
+#include "KtxLoader.h"
+#include <VirtualFileSystem.h>
+#include <GLExtensions.h>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+// Compressed formats which are not part of the 3.3 core profile glad was generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_R11_EAC 0x9270
+#define GL_COMPRESSED_RG11_EAC 0x9272
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_SRGB8_ETC2 0x9275
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9276
+#define GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9277
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC 0x9279
+#endif
+
+namespace
+{
+	const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// Fixed part of the KTX2 header, right after the identifier
+	struct Ktx2Header
+	{
+		unsigned int vkFormat;
+		unsigned int typeSize;
+		unsigned int pixelWidth;
+		unsigned int pixelHeight;
+		unsigned int pixelDepth;
+		unsigned int layerCount;
+		unsigned int faceCount;
+		unsigned int levelCount;
+		unsigned int supercompressionScheme;
+
+		unsigned int dfdByteOffset;
+		unsigned int dfdByteLength;
+		unsigned int kvdByteOffset;
+		unsigned int kvdByteLength;
+		unsigned long long sgdByteOffset;
+		unsigned long long sgdByteLength;
+	};
+
+	struct Ktx2LevelIndex
+	{
+		unsigned long long byteOffset;
+		unsigned long long byteLength;
+		unsigned long long uncompressedByteLength;
+	};
+
+	// the largest texture GL 3.3 drivers commonly allow, a full mip chain of it has 15 levels
+	const unsigned int MAX_DIMENSION = 16384;
+	const unsigned int MAX_LEVEL_COUNT = 15;
+
+	// written so that offset + length can't wrap around
+	bool IsRangeInFile(unsigned long long offset, unsigned long long length, size_t fileSize)
+	{
+		return offset <= fileSize && length <= fileSize - offset;
+	}
+}
+
+bool KtxLoader::s_flipVertically = false;
+
+unsigned int KtxLoader::LoadTexture(const std::string& path)
+{
+	KtxData data;
+	if (!LoadTextureData(path, data))
+		return 0;
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	UploadLevels(GL_TEXTURE_2D, data, 0, AllocateStorage(GL_TEXTURE_2D, data));
+
+	if (data.hasAlpha)
+	{
+		// avoid top-bottom interpolation when repeating alpha texture
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, data.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return textureID;
+}
+
+bool KtxLoader::LoadTextureData(const std::string& path, KtxData& outData)
+{
+	if (!ReadFile(path, outData))
+		return false;
+
+	if (outData.faceCount != 1)
+	{
+		std::cout << "ERROR::KTX::NOT_A_2D_TEXTURE: " << path << std::endl;
+		return false;
+	}
+
+	if (!IsFormatSupported(outData.internalFormat))
+		return false;
+
+	if (!MatchOrientation(outData))
+	{
+		std::cout << "ERROR::KTX::CANNOT_FLIP: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+unsigned int KtxLoader::LoadCubemap(const std::vector<std::string>& facePaths)
+{
+	// every face has to be present, square, in the same supported format and with the same size and mip chain
+	std::vector<KtxData> faces(facePaths.size());
+	for (unsigned int i = 0; i < facePaths.size(); i++)
+	{
+		if (!ReadFile(facePaths[i], faces[i]) || faces[i].faceCount != 1 || !IsFormatSupported(faces[i].internalFormat) || !MatchOrientation(faces[i]))
+			return 0;
+
+		if (faces[i].width != faces[i].height || faces[i].vkFormat != faces[0].vkFormat || faces[i].width != faces[0].width
+			|| faces[i].height != faces[0].height || faces[i].levelCount != faces[0].levelCount)
+		{
+			std::cout << "ERROR::KTX::CUBEMAP_FACES_MISMATCH: " << facePaths[i] << std::endl;
+			return 0;
+		}
+	}
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	bool allocated = AllocateStorage(GL_TEXTURE_CUBE_MAP, faces[0]);
+	for (unsigned int i = 0; i < faces.size(); i++)
+	{
+		UploadLevels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i], 0, allocated);
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, faces[0].levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	return textureID;
+}
+
+unsigned int KtxLoader::LoadCubemap(const std::string& path)
+{
+	KtxData data;
+	if (!ReadFile(path, data))
+		return 0;
+
+	if (data.faceCount != 6 || data.width != data.height || !IsFormatSupported(data.internalFormat) || !MatchOrientation(data))
+	{
+		std::cout << "ERROR::KTX::UNSUPPORTED_CUBEMAP: " << path << std::endl;
+		return 0;
+	}
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	bool allocated = AllocateStorage(GL_TEXTURE_CUBE_MAP, data);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		UploadLevels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, data, i, allocated);
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, data.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	return textureID;
+}
+
+std::string KtxLoader::GetSiblingPath(const std::string& imagePath, const char* suffix)
+{
+	size_t dot = imagePath.find_last_of('.');
+	size_t separator = imagePath.find_last_of("\\/");
+	if (dot == std::string::npos || (separator != std::string::npos && dot < separator))
+		dot = imagePath.size();
+
+	return imagePath.substr(0, dot) + suffix;
+}
+
+bool KtxLoader::ReadFile(const std::string& path, KtxData& outData)
+{
+	// mapped straight from the asset pack when it is mounted
+	if (!VirtualFileSystem::Read(path, outData.file))
+		return false;
+
+	if (!ReadHeader(outData))
+	{
+		std::cout << "ERROR::KTX::INVALID_FILE: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool KtxLoader::WriteFile(const std::string& path, const KtxData& data)
+{
+	// data format descriptor: one basic block, samples describe where each channel lives in a block
+	unsigned int colorModel = 0;
+	std::vector<unsigned int> samples; // (bitOffset, channelType) pairs of 64 bit samples
+	switch (data.vkFormat)
+	{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: colorModel = 128; samples = { 0, 0 }; break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: colorModel = 130; samples = { 0, 15, 64, 0 }; break;
+		case VK_FORMAT_BC4_UNORM_BLOCK: colorModel = 131; samples = { 0, 0 }; break;
+		case VK_FORMAT_BC5_UNORM_BLOCK: colorModel = 132; samples = { 0, 0, 64, 1 }; break;
+		default:
+			std::cout << "ERROR::KTX::UNSUPPORTED_WRITE_FORMAT: " << data.vkFormat << std::endl;
+			return false;
+	}
+
+	std::vector<unsigned int> dfd;
+	unsigned int sampleCount = (unsigned int)samples.size() / 2;
+	unsigned int blockSize = 24 + 16 * sampleCount;
+	dfd.push_back(4 + blockSize);
+	dfd.push_back(0);								// vendorId, descriptorType
+	dfd.push_back(2 | (blockSize << 16));			// versionNumber, descriptorBlockSize
+	dfd.push_back(colorModel | (1 << 8) | (1 << 16));	// BT709 primaries, linear transfer, straight alpha
+	dfd.push_back(3 | (3 << 8));					// 4x4x1x1 texel block
+	dfd.push_back(data.blockBytes);					// bytesPlane0
+	dfd.push_back(0);
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		dfd.push_back(samples[i * 2] | (63 << 16) | (samples[i * 2 + 1] << 24));
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(0xFFFFFFFF);
+	}
+
+	// key/value data, sorted by key, each entry padded to 4 bytes
+	std::vector<unsigned char> kvd;
+	const char* keyValues[][2] = { { "KTXorientation", data.topDown ? "rd" : "ru" }, { "KTXwriter", "Learn_OpenGL cook" } };
+	for (const auto& keyValue : keyValues)
+	{
+		std::string entry = std::string(keyValue[0]) + '\0' + keyValue[1] + '\0';
+		unsigned int length = (unsigned int)entry.size();
+		kvd.insert(kvd.end(), (unsigned char*)&length, (unsigned char*)&length + 4);
+		kvd.insert(kvd.end(), entry.begin(), entry.end());
+		kvd.resize((kvd.size() + 3) & ~size_t(3), 0);
+	}
+
+	Ktx2Header header = {};
+	header.vkFormat = data.vkFormat;
+	header.typeSize = 1;
+	header.pixelWidth = data.width;
+	header.pixelHeight = data.height;
+	header.faceCount = data.faceCount;
+	header.levelCount = data.levelCount;
+
+	size_t levelIndexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header);
+	header.dfdByteOffset = (unsigned int)(levelIndexOffset + data.levelCount * sizeof(Ktx2LevelIndex));
+	header.dfdByteLength = (unsigned int)(dfd.size() * 4);
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = (unsigned int)kvd.size();
+
+	// level data is stored smallest mip first, each level aligned to the block size
+	std::vector<Ktx2LevelIndex> levelIndex(data.levelCount);
+	size_t offset = header.kvdByteOffset + header.kvdByteLength;
+	for (int level = (int)data.levelCount - 1; level >= 0; level--)
+	{
+		offset = (offset + 15) & ~size_t(15);
+		levelIndex[level].byteOffset = offset;
+		levelIndex[level].byteLength = data.levels[level].size;
+		levelIndex[level].uncompressedByteLength = data.levels[level].size;
+		offset += data.levels[level].size;
+	}
+
+	std::vector<unsigned char> file(offset, 0);
+	std::memcpy(&file[0], KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	std::memcpy(&file[sizeof(KTX2_IDENTIFIER)], &header, sizeof(Ktx2Header));
+	std::memcpy(&file[levelIndexOffset], &levelIndex[0], levelIndex.size() * sizeof(Ktx2LevelIndex));
+	std::memcpy(&file[header.dfdByteOffset], &dfd[0], header.dfdByteLength);
+	std::memcpy(&file[header.kvdByteOffset], &kvd[0], header.kvdByteLength);
+	for (unsigned int level = 0; level < data.levelCount; level++)
+	{
+		std::memcpy(&file[(size_t)levelIndex[level].byteOffset], data.file.data + data.levels[level].offset, data.levels[level].size);
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open() || !out.write((const char*)&file[0], file.size()))
+	{
+		std::cout << "ERROR::KTX::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool KtxLoader::ReadHeader(KtxData& data)
+{
+	const unsigned char* bytes = data.file.data;
+	size_t size = data.file.size;
+	if (size < sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) || std::memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		return false;
+
+	Ktx2Header header;
+	std::memcpy(&header, &bytes[sizeof(KTX2_IDENTIFIER)], sizeof(Ktx2Header));
+
+	// supercompressed payloads (BasisLZ, zstd) and volume/array textures are not handled
+	if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1)
+		return false;
+
+	data.vkFormat = header.vkFormat;
+	data.width = header.pixelWidth;
+	data.height = header.pixelHeight;
+	data.faceCount = header.faceCount;
+	data.levelCount = header.levelCount == 0 ? 1 : header.levelCount;
+	if (!SetupFormat(data) || (data.faceCount != 1 && data.faceCount != 6))
+		return false;
+
+	// everything below is sized from these, so they are checked before anything is allocated
+	if (data.width == 0 || data.height == 0 || data.width > MAX_DIMENSION || data.height > MAX_DIMENSION)
+		return false;
+	if (data.levelCount > MAX_LEVEL_COUNT || (std::max(data.width, data.height) >> (data.levelCount - 1)) == 0)
+		return false;
+	if (!IsRangeInFile(header.dfdByteOffset, header.dfdByteLength, size) || !IsRangeInFile(header.kvdByteOffset, header.kvdByteLength, size)
+		|| !IsRangeInFile(header.sgdByteOffset, header.sgdByteLength, size))
+		return false;
+
+	size_t levelIndexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header);
+	if (!IsRangeInFile(levelIndexOffset, data.levelCount * sizeof(Ktx2LevelIndex), size))
+		return false;
+
+	data.levels.resize(data.levelCount);
+	for (unsigned int i = 0; i < data.levelCount; i++)
+	{
+		Ktx2LevelIndex index;
+		std::memcpy(&index, &bytes[levelIndexOffset + i * sizeof(Ktx2LevelIndex)], sizeof(Ktx2LevelIndex));
+		if (!IsRangeInFile(index.byteOffset, index.byteLength, size) || index.byteLength % data.faceCount != 0)
+			return false;
+
+		// the upload and the orientation flip read a whole image per face
+		unsigned int width = std::max(1u, data.width >> i);
+		unsigned int height = std::max(1u, data.height >> i);
+		size_t imageSize = data.compressed ? (size_t)((width + 3) / 4) * ((height + 3) / 4) * data.blockBytes : (size_t)width * height * data.blockBytes;
+		if (index.byteLength / data.faceCount < imageSize)
+			return false;
+
+		data.levels[i].offset = (size_t)index.byteOffset;
+		data.levels[i].size = (size_t)index.byteLength;
+	}
+
+	// key/value pairs: only KTXorientation matters here ("rd" is the default top-down layout)
+	size_t kvd = header.kvdByteOffset;
+	size_t kvdEnd = kvd + header.kvdByteLength;
+	while (kvd + 4 <= kvdEnd)
+	{
+		unsigned int length;
+		std::memcpy(&length, &bytes[kvd], 4);
+		// an entry running past the block means the rest of it can't be trusted either
+		if (length > kvdEnd - (kvd + 4))
+			break;
+
+		const char* key = (const char*)&bytes[kvd + 4];
+		size_t keyLength = strnlen(key, length);
+		if (keyLength + 2 < length && std::strcmp(key, "KTXorientation") == 0)
+		{
+			data.topDown = key[keyLength + 2] != 'u';
+		}
+		kvd += 4 + ((length + 3) & ~3u);
+	}
+
+	return true;
+}
+
+bool KtxLoader::SetupFormat(KtxData& data)
+{
+	data.compressed = true;
+	data.hasAlpha = false;
+	data.blockBytes = 16;
+
+	switch (data.vkFormat)
+	{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; data.blockBytes = 8; break;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT; data.blockBytes = 8; break;
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; data.blockBytes = 8; data.hasAlpha = true; break;
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; data.blockBytes = 8; data.hasAlpha = true; break;
+		case VK_FORMAT_BC2_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; data.hasAlpha = true; break;
+		case VK_FORMAT_BC2_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT; data.hasAlpha = true; break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; data.hasAlpha = true; break;
+		case VK_FORMAT_BC3_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; data.hasAlpha = true; break;
+		case VK_FORMAT_BC4_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RED_RGTC1; data.blockBytes = 8; break;
+		case VK_FORMAT_BC5_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RG_RGTC2; break;
+		case VK_FORMAT_BC7_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+		case VK_FORMAT_BC7_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGB8_ETC2; data.blockBytes = 8; break;
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB8_ETC2; data.blockBytes = 8; break;
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2; data.blockBytes = 8; data.hasAlpha = true; break;
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2; data.blockBytes = 8; data.hasAlpha = true; break;
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RGBA8_ETC2_EAC; data.hasAlpha = true; break;
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK: data.internalFormat = GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC; data.hasAlpha = true; break;
+		case VK_FORMAT_EAC_R11_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_R11_EAC; data.blockBytes = 8; break;
+		case VK_FORMAT_EAC_R11G11_UNORM_BLOCK: data.internalFormat = GL_COMPRESSED_RG11_EAC; break;
+
+		// uncompressed fallbacks, mostly useful for small textures where block compression hurts
+		case VK_FORMAT_R8_UNORM: data.compressed = false; data.internalFormat = GL_R8; data.format = GL_RED; data.blockBytes = 1; break;
+		case VK_FORMAT_R8G8_UNORM: data.compressed = false; data.internalFormat = GL_RG8; data.format = GL_RG; data.blockBytes = 2; break;
+		case VK_FORMAT_R8G8B8_UNORM: data.compressed = false; data.internalFormat = GL_RGB8; data.format = GL_RGB; data.blockBytes = 3; break;
+		case VK_FORMAT_R8G8B8_SRGB: data.compressed = false; data.internalFormat = GL_SRGB8; data.format = GL_RGB; data.blockBytes = 3; break;
+		case VK_FORMAT_R8G8B8A8_UNORM: data.compressed = false; data.internalFormat = GL_RGBA8; data.format = GL_RGBA; data.blockBytes = 4; data.hasAlpha = true; break;
+		case VK_FORMAT_R8G8B8A8_SRGB: data.compressed = false; data.internalFormat = GL_SRGB8_ALPHA8; data.format = GL_RGBA; data.blockBytes = 4; data.hasAlpha = true; break;
+
+		default:
+			return false;
+	}
+	return true;
+}
+
+bool KtxLoader::IsFormatSupported(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return GLExtensions::HasExtension("GL_EXT_texture_compression_s3tc");
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+			return GLExtensions::HasExtension("GL_EXT_texture_compression_s3tc") && GLExtensions::HasExtension("GL_EXT_texture_sRGB");
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+			return GLExtensions::HasExtension("GL_ARB_texture_compression_bptc");
+		case GL_COMPRESSED_R11_EAC:
+		case GL_COMPRESSED_RG11_EAC:
+		case GL_COMPRESSED_RGB8_ETC2:
+		case GL_COMPRESSED_SRGB8_ETC2:
+		case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		case GL_COMPRESSED_RGBA8_ETC2_EAC:
+		case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+			return GLExtensions::HasExtension("GL_ARB_ES3_compatibility");
+		case 0:
+			return false;
+		default:
+			// RGTC and uncompressed formats are core in 3.3
+			return true;
+	}
+}
+
+void KtxLoader::SetFlipVerticallyOnLoad(bool flip)
+{
+	s_flipVertically = flip;
+}
+
+bool KtxLoader::GetFlipVerticallyOnLoad()
+{
+	return s_flipVertically;
+}
+
+bool KtxLoader::MatchOrientation(KtxData& data)
+{
+	// stb_image returns top-down images unless flipping is requested, cooked files must match
+	bool wantTopDown = !s_flipVertically;
+	if (data.topDown == wantTopDown)
+		return true;
+
+	bool isS3tcOrRgtc = data.vkFormat >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && data.vkFormat <= VK_FORMAT_BC5_UNORM_BLOCK;
+	if (data.compressed && !isS3tcOrRgtc)
+		return false;
+
+	// rows can only be swapped block-wise when no block straddles the image edge
+	for (unsigned int level = 0; level < data.levelCount; level++)
+	{
+		unsigned int height = std::max(1u, data.height >> level);
+		if (data.compressed && height > 4 && height % 4 != 0)
+			return false;
+	}
+
+	// pack entries are mapped read-only, flipping needs a private copy
+	unsigned char* bytes = data.file.MakeWritable();
+	for (unsigned int level = 0; level < data.levelCount; level++)
+	{
+		unsigned int width = std::max(1u, data.width >> level);
+		unsigned int height = std::max(1u, data.height >> level);
+		unsigned int rowCount = data.compressed ? (height + 3) / 4 : height;
+		size_t rowBytes = data.compressed ? (size_t)((width + 3) / 4) * data.blockBytes : (size_t)width * data.blockBytes;
+		std::vector<unsigned char> tmp(rowBytes);
+
+		for (unsigned int face = 0; face < data.faceCount; face++)
+		{
+			unsigned char* image = bytes + data.levels[level].offset + face * data.GetFaceSize(level);
+			for (unsigned int row = 0; row < rowCount / 2; row++)
+			{
+				unsigned char* top = image + row * rowBytes;
+				unsigned char* bottom = image + (rowCount - 1 - row) * rowBytes;
+				std::memcpy(&tmp[0], top, rowBytes);
+				std::memcpy(top, bottom, rowBytes);
+				std::memcpy(bottom, &tmp[0], rowBytes);
+			}
+
+			if (data.compressed)
+			{
+				unsigned int texelRows = std::min(height, 4u);
+				for (size_t block = 0; block < rowCount * rowBytes / data.blockBytes; block++)
+				{
+					FlipBlockRows(image + block * data.blockBytes, data, texelRows);
+				}
+			}
+		}
+	}
+
+	data.topDown = wantTopDown;
+	return true;
+}
+
+void KtxLoader::FlipBlockRows(unsigned char* block, const KtxData& data, unsigned int rows)
+{
+	// BC1 color indices: one byte per row, after the two 16 bit endpoints
+	struct Local
+	{
+		static void FlipColor(unsigned char* color, unsigned int rows)
+		{
+			std::reverse(color + 4, color + 4 + rows);
+		}
+
+		// BC4 / BC3 alpha: 3 bit indices packed into 48 bits, 12 bits per row
+		static void FlipInterpolatedAlpha(unsigned char* alpha, unsigned int rows)
+		{
+			unsigned long long bits = 0;
+			for (int i = 0; i < 6; i++)
+				bits |= (unsigned long long)alpha[2 + i] << (8 * i);
+
+			unsigned long long flipped = bits;
+			for (unsigned int r = 0; r < rows; r++)
+			{
+				unsigned long long row = (bits >> (12 * r)) & 0xFFF;
+				flipped &= ~(0xFFFull << (12 * (rows - 1 - r)));
+				flipped |= row << (12 * (rows - 1 - r));
+			}
+
+			for (int i = 0; i < 6; i++)
+				alpha[2 + i] = (unsigned char)(flipped >> (8 * i));
+		}
+
+		// BC2 explicit alpha: 4 bits per texel, 2 bytes per row
+		static void FlipExplicitAlpha(unsigned char* alpha, unsigned int rows)
+		{
+			for (unsigned int r = 0; r < rows / 2; r++)
+			{
+				std::swap(alpha[r * 2], alpha[(rows - 1 - r) * 2]);
+				std::swap(alpha[r * 2 + 1], alpha[(rows - 1 - r) * 2 + 1]);
+			}
+		}
+	};
+
+	switch (data.vkFormat)
+	{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			Local::FlipColor(block, rows);
+			break;
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+			Local::FlipExplicitAlpha(block, rows);
+			Local::FlipColor(block + 8, rows);
+			break;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+			Local::FlipInterpolatedAlpha(block, rows);
+			Local::FlipColor(block + 8, rows);
+			break;
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+			Local::FlipInterpolatedAlpha(block, rows);
+			break;
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+			Local::FlipInterpolatedAlpha(block, rows);
+			Local::FlipInterpolatedAlpha(block + 8, rows);
+			break;
+	}
+}
+
+bool KtxLoader::AllocateStorage(GLenum bindTarget, const KtxData& data)
+{
+	if (!GLExtensions::TexStorage2D)
+		return false;
+
+	GLExtensions::TexStorage2D(bindTarget, data.levelCount, data.internalFormat, data.width, data.height);
+	return true;
+}
+
+void KtxLoader::UploadLevels(GLenum target, const KtxData& data, unsigned int face, bool allocated)
+{
+	GLenum bindTarget = target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (unsigned int level = 0; level < data.levelCount; level++)
+	{
+		unsigned int width = std::max(1u, data.width >> level);
+		unsigned int height = std::max(1u, data.height >> level);
+		const unsigned char* pixels = data.GetFaceData(level, face);
+
+		if (data.compressed && allocated)
+		{
+			glCompressedTexSubImage2D(target, level, 0, 0, width, height, data.internalFormat, (GLsizei)data.GetFaceSize(level), pixels);
+		}
+		else if (data.compressed)
+		{
+			glCompressedTexImage2D(target, level, data.internalFormat, width, height, 0, (GLsizei)data.GetFaceSize(level), pixels);
+		}
+		else if (allocated)
+		{
+			glTexSubImage2D(target, level, 0, 0, width, height, data.format, GL_UNSIGNED_BYTE, pixels);
+		}
+		else
+		{
+			glTexImage2D(target, level, data.internalFormat, width, height, 0, data.format, GL_UNSIGNED_BYTE, pixels);
+		}
+	}
+
+	glTexParameteri(bindTarget, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(bindTarget, GL_TEXTURE_MAX_LEVEL, data.levelCount - 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -1,8 +1,30 @@
 #include "LightScene.h"
 #include <Model.h>
 #include "VertexArrayInitializer.h"
+#include <GLFW/glfw3.h>
+#include <initializer_list>
+#include <algorithm>
 
-LightScene::LightScene()
+namespace
+{
+	const char* SCENE_PATH = ".\\resources\\scenes\\lights.scene";
+	// when the scene has no directional light
+	const glm::vec3 LIGHT_DIRECTION = glm::vec3(-0.2f, -1.0f, -0.3f);
+	const int DYNAMIC_CUBE_COUNT = 2;
+
+	// frames timed per mode when benchmarking
+	const int BENCHMARK_FRAMES = 300;
+
+	// sphere around a transformed unit cube
+	void GetCubeBounds(const glm::mat4& model, glm::vec3& center, float& radius)
+	{
+		center = glm::vec3(model[3]);
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		radius = 0.87f * scale;
+	}
+}
+
+LightScene::LightScene() : m_lightDirection(LIGHT_DIRECTION)
 {
 }
 
@@ -10,8 +32,23 @@ void LightScene::Setup()
 {
 	m_litShader.LoadShader(".\\shaders\\litShader.vs", ".\\shaders\\litShader.fs");
 	m_lightSourceShader.LoadShader(".\\shaders\\lightSourceShader.vs", ".\\shaders\\lightSourceShader.fs");
-	m_diffuseMap = Model::TextureFromFile("container2.png", ".\\resources\\textures");
-	m_specularMap = Model::TextureFromFile("container2_specular.png", ".\\resources\\textures");
+	m_shadowDepthShader.LoadShader(".\\shaders\\shadow_depth.vs", ".\\shaders\\shadow_depth.fs");
+	m_pointShadowShader.LoadShader(".\\shaders\\point_shadow_depth.vs", ".\\shaders\\point_shadow_depth.fs", ".\\shaders\\point_shadow_depth.gs");
+	m_diffuseLayer = m_textures.AddTexture("container2.png", ".\\resources\\textures");
+	m_specularLayer = m_textures.AddTexture("container2_specular.png", ".\\resources\\textures");
+	m_textures.Build();
+
+	if (!m_sceneFile.Load(SCENE_PATH))
+		std::cout << "ERROR::LIGHT_SCENE::SCENE_NOT_LOADED: " << SCENE_PATH << std::endl;
+
+	for (unsigned int i = 0; i < m_sceneFile.GetLightCount(); i++)
+	{
+		const SceneLight& light = m_sceneFile.GetLights()[i];
+		if (light.type == SCENE_LIGHT_POINT && m_sourceLightPositions.size() < 4)
+			m_sourceLightPositions.push_back(light.position);
+		else if (light.type == SCENE_LIGHT_DIRECTIONAL)
+			m_lightDirection = light.direction;
+	}
 
 	SetupMaterial(m_litShader);
 	SetupDirectionalLight(m_litShader);
@@ -20,58 +57,167 @@ void LightScene::Setup()
 	VertexArrayInitializer::SetupCube(m_cubeVAO);
 	VertexArrayInitializer::SetupCube(m_sourceVAO);
 
-	m_cubePositions = {
-		glm::vec3(0.0f,  0.0f,  0.0f),
-		glm::vec3(2.0f,  5.0f, -15.0f),
-		glm::vec3(-1.5f, -2.2f, -2.5f),
-		glm::vec3(-3.8f, -2.0f, -12.3f),
-		glm::vec3(2.4f, -0.4f, -3.5f),
-		glm::vec3(-1.7f,  3.0f, -7.5f),
-		glm::vec3(1.3f, -2.0f, -2.5f),
-		glm::vec3(1.5f,  2.0f, -2.5f),
-		glm::vec3(1.5f,  0.2f, -1.5f),
-		glm::vec3(-1.3f,  1.0f, -1.5f)
-	};
-
-	m_sourceLightPositions = {
-		glm::vec3(0.7f, 0.2f, 2.0f),
-		glm::vec3(2.3f, -3.3f, -4.0f),
-		glm::vec3(-4.0f, 2.0f, -12.0f),
-		glm::vec3(0.0f, 0.0f, -3.0f)
-	};
+	SetupTransforms();
+
+	m_shadowMap.Setup(1024, 30.0f);
+	m_shadowMap.SetSceneBounds(glm::vec3(0.0f, -2.0f, -7.0f), 20.0f);
+	m_shadowMap.SetLightDirection(m_lightDirection);
+	m_pointShadows.Setup(512, 25.0f, 15.0f);
 
 	glEnable(GL_DEPTH_TEST);
 }
 
 void LightScene::Draw(const Camera& camera)
 {
+	UpdateDynamicTransforms();
+
+	// the shadow passes render at the maps' resolution, the window's viewport comes back after them
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	DrawShadows(camera);
+	DrawPointShadows(camera);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
 	m_litShader.Use();
 	m_litShader.SetVec3("viewPos", camera.Position);
+	m_litShader.SetVec3("cameraFront", camera.Front);
+	m_shadowMap.Bind(m_litShader);
+	m_pointShadows.Bind(m_litShader, (int)m_sourceLightPositions.size());
 	UpdateSpotLight(m_litShader, camera);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_diffuseMap);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, m_specularMap);
+	m_textures.Bind(0);
 	DrawLitCubes(m_cubeVAO, camera, m_litShader);
 	
 	m_lightSourceShader.Use();
 	m_lightSourceShader.SetVec3("objectColor", glm::vec3(1.0f, 1.0f, 1.0f));
 	DrawSourceLightCubes(m_sourceVAO, camera, m_lightSourceShader);
+
+	UpdateBenchmark();
+}
+
+void LightScene::OnKeyPressed(int key)
+{
+	if (key == GLFW_KEY_C)
+	{
+		m_shadowMap.SetCachingEnabled(!m_shadowMap.IsCachingEnabled());
+		std::cout << "Static shadow cache: " << (m_shadowMap.IsCachingEnabled() ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_B && m_benchmarkFrame < 0)
+	{
+		std::cout << "Benchmarking the shadow pass over " << BENCHMARK_FRAMES << " frames per mode..." << std::endl;
+		m_shadowMap.SetCachingEnabled(true);
+		m_shadowTimer.Reset();
+		m_benchmarkFrame = 0;
+	}
+	else if (key == GLFW_KEY_P)
+	{
+		size_t casterCount = m_litCubeTransforms.Size() + m_dynamicCubeTransforms.Size();
+		std::cout << "Point shadows: " << m_pointShadows.GetSlotCount() << " of " << m_sourceLightPositions.size() << " lights shadowed" << std::endl;
+		for (int slot = 0; slot < m_pointShadows.GetSlotCount(); slot++)
+		{
+			std::cout << "  light " << m_pointShadows.GetSlotLight(slot) << ": " << m_pointShadowDrawCalls[slot]
+				<< " draw calls (" << casterCount * PointShadowMaps::FACE_COUNT << " with a pass per face)" << std::endl;
+		}
+	}
+}
+
+void LightScene::DrawPointShadows(const Camera& camera)
+{
+	m_pointShadows.AssignSlots(m_sourceLightPositions, camera.Position);
+
+	glBindVertexArray(m_cubeVAO);
+	for (int slot = 0; slot < m_pointShadows.GetSlotCount(); slot++)
+	{
+		m_pointShadows.BeginPass(slot, m_pointShadowShader);
+
+		// one draw per caster covers every face it touches, casters touching none are skipped
+		m_pointShadowDrawCalls[slot] = 0;
+		for (const TransformBatch* transforms : { &m_litCubeTransforms, &m_dynamicCubeTransforms })
+		{
+			for (size_t i = 0; i < transforms->Size(); i++)
+			{
+				glm::vec3 center;
+				float radius;
+				GetCubeBounds(transforms->GetModel(i), center, radius);
+				int faceMask = m_pointShadows.GetFaceMask(slot, center, radius);
+				if (faceMask == 0)
+					continue;
+
+				m_pointShadowShader.SetInt("faceMask", faceMask);
+				m_pointShadowShader.SetMat4("model", transforms->GetModel(i));
+				glDrawArrays(GL_TRIANGLES, 0, 36);
+				m_pointShadowDrawCalls[slot]++;
+			}
+		}
+	}
+	m_pointShadows.EndPass();
+}
+
+void LightScene::DrawShadows(const Camera& camera)
+{
+	m_shadowTimer.Begin();
+
+	m_shadowMap.Update(camera);
+	m_shadowDepthShader.Use();
+	glBindVertexArray(m_cubeVAO);
+	for (int i = 0; i < CascadedShadowMap::CASCADE_COUNT; i++)
+	{
+		m_shadowDepthShader.SetMat4("lightSpaceMatrix", m_shadowMap.GetLightSpaceMatrix(i));
+		if (m_shadowMap.BeginStaticPass(i))
+			DrawShadowCasters(m_litCubeTransforms, m_shadowDepthShader);
+
+		m_shadowMap.BeginDynamicPass(i);
+		DrawShadowCasters(m_dynamicCubeTransforms, m_shadowDepthShader);
+	}
+	m_shadowMap.EndPasses();
+
+	m_shadowTimer.End();
+}
+
+void LightScene::DrawShadowCasters(const TransformBatch& transforms, Shader& shader)
+{
+	for (size_t i = 0; i < transforms.Size(); i++)
+	{
+		shader.SetMat4("model", transforms.GetModel(i));
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+	}
+}
+
+void LightScene::UpdateBenchmark()
+{
+	if (m_benchmarkFrame < 0 || ++m_benchmarkFrame < BENCHMARK_FRAMES)
+		return;
+
+	bool cached = m_shadowMap.IsCachingEnabled();
+	m_benchmarkResults[cached ? 0 : 1] = m_shadowTimer.GetAverageMs();
+	m_shadowTimer.Reset();
+	m_benchmarkFrame = 0;
+	if (cached)
+	{
+		m_shadowMap.SetCachingEnabled(false);
+		return;
+	}
+
+	std::cout << "Shadow pass GPU time (" << CascadedShadowMap::CASCADE_COUNT << " cascades):" << std::endl;
+	std::cout << "  static cache: " << m_benchmarkResults[0] << " ms" << std::endl;
+	std::cout << "  no cache: " << m_benchmarkResults[1] << " ms" << std::endl;
+	m_shadowMap.SetCachingEnabled(true);
+	m_benchmarkFrame = -1;
 }
 
 void LightScene::SetupMaterial(Shader& shader)
 {
 	shader.Use();
-	shader.SetInt("material.diffuse", 0);
-	shader.SetInt("material.specular", 1);
+	shader.SetInt("material.textures", 0);
+	shader.SetFloat("material.diffuseLayer", (float)m_diffuseLayer);
+	shader.SetFloat("material.specularLayer", (float)m_specularLayer);
 	shader.SetFloat("material.shininess", 0.25f * 128.0f);
 }
 
 void LightScene::SetupDirectionalLight(Shader& shader)
 {
 	shader.Use();
-	shader.SetVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
+	shader.SetVec3("dirLight.direction", m_lightDirection);
 	shader.SetVec3("dirLight.ambient", glm::vec3(0.05f, 0.05f, 0.05f));
 	shader.SetVec3("dirLight.diffuse", glm::vec3(0.4f, 0.4f, 0.4f));
 	shader.SetVec3("dirLight.specular", glm::vec3(0.5f, 0.5f, 0.5f));
@@ -79,18 +225,11 @@ void LightScene::SetupDirectionalLight(Shader& shader)
 
 void LightScene::SetupPointLights(Shader& shader)
 {
-	glm::vec3 pointLightPositions[] = {
-		glm::vec3(0.7f, 0.2f, 2.0f),
-		glm::vec3(2.3f, -3.3f, -4.0f),
-		glm::vec3(-4.0f, 2.0f, -12.0f),
-		glm::vec3(0.0f, 0.0f, -3.0f)
-	};
-
 	shader.Use();
-	for (int i = 0; i < 4; i++)
+	for (int i = 0; i < (int)m_sourceLightPositions.size(); i++)
 	{
 		std::string indexStr = std::to_string(i);
-		shader.SetVec3("pointLights[" + indexStr + "].position", pointLightPositions[i]);
+		shader.SetVec3("pointLights[" + indexStr + "].position", m_sourceLightPositions[i]);
 
 		shader.SetVec3("pointLights[" + indexStr + "].ambient", glm::vec3(0.1f, 0.1f, 0.1f));
 		shader.SetVec3("pointLights[" + indexStr + "].diffuse", glm::vec3(0.8f, 0.8f, 0.8f));
@@ -116,36 +255,78 @@ void LightScene::UpdateSpotLight(Shader& shader, const Camera& camera)
 	shader.SetVec3("spotLight.specular", glm::vec3(1.0f, 1.0f, 1.0f));
 }
 
-void LightScene::DrawLitCubes(unsigned int cubeVAO, const Camera& camera, Shader& shader)
+void LightScene::SetupTransforms()
 {
-	glBindVertexArray(cubeVAO);
+	// the objects are static: model and normal matrices are computed once here, only the MVPs follow the camera
+	// every entity is a cube here, the floor included
+	std::vector<glm::mat4> cubeModels;
+	for (unsigned int i = 0; i < m_sceneFile.GetEntityCount(); i++)
+	{
+		cubeModels.push_back(SceneFile::GetEntityMatrix(m_sceneFile.GetEntities()[i]));
+	}
+	m_litCubeTransforms.SetModels(cubeModels);
 
-	int i = 0;
-	for (const glm::vec3& cubePos : m_cubePositions)
+	m_dynamicCubeTransforms.SetModels(std::vector<glm::mat4>(DYNAMIC_CUBE_COUNT, glm::mat4(1.0f)));
+
+	std::vector<glm::mat4> sourceModels;
+	for (const glm::vec3& sourcePos : m_sourceLightPositions)
 	{
 		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, cubePos);
+		model = glm::translate(model, sourcePos);
+		model = glm::scale(model, glm::vec3(0.2f));
+		sourceModels.push_back(model);
+	}
+	m_sourceLightTransforms.SetModels(sourceModels);
+}
 
-		float angle = glm::radians(20.0f * i);
-		model = glm::rotate(model, angle, glm::vec3(1.0f, 0.3, 0.5f));
-		shader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		i++;
+void LightScene::UpdateDynamicTransforms()
+{
+	float time = (float)glfwGetTime();
+	for (int i = 0; i < DYNAMIC_CUBE_COUNT; i++)
+	{
+		float angle = time * 0.6f + glm::radians(180.0f) * i;
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(3.5f * cos(angle), -1.0f + 0.5f * sin(time + i), -5.0f + 3.5f * sin(angle)));
+		model = glm::rotate(model, time, glm::vec3(0.3f, 1.0f, 0.2f));
+		m_dynamicCubeTransforms.SetModel(i, glm::scale(model, glm::vec3(0.7f)));
 	}
 }
 
+void LightScene::DrawLitCubes(unsigned int cubeVAO, const Camera& camera, Shader& shader)
+{
+	const glm::mat4 viewProj = camera.GetPerspectiveProj() * camera.GetViewMatrix();
+	m_litCubeTransforms.Update(viewProj);
+	m_dynamicCubeTransforms.Update(viewProj);
+
+	// looked up here, the workers can't make GL calls; from shader, whose program the buffers bind
+	const ObjectMatrixLocations locations = shader.GetObjectMatrixLocations();
+
+	// the static cubes then the dynamic ones, each buffer starts with its own binds so it replays alone
+	size_t staticCount = m_litCubeTransforms.Size();
+	size_t cubeCount = staticCount + m_dynamicCubeTransforms.Size();
+	CommandBuffer::RecordParallel(m_litCubeCommands, cubeCount, 0, [&](CommandBuffer& commands, size_t begin, size_t end)
+	{
+		commands.UseProgram(shader.ID);
+		commands.BindVertexArray(cubeVAO);
+		for (size_t i = begin; i < end; i++)
+		{
+			const TransformBatch& transforms = i < staticCount ? m_litCubeTransforms : m_dynamicCubeTransforms;
+			size_t index = i < staticCount ? i : i - staticCount;
+			commands.SetObjectMatrices(locations, transforms.GetModel(index), transforms.GetMVP(index), transforms.GetNormalMatrix(index));
+			commands.DrawArrays(GL_TRIANGLES, 0, 36);
+		}
+	});
+	CommandBuffer::ExecuteAll(m_litCubeCommands);
+}
+
 void LightScene::DrawSourceLightCubes(unsigned int VAO, const Camera& camera, Shader& shader)
 {
 	shader.Use();
+	glBindVertexArray(VAO);
 
-	for (const glm::vec3& sourcePos : m_sourceLightPositions)
+	m_sourceLightTransforms.Update(camera.GetPerspectiveProj() * camera.GetViewMatrix());
+	for (size_t i = 0; i < m_sourceLightTransforms.Size(); i++)
 	{
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, sourcePos);
-		model = glm::scale(model, glm::vec3(0.2f));
-
-		shader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
-		glBindVertexArray(VAO);
+		shader.SetMat4("mvp", m_sourceLightTransforms.GetMVP(i));
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "Lz4.h"
+#include <cstring>
+
+namespace
+{
+	const size_t MIN_MATCH = 4;
+	const size_t LAST_LITERALS = 5;		// the block always ends with at least 5 literals
+	const size_t MATCH_SAFE_DISTANCE = 12;	// and its last match starts 12 bytes before the end
+	const size_t MAX_OFFSET = 65535;
+	const unsigned int HASH_BITS = 14;
+
+	unsigned int Read32(const unsigned char* p)
+	{
+		unsigned int value;
+		std::memcpy(&value, p, 4);
+		return value;
+	}
+
+	unsigned int Hash(unsigned int sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	void WriteLength(std::vector<unsigned char>& out, size_t length)
+	{
+		while (length >= 255)
+		{
+			out.push_back(255);
+			length -= 255;
+		}
+		out.push_back((unsigned char)length);
+	}
+
+	void WriteSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		unsigned char token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (matchLength > 0)
+			token |= (unsigned char)(matchLength - MIN_MATCH >= 15 ? 15 : matchLength - MIN_MATCH);
+		out.push_back(token);
+
+		if (literalLength >= 15)
+			WriteLength(out, literalLength - 15);
+		out.insert(out.end(), literals, literals + literalLength);
+
+		if (matchLength == 0)
+			return;
+
+		out.push_back((unsigned char)(offset & 0xFF));
+		out.push_back((unsigned char)(offset >> 8));
+		if (matchLength - MIN_MATCH >= 15)
+			WriteLength(out, matchLength - MIN_MATCH - 15);
+	}
+}
+
+void Lz4::Compress(const unsigned char* source, size_t sourceSize, std::vector<unsigned char>& outCompressed)
+{
+	outCompressed.clear();
+	outCompressed.reserve(sourceSize + sourceSize / 255 + 16);
+
+	size_t anchor = 0;
+	if (sourceSize > MATCH_SAFE_DISTANCE)
+	{
+		std::vector<size_t> table((size_t)1 << HASH_BITS, (size_t)-1);
+		size_t matchLimit = sourceSize - LAST_LITERALS;
+		size_t position = 0;
+
+		while (position + MATCH_SAFE_DISTANCE < sourceSize)
+		{
+			unsigned int sequence = Read32(source + position);
+			unsigned int hash = Hash(sequence);
+			size_t candidate = table[hash];
+			table[hash] = position;
+
+			if (candidate == (size_t)-1 || position - candidate > MAX_OFFSET || Read32(source + candidate) != sequence)
+			{
+				position++;
+				continue;
+			}
+
+			size_t matchLength = MIN_MATCH;
+			while (position + matchLength < matchLimit && source[candidate + matchLength] == source[position + matchLength])
+				matchLength++;
+
+			WriteSequence(outCompressed, source + anchor, position - anchor, position - candidate, matchLength);
+			position += matchLength;
+			anchor = position;
+		}
+	}
+
+	WriteSequence(outCompressed, source + anchor, sourceSize - anchor, 0, 0);
+}
+
+bool Lz4::Decompress(const unsigned char* source, size_t sourceSize, unsigned char* dest, size_t destSize)
+{
+	const unsigned char* input = source;
+	const unsigned char* inputEnd = source + sourceSize;
+	unsigned char* output = dest;
+	unsigned char* outputEnd = dest + destSize;
+
+	while (input < inputEnd)
+	{
+		unsigned char token = *input++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15)
+		{
+			unsigned char extra;
+			do
+			{
+				if (input >= inputEnd)
+					return false;
+				extra = *input++;
+				literalLength += extra;
+			} while (extra == 255);
+		}
+
+		if ((size_t)(inputEnd - input) < literalLength || (size_t)(outputEnd - output) < literalLength)
+			return false;
+		std::memcpy(output, input, literalLength);
+		input += literalLength;
+		output += literalLength;
+
+		// the last sequence has no match part
+		if (input == inputEnd)
+			break;
+
+		if (inputEnd - input < 2)
+			return false;
+		size_t offset = input[0] | (input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(output - dest))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15)
+		{
+			unsigned char extra;
+			do
+			{
+				if (input >= inputEnd)
+					return false;
+				extra = *input++;
+				matchLength += extra;
+			} while (extra == 255);
+		}
+		matchLength += MIN_MATCH;
+
+		if ((size_t)(outputEnd - output) < matchLength)
+			return false;
+
+		// matches may overlap their own output (offset < length), so copy byte by byte
+		const unsigned char* match = output - offset;
+		for (size_t i = 0; i < matchLength; i++)
+			output[i] = match[i];
+		output += matchLength;
+	}
+
+	return output == outputEnd;
+}
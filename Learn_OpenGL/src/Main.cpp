@@ -14,6 +14,16 @@
 
 #include <ICustomScene.h>
 #include <CustomSceneBuilder.h>
+#include <AssetCooker.h>
+#include <JobBenchmark.h>
+#include <JobSystem.h>
+#include <VirtualFileSystem.h>
+#include <GLExtensions.h>
+#include <FrameMailbox.h>
+
+#include <future>
+#include <thread>
+#include <vector>
 
 Camera camera;
 
@@ -25,9 +35,22 @@ float lastFrame = 0.0f;
 
 bool xDirection = true;
 
+// scene receiving the key presses
+std::shared_ptr<ICustomScene> currentScene;
+
+// with the render thread the GL context is current there, the update thread (this one) polls the events
+// and hands everything over through the snapshots
+bool renderThreadEnabled = true;
+FrameMailbox<FrameSnapshot> frameMailbox;
+std::vector<int> pendingKeys;
+int framebufferWidth = 800, framebufferHeight = 600;
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	framebufferWidth = width;
+	framebufferHeight = height;
+	if (!renderThreadEnabled)
+		glViewport(0, 0, width, height);
 }
 
 void initGLFW()
@@ -61,6 +84,17 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 	camera.ProcessMouseScroll(yoffset);
 }
 
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS || !currentScene)
+		return;
+
+	if (renderThreadEnabled && !currentScene->HasUpdate())
+		pendingKeys.push_back(key);
+	else
+		currentScene->OnKeyPressed(key);
+}
+
 GLFWwindow* initGLFWWindow()
 {
 	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
@@ -76,6 +110,7 @@ GLFWwindow* initGLFWWindow()
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetKeyCallback(window, key_callback);
 	return window;
 }
 
@@ -104,6 +139,14 @@ void processInput(GLFWwindow* window)
 	}
 }
 
+void updateCameraAspect()
+{
+	// scenes replace the camera in SetupCamera, the window size is applied again every frame; a minimized
+	// window has a 0 height and keeps the last aspect
+	if (framebufferHeight > 0)
+		camera.AspectRatio = (float)framebufferWidth / framebufferHeight;
+}
+
 glm::mat4 GetInvertedView()
 {
 	camera.Front *= -1;
@@ -128,12 +171,15 @@ void updateDeltaTime()
 void mainCustomSceneLoop(GLFWwindow* window, std::shared_ptr<ICustomScene> scene)
 {
 	scene->Setup();
+	currentScene = scene;
 	camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+	scene->SetupCamera(camera);
 
 	while (!glfwWindowShouldClose(window))
 	{
 		updateDeltaTime();
 		processInput(window);
+		updateCameraAspect();
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -145,11 +191,89 @@ void mainCustomSceneLoop(GLFWwindow* window, std::shared_ptr<ICustomScene> scene
 	}
 }
 
+void renderThreadLoop(GLFWwindow* window, std::shared_ptr<ICustomScene> scene, std::promise<void>* setupDone)
+{
+	glfwMakeContextCurrent(window);
+	scene->Setup();
+	setupDone->set_value();
+
+	int viewportWidth = framebufferWidth, viewportHeight = framebufferHeight;
+	while (const FrameSnapshot* snapshot = frameMailbox.Take())
+	{
+		if (snapshot->framebufferWidth != viewportWidth || snapshot->framebufferHeight != viewportHeight)
+		{
+			viewportWidth = snapshot->framebufferWidth;
+			viewportHeight = snapshot->framebufferHeight;
+			glViewport(0, 0, viewportWidth, viewportHeight);
+		}
+
+		if (!scene->HasUpdate())
+		{
+			for (int key : snapshot->keys)
+				scene->OnKeyPressed(key);
+		}
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		scene->Render(*snapshot);
+
+		glfwSwapBuffers(window);
+	}
+	glfwMakeContextCurrent(NULL);
+}
+
+void mainThreadedSceneLoop(GLFWwindow* window, std::shared_ptr<ICustomScene> scene)
+{
+	// the render thread takes the context over and sets the scene up before the first snapshot
+	glfwMakeContextCurrent(NULL);
+	std::promise<void> setupDone;
+	std::future<void> setup = setupDone.get_future();
+	std::thread renderThread(renderThreadLoop, window, scene, &setupDone);
+	setup.wait();
+
+	currentScene = scene;
+	camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+	scene->SetupCamera(camera);
+
+	unsigned long long frame = 0;
+	while (!glfwWindowShouldClose(window))
+	{
+		// at most one snapshot waits for the render thread, the next one is built from the freshest input
+		// while it draws the previous one
+		frameMailbox.WaitUntilTaken();
+
+		glfwPollEvents();
+		updateDeltaTime();
+		processInput(window);
+		updateCameraAspect();
+
+		FrameSnapshot& snapshot = frameMailbox.GetWriteSlot();
+		snapshot.frame = frame++;
+		snapshot.time = lastFrame;
+		snapshot.deltaTime = deltaTime;
+		snapshot.framebufferWidth = framebufferWidth;
+		snapshot.framebufferHeight = framebufferHeight;
+		snapshot.camera = camera;
+		snapshot.view = camera.GetViewMatrix();
+		snapshot.projection = camera.GetPerspectiveProj();
+		snapshot.keys.swap(pendingKeys);
+		pendingKeys.clear();
+
+		scene->Update(snapshot);
+		frameMailbox.Publish();
+	}
+
+	frameMailbox.Close();
+	renderThread.join();
+	glfwMakeContextCurrent(window);
+}
+
 void mainLoop(GLFWwindow* window)
 {
 	camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
-	stbi_set_flip_vertically_on_load(true);
+	Model::SetFlipVerticallyOnLoad(true);
 	glEnable(GL_DEPTH_TEST);
 
 	while (!glfwWindowShouldClose(window))
@@ -167,8 +291,37 @@ void mainLoop(GLFWwindow* window)
 	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// "Learn_OpenGL.exe cook ..." runs the offline asset pipeline, no window needed
+	if (argc > 1 && std::string(argv[1]) == "cook")
+	{
+		int status = AssetCooker::Run(argc - 2, argv + 2);
+		JobSystem::Shutdown();
+		return status;
+	}
+	if (argc > 1 && std::string(argv[1]) == "pack")
+	{
+		int status = AssetCooker::RunPack(argc - 2, argv + 2);
+		JobSystem::Shutdown();
+		return status;
+	}
+	if (argc > 1 && std::string(argv[1]) == "bench-jobs")
+	{
+		return JobBenchmark::Run(argc - 2, argv + 2);
+	}
+	// "Learn_OpenGL.exe --single-thread" updates and draws on the same thread, to compare frame times
+	if (argc > 1 && std::string(argv[1]) == "--single-thread")
+	{
+		renderThreadEnabled = false;
+	}
+
+	// without a pack every asset is read from the loose files
+	if (VirtualFileSystem::Mount(".\\assets.pack"))
+	{
+		std::cout << "Mounted .\\assets.pack" << std::endl;
+	}
+
 	initGLFW();
 	GLFWwindow* window = initGLFWWindow();
 	if (!window)
@@ -181,13 +334,22 @@ int main()
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return NULL;
 	}
+	GLExtensions::Load((GLADloadproc)glfwGetProcAddress);
 
 	CustomSceneType sceneType = CustomSceneType::TEST_SCENE;
 	std::shared_ptr<ICustomScene> scene = CustomSceneBuilder::BuildCustomScene(sceneType);
 
 	//mainLoop(window);
-	mainCustomSceneLoop(window, scene);
-	
+	if (renderThreadEnabled)
+		mainThreadedSceneLoop(window, scene);
+	else
+		mainCustomSceneLoop(window, scene);
+
+	// scenes release their GL objects when destroyed, the context has to still be there
+	currentScene.reset();
+	scene.reset();
 	glfwTerminate();
+	// the workers have to be joined before the statics they wait on are destroyed
+	JobSystem::Shutdown();
 	return 0;
 }
\ No newline at end of file
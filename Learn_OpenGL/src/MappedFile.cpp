@@ -0,0 +1,83 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		std::cout << "ERROR::MAPPED_FILE::MAPPING_FAILED: " << path << std::endl;
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_data = (const unsigned char*)view;
+	m_size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat fileStat;
+	void* view = fstat(file, &fileStat) == 0 && fileStat.st_size > 0 ? mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	// the mapping keeps the file alive
+	close(file);
+	if (view == MAP_FAILED)
+	{
+		std::cout << "ERROR::MAPPED_FILE::MAPPING_FAILED: " << path << std::endl;
+		return false;
+	}
+
+	m_data = (const unsigned char*)view;
+	m_size = (size_t)fileStat.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!m_data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle((HANDLE)m_mappingHandle);
+	CloseHandle((HANDLE)m_fileHandle);
+	m_fileHandle = nullptr;
+	m_mappingHandle = nullptr;
+#else
+	munmap((void*)m_data, m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
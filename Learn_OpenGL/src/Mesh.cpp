@@ -1,46 +1,83 @@
 #include "Mesh.h"
 
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<MeshLod> lods, MeshBounds bounds,
+	vector<Meshlet> meshlets)
 {
 	this->vertices = vertices;
 	this->indices = indices;
 	this->textures = textures;
+	this->lods = lods;
+	this->bounds = bounds;
+	this->meshlets = meshlets;
 
+	if (this->lods.empty())
+		this->lods.push_back(MeshLod{ 0, (unsigned int)indices.size(), 0.0f });
+
+	// litShader samples the first diffuse and specular maps
+	for (int i = (int)textures.size() - 1; i >= 0; i--)
+	{
+		if (textures[i].type == "texture_diffuse")
+			diffuseLayer = textures[i].layer;
+		else if (textures[i].type == "texture_specular")
+			specularLayer = textures[i].layer;
+	}
+
+	meshletCuller.Setup(meshlets);
 	setupMesh();
 }
 
-void Mesh::Draw(Shader& shader)
+void Mesh::Draw(Shader& shader, unsigned int lod)
 {
-	unsigned int diffuseNr = 1;
-	unsigned int specularNr = 1;
-	for (unsigned int i = 0; i < textures.size(); i++)
-	{
-		glActiveTexture(GL_TEXTURE0 + i);
-
-		// retrieve texture number (N in diffuse_textureN)
-		string number;
-		string name = textures[i].type;
-		if (name == "texture_diffuse")
-		{
-			number = std::to_string(diffuseNr);
-			diffuseNr++;
-		}
-		else if (name == "texture_specular")
-		{
-			number = std::to_string(specularNr);
-			specularNr++;
-		}
-
-		shader.SetInt(("material." + name + number).c_str(), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
-	}
+	setMaterial(shader);
 
 	// draw mesh
+	const MeshLod& level = lods[lod < lods.size() ? lod : lods.size() - 1];
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(level.indexOffset * sizeof(unsigned int)));
+	glBindVertexArray(0);
+}
+
+void Mesh::DrawMeshlets(Shader& shader, const Frustum& frustum, const glm::vec3& cameraPosition, MeshletStats& stats)
+{
+	meshletCuller.Cull(frustum, cameraPosition, rangeCounts, rangeOffsets, stats);
+	if (rangeCounts.empty())
+		return;
+
+	setMaterial(shader);
+
+	// one range per run of visible meshlets, they sit back to back in the index buffer
 	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+	glMultiDrawElements(GL_TRIANGLES, rangeCounts.data(), GL_UNSIGNED_INT, rangeOffsets.data(), (GLsizei)rangeCounts.size());
 	glBindVertexArray(0);
+}
+
+bool Mesh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, BvhRayHit& outHit)
+{
+	if (!triangleBvh.IsBuilt())
+	{
+		vector<glm::vec3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+			positions[i] = vertices[i].Position;
+
+		const MeshLod& level = lods[0];
+		triangleBvh.Build(positions, vector<unsigned int>(indices.begin() + level.indexOffset, indices.begin() + level.indexOffset + level.indexCount));
+	}
+	return triangleBvh.RaycastNearest(origin, direction, maxDistance, outHit);
+}
+
+void Mesh::setMaterial(Shader& shader)
+{
+	// the model's texture array is already bound, only the layers change between meshes
+	shader.SetFloat("material.diffuseLayer", (float)diffuseLayer);
+	shader.SetFloat("material.specularLayer", (float)specularLayer);
+}
 
-	glActiveTexture(GL_TEXTURE0);
+void Mesh::Release()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	VAO = VBO = EBO = 0;
 }
 
 void Mesh::setupMesh()
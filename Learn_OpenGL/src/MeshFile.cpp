@@ -0,0 +1,208 @@
+#include "MeshFile.h"
+#include <VirtualFileSystem.h>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+	const char MESH_MAGIC[4] = { 'M', 'E', 'S', 'H' };
+
+	template<typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write((const char*)&value, sizeof(T));
+	}
+
+	void WriteString(std::ofstream& file, const string& value)
+	{
+		WriteValue(file, (unsigned int)value.size());
+		file.write(value.data(), value.size());
+	}
+
+	// bounds-checked cursor over the file bytes
+	struct MeshReader
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t position = 0;
+
+		bool ReadBytes(void* dest, size_t count)
+		{
+			if (count > size - position)
+				return false;
+			if (count > 0)
+				std::memcpy(dest, data + position, count);
+			position += count;
+			return true;
+		}
+
+		template<typename T>
+		bool ReadValue(T& value)
+		{
+			return ReadBytes(&value, sizeof(T));
+		}
+
+		bool ReadString(string& value)
+		{
+			unsigned int length = 0;
+			if (!ReadValue(length) || length > size - position)
+				return false;
+
+			value.assign((const char*)data + position, length);
+			position += length;
+			return true;
+		}
+	};
+}
+
+bool MeshFile::Read(const string& path, vector<MeshData>& outMeshes, vector<ModelNode>& outNodes)
+{
+	FileData file;
+	if (!VirtualFileSystem::Read(path, file))
+		return false;
+
+	MeshReader reader{ file.data, file.size };
+	char magic[4];
+	unsigned int version = 0, meshCount = 0, nodeCount = 0;
+	if (!reader.ReadBytes(magic, 4) || std::memcmp(magic, MESH_MAGIC, 4) != 0 || !reader.ReadValue(version) || version != VERSION
+		|| !reader.ReadValue(meshCount) || !reader.ReadValue(nodeCount) || nodeCount == 0 || nodeCount > file.size / sizeof(ModelNode))
+	{
+		std::cout << "ERROR::MESH::INVALID_FILE: " << path << std::endl;
+		return false;
+	}
+
+	// parents before children, the hierarchy is rebuilt in the same order
+	outNodes.resize(nodeCount);
+	bool nodesValid = reader.ReadBytes(outNodes.data(), nodeCount * sizeof(ModelNode));
+	for (unsigned int i = 0; i < nodeCount && nodesValid; i++)
+		nodesValid = outNodes[i].parent >= -1 && outNodes[i].parent < (int)i;
+	if (!nodesValid)
+	{
+		std::cout << "ERROR::MESH::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+		outNodes.clear();
+		return false;
+	}
+
+	outMeshes.clear();
+	outMeshes.resize(meshCount);
+	for (MeshData& mesh : outMeshes)
+	{
+		unsigned int vertexCount = 0, indexCount = 0, textureCount = 0, lodCount = 0, meshletCount = 0;
+		bool valid = reader.ReadValue(mesh.node) && mesh.node >= 0 && mesh.node < (int)nodeCount
+			&& reader.ReadValue(vertexCount) && reader.ReadValue(indexCount) && reader.ReadValue(textureCount)
+			&& reader.ReadValue(lodCount) && reader.ReadValue(meshletCount)
+			&& textureCount <= file.size && lodCount <= file.size / sizeof(MeshLod) && meshletCount <= file.size / sizeof(Meshlet)
+			&& (size_t)vertexCount * sizeof(Vertex) + (size_t)indexCount * sizeof(unsigned int) <= file.size;
+
+		if (valid)
+		{
+			mesh.textures.resize(textureCount);
+			for (MeshTextureRef& texture : mesh.textures)
+				valid = valid && reader.ReadString(texture.type) && reader.ReadString(texture.path);
+
+			mesh.lods.resize(lodCount);
+			mesh.meshlets.resize(meshletCount);
+			mesh.vertices.resize(vertexCount);
+			mesh.indices.resize(indexCount);
+			valid = valid && reader.ReadValue(mesh.bounds) && reader.ReadBytes(mesh.lods.data(), lodCount * sizeof(MeshLod))
+				&& reader.ReadBytes(mesh.meshlets.data(), meshletCount * sizeof(Meshlet))
+				&& reader.ReadBytes(mesh.vertices.data(), vertexCount * sizeof(Vertex))
+				&& reader.ReadBytes(mesh.indices.data(), indexCount * sizeof(unsigned int));
+
+			for (const MeshLod& lod : mesh.lods)
+				valid = valid && lod.indexOffset <= indexCount && lod.indexCount <= indexCount - lod.indexOffset;
+			for (const Meshlet& meshlet : mesh.meshlets)
+				valid = valid && meshlet.indexOffset <= indexCount && meshlet.triangleCount <= (indexCount - meshlet.indexOffset) / 3;
+		}
+
+		if (!valid)
+		{
+			std::cout << "ERROR::MESH::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+			outMeshes.clear();
+			outNodes.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MeshFile::Write(const string& path, const vector<MeshData>& meshes, const vector<ModelNode>& nodes)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::MESH::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+
+	file.write(MESH_MAGIC, 4);
+	WriteValue(file, VERSION);
+	WriteValue(file, (unsigned int)meshes.size());
+	WriteValue(file, (unsigned int)nodes.size());
+	if (!nodes.empty())
+		file.write((const char*)&nodes[0], (std::streamsize)nodes.size() * sizeof(ModelNode));
+	for (const MeshData& mesh : meshes)
+	{
+		WriteValue(file, mesh.node);
+		WriteValue(file, (unsigned int)mesh.vertices.size());
+		WriteValue(file, (unsigned int)mesh.indices.size());
+		WriteValue(file, (unsigned int)mesh.textures.size());
+		WriteValue(file, (unsigned int)mesh.lods.size());
+		WriteValue(file, (unsigned int)mesh.meshlets.size());
+		for (const MeshTextureRef& texture : mesh.textures)
+		{
+			WriteString(file, texture.type);
+			WriteString(file, texture.path);
+		}
+
+		WriteValue(file, mesh.bounds);
+		if (!mesh.lods.empty())
+			file.write((const char*)&mesh.lods[0], (std::streamsize)mesh.lods.size() * sizeof(MeshLod));
+		if (!mesh.meshlets.empty())
+			file.write((const char*)&mesh.meshlets[0], (std::streamsize)mesh.meshlets.size() * sizeof(Meshlet));
+
+		if (!mesh.vertices.empty())
+			file.write((const char*)&mesh.vertices[0], (std::streamsize)mesh.vertices.size() * sizeof(Vertex));
+		if (!mesh.indices.empty())
+			file.write((const char*)&mesh.indices[0], (std::streamsize)mesh.indices.size() * sizeof(unsigned int));
+	}
+
+	if (!file)
+	{
+		std::cout << "ERROR::MESH::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+string MeshFile::GetCookedPath(const string& modelPath)
+{
+	size_t dot = modelPath.find_last_of('.');
+	size_t separator = modelPath.find_last_of("\\/");
+	if (dot == string::npos || (separator != string::npos && dot < separator))
+		return modelPath + ".mesh";
+
+	return modelPath.substr(0, dot) + ".mesh";
+}
+
+void MeshFile::OptimizeVertexFetch(MeshData& mesh)
+{
+	const unsigned int unused = 0xFFFFFFFFu;
+	vector<unsigned int> remap(mesh.vertices.size(), unused);
+	vector<Vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (unsigned int& index : mesh.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)vertices.size();
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	// vertices no face references are dropped
+	mesh.vertices.swap(vertices);
+}
@@ -0,0 +1,327 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+	// each level aims at this fraction of the previous one's triangles
+	const float LOD_REDUCTION = 0.5f;
+	// a level that doesn't get below this fraction of the previous one ends the chain
+	const float LOD_MIN_SHRINK = 0.85f;
+	// largest error of a single simplification step, relative to the mesh radius
+	const float LOD_MAX_STEP_ERROR = 0.08f;
+
+	// weights of the attribute change against the squared position error, the latter being relative to the
+	// mesh extent: a uv shift of 1% of the texture costs about as much as moving 0.5% of the mesh size
+	const double UV_WEIGHT = 0.25;
+	const double NORMAL_WEIGHT = 0.01;
+
+	// symmetric 4x4 matrix summing the squared distances to the planes around a vertex, with the total
+	// weight of those planes so the error can be read back as a mean squared distance, in mesh units
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+		double weight = 0;
+
+		void AddPlane(const glm::dvec3& n, double d, double weight)
+		{
+			a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+			a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+			a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+			a33 += weight * d * d;
+			this->weight += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+		}
+
+		double Evaluate(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double error = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+				+ a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+				+ a22 * z * z + 2.0 * a23 * z
+				+ a33;
+			return error > 0.0 && weight > 0.0 ? error / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double cost;	// error plus the attribute penalty, only ranks the collapses
+		double error;	// squared geometric error, what maxError bounds
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			unsigned int bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+		}
+	};
+
+	// first vertex sharing each vertex's position, seams split a position into several vertices
+	vector<unsigned int> BuildPositionRemap(const vector<Vertex>& vertices)
+	{
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> firstVertex;
+		firstVertex.reserve(vertices.size());
+
+		vector<unsigned int> remap(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++)
+		{
+			remap[i] = firstVertex.emplace(vertices[i].Position, i).first->second;
+		}
+		return remap;
+	}
+
+	// vertex -> triangles, as offsets into a flat list
+	void BuildAdjacency(const vector<unsigned int>& indices, size_t vertexCount, vector<unsigned int>& offsets, vector<unsigned int>& triangles)
+	{
+		offsets.assign(vertexCount + 1, 0);
+		for (unsigned int index : indices)
+			offsets[index + 1]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			offsets[i + 1] += offsets[i];
+
+		triangles.resize(indices.size());
+		vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			triangles[cursor[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+}
+
+vector<unsigned int> MeshSimplifier::Simplify(const vector<Vertex>& vertices, const vector<unsigned int>& indices,
+	size_t targetIndexCount, float maxError, float& outError)
+{
+	outError = 0.0f;
+	vector<unsigned int> result(indices);
+	if (result.size() <= targetIndexCount || vertices.empty())
+		return result;
+
+	size_t vertexCount = vertices.size();
+	vector<unsigned int> position = BuildPositionRemap(vertices);
+
+	// a position split by a seam, or on an open border, is locked: moving it would tear the surface
+	vector<unsigned char> locked(vertexCount, 0);
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		if (position[i] != i)
+			locked[i] = locked[position[i]] = 1;
+	}
+
+	std::unordered_map<unsigned long long, int> edgeUses;
+	edgeUses.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned long long a = position[result[i + e]], b = position[result[i + (e + 1) % 3]];
+			edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+		}
+	}
+	for (const auto& edge : edgeUses)
+	{
+		if (edge.second == 1)
+			locked[edge.first >> 32] = locked[edge.first & 0xFFFFFFFFu] = 1;
+	}
+
+	glm::vec3 minBounds(vertices[0].Position), maxBounds(vertices[0].Position);
+	for (const Vertex& vertex : vertices)
+	{
+		minBounds = glm::min(minBounds, vertex.Position);
+		maxBounds = glm::max(maxBounds, vertex.Position);
+	}
+	double extent = glm::length(maxBounds - minBounds);
+	double attributeScale = extent * extent;
+
+	// the quadrics live on the first vertex of each position so seam vertices share theirs
+	vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = vertices[result[i]].Position;
+		glm::dvec3 normal = TriangleNormal(p0, vertices[result[i + 1]].Position, vertices[result[i + 2]].Position);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+
+		// area weighted, so slivers don't pin down their vertices
+		normal /= length;
+		double d = -glm::dot(normal, glm::dvec3(p0));
+		for (int k = 0; k < 3; k++)
+			quadrics[position[result[i + k]]].AddPlane(normal, d, length * 0.5);
+	}
+
+	vector<unsigned int> remap(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+		remap[i] = i;
+
+	double maxSquaredError = (double)maxError * maxError;
+	double worstSquaredError = 0.0;
+	vector<unsigned int> adjacencyOffsets, adjacency;
+	vector<Collapse> collapses;
+	vector<unsigned char> touched(vertexCount);
+
+	while (result.size() > targetIndexCount)
+	{
+		BuildAdjacency(result, vertexCount, adjacencyOffsets, adjacency);
+
+		// every edge in both directions, interior edges show up twice which only costs a skipped entry
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 6; e++)
+			{
+				unsigned int from = result[i + e % 3];
+				unsigned int to = result[i + (e + (e < 3 ? 1 : 2)) % 3];
+				if (locked[from])
+					continue;
+
+				const Vertex& a = vertices[from];
+				const Vertex& b = vertices[to];
+				glm::vec2 uvDelta = a.TexCoords - b.TexCoords;
+				glm::vec3 normalDelta = a.Normal - b.Normal;
+				Quadric merged = quadrics[position[from]];
+				merged.Add(quadrics[position[to]]);
+				double error = merged.Evaluate(b.Position);
+				if (error > maxSquaredError)
+					continue;
+
+				double cost = error + attributeScale * (UV_WEIGHT * glm::dot(uvDelta, uvDelta) + NORMAL_WEIGHT * glm::dot(normalDelta, normalDelta));
+				collapses.push_back(Collapse{ from, to, cost, error });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// a collapse reshapes every triangle around the vertex it moves, so its whole one-ring sits out the
+		// rest of the pass: a later collapse there would be flip tested and costed against stale triangles
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t indexCount = result.size();
+		size_t collapsedCount = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (indexCount <= targetIndexCount)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// reject the collapse if any triangle that survives it would flip over
+			const glm::vec3& target = vertices[collapse.to].Position;
+			bool flips = false;
+			unsigned int removedTriangles = 0;
+			for (unsigned int t = adjacencyOffsets[collapse.from]; t < adjacencyOffsets[collapse.from + 1] && !flips; t++)
+			{
+				unsigned int triangle = adjacency[t];
+				unsigned int v[3] = { remap[result[triangle * 3]], remap[result[triangle * 3 + 1]], remap[result[triangle * 3 + 2]] };
+				if (position[v[0]] == position[collapse.to] || position[v[1]] == position[collapse.to] || position[v[2]] == position[collapse.to])
+				{
+					removedTriangles++;
+					continue;
+				}
+
+				glm::vec3 before = TriangleNormal(vertices[v[0]].Position, vertices[v[1]].Position, vertices[v[2]].Position);
+				glm::vec3 after = TriangleNormal(
+					v[0] == collapse.from ? target : vertices[v[0]].Position,
+					v[1] == collapse.from ? target : vertices[v[1]].Position,
+					v[2] == collapse.from ? target : vertices[v[2]].Position);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+			if (flips)
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			for (unsigned int t = adjacencyOffsets[collapse.from]; t < adjacencyOffsets[collapse.from + 1]; t++)
+			{
+				unsigned int triangle = adjacency[t];
+				touched[result[triangle * 3]] = touched[result[triangle * 3 + 1]] = touched[result[triangle * 3 + 2]] = 1;
+			}
+			quadrics[position[collapse.to]].Add(quadrics[position[collapse.from]]);
+			worstSquaredError = std::max(worstSquaredError, collapse.error);
+			indexCount -= std::min<size_t>(indexCount, removedTriangles * 3);
+			collapsedCount++;
+		}
+
+		if (collapsedCount == 0)
+			break;
+
+		// apply the collapses, dropping the triangles that lost an edge
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a])
+				continue;
+
+			result[writeIndex++] = a;
+			result[writeIndex++] = b;
+			result[writeIndex++] = c;
+		}
+		result.resize(writeIndex);
+	}
+
+	outError = (float)std::sqrt(worstSquaredError);
+	return result;
+}
+
+void MeshSimplifier::GenerateLods(MeshData& mesh)
+{
+	mesh.bounds = ComputeBounds(mesh.vertices);
+	mesh.lods.assign(1, MeshLod{ 0, (unsigned int)mesh.indices.size(), 0.0f });
+
+	vector<unsigned int> previous(mesh.indices);
+	float error = 0.0f;
+	for (unsigned int level = 1; level < MAX_LODS; level++)
+	{
+		size_t targetIndexCount = (size_t)(previous.size() / 3 * LOD_REDUCTION) * 3;
+		float stepError = 0.0f;
+		vector<unsigned int> lod = Simplify(mesh.vertices, previous, targetIndexCount, LOD_MAX_STEP_ERROR * mesh.bounds.radius, stepError);
+
+		// locked seams and the error cap stall the reduction eventually, a barely smaller level isn't worth a switch
+		if (lod.empty() || lod.size() > previous.size() * LOD_MIN_SHRINK)
+			break;
+
+		// each level is simplified from the previous one, the errors add up
+		error += stepError;
+		mesh.lods.push_back(MeshLod{ (unsigned int)mesh.indices.size(), (unsigned int)lod.size(), error });
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+		previous.swap(lod);
+	}
+}
+
+MeshBounds MeshSimplifier::ComputeBounds(const vector<Vertex>& vertices)
+{
+	MeshBounds bounds;
+	if (vertices.empty())
+		return bounds;
+
+	glm::vec3 minBounds(vertices[0].Position), maxBounds(vertices[0].Position);
+	for (const Vertex& vertex : vertices)
+	{
+		minBounds = glm::min(minBounds, vertex.Position);
+		maxBounds = glm::max(maxBounds, vertex.Position);
+	}
+
+	bounds.center = (minBounds + maxBounds) * 0.5f;
+	for (const Vertex& vertex : vertices)
+		bounds.radius = std::max(bounds.radius, glm::length(vertex.Position - bounds.center));
+	return bounds;
+}
@@ -0,0 +1,145 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const unsigned int NONE = 0xFFFFFFFFu;
+
+	void ComputeMeshletBounds(const vector<Vertex>& vertices, const unsigned int* indices, Meshlet& meshlet)
+	{
+		glm::vec3 minBounds(vertices[indices[0]].Position), maxBounds(minBounds);
+		glm::vec3 axis(0.0f);
+		for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++)
+		{
+			minBounds = glm::min(minBounds, vertices[indices[i]].Position);
+			maxBounds = glm::max(maxBounds, vertices[indices[i]].Position);
+		}
+
+		meshlet.center = (minBounds + maxBounds) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++)
+			meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].Position - meshlet.center));
+
+		// the cone axis averages the unit face normals, its angle is the widest one away from the axis
+		vector<glm::vec3> normals;
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3]].Position;
+			glm::vec3 normal = glm::cross(vertices[indices[t * 3 + 1]].Position - p0, vertices[indices[t * 3 + 2]].Position - p0);
+			float length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+		}
+
+		meshlet.coneAxis = glm::vec3(0.0f);
+		meshlet.coneCutoff = 1.0f;
+		float axisLength = glm::length(axis);
+		if (axisLength <= 0.0f)
+			return;
+
+		axis /= axisLength;
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+			minDot = std::min(minDot, glm::dot(axis, normal));
+
+		// a cone wider than a hemisphere always has a face towards the camera
+		if (minDot <= 0.0f)
+			return;
+
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void MeshletBuilder::Build(MeshData& mesh)
+{
+	mesh.meshlets.clear();
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t vertexCount = mesh.vertices.size();
+	if (triangleCount == 0)
+		return;
+
+	// vertex -> triangles, as offsets into a flat list
+	vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+	for (unsigned int index : mesh.indices)
+		adjacencyOffsets[index + 1]++;
+	for (size_t i = 0; i < vertexCount; i++)
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+		adjacency[cursor[mesh.indices[i]]++] = (unsigned int)(i / 3);
+
+	vector<unsigned char> used(triangleCount, 0);
+	vector<unsigned int> vertexMeshlet(vertexCount, NONE);	// last meshlet that took the vertex
+	vector<unsigned int> meshletVertices;
+	vector<unsigned int> reordered;
+	reordered.reserve(mesh.indices.size());
+
+	size_t seed = 0;
+	while (true)
+	{
+		// seeds follow the original order, which is already cache friendly and spatially coherent
+		while (seed < triangleCount && used[seed])
+			seed++;
+		if (seed == triangleCount)
+			break;
+
+		unsigned int meshletIndex = (unsigned int)mesh.meshlets.size();
+		Meshlet meshlet = {};
+		meshlet.indexOffset = (unsigned int)reordered.size();
+		meshletVertices.clear();
+
+		unsigned int triangle = (unsigned int)seed;
+		while (triangle != NONE)
+		{
+			used[triangle] = 1;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = mesh.indices[triangle * 3 + k];
+				reordered.push_back(vertex);
+				if (vertexMeshlet[vertex] != meshletIndex)
+				{
+					vertexMeshlet[vertex] = meshletIndex;
+					meshletVertices.push_back(vertex);
+				}
+			}
+			if (++meshlet.triangleCount == MAX_TRIANGLES)
+				break;
+
+			// the unused neighbour that adds the fewest vertices and still fits, none ends the meshlet
+			triangle = NONE;
+			unsigned int bestNewVertices = 3;
+			for (size_t v = 0; v < meshletVertices.size() && bestNewVertices > 0; v++)
+			{
+				unsigned int vertex = meshletVertices[v];
+				for (unsigned int a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+				{
+					unsigned int candidate = adjacency[a];
+					if (used[candidate])
+						continue;
+
+					unsigned int newVertices = 0;
+					for (int k = 0; k < 3; k++)
+						newVertices += vertexMeshlet[mesh.indices[candidate * 3 + k]] != meshletIndex ? 1 : 0;
+
+					if (newVertices < bestNewVertices && meshletVertices.size() + newVertices <= MAX_VERTICES)
+					{
+						triangle = candidate;
+						bestNewVertices = newVertices;
+						if (newVertices == 0)
+							break;
+					}
+				}
+			}
+		}
+
+		ComputeMeshletBounds(mesh.vertices, &reordered[meshlet.indexOffset], meshlet);
+		mesh.meshlets.push_back(meshlet);
+	}
+
+	mesh.indices.swap(reordered);
+}
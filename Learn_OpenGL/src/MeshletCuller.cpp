@@ -0,0 +1,118 @@
+#include "MeshletCuller.h"
+#include <algorithm>
+#include <initializer_list>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define MESHLET_CULLER_SSE
+#endif
+
+void MeshletCuller::Setup(const std::vector<Meshlet>& meshlets)
+{
+	size_t paddedCount = (meshlets.size() + 3) / 4 * 4;
+	for (std::vector<float>* values : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_axisX, &m_axisY, &m_axisZ, &m_cutoff })
+		values->assign(paddedCount, 0.0f);
+
+	m_indexOffsets.resize(meshlets.size());
+	m_triangleCounts.resize(meshlets.size());
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		m_centerX[i] = meshlet.center.x;
+		m_centerY[i] = meshlet.center.y;
+		m_centerZ[i] = meshlet.center.z;
+		m_radius[i] = meshlet.radius;
+		m_axisX[i] = meshlet.coneAxis.x;
+		m_axisY[i] = meshlet.coneAxis.y;
+		m_axisZ[i] = meshlet.coneAxis.z;
+		m_cutoff[i] = meshlet.coneCutoff;
+
+		m_indexOffsets[i] = meshlet.indexOffset;
+		m_triangleCounts[i] = meshlet.triangleCount;
+	}
+}
+
+void MeshletCuller::Cull(const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<GLsizei>& outCounts, std::vector<const void*>& outOffsets, MeshletStats& stats) const
+{
+	outCounts.clear();
+	outOffsets.clear();
+
+	bool previousVisible = false;
+	for (size_t first = 0; first < m_indexOffsets.size(); first += 4)
+	{
+		unsigned int mask = CullBlock(first, frustum, cameraPosition);
+		size_t blockSize = std::min<size_t>(4, m_indexOffsets.size() - first);
+		for (size_t i = 0; i < blockSize; i++)
+		{
+			size_t meshlet = first + i;
+			stats.meshletCount++;
+			stats.triangleCount += m_triangleCounts[meshlet];
+
+			bool visible = (mask & (1u << i)) != 0;
+			if (visible)
+			{
+				stats.visibleMeshletCount++;
+				stats.visibleTriangleCount += m_triangleCounts[meshlet];
+
+				// meshlets are stored in index order, a visible one right after another extends its range
+				if (previousVisible)
+				{
+					outCounts.back() += m_triangleCounts[meshlet] * 3;
+				}
+				else
+				{
+					outCounts.push_back(m_triangleCounts[meshlet] * 3);
+					outOffsets.push_back((const void*)(m_indexOffsets[meshlet] * sizeof(unsigned int)));
+				}
+			}
+			previousVisible = visible;
+		}
+	}
+	stats.drawRangeCount += (unsigned int)outCounts.size();
+}
+
+unsigned int MeshletCuller::CullBlock(size_t first, const Frustum& frustum, const glm::vec3& cameraPosition) const
+{
+	// a meshlet is culled when its sphere is outside a frustum plane, or when the whole sphere lies in the
+	// region from which every normal of its cone faces away: dot(center - camera, axis) >= cutoff * distance + radius
+#ifdef MESHLET_CULLER_SSE
+	__m128 centerX = _mm_loadu_ps(&m_centerX[first]);
+	__m128 centerY = _mm_loadu_ps(&m_centerY[first]);
+	__m128 centerZ = _mm_loadu_ps(&m_centerZ[first]);
+	__m128 radius = _mm_loadu_ps(&m_radius[first]);
+	__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+	__m128 visible = _mm_cmpeq_ps(radius, radius);
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		__m128 distance = _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+		distance = _mm_add_ps(distance, _mm_mul_ps(centerY, _mm_set1_ps(plane.y)));
+		distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, _mm_set1_ps(plane.z)));
+		visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+	}
+
+	__m128 viewX = _mm_sub_ps(centerX, _mm_set1_ps(cameraPosition.x));
+	__m128 viewY = _mm_sub_ps(centerY, _mm_set1_ps(cameraPosition.y));
+	__m128 viewZ = _mm_sub_ps(centerZ, _mm_set1_ps(cameraPosition.z));
+	__m128 viewLength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(viewX, viewX), _mm_mul_ps(viewY, viewY)), _mm_mul_ps(viewZ, viewZ)));
+	__m128 facing = _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(viewX, _mm_loadu_ps(&m_axisX[first])),
+		_mm_mul_ps(viewY, _mm_loadu_ps(&m_axisY[first]))),
+		_mm_mul_ps(viewZ, _mm_loadu_ps(&m_axisZ[first])));
+	__m128 backfacing = _mm_cmpge_ps(facing, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_cutoff[first]), viewLength), radius));
+
+	return (unsigned int)_mm_movemask_ps(_mm_andnot_ps(backfacing, visible));
+#else
+	unsigned int mask = 0;
+	for (size_t i = first; i < first + 4 && i < m_indexOffsets.size(); i++)
+	{
+		glm::vec3 center(m_centerX[i], m_centerY[i], m_centerZ[i]);
+		glm::vec3 view = center - cameraPosition;
+		bool backfacing = glm::dot(view, glm::vec3(m_axisX[i], m_axisY[i], m_axisZ[i])) >= m_cutoff[i] * glm::length(view) + m_radius[i];
+		if (!backfacing && frustum.IntersectsSphere(center, m_radius[i]))
+			mask |= 1u << (i - first);
+	}
+	return mask;
+#endif
+}
@@ -1,8 +1,22 @@
 #include "MirrorFramebufferScene.h"
 #include <VertexArrayInitializer.h>
 #include <Model.h>
+#include <CubemapScene.h>
 #include <map>
 #include <stb_image.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const float CUBE_RADIUS = 0.87f;
+    const float WINDOW_RADIUS = 0.71f;
+    const float FLOOR_RADIUS = 7.08f;
+
+    // frames timed per mode when benchmarking
+    const int BENCHMARK_FRAMES = 300;
+}
 
 MirrorFramebufferScene::MirrorFramebufferScene()
 {
@@ -14,17 +28,21 @@ void MirrorFramebufferScene::Setup()
     VertexArrayInitializer::SetupPlane(m_planeVAO);
     VertexArrayInitializer::Setup3DQuad(m_quadVAO);
     VertexArrayInitializer::SetupScreenQuad(m_screenQuadVAO);
-    VertexArrayInitializer::SetupMirrorQuad(m_mirrorQuadVAO);
+    VertexArrayInitializer::Setup3DQuad(m_mirrorQuadVAO);
 
     m_shader = Shader(".\\shaders\\depth_testing.vs", ".\\shaders\\depth_testing.fs");
     m_borderShader = Shader(".\\shaders\\depth_testing.vs", ".\\shaders\\shaderSingleColor.fs");
     m_screenShader = Shader(".\\shaders\\screenShader.vs", ".\\shaders\\screenShader.fs");
+    m_mirrorShader = Shader(".\\shaders\\mirror.vs", ".\\shaders\\mirror.fs");
+    m_ssrShader = Shader(".\\shaders\\ssr.vs", ".\\shaders\\ssr.fs");
 
-    m_cubeTexture = Model::TextureFromFile("marble.jpg", ".\\resources\\textures");
-    m_floorTexture = Model::TextureFromFile("metal.png", ".\\resources\\textures");
-    m_windowTexture = Model::TextureFromFile("blending_transparent_window.png", ".\\resources\\textures");
+    m_cubeLayer = m_textures.AddTexture("marble.jpg", ".\\resources\\textures");
+    m_floorLayer = m_textures.AddTexture("metal.png", ".\\resources\\textures");
+    m_windowLayer = m_textures.AddTexture("blending_transparent_window.png", ".\\resources\\textures");
+    m_textures.Build();
+    m_skyboxTexture = CubemapScene::LoadSkybox();
 
-    stbi_set_flip_vertically_on_load(true);
+    Model::SetFlipVerticallyOnLoad(true);
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
@@ -37,19 +55,162 @@ void MirrorFramebufferScene::Setup()
     m_quadArrayPos.push_back(glm::vec3(-0.3f, 0.0f, -2.3f));
     m_quadArrayPos.push_back(glm::vec3(0.5f, 0.0f, -0.6f));
 
-    SetupFramebuffer(m_framebuffer, m_texColorbuffer);
-    SetupFramebuffer(m_mirrorFramebuffer, m_mirrorTexColorbuffer);
+    m_cubePositions.push_back(glm::vec3(-1.0f, 0.0f, -1.0f));
+    m_cubePositions.push_back(glm::vec3(2.0f, 0.0f, 0.0f));
+
+    // 5x2.5 mirror standing on the floor behind the scene, facing +z
+    glm::mat4 mirrorModel = glm::translate(glm::mat4(1.0f), glm::vec3(-2.5f, 0.75f, -4.0f));
+    mirrorModel = glm::scale(mirrorModel, glm::vec3(5.0f, 2.5f, 1.0f));
+    SetupMirror(mirrorModel);
+
+    m_mirrorShader.Use();
+    m_mirrorShader.SetInt("reflection", 0);
+
+    m_ssrShader.Use();
+    m_ssrShader.SetInt("sceneColor", 0);
+    m_ssrShader.SetInt("sceneDepth", 1);
+    m_ssrShader.SetInt("skybox", 2);
+    m_ssrShader.SetInt("maxSteps", 48);
+    m_ssrShader.SetFloat("stepSize", 0.1f);
+    m_ssrShader.SetFloat("thickness", 0.5f);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    SetupScreenTargets(viewport[2], viewport[3]);
+}
+
+void MirrorFramebufferScene::SetupScreenTargets(int width, int height)
+{
+    // a minimized window has an empty viewport, the targets keep their last size
+    if (width <= 0 || height <= 0)
+        return;
+
+    m_screenWidth = width;
+    m_screenHeight = height;
+    SetupFramebuffer(m_framebuffer, m_texColorbuffer, m_depthStencilbuffer, m_screenWidth, m_screenHeight);
+    SetupReflectionTarget();
+    SetupScreenSpaceSource();
+
+    m_mirrorShader.Use();
+    m_mirrorShader.SetVec2("screenSize", glm::vec2(m_screenWidth, m_screenHeight));
+}
+
+void MirrorFramebufferScene::SetupReflectionTarget()
+{
+    m_reflectionWidth = std::max((int)(m_screenWidth * m_reflectionScale), 1);
+    m_reflectionHeight = std::max((int)(m_screenHeight * m_reflectionScale), 1);
+    SetupFramebuffer(m_mirrorFramebuffer, m_mirrorTexColorbuffer, m_mirrorDepthStencilbuffer, m_reflectionWidth, m_reflectionHeight);
+}
+
+void MirrorFramebufferScene::SetupScreenSpaceSource()
+{
+    // release the previous attachments when resizing
+    if (m_ssrFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &m_ssrFramebuffer);
+        glDeleteTextures(1, &m_ssrColorbuffer);
+        glDeleteTextures(1, &m_ssrDepthbuffer);
+    }
+
+    glGenFramebuffers(1, &m_ssrFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_ssrFramebuffer);
+
+    glGenTextures(1, &m_ssrColorbuffer);
+    glBindTexture(GL_TEXTURE_2D, m_ssrColorbuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_screenWidth, m_screenHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ssrColorbuffer, 0);
+
+    // same format as the scene renderbuffer so the depth can be blitted, but sampleable
+    glGenTextures(1, &m_ssrDepthbuffer);
+    glBindTexture(GL_TEXTURE_2D, m_ssrDepthbuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, m_screenWidth, m_screenHeight, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_ssrDepthbuffer, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        cout << "ERROR::FRAMEBUFFER:: SSR framebuffer is not complete!" << endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void MirrorFramebufferScene::SetupMirror(const glm::mat4& model)
+{
+    m_mirrorModel = model;
+
+    // corners of the quad from VertexArrayInitializer::Setup3DQuad
+    const glm::vec3 quadCorners[4] = {
+        glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f),
+        glm::vec3(1.0f, -0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 0.0f)
+    };
+    for (int i = 0; i < 4; i++)
+        m_mirrorCorners[i] = glm::vec3(model * glm::vec4(quadCorners[i], 1.0f));
+
+    glm::vec3 normal = glm::normalize(glm::transpose(glm::inverse(glm::mat3(model))) * glm::vec3(0.0f, 0.0f, 1.0f));
+    m_mirrorPlane = glm::vec4(normal, -glm::dot(normal, m_mirrorCorners[0]));
+}
+
+void MirrorFramebufferScene::OnKeyPressed(int key)
+{
+    if (key == GLFW_KEY_M)
+    {
+        m_reflectionMode = m_reflectionMode == ReflectionMode::RERENDER ? ReflectionMode::SCREEN_SPACE : ReflectionMode::RERENDER;
+        std::cout << "Reflection mode: " << GetModeName(m_reflectionMode) << std::endl;
+        return;
+    }
+    if (key == GLFW_KEY_B && m_benchmarkFrame < 0)
+    {
+        std::cout << "Benchmarking reflections over " << BENCHMARK_FRAMES << " frames per mode..." << std::endl;
+        m_reflectionMode = ReflectionMode::RERENDER;
+        m_reflectionTimer.Reset();
+        m_benchmarkFrame = 0;
+        return;
+    }
+    if (key != GLFW_KEY_EQUAL && key != GLFW_KEY_MINUS)
+        return;
+
+    m_reflectionScale += key == GLFW_KEY_EQUAL ? 0.25f : -0.25f;
+    m_reflectionScale = std::min(std::max(m_reflectionScale, 0.25f), 1.0f);
+    SetupReflectionTarget();
+    std::cout << "Reflection resolution: " << m_reflectionWidth << "x" << m_reflectionHeight << std::endl;
 }
 
 void MirrorFramebufferScene::Draw(const Camera& camera)
 {
+    // the offscreen targets follow the window
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] != m_screenWidth || viewport[3] != m_screenHeight)
+        SetupScreenTargets(viewport[2], viewport[3]);
+
     glEnable(GL_STENCIL_TEST);
     glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+    const glm::mat4 view = camera.GetViewMatrix();
+    const glm::mat4 projection = camera.GetPerspectiveProj();
+
+    // every object samples a layer of the same array
+    m_textures.Bind(0);
+
+    // Draw the reflection first so the mirror can sample it in the scene pass
+    bool hasReflection = false;
+    if (m_reflectionMode == ReflectionMode::RERENDER)
+    {
+        m_reflectionTimer.Begin();
+        hasReflection = DrawReflection(camera, view, projection);
+        m_reflectionTimer.End();
+    }
+
     // Setup scene framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_screenWidth, m_screenHeight);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
@@ -57,40 +218,163 @@ void MirrorFramebufferScene::Draw(const Camera& camera)
     // Draw scene in framebuffer
     glm::mat4 model = glm::mat4(1.0f);
     m_shader.Use();
-    m_shader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
+    m_shader.SetMVPMatrix(model, view, projection);
     m_borderShader.Use();
-    m_borderShader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
+    m_borderShader.SetMVPMatrix(model, view, projection);
+
+    // Draw scene, the windows go last since they are blended
+    DrawFloor(m_shader, m_planeVAO, m_floorLayer, nullptr);
+    DrawCubes(m_shader, m_cubeVAO, m_cubeLayer, nullptr);
+    if (m_reflectionMode == ReflectionMode::SCREEN_SPACE && glm::dot(m_mirrorPlane, glm::vec4(camera.Position, 1.0f)) > 0.0f)
+    {
+        m_reflectionTimer.Begin();
+        DrawScreenSpaceMirror(view, projection);
+        m_reflectionTimer.End();
+    }
+    else
+    {
+        DrawMirror(view, projection, hasReflection);
+    }
+    DrawQuadArray(m_shader, m_quadVAO, m_windowLayer, m_quadArrayPos, camera.Position, nullptr);
+
+    // Draw screen quad
+    glBindFramebuffer(GL_FRAMEBUFFER, 0); // back to default
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    DrawScreenQuad(m_screenShader, m_screenQuadVAO, m_texColorbuffer);
+
+    UpdateBenchmark();
+}
+
+bool MirrorFramebufferScene::DrawReflection(const Camera& camera, const glm::mat4& view, const glm::mat4& projection)
+{
+    // nothing to reflect when looking at the back of the mirror
+    if (glm::dot(m_mirrorPlane, glm::vec4(camera.Position, 1.0f)) <= 0.0f)
+        return false;
+
+    glm::vec2 ndcMin, ndcMax;
+    if (!GetMirrorScreenBounds(projection * view, ndcMin, ndcMax))
+        return false;
 
-    // Draw scene
-    DrawFloor(m_shader, m_planeVAO, m_floorTexture);
-    DrawCubes(m_shader, m_cubeVAO, m_cubeTexture);
-    DrawQuadArray(m_shader, m_quadVAO, m_windowTexture, m_quadArrayPos, camera);
+    // the mirror covers the same pixels in both views, so the reflection is restricted to that rectangle:
+    // the near plane is moved onto the mirror and the side planes of the culling frustum go through its edges
+    const glm::mat4 reflection = GetReflectionMatrix(m_mirrorPlane);
+    const glm::mat4 reflectedView = view * reflection;
+    const glm::mat4 reflectedProjection = GetObliqueProjection(projection, reflectedView, m_mirrorPlane);
+    const Frustum frustum = Frustum::FromMatrix(reflectedProjection * reflectedView, ndcMin, ndcMax);
+
+    // scissor to the mirror rectangle in the scaled target, one texel larger for bilinear filtering
+    int x0 = std::max((int)std::floor((ndcMin.x * 0.5f + 0.5f) * m_reflectionWidth) - 1, 0);
+    int y0 = std::max((int)std::floor((ndcMin.y * 0.5f + 0.5f) * m_reflectionHeight) - 1, 0);
+    int x1 = std::min((int)std::ceil((ndcMax.x * 0.5f + 0.5f) * m_reflectionWidth) + 1, m_reflectionWidth);
+    int y1 = std::min((int)std::ceil((ndcMax.y * 0.5f + 0.5f) * m_reflectionHeight) + 1, m_reflectionHeight);
 
-    // Setup mirror framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, m_mirrorFramebuffer);
+    glViewport(0, 0, m_reflectionWidth, m_reflectionHeight);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x0, y0, x1 - x0, y1 - y0);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
+    // reflecting flips the winding of every triangle
+    glFrontFace(GL_CW);
 
-    // Draw mirrored scene in framebuffer
-    model = glm::mat4(1.0f);
     m_shader.Use();
-    m_shader.SetMVPMatrix(model, GetInvertedView(camera), camera.GetPerspectiveProj());
-    DrawFloor(m_shader, m_planeVAO, m_floorTexture);
-    DrawCubes(m_shader, m_cubeVAO, m_cubeTexture);
-    DrawQuadArray(m_shader, m_quadVAO, m_windowTexture, m_quadArrayPos, camera);
+    m_shader.SetMVPMatrix(glm::mat4(1.0f), reflectedView, reflectedProjection);
+    glm::vec3 reflectedPosition = glm::vec3(reflection * glm::vec4(camera.Position, 1.0f));
+    DrawFloor(m_shader, m_planeVAO, m_floorLayer, &frustum);
+    DrawCubes(m_shader, m_cubeVAO, m_cubeLayer, &frustum);
+    DrawQuadArray(m_shader, m_quadVAO, m_windowLayer, m_quadArrayPos, reflectedPosition, &frustum);
 
-    // Draw screen quads
-    glBindFramebuffer(GL_FRAMEBUFFER, 0); // back to default
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glFrontFace(GL_CCW);
+    glDisable(GL_SCISSOR_TEST);
+    return true;
+}
 
-    DrawScreenQuad(m_screenShader, m_screenQuadVAO, m_texColorbuffer);
-    DrawScreenQuad(m_screenShader, m_mirrorQuadVAO, m_mirrorTexColorbuffer);
+void MirrorFramebufferScene::DrawMirror(const glm::mat4& view, const glm::mat4& projection, bool hasReflection)
+{
+    glStencilMask(0x00);
+
+    m_mirrorShader.Use();
+    m_mirrorShader.SetMVPMatrix(m_mirrorModel, view, projection);
+    m_mirrorShader.SetBool("hasReflection", hasReflection);
+    glBindVertexArray(m_mirrorQuadVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_mirrorTexColorbuffer);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+
+    // the scene shaders sample the array on the same unit
+    m_textures.Bind(0);
+}
+
+void MirrorFramebufferScene::DrawScreenSpaceMirror(const glm::mat4& view, const glm::mat4& projection)
+{
+    // the shader can't read the framebuffer it draws into, copy what's been drawn so far
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_ssrFramebuffer);
+    glBlitFramebuffer(0, 0, m_screenWidth, m_screenHeight, 0, 0, m_screenWidth, m_screenHeight,
+        GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    glStencilMask(0x00);
+
+    m_ssrShader.Use();
+    m_ssrShader.SetMVPMatrix(m_mirrorModel, view, projection);
+    m_ssrShader.SetMat3("inverseView", glm::transpose(glm::mat3(view)));
+    m_ssrShader.SetVec3("viewNormal", glm::normalize(glm::mat3(view) * glm::vec3(m_mirrorPlane)));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_ssrColorbuffer);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_ssrDepthbuffer);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_skyboxTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(m_mirrorQuadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+
+    m_textures.Bind(0);
+}
+
+void MirrorFramebufferScene::UpdateBenchmark()
+{
+    if (m_benchmarkFrame < 0 || ++m_benchmarkFrame < BENCHMARK_FRAMES)
+        return;
+
+    m_benchmarkResults[(int)m_reflectionMode] = m_reflectionTimer.GetAverageMs();
+    m_reflectionTimer.Reset();
+    m_benchmarkFrame = 0;
+    if (m_reflectionMode == ReflectionMode::RERENDER)
+    {
+        m_reflectionMode = ReflectionMode::SCREEN_SPACE;
+        return;
+    }
+
+    std::cout << "Reflection pass GPU time (" << m_reflectionWidth << "x" << m_reflectionHeight << " re-render target):" << std::endl;
+    std::cout << "  " << GetModeName(ReflectionMode::RERENDER) << ": " << m_benchmarkResults[0] << " ms" << std::endl;
+    std::cout << "  " << GetModeName(ReflectionMode::SCREEN_SPACE) << ": " << m_benchmarkResults[1] << " ms" << std::endl;
+    m_reflectionMode = ReflectionMode::RERENDER;
+    m_benchmarkFrame = -1;
+}
+
+const char* MirrorFramebufferScene::GetModeName(ReflectionMode mode)
+{
+    return mode == ReflectionMode::RERENDER ? "re-render" : "screen-space";
 }
 
-void MirrorFramebufferScene::SetupFramebuffer(unsigned int& fbo, unsigned int& texColorBuffer)
+void MirrorFramebufferScene::SetupFramebuffer(unsigned int& fbo, unsigned int& texColorBuffer, unsigned int& rbo, int width, int height)
 {
+    // release the previous attachments when resizing
+    if (fbo != 0)
+    {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texColorBuffer);
+        glDeleteRenderbuffers(1, &rbo);
+    }
+
     // framebuffer configuration
     // -------------------------
     glGenFramebuffers(1, &fbo);
@@ -99,16 +383,17 @@ void MirrorFramebufferScene::SetupFramebuffer(unsigned int& fbo, unsigned int& t
     // create a color attachment texture
     glGenTextures(1, &texColorBuffer);
     glBindTexture(GL_TEXTURE_2D, texColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 800.0f, 600.0f, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColorBuffer, 0);
 
     // create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
-    unsigned int rbo;
     glGenRenderbuffers(1, &rbo);
     glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 800.0f, 600.0f); // use a single renderbuffer object for both a depth AND stencil buffer.
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height); // use a single renderbuffer object for both a depth AND stencil buffer.
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
     
     // now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
@@ -117,50 +402,57 @@ void MirrorFramebufferScene::SetupFramebuffer(unsigned int& fbo, unsigned int& t
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void MirrorFramebufferScene::DrawFloor(Shader& shader, unsigned int planeVAO, unsigned int floorTexture)
+void MirrorFramebufferScene::DrawFloor(Shader& shader, unsigned int planeVAO, int floorLayer, const Frustum* frustum)
 {
+    if (frustum != nullptr && !frustum->IntersectsSphere(glm::vec3(0.0f, -0.5f, 0.0f), FLOOR_RADIUS))
+        return;
+
     glStencilMask(0x00);
 
     shader.Use();
     glBindVertexArray(planeVAO);
-    glBindTexture(GL_TEXTURE_2D, floorTexture);
+    m_textures.SelectLayer(shader, floorLayer);
     shader.SetMat4("model", glm::mat4(1.0f));
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
 }
 
-void MirrorFramebufferScene::DrawCubes(Shader& shader, unsigned int cubeVAO, unsigned int cubeTexture)
+void MirrorFramebufferScene::DrawCubes(Shader& shader, unsigned int cubeVAO, int cubeLayer, const Frustum* frustum)
 {
     glStencilFunc(GL_ALWAYS, 1, 0xFF);
     glStencilMask(0xFF);
 
     shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
     glBindVertexArray(cubeVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cubeTexture);
-    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-    shader.SetMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-    shader.SetMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    m_textures.SelectLayer(shader, cubeLayer);
+    for (const glm::vec3& position : m_cubePositions)
+    {
+        if (frustum != nullptr && !frustum->IntersectsSphere(position, CUBE_RADIUS))
+            continue;
+
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        shader.SetMat4("model", model);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
 }
 
-void MirrorFramebufferScene::DrawQuadArray(Shader& shader, unsigned int quadVAO, unsigned int texture, const std::vector<glm::vec3>& quadArray, const Camera& camera)
+void MirrorFramebufferScene::DrawQuadArray(Shader& shader, unsigned int quadVAO, int layer, const std::vector<glm::vec3>& quadArray, const glm::vec3& viewPosition, const Frustum* frustum)
 {
     std::map<float, glm::vec3> sorted;
     for (unsigned int i = 0; i < quadArray.size(); i++)
     {
-        float distance = glm::length(camera.Position - quadArray[i]);
+        // the quad spans [0, 1] on x from its position
+        if (frustum != nullptr && !frustum->IntersectsSphere(quadArray[i] + glm::vec3(0.5f, 0.0f, 0.0f), WINDOW_RADIUS))
+            continue;
+
+        float distance = glm::length(viewPosition - quadArray[i]);
         sorted[distance] = quadArray[i];
     }
 
     shader.Use();
 
     glBindVertexArray(quadVAO);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    m_textures.SelectLayer(shader, layer);
 
     glm::mat4 model = glm::mat4(1.0f);
     for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it !=
@@ -182,10 +474,64 @@ void MirrorFramebufferScene::DrawScreenQuad(Shader& shader, unsigned int quadVAO
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
-glm::mat4 MirrorFramebufferScene::GetInvertedView(const Camera& camera)
+glm::mat4 MirrorFramebufferScene::GetReflectionMatrix(const glm::vec4& plane)
 {
-    Camera tmpCamera = Camera(camera);
-    tmpCamera.Front *= -1;
-    glm::mat4 view = tmpCamera.GetViewMatrix();
-    return view;
-}
\ No newline at end of file
+    // p' = p - 2 * (n.p + d) * n
+    const glm::vec3 n = glm::vec3(plane);
+    glm::mat4 reflection = glm::mat4(1.0f);
+    for (int col = 0; col < 3; col++)
+    {
+        for (int row = 0; row < 3; row++)
+            reflection[col][row] -= 2.0f * n[row] * n[col];
+    }
+    reflection[3] = glm::vec4(-2.0f * plane.w * n, 1.0f);
+    return reflection;
+}
+
+glm::mat4 MirrorFramebufferScene::GetObliqueProjection(const glm::mat4& projection, const glm::mat4& view, const glm::vec4& plane)
+{
+    // replaces the near plane with the clip plane so nothing behind the mirror is rendered (Lengyel, "Oblique View Frustum Depth Projection and Clipping")
+    glm::vec4 clipPlane = glm::transpose(glm::inverse(view)) * plane;
+    glm::vec4 corner = glm::inverse(projection) * glm::vec4(glm::sign(clipPlane.x), glm::sign(clipPlane.y), 1.0f, 1.0f);
+    glm::vec4 scaledPlane = clipPlane * (2.0f / glm::dot(clipPlane, corner));
+
+    glm::mat4 oblique = projection;
+    for (int col = 0; col < 4; col++)
+        oblique[col][2] = scaledPlane[col] - oblique[col][3];
+    return oblique;
+}
+
+bool MirrorFramebufferScene::GetMirrorScreenBounds(const glm::mat4& viewProj, glm::vec2& ndcMin, glm::vec2& ndcMax) const
+{
+    glm::vec4 corners[4];
+    for (int i = 0; i < 4; i++)
+        corners[i] = viewProj * glm::vec4(m_mirrorCorners[i], 1.0f);
+
+    // clip the quad against the near plane (z >= -w) before dividing
+    std::vector<glm::vec4> clipped;
+    for (int i = 0; i < 4; i++)
+    {
+        const glm::vec4& a = corners[i];
+        const glm::vec4& b = corners[(i + 1) % 4];
+        float distA = a.z + a.w;
+        float distB = b.z + b.w;
+        if (distA >= 0.0f)
+            clipped.push_back(a);
+        if ((distA >= 0.0f) != (distB >= 0.0f))
+            clipped.push_back(a + (b - a) * (distA / (distA - distB)));
+    }
+    if (clipped.empty())
+        return false;
+
+    ndcMin = glm::vec2(std::numeric_limits<float>::max());
+    ndcMax = glm::vec2(-std::numeric_limits<float>::max());
+    for (const glm::vec4& corner : clipped)
+    {
+        glm::vec2 ndc = glm::vec2(corner) / std::max(corner.w, 1e-5f);
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+    ndcMin = glm::max(ndcMin, glm::vec2(-1.0f));
+    ndcMax = glm::min(ndcMax, glm::vec2(1.0f));
+    return ndcMin.x < ndcMax.x && ndcMin.y < ndcMax.y;
+}
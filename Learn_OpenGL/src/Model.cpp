@@ -3,6 +3,97 @@
 #include <assimp/postprocess.h>
 #include <assimp/material.h>
 #include <stb_image.h>
+#include <KtxLoader.h>
+#include <VirtualFileSystem.h>
+#include <MeshSimplifier.h>
+#include <JobSystem.h>
+#include <MeshletBuilder.h>
+#include <TransformBatch.h>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cfloat>
+
+namespace
+{
+	// projected simplification error, in pixels, a LOD may show
+	const float LOD_PIXEL_ERROR = 1.0f;
+	// a coarser LOD has to fit this fraction of the budget before it replaces the current one
+	const float LOD_HYSTERESIS = 0.6f;
+
+	int SelectLod(const vector<MeshLod>& lods, float pixelsPerUnit, int currentLod)
+	{
+		// coarsest level within the budget, and the coarsest one well inside it
+		int allowed = 0, preferred = 0;
+		for (int i = 1; i < (int)lods.size(); i++)
+		{
+			float pixels = lods[i].error * pixelsPerUnit;
+			if (pixels <= LOD_PIXEL_ERROR)
+				allowed = i;
+			if (pixels <= LOD_PIXEL_ERROR * LOD_HYSTERESIS)
+				preferred = i;
+		}
+
+		// in between the current level stays, a mesh sitting on a threshold doesn't switch every frame
+		return std::min(std::max(currentLod, preferred), allowed);
+	}
+
+	// Lets Assimp read models (and the files they reference, like .mtl) through the asset pack
+	class VfsIOStream : public Assimp::IOStream
+	{
+	public:
+		explicit VfsIOStream(FileData&& file) : m_file(std::move(file)) {}
+
+		size_t Read(void* pvBuffer, size_t pSize, size_t pCount) override
+		{
+			if (pSize == 0)
+				return 0;
+
+			size_t count = std::min(pCount, (m_file.size - m_position) / pSize);
+			std::memcpy(pvBuffer, m_file.data + m_position, count * pSize);
+			m_position += count * pSize;
+			return count;
+		}
+
+		size_t Write(const void* /*pvBuffer*/, size_t /*pSize*/, size_t /*pCount*/) override { return 0; }
+
+		aiReturn Seek(size_t pOffset, aiOrigin pOrigin) override
+		{
+			size_t position = pOrigin == aiOrigin_SET ? pOffset : pOrigin == aiOrigin_CUR ? m_position + pOffset : m_file.size + pOffset;
+			if (position > m_file.size)
+				return aiReturn_FAILURE;
+
+			m_position = position;
+			return aiReturn_SUCCESS;
+		}
+
+		size_t Tell() const override { return m_position; }
+		size_t FileSize() const override { return m_file.size; }
+		void Flush() override {}
+
+	private:
+		FileData m_file;
+		size_t m_position = 0;
+	};
+
+	class VfsIOSystem : public Assimp::IOSystem
+	{
+	public:
+		bool Exists(const char* pFile) const override { return VirtualFileSystem::Exists(pFile); }
+		char getOsSeparator() const override { return '\\'; }
+
+		Assimp::IOStream* Open(const char* pFile, const char* pMode) override
+		{
+			FileData file;
+			if (std::strchr(pMode, 'w') || !VirtualFileSystem::Read(pFile, file))
+				return nullptr;
+			return new VfsIOStream(std::move(file));
+		}
+
+		void Close(Assimp::IOStream* pFile) override { delete pFile; }
+	};
+}
 
 Model::Model()
 {
@@ -15,47 +106,268 @@ Model::Model(const char* path)
 
 void Model::LoadModel(string path)
 {
+	// the cooked mesh skips the Assimp import entirely
+	vector<MeshData> meshData;
+	vector<ModelNode> nodeData;
+	if (!MeshFile::Read(MeshFile::GetCookedPath(path), meshData, nodeData) && !ImportMeshData(path, meshData, nodeData))
+		return;
+
+	directory = path.substr(0, path.find_last_of('\\'));
+	for (unsigned int i = 0; i < meshData.size(); i++)
+	{
+		meshes.push_back(Mesh(meshData[i].vertices, meshData[i].indices, loadMaterialTextures(meshData[i].textures),
+			meshData[i].lods, meshData[i].bounds, meshData[i].meshlets));
+		meshNodes.push_back(meshData[i].node);
+	}
+
+	// the import keeps Assimp's depth-first order, which is the one the hierarchy wants
+	nodes.Clear();
+	for (const ModelNode& node : nodeData)
+		nodes.AddNode(node.parent, node.position, node.rotation, node.scale);
+	updateNodes();
+
+	// all the material textures end up in a single array, Draw binds it once for every mesh
+	unsigned int arrayID = textureArray.Build();
+	for (Mesh& mesh : meshes)
+	{
+		for (Texture& texture : mesh.textures)
+			texture.id = arrayID;
+	}
+}
+
+bool Model::ImportMeshData(const string& path, vector<MeshData>& outMeshes, vector<ModelNode>& outNodes, bool optimize)
+{
+	unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+	if (optimize)
+		flags |= aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality;
+
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+	importer.SetIOHandler(new VfsIOSystem);
+	const aiScene* scene = importer.ReadFile(path, flags);
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
 		std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-		return;
+		return false;
 	}
 
-	directory = path.substr(0, path.find_last_of('\\'));
-	processNode(scene->mRootNode, scene);
+	outMeshes.clear();
+	outNodes.clear();
+	processNode(scene->mRootNode, TransformHierarchy::NO_PARENT, scene, outMeshes, outNodes);
+
+	// meshlets and LODs are the slow part of an import and every mesh is independent
+	JobSystem::ParallelFor(outMeshes.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			if (optimize)
+				MeshFile::OptimizeVertexFetch(outMeshes[i]);
+			MeshletBuilder::Build(outMeshes[i]);
+			MeshSimplifier::GenerateLods(outMeshes[i]);
+		}
+	});
+	return true;
 }
 
 void Model::Draw(Shader& shader)
 {
+	textureArray.Bind(0);
+	shader.SetInt("material.textures", 0);
+
 	for (unsigned int i = 0; i < meshes.size(); i++)
 	{
 		meshes[i].Draw(shader);
 	}
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::Draw(Shader& shader, const Camera& camera, const glm::mat4& model, ModelLodState& lodState, MeshletStats& stats,
+	OcclusionQueryManager* occlusionQueries)
+{
+	textureArray.Bind(0);
+	shader.SetInt("material.textures", 0);
+
+	lodState.meshLods.resize(meshes.size(), 0);
+	if (occlusionQueries && lodState.occlusionObjects.size() != meshes.size())
+	{
+		lodState.occlusionObjects.clear();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			glm::vec3 boxMin, boxMax;
+			GetMeshBox(i, boxMin, boxMax);
+			lodState.occlusionObjects.push_back(occlusionQueries->AddObject(boxMin, boxMax));
+		}
+	}
+	// a static hierarchy costs nothing here, moved nodes are recomputed with their subtrees
+	updateNodes();
+
+	glm::mat4 viewProj = camera.GetPerspectiveProj() * camera.GetViewMatrix();
+	glm::mat4 meshModel;
+	float scale = 1.0f;
+	Frustum localFrustum;
+	glm::vec3 localCamera;
+	auto placeMesh = [&](const glm::mat4& transform)
+	{
+		meshModel = transform;
+		scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		// meshlets are culled in mesh space, which only needs the camera and the frustum moved there once
+		localFrustum = Frustum::FromMatrix(viewProj * transform);
+		localCamera = glm::vec3(glm::inverse(transform) * glm::vec4(camera.Position, 1.0f));
+	};
+	placeMesh(model);
+
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		if (!nodesAreIdentity)
+		{
+			placeMesh(model * nodes.GetWorld(meshNodes[i]));
+			shader.SetObjectMatrices(meshModel, viewProj * meshModel, TransformBatch::ComputeNormalMatrix(meshModel));
+		}
+
+		const MeshBounds& bounds = meshes[i].bounds;
+		int& lod = lodState.meshLods[i];
+		if (lodEnabled && bounds.radius > 0.0f)
+		{
+			// pixels covered by one unit of the mesh at its distance
+			glm::vec3 center = glm::vec3(meshModel * glm::vec4(bounds.center, 1.0f));
+			float pixelsPerUnit = camera.GetProjectedSphereRadius(center, bounds.radius * scale) / bounds.radius;
+			lod = SelectLod(meshes[i].lods, pixelsPerUnit, lod);
+		}
+		else
+		{
+			lod = 0;
+		}
+
+		if (occlusionQueries)
+		{
+			occlusionQueries->BeginConditionalRender(lodState.occlusionObjects[i], localCamera);
+			occlusionQueries->QueueTest(lodState.occlusionObjects[i], meshModel);
+		}
+
+		// the coarser levels have few triangles left to cull, they are drawn whole
+		if (lod == 0 && meshletCullingEnabled && !meshes[i].meshlets.empty())
+		{
+			meshes[i].DrawMeshlets(shader, localFrustum, localCamera, stats);
+		}
+		else
+		{
+			meshes[i].Draw(shader, lod);
+			stats.triangleCount += meshes[i].lods[lod].indexCount / 3;
+			stats.visibleTriangleCount += meshes[i].lods[lod].indexCount / 3;
+		}
+
+		if (occlusionQueries)
+			occlusionQueries->EndConditionalRender();
+	}
+}
+
+unsigned int Model::GetTriangleCount() const
 {
+	unsigned int triangleCount = 0;
+	for (const Mesh& mesh : meshes)
+		triangleCount += mesh.lods[0].indexCount / 3;
+	return triangleCount;
+}
+
+void Model::Release()
+{
+	for (Mesh& mesh : meshes)
+		mesh.Release();
+	textureArray.Release();
+}
+
+void Model::updateNodes()
+{
+	if (!nodes.Update())
+		return;
+
+	// most models only have identity nodes, their meshes keep the matrices the caller set
+	nodesAreIdentity = true;
+	for (int node : meshNodes)
+		nodesAreIdentity = nodesAreIdentity && nodes.GetWorld(node) == glm::mat4(1.0f);
+}
+
+void Model::GetMeshBox(unsigned int mesh, glm::vec3& outMin, glm::vec3& outMax) const
+{
+	outMin = glm::vec3(FLT_MAX);
+	outMax = glm::vec3(-FLT_MAX);
+	for (const Vertex& vertex : meshes[mesh].vertices)
+	{
+		outMin = glm::min(outMin, vertex.Position);
+		outMax = glm::max(outMax, vertex.Position);
+	}
+}
+
+void Model::GetBounds(glm::vec3& outMin, glm::vec3& outMax) const
+{
+	outMin = glm::vec3(FLT_MAX);
+	outMax = glm::vec3(-FLT_MAX);
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		glm::vec3 meshMin, meshMax;
+		GetMeshBox(i, meshMin, meshMax);
+		if (!nodesAreIdentity)
+			Bvh::TransformBox(nodes.GetWorld(meshNodes[i]), meshMin, meshMax, meshMin, meshMax);
+
+		outMin = glm::min(outMin, meshMin);
+		outMax = glm::max(outMax, meshMax);
+	}
+}
+
+bool Model::Raycast(const glm::vec3& origin, const glm::vec3& direction, const glm::mat4& model, float& inOutDistance)
+{
+	// the ray goes to mesh space with an affine transform, its parameter stays a world space distance
+	bool hit = false;
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		glm::mat4 toMesh = glm::inverse(nodesAreIdentity ? model : model * nodes.GetWorld(meshNodes[i]));
+		glm::vec3 meshOrigin = glm::vec3(toMesh * glm::vec4(origin, 1.0f));
+		glm::vec3 meshDirection = glm::mat3(toMesh) * direction;
+
+		BvhRayHit meshHit;
+		if (meshes[i].Raycast(meshOrigin, meshDirection, inOutDistance, meshHit))
+		{
+			inOutDistance = meshHit.distance;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+void Model::processNode(aiNode* node, int parent, const aiScene* scene, vector<MeshData>& outMeshes, vector<ModelNode>& outNodes)
+{
+	// the node's transform relative to its parent, a shear would be lost but Assimp scenes don't have any in practice
+	aiVector3D scaling, position;
+	aiQuaternion rotation;
+	node->mTransformation.Decompose(scaling, rotation, position);
+
+	ModelNode modelNode;
+	modelNode.parent = parent;
+	modelNode.position = glm::vec3(position.x, position.y, position.z);
+	modelNode.rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+	modelNode.scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+	int nodeIndex = (int)outNodes.size();
+	outNodes.push_back(modelNode);
+
 	// process all the node's meshes
 	for (unsigned int i = 0; i < node->mNumMeshes; i++)
 	{
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(mesh, scene));
+		outMeshes.push_back(processMesh(mesh, scene));
+		outMeshes.back().node = nodeIndex;
 	}
 
 	for (unsigned int i = 0; i < node->mNumChildren; i++)
 	{
 		aiNode* child = node->mChildren[i];
-		processNode(child, scene);
+		processNode(child, nodeIndex, scene, outMeshes, outNodes);
 	}
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+MeshData Model::processMesh(aiMesh* mesh, const aiScene* scene)
 {
-	vector<Vertex> vertices;
-	vector<unsigned int> indices;
-	vector<Texture> textures;
+	MeshData meshData;
+	vector<Vertex>& vertices = meshData.vertices;
+	vector<unsigned int>& indices = meshData.indices;
 
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 	{
@@ -103,29 +415,39 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 	if (mesh->mMaterialIndex >= 0)
 	{
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		
-		vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		getMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", meshData.textures);
+		getMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", meshData.textures);
 	}
 
-	return Mesh(vertices, indices, textures);
+	return meshData;
 }
 
-vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+void Model::getMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName, vector<MeshTextureRef>& outTextures)
 {
-	vector<Texture> textures;
-
 	for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
 	{
 		aiString str;
 		mat->GetTexture(type, i, &str);
 
+		MeshTextureRef texture;
+		texture.type = typeName;
+		texture.path = str.C_Str();
+		outTextures.push_back(texture);
+	}
+}
+
+vector<Texture> Model::loadMaterialTextures(const vector<MeshTextureRef>& textureRefs)
+{
+	vector<Texture> textures;
+
+	for (unsigned int i = 0; i < textureRefs.size(); i++)
+	{
+		const char* str = textureRefs[i].path.c_str();
+
 		bool skip = false;
 		for (unsigned int j = 0; j < textures_loaded.size(); j++)
 		{
-			if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+			if (std::strcmp(textures_loaded[j].path.data(), str) == 0)
 			{
 				textures.push_back(textures_loaded[j]);
 				skip = true;
@@ -136,9 +458,10 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type,
 		if (!skip)
 		{
 			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
+			texture.id = 0;
+			texture.layer = textureArray.AddTexture(str, directory);
+			texture.type = textureRefs[i].type;
+			texture.path = str;
 			textures.push_back(texture);
 			textures_loaded.push_back(texture);
 		}
@@ -151,11 +474,21 @@ unsigned int Model::TextureFromFile(const char* path, const string& directory)
 	string filename = string(path);
 	filename = directory + '/' + filename;
 
+	// prefer a GPU-compressed sibling (BC first, then the ETC2 fallback) over decoding the source image
+	unsigned int compressedID = KtxLoader::LoadTexture(KtxLoader::GetSiblingPath(filename));
+	if (compressedID == 0)
+		compressedID = KtxLoader::LoadTexture(KtxLoader::GetSiblingPath(filename, ".etc2.ktx2"));
+	if (compressedID != 0)
+		return compressedID;
+
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
 	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+	unsigned char* data = nullptr;
+	FileData file;
+	if (VirtualFileSystem::Read(filename, file))
+		data = stbi_load_from_memory(file.data, (int)file.size, &width, &height, &nrComponents, 0);
 	if (data)
 	{
 		GLenum format = GL_RGB; // default
@@ -194,3 +527,9 @@ unsigned int Model::TextureFromFile(const char* path, const string& directory)
 
 	return textureID;
 }
+
+void Model::SetFlipVerticallyOnLoad(bool flip)
+{
+	stbi_set_flip_vertically_on_load(flip);
+	KtxLoader::SetFlipVerticallyOnLoad(flip);
+}
@@ -1,7 +1,25 @@
 #include <ModelScene.h>
 #include <Model.h>
 #include <VertexArrayInitializer.h>
+#include <TransformBatch.h>
+#include <CascadedShadowMap.h>
+#include <PointShadowMaps.h>
 #include <stb_image.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/quaternion.hpp>
+#include <iostream>
+
+namespace
+{
+	const int CROWD_COLUMNS = 8;
+	const int CROWD_ROWS = 32;
+	// radians per second when the crowd spins
+	const float CROWD_SPIN_SPEED = 0.3f;
+
+	// frames timed per mode when benchmarking
+	const int BENCHMARK_FRAMES = 300;
+	const char* BENCHMARK_MODE_NAMES[] = { "full detail", "LODs", "LODs + occlusion queries" };
+}
 
 ModelScene::ModelScene()
 {
@@ -10,10 +28,6 @@ ModelScene::ModelScene()
 void ModelScene::Setup()
 {
 	m_modelShader.LoadShader(".\\shaders\\litShader.vs", ".\\shaders\\litShader.fs");
-	SetupMaterial(m_modelShader);
-	SetupDirectionalLight(m_modelShader);
-	SetupPointLights(m_modelShader);
-
 	m_sourceLightPositions = {
 		glm::vec3(0.7f, 0.2f, 2.0f),
 		glm::vec3(2.3f, -3.3f, -4.0f),
@@ -21,10 +35,16 @@ void ModelScene::Setup()
 		glm::vec3(0.0f, 0.0f, -3.0f)
 	};
 
-	stbi_set_flip_vertically_on_load(true);
+	SetupMaterial(m_modelShader);
+	SetupDirectionalLight(m_modelShader);
+	SetupPointLights(m_modelShader);
+
+	Model::SetFlipVerticallyOnLoad(true);
 	glEnable(GL_DEPTH_TEST);
 
 	m_model.LoadModel(".\\resources\\models\\backpack\\backpack.blobj");
+	SetupCrowd();
+	m_occlusionQueries.Setup();
 }
 
 void ModelScene::Draw(const Camera& camera)
@@ -36,9 +56,169 @@ void ModelScene::Draw(const Camera& camera)
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
 	model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-	m_modelShader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
+	glm::mat4 mvp = camera.GetPerspectiveProj() * camera.GetViewMatrix() * model;
+	m_modelShader.SetObjectMatrices(model, mvp, TransformBatch::ComputeNormalMatrix(model));
+
+	OcclusionQueryManager* occlusionQueries = m_occlusionQueriesEnabled ? &m_occlusionQueries : nullptr;
+	m_drawStats = MeshletStats();
+	m_drawTimer.Begin();
+	m_model.Draw(m_modelShader, camera, model, m_modelLod, m_drawStats, occlusionQueries);
+	if (m_showCrowd)
+		DrawCrowd(camera);
+	if (occlusionQueries)
+		occlusionQueries->IssueQueries(camera.GetPerspectiveProj() * camera.GetViewMatrix());
+	m_drawTimer.End();
+
+	UpdateBenchmark();
+}
+
+void ModelScene::OnKeyPressed(int key)
+{
+	if (key == GLFW_KEY_G)
+	{
+		m_showCrowd = !m_showCrowd;
+		std::cout << "Backpack crowd: " << (m_showCrowd ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_R)
+	{
+		m_spinCrowd = !m_spinCrowd;
+		std::cout << "Crowd spin: " << (m_spinCrowd ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_L)
+	{
+		m_model.SetLodEnabled(!m_model.IsLodEnabled());
+		std::cout << "Mesh LODs: " << (m_model.IsLodEnabled() ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_M)
+	{
+		m_model.SetMeshletCullingEnabled(!m_model.IsMeshletCullingEnabled());
+		std::cout << "Meshlet culling: " << (m_model.IsMeshletCullingEnabled() ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_O)
+	{
+		m_occlusionQueriesEnabled = !m_occlusionQueriesEnabled;
+		m_occlusionQueries.ResetStats();
+		std::cout << "Occlusion queries: " << (m_occlusionQueriesEnabled ? "on" : "off")
+			<< (m_occlusionQueries.IsConservative() ? " (conservative)" : "") << std::endl;
+	}
+	else if (key == GLFW_KEY_P)
+	{
+		std::cout << "Crowd transforms: " << m_crowd.GetLastUpdateCount() << " of " << m_crowd.Size() << " recomputed last frame" << std::endl;
+		std::cout << "Triangles: " << m_drawStats.triangleCount << " submitted, " << m_drawStats.visibleTriangleCount << " visible after meshlet culling" << std::endl;
+		std::cout << "  meshlets: " << m_drawStats.visibleMeshletCount << " of " << m_drawStats.meshletCount
+			<< " visible, drawn as " << m_drawStats.drawRangeCount << " index ranges" << std::endl;
+		if (m_occlusionQueriesEnabled)
+			PrintOcclusionStats();
+	}
+	else if (key == GLFW_KEY_B && m_benchmarkFrame < 0)
+	{
+		std::cout << "Benchmarking " << m_crowdNodes.size() << " backpacks over " << BENCHMARK_FRAMES << " frames per mode..." << std::endl;
+		m_showCrowd = true;
+		m_model.SetLodEnabled(false);
+		m_occlusionQueriesEnabled = false;
+		m_drawTimer.Reset();
+		m_benchmarkMode = 0;
+		m_benchmarkFrame = 0;
+	}
+}
+
+void ModelScene::SetupCrowd()
+{
+	// rows run from right behind the center backpack out to the far plane, around a root that can spin them
+	m_crowdRoot = m_crowd.AddNode(TransformHierarchy::NO_PARENT, glm::vec3(0.0f, 0.0f, -6.0f - 0.5f * (CROWD_ROWS - 1) * 3.0f));
+	for (int row = 0; row < CROWD_ROWS; row++)
+	{
+		for (int column = 0; column < CROWD_COLUMNS; column++)
+		{
+			glm::vec3 position((column - 0.5f * (CROWD_COLUMNS - 1)) * 4.0f, 0.0f, (0.5f * (CROWD_ROWS - 1) - row) * 3.0f);
+			glm::quat rotation = glm::angleAxis(glm::radians((float)(row * 37 + column * 53)), glm::vec3(0.0f, 1.0f, 0.0f));
+			m_crowdNodes.push_back(m_crowd.AddNode(m_crowdRoot, position, rotation));
+		}
+	}
+	m_crowdLods.resize(m_crowdNodes.size());
+}
 
-	m_model.Draw(m_modelShader);
+void ModelScene::DrawCrowd(const Camera& camera)
+{
+	// standing still, the crowd's matrices are never touched again after the first frame
+	if (m_spinCrowd)
+	{
+		float angle = CROWD_SPIN_SPEED * (float)glfwGetTime();
+		m_crowd.SetRotation(m_crowdRoot, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+	m_crowd.Update();
+
+	glm::mat4 viewProj = camera.GetPerspectiveProj() * camera.GetViewMatrix();
+	for (size_t i = 0; i < m_crowdNodes.size(); i++)
+	{
+		const glm::mat4& model = m_crowd.GetWorld(m_crowdNodes[i]);
+		m_modelShader.SetObjectMatrices(model, viewProj * model, TransformBatch::ComputeNormalMatrix(model));
+		m_model.Draw(m_modelShader, camera, model, m_crowdLods[i], m_drawStats, m_occlusionQueriesEnabled ? &m_occlusionQueries : nullptr);
+	}
+}
+
+void ModelScene::PrintOcclusionStats() const
+{
+	// hit rates over every instance, per mesh of the model
+	std::cout << "  occlusion queries: " << m_occlusionQueries.GetPoolSize() << " in the pool, "
+		<< m_occlusionQueries.GetPendingCount() << " waiting for a result" << std::endl;
+	for (unsigned int mesh = 0; mesh < m_model.GetMeshCount(); mesh++)
+	{
+		OcclusionQueryStats total;
+		for (const ModelLodState& instance : m_crowdLods)
+		{
+			if (mesh < instance.occlusionObjects.size())
+			{
+				const OcclusionQueryStats& stats = m_occlusionQueries.GetStats(instance.occlusionObjects[mesh]);
+				total.testCount += stats.testCount;
+				total.hitCount += stats.hitCount;
+			}
+		}
+		std::cout << "  mesh " << mesh << ": " << 100.0f * total.GetHitRate() << "% of " << total.testCount
+			<< " box tests visible" << std::endl;
+	}
+}
+
+void ModelScene::UpdateBenchmark()
+{
+	if (m_benchmarkFrame < 0 || ++m_benchmarkFrame < BENCHMARK_FRAMES)
+		return;
+
+	m_benchmarkResults[m_benchmarkMode] = m_drawTimer.GetAverageMs();
+	m_benchmarkTriangles[m_benchmarkMode] = m_drawStats.visibleTriangleCount;
+	m_drawTimer.Reset();
+	m_benchmarkFrame = 0;
+
+	// each mode adds one technique to the previous one
+	if (++m_benchmarkMode == 1)
+	{
+		m_model.SetLodEnabled(true);
+		return;
+	}
+	if (m_benchmarkMode == 2)
+	{
+		m_occlusionQueriesEnabled = true;
+		m_occlusionQueries.ResetStats();
+		return;
+	}
+
+	OcclusionQueryStats total;
+	for (const ModelLodState& instance : m_crowdLods)
+	{
+		for (int object : instance.occlusionObjects)
+		{
+			total.testCount += m_occlusionQueries.GetStats(object).testCount;
+			total.hitCount += m_occlusionQueries.GetStats(object).hitCount;
+		}
+	}
+
+	// triangles are the ones submitted, occlusion queries only skip them on the GPU
+	std::cout << "Backpack draw GPU time (" << m_crowdNodes.size() + 1 << " backpacks):" << std::endl;
+	for (int mode = 0; mode < 3; mode++)
+		std::cout << "  " << BENCHMARK_MODE_NAMES[mode] << ": " << m_benchmarkResults[mode] << " ms, " << m_benchmarkTriangles[mode] << " triangles" << std::endl;
+	std::cout << "  crowd box tests visible: " << 100.0f * total.GetHitRate() << "%" << std::endl;
+	m_occlusionQueriesEnabled = false;
+	m_benchmarkFrame = -1;
 }
 
 void ModelScene::SetupMaterial(Shader& shader)
@@ -54,22 +234,19 @@ void ModelScene::SetupDirectionalLight(Shader& shader)
 	shader.SetVec3("dirLight.ambient", glm::vec3(0.05f, 0.05f, 0.05f));
 	shader.SetVec3("dirLight.diffuse", glm::vec3(0.4f, 0.4f, 0.4f));
 	shader.SetVec3("dirLight.specular", glm::vec3(0.5f, 0.5f, 0.5f));
+
+	// no shadows here, the sampler still needs its own unit since its type differs from the material array
+	shader.SetBool("shadowsEnabled", false);
+	shader.SetInt("shadowMap", CascadedShadowMap::TEXTURE_UNIT);
 }
 
 void ModelScene::SetupPointLights(Shader& shader)
 {
-	glm::vec3 pointLightPositions[] = {
-		glm::vec3(0.7f, 0.2f, 2.0f),
-		glm::vec3(2.3f, -3.3f, -4.0f),
-		glm::vec3(-4.0f, 2.0f, -12.0f),
-		glm::vec3(0.0f, 0.0f, -3.0f)
-	};
-
 	shader.Use();
 	for (int i = 0; i < 4; i++)
 	{
 		std::string indexStr = std::to_string(i);
-		shader.SetVec3("pointLights[" + indexStr + "].position", pointLightPositions[i]);
+		shader.SetVec3("pointLights[" + indexStr + "].position", m_sourceLightPositions[i]);
 
 		shader.SetVec3("pointLights[" + indexStr + "].ambient", glm::vec3(0.1f, 0.1f, 0.1f));
 		shader.SetVec3("pointLights[" + indexStr + "].diffuse", glm::vec3(0.8f, 0.8f, 0.8f));
@@ -79,6 +256,16 @@ void ModelScene::SetupPointLights(Shader& shader)
 		shader.SetFloat("pointLights[" + indexStr + "].linear", 0.09f);
 		shader.SetFloat("pointLights[" + indexStr + "].quadratic", 0.032f);
 	}
+
+	// no point shadows either, their samplers get their own units too
+	for (int i = 0; i < 4; i++)
+	{
+		shader.SetInt("pointShadowSlots[" + std::to_string(i) + "]", -1);
+	}
+	for (int i = 0; i < PointShadowMaps::MAX_SHADOWED_LIGHTS; i++)
+	{
+		shader.SetInt("pointShadowMaps[" + std::to_string(i) + "]", PointShadowMaps::FIRST_TEXTURE_UNIT + i);
+	}
 }
 
 void ModelScene::UpdateSpotLight(Shader& shader, const Camera& camera)
@@ -0,0 +1,118 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+
+OcclusionCuller::OcclusionCuller()
+{
+}
+
+void OcclusionCuller::Setup(const std::vector<glm::vec4>& spheres)
+{
+	m_testShader.LoadShader(".\\shaders\\hiz_test.vs", ".\\shaders\\hiz_test.fs");
+	m_objectCount = spheres.size();
+	m_height = std::max(1, (int)((m_objectCount + VISIBILITY_WIDTH - 1) / VISIBILITY_WIDTH));
+
+	glGenVertexArrays(1, &m_pointVAO);
+	glGenBuffers(1, &m_pointVBO);
+	glBindVertexArray(m_pointVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_pointVBO);
+	glBufferData(GL_ARRAY_BUFFER, spheres.size() * sizeof(glm::vec4), spheres.empty() ? NULL : &spheres[0], GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+	glBindVertexArray(0);
+
+	glGenTextures(2, m_textures);
+	glGenFramebuffers(2, m_framebuffers);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, VISIBILITY_WIDTH, m_height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textures[i], 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::FRAMEBUFFER:: Visibility framebuffer is not complete!" << std::endl;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	ResetVisibility();
+}
+
+void OcclusionCuller::ResetVisibility()
+{
+	const float visible[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int i = 0; i < 2; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[i]);
+		glClearBufferfv(GL_COLOR, 0, visible);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OcclusionCuller::Test(const HiZBuffer& hiZ, const glm::mat4& viewProj)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[m_current]);
+	glViewport(0, 0, VISIBILITY_WIDTH, m_height);
+	glDisable(GL_DEPTH_TEST);
+
+	m_testShader.Use();
+	m_testShader.SetMat4("viewProj", viewProj);
+	m_testShader.SetInt("hiZ", 0);
+	m_testShader.SetInt("mipCount", hiZ.GetMipCount());
+	m_testShader.SetInt("outputWidth", VISIBILITY_WIDTH);
+	m_testShader.SetVec2("outputSize", glm::vec2(VISIBILITY_WIDTH, m_height));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hiZ.GetTexture());
+
+	// every object lands on its own texel, nothing else needs clearing
+	glBindVertexArray(m_pointVAO);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)m_objectCount);
+	glBindVertexArray(0);
+
+	glEnable(GL_DEPTH_TEST);
+}
+
+void OcclusionCuller::Bind(Shader& shader, int firstUnit) const
+{
+	shader.SetInt("previousVisibility", firstUnit);
+	shader.SetInt("currentVisibility", firstUnit + 1);
+	shader.SetInt("visibilityWidth", VISIBILITY_WIDTH);
+
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_2D, m_textures[1 - m_current]);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, m_textures[m_current]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void OcclusionCuller::SetVisibility(const std::vector<unsigned char>& visibility)
+{
+	std::vector<unsigned char> texels((size_t)VISIBILITY_WIDTH * m_height, 0);
+	for (size_t i = 0; i < m_objectCount && i < visibility.size(); i++)
+		texels[i] = visibility[i] ? 255 : 0;
+
+	glBindTexture(GL_TEXTURE_2D, m_textures[1 - m_current]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VISIBILITY_WIDTH, m_height, GL_RED, GL_UNSIGNED_BYTE, &texels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+unsigned int OcclusionCuller::CountVisible() const
+{
+	std::vector<unsigned char> visibility((size_t)VISIBILITY_WIDTH * m_height);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffers[1 - m_current]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, VISIBILITY_WIDTH, m_height, GL_RED, GL_UNSIGNED_BYTE, &visibility[0]);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	unsigned int count = 0;
+	for (size_t i = 0; i < m_objectCount; i++)
+	{
+		if (visibility[i] > 127)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,171 @@
+#include "OcclusionQueryManager.h"
+#include <VertexArrayInitializer.h>
+#include <GLExtensions.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+// GL 4.3 / GL_ARB_ES3_compatibility, glad only knows the 3.3 enums
+#ifndef GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#endif
+
+namespace
+{
+	// how far around the box, as a fraction of its size, the camera counts as inside it; the near plane
+	// clips the faces before the camera actually gets in
+	const float INSIDE_MARGIN = 0.1f;
+}
+
+OcclusionQueryManager::OcclusionQueryManager()
+{
+}
+
+void OcclusionQueryManager::Setup()
+{
+	m_proxyShader.LoadShader(".\\shaders\\occlusion_proxy.vs", ".\\shaders\\shadow_depth.fs");
+	VertexArrayInitializer::SetupCube(m_cubeVAO);
+
+	// the conservative query may answer visible for a box that is just hidden, never the other way
+	// around, and lets the driver skip the exact per-sample test
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool conservative = major > 4 || (major == 4 && minor >= 3) || GLExtensions::HasExtension("GL_ARB_ES3_compatibility");
+	m_target = conservative ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+}
+
+int OcclusionQueryManager::AddObject(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	ObjectState object;
+	object.boxTransform = glm::scale(glm::translate(glm::mat4(1.0f), 0.5f * (boxMin + boxMax)), boxMax - boxMin);
+	m_objects.push_back(object);
+	return (int)m_objects.size() - 1;
+}
+
+void OcclusionQueryManager::BeginConditionalRender(int object, const glm::vec3& localCamera)
+{
+	// a query older than the last frame says nothing about what the camera sees now
+	const ObjectState& state = m_objects[object];
+	if (state.query == 0 || state.queryFrame + 1 < m_frame)
+		return;
+
+	glm::vec3 boxCenter = glm::vec3(state.boxTransform[3]);
+	glm::vec3 halfSize = glm::vec3(state.boxTransform[0][0], state.boxTransform[1][1], state.boxTransform[2][2]) * (0.5f + INSIDE_MARGIN);
+	if (glm::all(glm::lessThanEqual(glm::abs(localCamera - boxCenter), halfSize)))
+		return;
+
+	// with NO_WAIT a result that isn't there yet draws the object, the GPU doesn't stall either
+	glBeginConditionalRender(state.query, GL_QUERY_NO_WAIT);
+	m_conditionalActive = true;
+}
+
+void OcclusionQueryManager::EndConditionalRender()
+{
+	if (!m_conditionalActive)
+		return;
+
+	glEndConditionalRender();
+	m_conditionalActive = false;
+}
+
+void OcclusionQueryManager::QueueTest(int object, const glm::mat4& model)
+{
+	ObjectState& state = m_objects[object];
+	state.model = model;
+	if (!state.queued)
+	{
+		state.queued = true;
+		m_queued.push_back(object);
+	}
+}
+
+void OcclusionQueryManager::IssueQueries(const glm::mat4& viewProj)
+{
+	if (!m_queued.empty())
+	{
+		// tested against the scene's depth, without touching it: a box must not hide what's behind it
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_FALSE);
+		m_proxyShader.Use();
+		glBindVertexArray(m_cubeVAO);
+
+		for (int object : m_queued)
+		{
+			ObjectState& state = m_objects[object];
+			state.queued = false;
+
+			// the query it replaces goes back to the pool once its result has been read
+			if (state.query != 0 && state.queryCollected)
+				m_freeQueries.push_back(state.query);
+			state.query = AcquireQuery();
+			state.queryCollected = false;
+			state.queryFrame = m_frame;
+
+			m_proxyShader.SetMat4("mvp", viewProj * state.model * state.boxTransform);
+			glBeginQuery(m_target, state.query);
+			glDrawArrays(GL_TRIANGLES, 0, 36);
+			glEndQuery(m_target);
+
+			PendingQuery pending;
+			pending.query = state.query;
+			pending.object = object;
+			m_pending.push_back(pending);
+		}
+		m_queued.clear();
+
+		glBindVertexArray(0);
+		glDepthMask(GL_TRUE);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+	m_frame++;
+	CollectResults();
+}
+
+void OcclusionQueryManager::ResetStats()
+{
+	for (ObjectState& object : m_objects)
+		object.stats = OcclusionQueryStats();
+}
+
+unsigned int OcclusionQueryManager::AcquireQuery()
+{
+	if (m_freeQueries.empty())
+	{
+		unsigned int query = 0;
+		glGenQueries(1, &query);
+		m_queryCount++;
+		return query;
+	}
+
+	unsigned int query = m_freeQueries.back();
+	m_freeQueries.pop_back();
+	return query;
+}
+
+void OcclusionQueryManager::CollectResults()
+{
+	// queries finish in the order they were issued, the first one not ready ends the loop
+	while (!m_pending.empty())
+	{
+		const PendingQuery& pending = m_pending.front();
+		GLuint available = 0;
+		glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+
+		GLuint passed = 0;
+		glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT, &passed);
+
+		ObjectState& object = m_objects[pending.object];
+		object.stats.testCount++;
+		if (passed)
+			object.stats.hitCount++;
+
+		// the object's latest query stays out of the pool, the next frame's conditional render reads it
+		if (object.query == pending.query)
+			object.queryCollected = true;
+		else
+			m_freeQueries.push_back(pending.query);
+		m_pending.pop_front();
+	}
+}
@@ -0,0 +1,278 @@
+#include "OcclusionRasterizer.h"
+#include <JobSystem.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define OCCLUSION_RASTERIZER_SSE
+#endif
+
+namespace
+{
+	// corners of the unit cube, bit 0 picks +x, bit 1 +y and bit 2 +z
+	const glm::vec3 BOX_CORNERS[8] = {
+		glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f),
+		glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f)
+	};
+
+	const unsigned int BOX_INDICES[36] = {
+		0, 2, 3, 0, 3, 1,	// -z
+		4, 5, 7, 4, 7, 6,	// +z
+		0, 4, 6, 0, 6, 2,	// -x
+		1, 3, 7, 1, 7, 5,	// +x
+		0, 1, 5, 0, 5, 4,	// -y
+		2, 6, 7, 2, 7, 3	// +y
+	};
+
+	// w below this counts as behind the camera
+	const float MIN_W = 1e-5f;
+}
+
+OcclusionRasterizer::OcclusionRasterizer()
+{
+}
+
+void OcclusionRasterizer::Setup(int width, int height)
+{
+	m_width = (width + TILE_WIDTH - 1) / TILE_WIDTH * TILE_WIDTH;
+	m_height = height;
+	m_tilesX = m_width / TILE_WIDTH;
+	m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	m_depth.assign((size_t)m_width * m_height, 1.0f);
+	m_bins.assign((size_t)m_tilesX * m_tilesY, std::vector<unsigned int>());
+}
+
+void OcclusionRasterizer::BeginFrame(const glm::mat4& viewProj)
+{
+	m_viewProj = viewProj;
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	m_triangles.clear();
+	for (std::vector<unsigned int>& bin : m_bins)
+		bin.clear();
+}
+
+void OcclusionRasterizer::AddOccluder(const glm::vec3* positions, const unsigned int* indices, size_t indexCount, const glm::mat4& model)
+{
+	glm::mat4 mvp = m_viewProj * model;
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		glm::vec4 clip[3];
+		for (int k = 0; k < 3; k++)
+			clip[k] = mvp * glm::vec4(positions[indices[i + k]], 1.0f);
+		AddClippedTriangle(clip);
+	}
+}
+
+void OcclusionRasterizer::AddBoxOccluder(const glm::mat4& model)
+{
+	AddOccluder(BOX_CORNERS, BOX_INDICES, 36, model);
+}
+
+void OcclusionRasterizer::AddClippedTriangle(const glm::vec4* clip)
+{
+	// near plane (z >= -w) clipping, a triangle becomes at most a quad
+	glm::vec4 polygon[4];
+	int count = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		const glm::vec4& a = clip[k];
+		const glm::vec4& b = clip[(k + 1) % 3];
+		float da = a.z + a.w;
+		float db = b.z + b.w;
+		if (da >= 0.0f)
+			polygon[count++] = a;
+		if ((da >= 0.0f) != (db >= 0.0f))
+			polygon[count++] = a + (b - a) * (da / (da - db));
+	}
+
+	for (int k = 1; k + 1 < count; k++)
+	{
+		SetupTriangle(polygon[0], polygon[k], polygon[k + 1]);
+	}
+}
+
+void OcclusionRasterizer::SetupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+	if (v0.w < MIN_W || v1.w < MIN_W || v2.w < MIN_W)
+		return;
+
+	// window coordinates, y up like GL so counter-clockwise triangles have a positive area
+	glm::vec3 p[3];
+	const glm::vec4* clip[3] = { &v0, &v1, &v2 };
+	for (int k = 0; k < 3; k++)
+	{
+		glm::vec3 ndc = glm::vec3(*clip[k]) / clip[k]->w;
+		p[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+	}
+
+	float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+	if (area <= 0.0f)
+		return;
+
+	RasterTriangle triangle;
+	triangle.minX = std::max(0, (int)std::floor(std::min(p[0].x, std::min(p[1].x, p[2].x))));
+	triangle.minY = std::max(0, (int)std::floor(std::min(p[0].y, std::min(p[1].y, p[2].y))));
+	triangle.maxX = std::min(m_width - 1, (int)std::floor(std::max(p[0].x, std::max(p[1].x, p[2].x))));
+	triangle.maxY = std::min(m_height - 1, (int)std::floor(std::max(p[0].y, std::max(p[1].y, p[2].y))));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	for (int k = 0; k < 3; k++)
+	{
+		const glm::vec3& a = p[k];
+		const glm::vec3& b = p[(k + 1) % 3];
+		triangle.edgeA[k] = a.y - b.y;
+		triangle.edgeB[k] = b.x - a.x;
+		triangle.edgeC[k] = -(triangle.edgeA[k] * a.x + triangle.edgeB[k] * a.y);
+	}
+
+	// depth is affine in window space once divided by w
+	glm::vec3 d1 = p[1] - p[0];
+	glm::vec3 d2 = p[2] - p[0];
+	triangle.depthA = (d1.z * d2.y - d1.y * d2.z) / area;
+	triangle.depthB = (d1.x * d2.z - d1.z * d2.x) / area;
+	triangle.depthC = p[0].z - triangle.depthA * p[0].x - triangle.depthB * p[0].y;
+
+	unsigned int index = (unsigned int)m_triangles.size();
+	m_triangles.push_back(triangle);
+	for (int ty = triangle.minY / TILE_HEIGHT; ty <= triangle.maxY / TILE_HEIGHT; ty++)
+	{
+		for (int tx = triangle.minX / TILE_WIDTH; tx <= triangle.maxX / TILE_WIDTH; tx++)
+			m_bins[ty * m_tilesX + tx].push_back(index);
+	}
+}
+
+void OcclusionRasterizer::Rasterize()
+{
+	// tiles don't overlap, whoever takes one owns its pixels; their cost varies a lot so each is a job
+	JobSystem::ParallelFor((size_t)m_tilesX * m_tilesY, 1, [this](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; tile++)
+			RasterizeTile((int)tile);
+	});
+}
+
+void OcclusionRasterizer::RasterizeTile(int tile)
+{
+	int tileX = (tile % m_tilesX) * TILE_WIDTH;
+	int tileY = (tile / m_tilesX) * TILE_HEIGHT;
+	int tileMaxX = tileX + TILE_WIDTH - 1;
+	int tileMaxY = std::min(tileY + TILE_HEIGHT, m_height) - 1;
+
+	for (unsigned int index : m_bins[tile])
+	{
+		const RasterTriangle& triangle = m_triangles[index];
+		// groups of four pixels start on a multiple of four, the tile width is one too
+		int minX = std::max(triangle.minX, tileX) & ~3;
+		int maxX = std::min(triangle.maxX, tileMaxX);
+		int minY = std::max(triangle.minY, tileY);
+		int maxY = std::min(triangle.maxY, tileMaxY);
+
+#ifdef OCCLUSION_RASTERIZER_SSE
+		const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+		__m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+		__m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+		__m128 depthA = _mm_set1_ps(triangle.depthA);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float pixelY = y + 0.5f;
+			__m128 rowEdge0 = _mm_set1_ps(triangle.edgeB[0] * pixelY + triangle.edgeC[0]);
+			__m128 rowEdge1 = _mm_set1_ps(triangle.edgeB[1] * pixelY + triangle.edgeC[1]);
+			__m128 rowEdge2 = _mm_set1_ps(triangle.edgeB[2] * pixelY + triangle.edgeC[2]);
+			__m128 rowDepth = _mm_set1_ps(triangle.depthB * pixelY + triangle.depthC);
+			float* row = &m_depth[(size_t)y * m_width];
+
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), pixelOffsets);
+				__m128 inside = _mm_and_ps(
+					_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowEdge0), zero),
+					_mm_and_ps(
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowEdge1), zero),
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowEdge2), zero)));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 depth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth);
+				__m128 previous = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(previous, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+			}
+		}
+#else
+		for (int y = minY; y <= maxY; y++)
+		{
+			float pixelY = y + 0.5f;
+			float* row = &m_depth[(size_t)y * m_width];
+			for (int x = minX; x <= maxX; x++)
+			{
+				float pixelX = x + 0.5f;
+				bool inside = true;
+				for (int k = 0; k < 3; k++)
+					inside = inside && triangle.edgeA[k] * pixelX + triangle.edgeB[k] * pixelY + triangle.edgeC[k] >= 0.0f;
+				if (inside)
+					row[x] = std::min(row[x], triangle.depthA * pixelX + triangle.depthB * pixelY + triangle.depthC);
+			}
+		}
+#endif
+	}
+}
+
+bool OcclusionRasterizer::IsVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	glm::vec2 minScreen(FLT_MAX), maxScreen(-FLT_MAX);
+	float nearest = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+		glm::vec4 clip = m_viewProj * glm::vec4(corner, 1.0f);
+
+		// reaching behind the near plane, there's no rectangle to test
+		if (clip.w < MIN_W || clip.z < -clip.w)
+			return true;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height);
+		minScreen = glm::min(minScreen, screen);
+		maxScreen = glm::max(maxScreen, screen);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+
+	// outside the frustum
+	if (maxScreen.x < 0.0f || maxScreen.y < 0.0f || minScreen.x >= m_width || minScreen.y >= m_height || nearest > 1.0f)
+		return false;
+
+	int minX = std::max(0, (int)minScreen.x) & ~3;
+	int maxX = std::min(m_width - 1, (int)maxScreen.x);
+	int minY = std::max(0, (int)minScreen.y);
+	int maxY = std::min(m_height - 1, (int)maxScreen.y);
+
+#ifdef OCCLUSION_RASTERIZER_SSE
+	__m128 boxDepth = _mm_set1_ps(nearest);
+	for (int y = minY; y <= maxY; y++)
+	{
+		const float* row = &m_depth[(size_t)y * m_width];
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0)
+				return true;
+		}
+	}
+#else
+	for (int y = minY; y <= maxY; y++)
+	{
+		const float* row = &m_depth[(size_t)y * m_width];
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (row[x] >= nearest)
+				return true;
+		}
+	}
+#endif
+	return false;
+}
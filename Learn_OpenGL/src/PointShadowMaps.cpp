@@ -0,0 +1,149 @@
+#include "PointShadowMaps.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <string>
+
+namespace
+{
+	// face order and up vectors of GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+	const glm::vec3 faceDirections[PointShadowMaps::FACE_COUNT] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 faceUps[PointShadowMaps::FACE_COUNT] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+PointShadowMaps::PointShadowMaps()
+{
+}
+
+void PointShadowMaps::Setup(int resolution, float farPlane, float maxViewDistance)
+{
+	m_resolution = resolution;
+	m_farPlane = farPlane;
+	m_maxViewDistance = maxViewDistance;
+	m_projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, farPlane);
+
+	glGenTextures(MAX_SHADOWED_LIGHTS, m_cubemaps);
+	for (int slot = 0; slot < MAX_SHADOWED_LIGHTS; slot++)
+	{
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemaps[slot]);
+		for (int face = 0; face < FACE_COUNT; face++)
+		{
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 0,
+				GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		}
+		// the depth holds the distance to the light, compared in hardware against the fragment's
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	}
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cubemaps[0], 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Point shadow framebuffer is not complete!" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadowMaps::AssignSlots(const std::vector<glm::vec3>& lightPositions, const glm::vec3& viewPosition)
+{
+	std::vector<std::pair<float, int>> candidates;
+	for (size_t i = 0; i < lightPositions.size(); i++)
+	{
+		float distance = glm::length(lightPositions[i] - viewPosition);
+		if (distance <= m_maxViewDistance)
+			candidates.push_back(std::make_pair(distance, (int)i));
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	m_slotCount = std::min((int)candidates.size(), MAX_SHADOWED_LIGHTS);
+	for (int slot = 0; slot < m_slotCount; slot++)
+	{
+		m_slotLights[slot] = candidates[slot].second;
+		m_slotPositions[slot] = lightPositions[candidates[slot].second];
+	}
+}
+
+void PointShadowMaps::BeginPass(int slot, Shader& depthShader)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cubemaps[slot], 0);
+	glViewport(0, 0, m_resolution, m_resolution);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	const glm::vec3& position = m_slotPositions[slot];
+	depthShader.Use();
+	depthShader.SetVec3("lightPos", position);
+	depthShader.SetFloat("farPlane", m_farPlane);
+	for (int face = 0; face < FACE_COUNT; face++)
+	{
+		glm::mat4 view = glm::lookAt(position, position + faceDirections[face], faceUps[face]);
+		depthShader.SetMat4("faceViewProj[" + std::to_string(face) + "]", m_projection * view);
+	}
+}
+
+int PointShadowMaps::GetFaceMask(int slot, const glm::vec3& center, float radius) const
+{
+	const glm::vec3 toCenter = center - m_slotPositions[slot];
+	if (glm::length(toCenter) - radius > m_farPlane)
+		return 0;
+
+	// a face sees the 90 degree pyramid around its axis, bounded by four planes through the light
+	int mask = 0;
+	for (int face = 0; face < FACE_COUNT; face++)
+	{
+		const glm::vec3& axis = faceDirections[face];
+		const glm::vec3 u = faceUps[face];
+		const glm::vec3 v = glm::cross(axis, u);
+		const glm::vec3 normals[4] = { axis + u, axis - u, axis + v, axis - v };
+
+		bool inside = true;
+		for (const glm::vec3& normal : normals)
+		{
+			if (glm::dot(toCenter, normal) < -radius * glm::length(normal))
+			{
+				inside = false;
+				break;
+			}
+		}
+		if (inside)
+			mask |= 1 << face;
+	}
+	return mask;
+}
+
+void PointShadowMaps::EndPass()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadowMaps::Bind(Shader& shader, int lightCount) const
+{
+	shader.Use();
+	shader.SetFloat("pointShadowFar", m_farPlane);
+	for (int light = 0; light < lightCount; light++)
+		shader.SetInt("pointShadowSlots[" + std::to_string(light) + "]", -1);
+
+	for (int slot = 0; slot < MAX_SHADOWED_LIGHTS; slot++)
+	{
+		shader.SetInt("pointShadowMaps[" + std::to_string(slot) + "]", FIRST_TEXTURE_UNIT + slot);
+		glActiveTexture(GL_TEXTURE0 + FIRST_TEXTURE_UNIT + slot);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemaps[slot]);
+		if (slot < m_slotCount)
+			shader.SetInt("pointShadowSlots[" + std::to_string(m_slotLights[slot]) + "]", slot);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,210 @@
+#include "PostProcessStack.h"
+#include <VertexArrayInitializer.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const int MAX_BLUR_TAPS = PostProcessStack::MAX_BLUR_RADIUS / 2 + 1;
+
+	const float sharpenKernel[9] = {
+		-1.0f, -1.0f, -1.0f,
+		-1.0f,  9.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f
+	};
+
+	const float edgeDetectionKernel[9] = {
+		1.0f,  1.0f, 1.0f,
+		1.0f, -8.0f, 1.0f,
+		1.0f,  1.0f, 1.0f
+	};
+
+	const float identityKernel[9] = {
+		0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f
+	};
+}
+
+PostProcessStack::PostProcessStack()
+{
+}
+
+void PostProcessStack::Setup()
+{
+	m_blurShader.LoadShader(".\\shaders\\framebuffers_screen.vs", ".\\shaders\\post_blur.fs");
+	m_kernelShader.LoadShader(".\\shaders\\framebuffers_screen.vs", ".\\shaders\\post_kernel.fs");
+	m_grayscaleShader.LoadShader(".\\shaders\\framebuffers_screen.vs", ".\\shaders\\post_grayscale.fs");
+
+	m_blurShader.Use();
+	m_blurShader.SetInt("screenTexture", 0);
+	m_kernelShader.Use();
+	m_kernelShader.SetInt("screenTexture", 0);
+	m_grayscaleShader.Use();
+	m_grayscaleShader.SetInt("screenTexture", 0);
+
+	VertexArrayInitializer::SetupScreenQuad(m_quadVAO);
+}
+
+void PostProcessStack::AddEffect(PostEffectType type, float radius)
+{
+	PostEffect effect;
+	effect.type = type;
+	effect.radius = radius;
+	m_effects.push_back(effect);
+}
+
+const char* PostProcessStack::GetEffectName(PostEffectType type)
+{
+	switch (type)
+	{
+	case PostEffectType::GAUSSIAN_BLUR:
+		return "Gaussian blur";
+	case PostEffectType::EDGE_DETECT:
+		return "Edge detect";
+	case PostEffectType::GRAYSCALE:
+		return "Grayscale";
+	case PostEffectType::SHARPEN:
+		return "Sharpen";
+	}
+	return "Unknown";
+}
+
+void PostProcessStack::PrintEffects() const
+{
+	std::cout << "Post-processing:";
+	bool any = false;
+	for (const PostEffect& effect : m_effects)
+	{
+		if (!effect.enabled)
+			continue;
+		std::cout << (any ? " -> " : " ") << GetEffectName(effect.type);
+		if (effect.type == PostEffectType::GAUSSIAN_BLUR)
+			std::cout << " (radius " << effect.radius << ")";
+		any = true;
+	}
+	std::cout << (any ? "" : " none") << std::endl;
+}
+
+void PostProcessStack::Apply(unsigned int sourceTexture, int width, int height, unsigned int targetFramebuffer)
+{
+	// a blur is two 1D passes, the other effects are a single pass
+	std::vector<Pass> passes;
+	for (const PostEffect& effect : m_effects)
+	{
+		if (!effect.enabled)
+			continue;
+
+		switch (effect.type)
+		{
+		case PostEffectType::GAUSSIAN_BLUR:
+			passes.push_back({ &m_blurShader, effect.radius, false, nullptr });
+			passes.push_back({ &m_blurShader, effect.radius, true, nullptr });
+			break;
+		case PostEffectType::EDGE_DETECT:
+			passes.push_back({ &m_kernelShader, 0.0f, false, edgeDetectionKernel });
+			break;
+		case PostEffectType::SHARPEN:
+			passes.push_back({ &m_kernelShader, 0.0f, false, sharpenKernel });
+			break;
+		case PostEffectType::GRAYSCALE:
+			passes.push_back({ &m_grayscaleShader, 0.0f, false, nullptr });
+			break;
+		}
+	}
+
+	// nothing enabled, still copy the frame to the destination
+	if (passes.empty())
+		passes.push_back({ &m_kernelShader, 0.0f, false, identityKernel });
+
+	// a resize would otherwise leave the targets of every previous size in the pool
+	if (width != m_width || height != m_height)
+	{
+		m_targetPool.Clear();
+		m_width = width;
+		m_height = height;
+	}
+
+	// intermediate targets are only needed between passes, a single pass writes straight to the destination
+	RenderTarget pingPong[2];
+	if (passes.size() > 1)
+		pingPong[0] = m_targetPool.Acquire(width, height);
+	if (passes.size() > 2)
+		pingPong[1] = m_targetPool.Acquire(width, height);
+
+	glDisable(GL_DEPTH_TEST);
+	glViewport(0, 0, width, height);
+	glBindVertexArray(m_quadVAO);
+	glActiveTexture(GL_TEXTURE0);
+
+	unsigned int input = sourceTexture;
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		const bool lastPass = i + 1 == passes.size();
+		const RenderTarget& output = pingPong[i % 2];
+
+		glBindFramebuffer(GL_FRAMEBUFFER, lastPass ? targetFramebuffer : output.framebuffer);
+		SetupPass(passes[i], width, height);
+		glBindTexture(GL_TEXTURE_2D, input);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		input = output.texture;
+	}
+
+	m_targetPool.Release(pingPong[0]);
+	m_targetPool.Release(pingPong[1]);
+}
+
+void PostProcessStack::SetupPass(const Pass& pass, int width, int height)
+{
+	pass.shader->Use();
+	if (pass.shader == &m_blurShader)
+	{
+		SetBlurRadius(pass.radius);
+		m_blurShader.SetVec2("direction", pass.vertical ? glm::vec2(0.0f, 1.0f / height) : glm::vec2(1.0f / width, 0.0f));
+	}
+	else if (pass.kernel != nullptr)
+	{
+		pass.shader->SetFloatArray("kernel", pass.kernel, 9);
+	}
+}
+
+void PostProcessStack::SetBlurRadius(float radius)
+{
+	radius = std::min(std::max(radius, 1.0f), (float)MAX_BLUR_RADIUS);
+	// uniforms stay on the program, only rebuild the taps when the radius changes
+	if (radius == m_blurRadius)
+		return;
+	m_blurRadius = radius;
+
+	// discrete gaussian over [-radius, radius] with the radius at 3 sigma
+	const int texelRadius = (int)std::ceil(radius);
+	const float sigma = radius / 3.0f;
+	std::vector<float> texelWeights(texelRadius + 1);
+	float total = 0.0f;
+	for (int i = 0; i <= texelRadius; i++)
+	{
+		texelWeights[i] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += i == 0 ? texelWeights[i] : 2.0f * texelWeights[i];
+	}
+
+	// merge texel pairs (1,2), (3,4)... into one bilinear fetch placed at their weighted center
+	float offsets[MAX_BLUR_TAPS];
+	float weights[MAX_BLUR_TAPS];
+	offsets[0] = 0.0f;
+	weights[0] = texelWeights[0] / total;
+	int tapCount = 1;
+	for (int i = 1; i <= texelRadius; i += 2)
+	{
+		const float weightA = texelWeights[i];
+		const float weightB = i + 1 <= texelRadius ? texelWeights[i + 1] : 0.0f;
+		const float weight = weightA + weightB;
+		offsets[tapCount] = (i * weightA + (i + 1) * weightB) / weight;
+		weights[tapCount] = weight / total;
+		tapCount++;
+	}
+
+	m_blurShader.SetInt("tapCount", tapCount);
+	m_blurShader.SetFloatArray("offsets", offsets, tapCount);
+	m_blurShader.SetFloatArray("weights", weights, tapCount);
+}
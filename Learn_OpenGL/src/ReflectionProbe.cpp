@@ -0,0 +1,101 @@
+#include "ReflectionProbe.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <string>
+
+ReflectionProbe::ReflectionProbe()
+{
+}
+
+void ReflectionProbe::Setup(const glm::vec3& position, int size)
+{
+	m_position = position;
+	m_size = size;
+
+	// face order and up vectors of GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+	const glm::vec3 directions[FACE_COUNT] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 ups[FACE_COUNT] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+	for (int i = 0; i < FACE_COUNT; i++)
+		m_faceViewProj[i] = projection * glm::lookAt(position, position + directions[i], ups[i]);
+
+	m_cubemaps[0] = CreateCubemap(size, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE);
+	m_cubemaps[1] = CreateCubemap(size, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE);
+	m_depthCubemap = CreateCubemap(size, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+
+	// whole cubemaps are attached, gl_Layer picks the face
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_cubemaps[1 - m_front], 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthCubemap, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Reflection probe framebuffer is not complete!" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ReflectionProbe::SetFaceBudget(int budget)
+{
+	m_faceBudget = std::min(std::max(budget, 1), FACE_COUNT);
+}
+
+void ReflectionProbe::Begin(Shader& layeredShader)
+{
+	// a cycle always ends on the last face so the swap happens on complete cubes
+	m_facesThisFrame = m_initialized ? std::min(m_faceBudget, FACE_COUNT - m_nextFace) : FACE_COUNT;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_size, m_size);
+	// clearing a layered framebuffer clears every face, so only the depth is cleared: the caller draws
+	// the skybox first which overwrites the color of the faces being rendered and leaves the others intact
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	layeredShader.Use();
+	layeredShader.SetInt("faceCount", m_facesThisFrame);
+	for (int i = 0; i < m_facesThisFrame; i++)
+	{
+		int face = m_nextFace + i;
+		layeredShader.SetInt("faces[" + std::to_string(i) + "]", face);
+		layeredShader.SetMat4("faceViewProj[" + std::to_string(i) + "]", m_faceViewProj[face]);
+	}
+}
+
+void ReflectionProbe::End()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_nextFace += m_facesThisFrame;
+	if (m_nextFace < FACE_COUNT)
+		return;
+
+	// the back cubemap is complete, shade with it and start filling the other one
+	m_nextFace = 0;
+	m_initialized = true;
+	m_front = 1 - m_front;
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_cubemaps[1 - m_front], 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+unsigned int ReflectionProbe::CreateCubemap(int size, GLenum internalFormat, GLenum format, GLenum type)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	for (int i = 0; i < FACE_COUNT; i++)
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, size, size, 0, format, type, NULL);
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	return textureID;
+}
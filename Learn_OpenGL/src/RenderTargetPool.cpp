@@ -0,0 +1,59 @@
+#include "RenderTargetPool.h"
+#include <iostream>
+
+RenderTarget RenderTargetPool::Acquire(int width, int height, GLenum internalFormat)
+{
+	for (size_t i = 0; i < m_freeTargets.size(); i++)
+	{
+		const RenderTarget& target = m_freeTargets[i];
+		if (target.width == width && target.height == height && target.internalFormat == internalFormat)
+		{
+			RenderTarget found = target;
+			m_freeTargets.erase(m_freeTargets.begin() + i);
+			return found;
+		}
+	}
+	return Create(width, height, internalFormat);
+}
+
+void RenderTargetPool::Release(const RenderTarget& target)
+{
+	if (target.framebuffer != 0)
+		m_freeTargets.push_back(target);
+}
+
+void RenderTargetPool::Clear()
+{
+	for (const RenderTarget& target : m_freeTargets)
+	{
+		glDeleteFramebuffers(1, &target.framebuffer);
+		glDeleteTextures(1, &target.texture);
+	}
+	m_freeTargets.clear();
+}
+
+RenderTarget RenderTargetPool::Create(int width, int height, GLenum internalFormat)
+{
+	RenderTarget target;
+	target.width = width;
+	target.height = height;
+	target.internalFormat = internalFormat;
+
+	glGenTextures(1, &target.texture);
+	glBindTexture(GL_TEXTURE_2D, target.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	// linear filtering is what lets the blur read two texels with a single fetch
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &target.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Render target is not complete!" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return target;
+}
@@ -0,0 +1,426 @@
+#include "SceneFile.h"
+#include <VirtualFileSystem.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	const char SCENE_MAGIC[4] = { 'S', 'C', 'N', 'E' };
+
+	struct SceneFileHeader
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned int meshCount;
+		unsigned int materialCount;
+		unsigned int entityCount;
+		unsigned int lightCount;
+		unsigned int cameraCount;
+		unsigned int stringsSize;
+	};
+
+	template<typename T>
+	void AppendTable(std::vector<unsigned char>& bytes, const std::vector<T>& table)
+	{
+		if (!table.empty())
+			bytes.insert(bytes.end(), (const unsigned char*)&table[0], (const unsigned char*)&table[0] + table.size() * sizeof(T));
+	}
+
+	// points table at count records and moves past them, false when the file is too short
+	template<typename T>
+	bool TakeTable(const unsigned char* data, size_t size, size_t& offset, unsigned int count, const T*& table)
+	{
+		if (count > (size - offset) / sizeof(T))
+			return false;
+
+		table = (const T*)(data + offset);
+		offset += (size_t)count * sizeof(T);
+		return true;
+	}
+
+	bool ReadVec3(std::istringstream& line, glm::vec3& value)
+	{
+		return (bool)(line >> value.x >> value.y >> value.z);
+	}
+
+	// a source edited after it was cooked: both are loose files and the source was written last. Packs never
+	// hold the sources of their compiled scenes, so a packed scene is always current
+	bool IsSourceNewer(const std::string& sourcePath, const std::string& compiledPath)
+	{
+		std::error_code sourceError, compiledError;
+		std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(sourcePath, sourceError);
+		std::filesystem::file_time_type compiledTime = std::filesystem::last_write_time(compiledPath, compiledError);
+		return !sourceError && !compiledError && sourceTime > compiledTime;
+	}
+
+	SceneLight DefaultLight(SceneLightType type)
+	{
+		SceneLight light;
+		light.type = type;
+		light.position = glm::vec3(0.0f);
+		light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		light.ambient = glm::vec3(0.05f);
+		light.diffuse = glm::vec3(0.8f);
+		light.specular = glm::vec3(1.0f);
+		light.constant = 1.0f;
+		light.linear = 0.09f;
+		light.quadratic = 0.032f;
+		light.cutOff = glm::cos(glm::radians(12.5f));
+		light.outerCutOff = glm::cos(glm::radians(17.5f));
+		return light;
+	}
+}
+
+unsigned int SceneData::AddString(const std::string& value)
+{
+	auto found = m_stringOffsets.find(value);
+	if (found != m_stringOffsets.end())
+		return found->second;
+
+	unsigned int offset = (unsigned int)strings.size();
+	strings += value;
+	strings += '\0';
+	m_stringOffsets[value] = offset;
+	return offset;
+}
+
+SceneFile::SceneFile()
+{
+}
+
+bool SceneFile::Load(const std::string& path)
+{
+	// the compiled file is read in place, a source that wasn't cooked yet or was edited since is compiled
+	// on the spot
+	std::string compiledPath = GetCompiledPath(path);
+	if (IsSourceNewer(path, compiledPath))
+		std::cout << "Scene " << path << " changed since it was cooked, compiling it" << std::endl;
+	else if (VirtualFileSystem::Map(compiledPath, m_file))
+		return ReadTables(compiledPath);
+
+	std::string source, error;
+	SceneData scene;
+	if (!VirtualFileSystem::ReadText(path, source))
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_FOUND: " << path << std::endl;
+		return false;
+	}
+	if (!Compile(source, scene, error))
+	{
+		std::cout << "ERROR::SCENE::COMPILE_FAILED: " << path << ": " << error << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> bytes;
+	Write(scene, bytes);
+	m_file.Assign(std::move(bytes));
+	return ReadTables(path);
+}
+
+bool SceneFile::Load(std::vector<unsigned char>&& bytes)
+{
+	m_file.Assign(std::move(bytes));
+	return ReadTables("<memory>");
+}
+
+bool SceneFile::ReadTables(const std::string& name)
+{
+	SceneFileHeader header;
+	size_t offset = sizeof(SceneFileHeader);
+	bool valid = m_file.size >= sizeof(SceneFileHeader);
+	if (valid)
+	{
+		std::memcpy(&header, m_file.data, sizeof(SceneFileHeader));
+		valid = std::memcmp(header.magic, SCENE_MAGIC, 4) == 0 && header.version == VERSION
+			&& TakeTable(m_file.data, m_file.size, offset, header.meshCount, m_meshes)
+			&& TakeTable(m_file.data, m_file.size, offset, header.materialCount, m_materials)
+			&& TakeTable(m_file.data, m_file.size, offset, header.entityCount, m_entities)
+			&& TakeTable(m_file.data, m_file.size, offset, header.lightCount, m_lights)
+			&& TakeTable(m_file.data, m_file.size, offset, header.cameraCount, m_cameras)
+			&& header.stringsSize == m_file.size - offset
+			&& (header.stringsSize == 0 || m_file.data[m_file.size - 1] == '\0');
+	}
+
+	// the string offsets and the indices are checked once here, nothing needs to check them afterwards
+	for (unsigned int i = 0; valid && i < header.meshCount; i++)
+	{
+		valid = m_meshes[i].name < header.stringsSize && m_meshes[i].type <= SCENE_MESH_MODEL
+			&& (m_meshes[i].path == SCENE_NO_STRING || m_meshes[i].path < header.stringsSize);
+	}
+	for (unsigned int i = 0; valid && i < header.materialCount; i++)
+	{
+		const SceneMaterial& material = m_materials[i];
+		valid = material.name < header.stringsSize && (material.diffuse == SCENE_NO_STRING || material.diffuse < header.stringsSize)
+			&& (material.specular == SCENE_NO_STRING || material.specular < header.stringsSize);
+	}
+	for (unsigned int i = 0; valid && i < header.entityCount; i++)
+		valid = m_entities[i].mesh < header.meshCount && m_entities[i].material < header.materialCount;
+
+	if (!valid)
+	{
+		std::cout << "ERROR::SCENE::INVALID_FILE: " << name << std::endl;
+		m_file = FileData();
+		m_meshCount = m_materialCount = m_entityCount = m_lightCount = m_cameraCount = m_stringsSize = 0;
+		return false;
+	}
+
+	m_strings = (const char*)(m_file.data + offset);
+	m_meshCount = header.meshCount;
+	m_materialCount = header.materialCount;
+	m_entityCount = header.entityCount;
+	m_lightCount = header.lightCount;
+	m_cameraCount = header.cameraCount;
+	m_stringsSize = header.stringsSize;
+	return true;
+}
+
+const char* SceneFile::GetString(unsigned int offset) const
+{
+	return offset < m_stringsSize ? m_strings + offset : "";
+}
+
+int SceneFile::FindMesh(const std::string& name) const
+{
+	for (unsigned int i = 0; i < m_meshCount; i++)
+	{
+		if (name == GetString(m_meshes[i].name))
+			return (int)i;
+	}
+	return -1;
+}
+
+bool SceneFile::Compile(const std::string& source, SceneData& outScene, std::string& outError)
+{
+	outScene = SceneData();
+	std::unordered_map<std::string, unsigned int> meshIndices;
+	std::unordered_map<std::string, unsigned int> materialIndices;
+
+	std::istringstream lines(source);
+	std::string text;
+	for (int lineNumber = 1; std::getline(lines, text); lineNumber++)
+	{
+		text = text.substr(0, text.find('#'));
+		std::istringstream line(text);
+		std::string keyword;
+		if (!(line >> keyword))
+			continue;
+
+		bool valid = true;
+		std::string key;
+		if (keyword == "camera")
+		{
+			SceneCamera camera;
+			camera.yaw = -90.0f;
+			camera.pitch = 0.0f;
+			valid = ReadVec3(line, camera.position);
+			while (valid && line >> key)
+			{
+				if (key == "yaw")
+					valid = (bool)(line >> camera.yaw);
+				else if (key == "pitch")
+					valid = (bool)(line >> camera.pitch);
+				else
+					valid = false;
+			}
+			outScene.cameras.push_back(camera);
+		}
+		else if (keyword == "mesh")
+		{
+			std::string name, type, path;
+			valid = (bool)(line >> name >> type) && meshIndices.count(name) == 0;
+
+			SceneMesh mesh;
+			mesh.name = outScene.AddString(name);
+			mesh.path = SCENE_NO_STRING;
+			if (type == "cube")
+				mesh.type = SCENE_MESH_CUBE;
+			else if (type == "plane")
+				mesh.type = SCENE_MESH_PLANE;
+			else if (type == "quad")
+				mesh.type = SCENE_MESH_QUAD;
+			else if (type == "model" && line >> path)
+			{
+				mesh.type = SCENE_MESH_MODEL;
+				mesh.path = outScene.AddString(path);
+			}
+			else
+				valid = false;
+
+			meshIndices[name] = (unsigned int)outScene.meshes.size();
+			outScene.meshes.push_back(mesh);
+		}
+		else if (keyword == "material")
+		{
+			std::string name, path;
+			valid = (bool)(line >> name) && materialIndices.count(name) == 0;
+
+			SceneMaterial material;
+			material.name = outScene.AddString(name);
+			material.diffuse = SCENE_NO_STRING;
+			material.specular = SCENE_NO_STRING;
+			material.shininess = 32.0f;
+			while (valid && line >> key)
+			{
+				if ((key == "diffuse" || key == "specular") && line >> path)
+					(key == "diffuse" ? material.diffuse : material.specular) = outScene.AddString(path);
+				else if (key == "shininess")
+					valid = (bool)(line >> material.shininess);
+				else
+					valid = false;
+			}
+
+			materialIndices[name] = (unsigned int)outScene.materials.size();
+			outScene.materials.push_back(material);
+		}
+		else if (keyword == "entity")
+		{
+			std::string mesh, material;
+			valid = (bool)(line >> mesh >> material) && meshIndices.count(mesh) > 0 && materialIndices.count(material) > 0;
+
+			SceneEntity entity;
+			entity.mesh = valid ? meshIndices[mesh] : 0;
+			entity.material = valid ? materialIndices[material] : 0;
+			entity.position = glm::vec3(0.0f);
+			entity.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+			entity.scale = glm::vec3(1.0f);
+			while (valid && line >> key)
+			{
+				if (key == "position")
+				{
+					valid = ReadVec3(line, entity.position);
+				}
+				else if (key == "rotation")
+				{
+					float degrees;
+					glm::vec3 axis;
+					valid = line >> degrees && ReadVec3(line, axis) && glm::length(axis) > 0.0f;
+					if (valid)
+						entity.rotation = glm::angleAxis(glm::radians(degrees), glm::normalize(axis));
+				}
+				else if (key == "scale")
+				{
+					// one value scales uniformly
+					valid = (bool)(line >> entity.scale.x);
+					entity.scale = glm::vec3(entity.scale.x);
+					std::streampos next = line.tellg();
+					float y, z;
+					if (valid && line >> y >> z)
+						entity.scale = glm::vec3(entity.scale.x, y, z);
+					else
+					{
+						line.clear();
+						line.seekg(next);
+					}
+				}
+				else
+				{
+					valid = false;
+				}
+			}
+			outScene.entities.push_back(entity);
+		}
+		else if (keyword == "light")
+		{
+			std::string type;
+			valid = (bool)(line >> type) && (type == "directional" || type == "point" || type == "spot");
+
+			SceneLight light = DefaultLight(type == "directional" ? SCENE_LIGHT_DIRECTIONAL : type == "point" ? SCENE_LIGHT_POINT : SCENE_LIGHT_SPOT);
+			while (valid && line >> key)
+			{
+				if (key == "position")
+					valid = ReadVec3(line, light.position);
+				else if (key == "direction")
+					valid = ReadVec3(line, light.direction);
+				else if (key == "ambient")
+					valid = ReadVec3(line, light.ambient);
+				else if (key == "diffuse")
+					valid = ReadVec3(line, light.diffuse);
+				else if (key == "specular")
+					valid = ReadVec3(line, light.specular);
+				else if (key == "attenuation")
+					valid = (bool)(line >> light.constant >> light.linear >> light.quadratic);
+				else if (key == "cutoff")
+				{
+					float inner, outer;
+					valid = (bool)(line >> inner >> outer);
+					light.cutOff = glm::cos(glm::radians(inner));
+					light.outerCutOff = glm::cos(glm::radians(outer));
+				}
+				else
+					valid = false;
+			}
+			outScene.lights.push_back(light);
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			outError = "line " + std::to_string(lineNumber) + ": " + text;
+			return false;
+		}
+	}
+	return true;
+}
+
+void SceneFile::Write(const SceneData& scene, std::vector<unsigned char>& outBytes)
+{
+	SceneFileHeader header;
+	std::memcpy(header.magic, SCENE_MAGIC, 4);
+	header.version = VERSION;
+	header.meshCount = (unsigned int)scene.meshes.size();
+	header.materialCount = (unsigned int)scene.materials.size();
+	header.entityCount = (unsigned int)scene.entities.size();
+	header.lightCount = (unsigned int)scene.lights.size();
+	header.cameraCount = (unsigned int)scene.cameras.size();
+	header.stringsSize = (unsigned int)scene.strings.size();
+
+	// every record is made of 4 byte values, the tables stay aligned back to back
+	outBytes.clear();
+	outBytes.reserve(sizeof(SceneFileHeader) + scene.meshes.size() * sizeof(SceneMesh) + scene.materials.size() * sizeof(SceneMaterial)
+		+ scene.entities.size() * sizeof(SceneEntity) + scene.lights.size() * sizeof(SceneLight) + scene.cameras.size() * sizeof(SceneCamera)
+		+ scene.strings.size());
+	outBytes.insert(outBytes.end(), (const unsigned char*)&header, (const unsigned char*)&header + sizeof(SceneFileHeader));
+	AppendTable(outBytes, scene.meshes);
+	AppendTable(outBytes, scene.materials);
+	AppendTable(outBytes, scene.entities);
+	AppendTable(outBytes, scene.lights);
+	AppendTable(outBytes, scene.cameras);
+	outBytes.insert(outBytes.end(), scene.strings.begin(), scene.strings.end());
+}
+
+bool SceneFile::WriteFile(const std::string& path, const SceneData& scene)
+{
+	std::vector<unsigned char> bytes;
+	Write(scene, bytes);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open() || !file.write((const char*)&bytes[0], (std::streamsize)bytes.size()))
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+glm::mat4 SceneFile::GetEntityMatrix(const SceneEntity& entity)
+{
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), entity.position) * glm::mat4_cast(entity.rotation);
+	return glm::scale(model, entity.scale);
+}
+
+std::string SceneFile::GetCompiledPath(const std::string& sourcePath)
+{
+	size_t dot = sourcePath.find_last_of('.');
+	size_t separator = sourcePath.find_last_of("\\/");
+	if (dot == std::string::npos || (separator != std::string::npos && dot < separator))
+		return sourcePath + ".sceneb";
+
+	return sourcePath.substr(0, dot) + ".sceneb";
+}
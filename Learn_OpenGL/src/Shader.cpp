@@ -1,13 +1,14 @@
 #include <Shader.h>
+#include <VirtualFileSystem.h>
 #include <glm/gtc/type_ptr.hpp>
 
 Shader::Shader()
 {
 }
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
 {
-	LoadShader(vertexPath, fragmentPath);
+	LoadShader(vertexPath, fragmentPath, geometryPath);
 }
 
 void Shader::Use()
@@ -15,7 +16,7 @@ void Shader::Use()
 	glUseProgram(ID);
 }
 
-void Shader::LoadShader(const char* vertexPath, const char* fragmentPath)
+void Shader::LoadShader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
 {
 	// 1. retrieve the vertex/fragment source code from filePath
 	std::string vertexCode = GetCodeFromFile(vertexPath);
@@ -29,10 +30,19 @@ void Shader::LoadShader(const char* vertexPath, const char* fragmentPath)
 	CompileShader(vShaderCode, GL_VERTEX_SHADER, vertex);
 	CompileShader(fShaderCode, GL_FRAGMENT_SHADER, fragment);
 
-	SetupProgram(vertex, fragment);
+	unsigned int geometry = 0;
+	if (geometryPath != nullptr)
+	{
+		std::string geometryCode = GetCodeFromFile(geometryPath);
+		CompileShader(geometryCode.c_str(), GL_GEOMETRY_SHADER, geometry);
+	}
+
+	SetupProgram(vertex, fragment, geometry);
 
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
+	if (geometry != 0)
+		glDeleteShader(geometry);
 }
 
 void Shader::SetBool(const std::string& name, bool value) const
@@ -50,11 +60,26 @@ void Shader::SetFloat(const std::string& name, float value) const
 	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
 
+void Shader::SetFloatArray(const std::string& name, const float* values, int count) const
+{
+	glUniform1fv(glGetUniformLocation(ID, name.c_str()), count, values);
+}
+
+void Shader::SetMat3(const std::string& name, const glm::mat3& value) const
+{
+	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+}
+
 void Shader::SetMat4(const std::string& name, const glm::mat4& value) const
 {
 	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
 }
 
+void Shader::SetVec2(const std::string& name, const glm::vec2& value) const
+{
+	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+
 void Shader::SetVec3(const std::string& name, const glm::vec3& value) const
 {
 	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
@@ -67,25 +92,31 @@ void Shader::SetMVPMatrix(const glm::mat4& model, const glm::mat4& view, const g
 	SetMat4("projection", projection);
 }
 
-std::string Shader::GetCodeFromFile(const char* filePath)
+void Shader::SetObjectMatrices(const glm::mat4& model, const glm::mat4& mvp, const glm::mat3& normalMatrix) const
 {
-	std::string strCode;
-	std::ifstream shaderFile;
-
-	// ensure ifstream objects can throw exceptions:
-	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try
-	{
-		shaderFile.open(filePath);
+	SetMat4("model", model);
+	SetMat4("mvp", mvp);
+	SetMat3("normalMatrix", normalMatrix);
+}
 
-		std::stringstream shaderStream;
-		shaderStream << shaderFile.rdbuf();
+int Shader::GetUniformLocation(const std::string& name) const
+{
+	return glGetUniformLocation(ID, name.c_str());
+}
 
-		shaderFile.close();
+ObjectMatrixLocations Shader::GetObjectMatrixLocations() const
+{
+	ObjectMatrixLocations locations;
+	locations.model = GetUniformLocation("model");
+	locations.mvp = GetUniformLocation("mvp");
+	locations.normalMatrix = GetUniformLocation("normalMatrix");
+	return locations;
+}
 
-		strCode = shaderStream.str();
-	}
-	catch (std::ifstream::failure e)
+std::string Shader::GetCodeFromFile(const char* filePath)
+{
+	std::string strCode;
+	if (!VirtualFileSystem::ReadText(filePath, strCode))
 	{
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
 	}
@@ -113,11 +144,13 @@ int Shader::CompileShader(const char* shaderSource, GLenum shaderType, unsigned
 	return 0;
 }
 
-int Shader::SetupProgram(unsigned int vertexShader, unsigned int fragmentShader)
+int Shader::SetupProgram(unsigned int vertexShader, unsigned int fragmentShader, unsigned int geometryShader)
 {
 	ID = glCreateProgram();
 	glAttachShader(ID, vertexShader);
 	glAttachShader(ID, fragmentShader);
+	if (geometryShader != 0)
+		glAttachShader(ID, geometryShader);
 	glLinkProgram(ID);
 
 	int success;
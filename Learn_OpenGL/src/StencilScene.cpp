@@ -17,8 +17,9 @@ void StencilScene::Setup()
 
 	m_shader.LoadShader(".\\shaders\\stencil_testing.vs", ".\\shaders\\stencil_testing.fs");
 	m_singleColorShader.LoadShader(".\\shaders\\stencil_testing.vs", ".\\shaders\\stencil_single_color.fs");
-	m_cubeTexture = Model::TextureFromFile("marble.jpg", ".\\resources\\textures");
-	m_floorTexture = Model::TextureFromFile("metal.png", ".\\resources\\textures");
+	m_cubeLayer = m_textures.AddTexture("marble.jpg", ".\\resources\\textures");
+	m_floorLayer = m_textures.AddTexture("metal.png", ".\\resources\\textures");
+	m_textures.Build();
 
 	VertexArrayInitializer::SetupCubeNoNormal(m_cubeVAO);
 	VertexArrayInitializer::SetupPlane(m_planeVAO);
@@ -40,6 +41,7 @@ void StencilScene::Draw(const Camera& camera)
 	m_singleColorShader.SetMVPMatrix(model, camera.GetViewMatrix(), camera.GetPerspectiveProj());
 
 	m_shader.Use();
+	m_textures.Bind(0);
 	m_shader.SetMat4("view", camera.GetViewMatrix());
 	m_shader.SetMat4("projection", camera.GetPerspectiveProj());
 	
@@ -47,7 +49,7 @@ void StencilScene::Draw(const Camera& camera)
     glStencilMask(0x00);
     // floor
     glBindVertexArray(m_planeVAO);
-    glBindTexture(GL_TEXTURE_2D, m_floorTexture);
+    m_textures.SelectLayer(m_shader, m_floorLayer);
     m_shader.SetMat4("model", glm::mat4(1.0f));
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
@@ -58,8 +60,7 @@ void StencilScene::Draw(const Camera& camera)
     glStencilMask(0xFF);
     // cubes
     glBindVertexArray(m_cubeVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_cubeTexture);
+    m_textures.SelectLayer(m_shader, m_cubeLayer);
     model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
     m_shader.SetMat4("model", model);
     glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -79,7 +80,6 @@ void StencilScene::Draw(const Camera& camera)
     float scale = 1.1f;
     // cubes
     glBindVertexArray(m_cubeVAO);
-    glBindTexture(GL_TEXTURE_2D, m_cubeTexture);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
     model = glm::scale(model, glm::vec3(scale, scale, scale));
@@ -0,0 +1,167 @@
+#include "StreamBuffer.h"
+#include <GLExtensions.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// partitions start on this boundary, enough for any attribute or uniform block offset
+	const size_t PARTITION_ALIGNMENT = 256;
+
+	// a wait that gets this long means the GPU is hung rather than behind, in nanoseconds
+	const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (GLsync& fence : m_fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = 0;
+	}
+
+	if (m_mapped)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glUnmapBuffer(m_target);
+		m_mapped = nullptr;
+	}
+	if (m_buffer)
+		glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::Setup(size_t frameSize, GLenum target)
+{
+	m_target = target;
+	m_frameSize = AlignUp(std::max<size_t>(frameSize, 1), PARTITION_ALIGNMENT);
+
+	GLint uniformAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	if (uniformAlignment > 0)
+		m_uniformAlignment = (size_t)uniformAlignment;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(m_target, m_buffer);
+
+	if (GLExtensions::BufferStorage)
+	{
+		// written by the CPU and read by the GPU while mapped, no flush or barrier needed in between
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		size_t totalSize = m_frameSize * FRAMES_IN_FLIGHT;
+		GLExtensions::BufferStorage(m_target, (GLsizeiptr)totalSize, NULL, flags);
+		m_mapped = (unsigned char*)glMapBufferRange(m_target, 0, (GLsizeiptr)totalSize, flags);
+		if (m_mapped)
+			return;
+
+		// the storage is immutable, orphaning needs a buffer of its own
+		std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED: falling back to orphaning" << std::endl;
+		glDeleteBuffers(1, &m_buffer);
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(m_target, m_buffer);
+	}
+
+	glBufferData(m_target, (GLsizeiptr)m_frameSize, NULL, GL_STREAM_DRAW);
+	m_staging.resize(m_frameSize);
+}
+
+void StreamBuffer::BeginFrame()
+{
+	m_head = 0;
+	m_inFrame = true;
+
+	if (!m_mapped)
+	{
+		// a new storage for this frame, the previous one lives on until the GPU is done with it
+		m_flushed = 0;
+		glBindBuffer(m_target, m_buffer);
+		glBufferData(m_target, (GLsizeiptr)m_frameSize, NULL, GL_STREAM_DRAW);
+		return;
+	}
+
+	m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+	GLsync fence = m_fences[m_frame];
+	if (!fence)
+		return;
+
+	// checked without waiting first, most frames the GPU is already past it
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		m_waitCount++;
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+	}
+	if (status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED)
+		std::cout << "ERROR::STREAM_BUFFER::FENCE_WAIT_FAILED" << std::endl;
+
+	glDeleteSync(fence);
+	m_fences[m_frame] = 0;
+}
+
+void StreamBuffer::EndFrame()
+{
+	Flush();
+	m_inFrame = false;
+	if (m_mapped)
+		m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamAllocation StreamBuffer::Allocate(size_t size, size_t alignment)
+{
+	StreamAllocation allocation;
+	size_t begin = AlignUp(m_head, alignment);
+	if (!m_inFrame || begin + size > m_frameSize)
+	{
+		if (m_inFrame && !m_overflowReported)
+		{
+			std::cout << "ERROR::STREAM_BUFFER::FRAME_FULL: " << begin + size << " of " << m_frameSize << " bytes" << std::endl;
+			m_overflowReported = true;
+		}
+		return allocation;
+	}
+
+	m_head = begin + size;
+	allocation.buffer = m_buffer;
+	allocation.size = size;
+	if (m_mapped)
+	{
+		allocation.offset = (size_t)m_frame * m_frameSize + begin;
+		allocation.data = m_mapped + allocation.offset;
+	}
+	else
+	{
+		allocation.offset = begin;
+		allocation.data = &m_staging[begin];
+	}
+	return allocation;
+}
+
+StreamAllocation StreamBuffer::AllocateUniforms(size_t size)
+{
+	return Allocate(size, m_uniformAlignment);
+}
+
+StreamAllocation StreamBuffer::Upload(const void* data, size_t size, size_t alignment)
+{
+	StreamAllocation allocation = Allocate(size, alignment);
+	if (allocation.IsValid())
+		std::memcpy(allocation.data, data, size);
+	return allocation;
+}
+
+void StreamBuffer::Flush()
+{
+	// coherent memory is seen by the draws issued after the writes
+	if (m_mapped || m_head <= m_flushed)
+		return;
+
+	glBindBuffer(m_target, m_buffer);
+	glBufferSubData(m_target, (GLintptr)m_flushed, (GLsizeiptr)(m_head - m_flushed), &m_staging[m_flushed]);
+	m_flushed = m_head;
+}
@@ -0,0 +1,458 @@
+#include "StressScene.h"
+#include <Model.h>
+#include <Bvh.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+	const char* TEXTURE_FILES[] = {
+		".\\resources\\textures\\container2.png",
+		".\\resources\\textures\\container.jpg",
+		".\\resources\\textures\\marble.jpg",
+		".\\resources\\textures\\metal.png",
+		".\\resources\\textures\\wall.jpg",
+		".\\resources\\textures\\matrix.jpg",
+		".\\resources\\textures\\awesomeface.png",
+		".\\resources\\textures\\lighting_maps_specular_color.png"
+	};
+	const unsigned int TEXTURE_FILE_COUNT = sizeof(TEXTURE_FILES) / sizeof(TEXTURE_FILES[0]);
+	const char* WINDOW_TEXTURE = ".\\resources\\textures\\blending_transparent_window.png";
+	const char* BACKPACK_PATH = ".\\resources\\models\\backpack\\backpack.blobj";
+
+	// one object in PLANE_EVERY is a plane and one in MODEL_EVERY a backpack, the rest are cubes
+	const unsigned int PLANE_EVERY = 8;
+	const unsigned int MODEL_EVERY = 64;
+	// room per object, the scene grows with the object count
+	const float OBJECT_SPACING = 3.0f;
+
+	// frames drawn before each step is timed, while the new scene's textures and buffers settle
+	const int BENCHMARK_WARMUP_FRAMES = 30;
+	// frames timed per step
+	const int BENCHMARK_FRAMES = 120;
+
+	// BVH benchmark: scene sizes, builds averaged per size and queries timed
+	const unsigned int BVH_BENCHMARK_OBJECTS[] = { 1000, 4000, 16000, 64000 };
+	const int BVH_BUILD_REPEATS = 5;
+	const int BVH_FRUSTUM_QUERIES = 1000;
+	const int BVH_RAYS = 100000;
+	// the linear scans are timed on fewer queries and scaled
+	const int LINEAR_SCAN_RAYS = 1000;
+	const int LINEAR_SCAN_TRIANGLE_RAYS = 100;
+
+	typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+	float ElapsedMs(BenchmarkClock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(BenchmarkClock::now() - start).count();
+	}
+
+	glm::quat RandomRotation(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> angle(0.0f, glm::radians(360.0f));
+		glm::vec3 axis(unit(random), unit(random), unit(random));
+		if (glm::dot(axis, axis) < 1e-4f)
+			axis = glm::vec3(0.0f, 1.0f, 0.0f);
+		return glm::angleAxis(angle(random), glm::normalize(axis));
+	}
+}
+
+StressScene::StressScene(const StressSceneSettings& settings) : m_settings(settings)
+{
+}
+
+void StressScene::Setup()
+{
+	BuildScene(m_settings);
+}
+
+void StressScene::SetupCamera(Camera& camera)
+{
+	camera = m_sceneCamera;
+}
+
+void StressScene::BuildScene(const StressSceneSettings& settings)
+{
+	SceneData scene;
+	Generate(settings, scene);
+
+	std::string name = "stress(" + std::to_string(settings.objects) + " objects, " + std::to_string(settings.lights) + " lights, "
+		+ std::to_string(settings.textures) + " textures, " + std::to_string(settings.quads) + " quads, seed " + std::to_string(settings.seed) + ")";
+	m_scene.reset(new FileScene(scene, name));
+	m_scene->Setup();
+	m_scene->SetupCamera(m_sceneCamera);
+}
+
+void StressScene::Generate(const StressSceneSettings& settings, SceneData& outScene)
+{
+	std::mt19937 random(settings.seed);
+	float size = OBJECT_SPACING * std::cbrt((float)std::max(settings.objects, 1u));
+	std::uniform_real_distribution<float> x(-0.5f * size, 0.5f * size);
+	std::uniform_real_distribution<float> y(0.0f, 0.25f * size);
+	std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+	std::uniform_real_distribution<float> shade(0.2f, 1.0f);
+
+	const unsigned int cube = (unsigned int)outScene.meshes.size();
+	outScene.meshes.push_back({ outScene.AddString("cube"), SCENE_MESH_CUBE, SCENE_NO_STRING });
+	const unsigned int plane = (unsigned int)outScene.meshes.size();
+	outScene.meshes.push_back({ outScene.AddString("plane"), SCENE_MESH_PLANE, SCENE_NO_STRING });
+	const unsigned int quad = (unsigned int)outScene.meshes.size();
+	outScene.meshes.push_back({ outScene.AddString("quad"), SCENE_MESH_QUAD, SCENE_NO_STRING });
+	const unsigned int backpack = (unsigned int)outScene.meshes.size();
+	outScene.meshes.push_back({ outScene.AddString("backpack"), SCENE_MESH_MODEL, outScene.AddString(BACKPACK_PATH) });
+
+	// past the texture files the materials still differ, by their shininess, so they stay separate draw groups
+	unsigned int materialCount = std::max(settings.textures, 1u);
+	for (unsigned int i = 0; i < materialCount; i++)
+	{
+		SceneMaterial material;
+		material.name = outScene.AddString("material" + std::to_string(i));
+		material.diffuse = outScene.AddString(TEXTURE_FILES[i % TEXTURE_FILE_COUNT]);
+		material.specular = SCENE_NO_STRING;
+		material.shininess = 8.0f + (float)i;
+		outScene.materials.push_back(material);
+	}
+	const unsigned int glass = (unsigned int)outScene.materials.size();
+	outScene.materials.push_back({ outScene.AddString("glass"), outScene.AddString(WINDOW_TEXTURE), SCENE_NO_STRING, 32.0f });
+
+	std::uniform_int_distribution<unsigned int> material(0, materialCount - 1);
+	for (unsigned int i = 0; i < settings.objects; i++)
+	{
+		SceneEntity entity;
+		entity.mesh = i % MODEL_EVERY == MODEL_EVERY - 1 ? backpack : i % PLANE_EVERY == PLANE_EVERY - 1 ? plane : cube;
+		entity.material = material(random);
+		entity.position = glm::vec3(x(random), y(random), x(random));
+		entity.rotation = RandomRotation(random);
+		// planes are 10 units wide and the backpack about 3
+		float objectScale = scale(random);
+		entity.scale = glm::vec3(entity.mesh == plane ? 0.15f * objectScale : entity.mesh == backpack ? 0.4f * objectScale : objectScale);
+		outScene.entities.push_back(entity);
+	}
+
+	// windows keep facing the camera's side of the scene, so the sorting shows
+	for (unsigned int i = 0; i < settings.quads; i++)
+	{
+		SceneEntity entity;
+		entity.mesh = quad;
+		entity.material = glass;
+		entity.position = glm::vec3(x(random), y(random), x(random));
+		entity.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		entity.scale = glm::vec3(scale(random));
+		outScene.entities.push_back(entity);
+	}
+
+	SceneLight sun = {};
+	sun.type = SCENE_LIGHT_DIRECTIONAL;
+	sun.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+	sun.ambient = glm::vec3(0.1f);
+	sun.diffuse = glm::vec3(0.3f);
+	sun.specular = glm::vec3(0.3f);
+	sun.constant = 1.0f;
+	outScene.lights.push_back(sun);
+
+	for (unsigned int i = 0; i < settings.lights; i++)
+	{
+		SceneLight light = {};
+		light.type = SCENE_LIGHT_POINT;
+		light.position = glm::vec3(x(random), y(random), x(random));
+		light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		light.diffuse = glm::vec3(shade(random), shade(random), shade(random));
+		light.specular = light.diffuse;
+		light.constant = 1.0f;
+		light.linear = 0.09f;
+		light.quadratic = 0.032f;
+		outScene.lights.push_back(light);
+	}
+
+	// on the edge of the scene, looking over it
+	SceneCamera camera;
+	camera.position = glm::vec3(0.0f, 0.3f * size, 0.5f * size + 5.0f);
+	camera.yaw = -90.0f;
+	camera.pitch = -15.0f;
+	outScene.cameras.push_back(camera);
+}
+
+void StressScene::Draw(const Camera& camera)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	m_frameTimer.Begin();
+
+	// the benchmark always looks from the generated camera, so runs stay comparable
+	m_scene->Draw(m_benchmarkFrame < 0 ? camera : m_sceneCamera);
+
+	m_frameTimer.End();
+	UpdateBenchmark(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+}
+
+void StressScene::OnKeyPressed(int key)
+{
+	if (key == GLFW_KEY_B && m_benchmarkFrame < 0)
+	{
+		StartBenchmark();
+	}
+	else if (key == GLFW_KEY_H && m_benchmarkFrame < 0)
+	{
+		RunBvhBenchmark();
+		RunTriangleBvhBenchmark();
+	}
+	else if (key == GLFW_KEY_P || key == GLFW_KEY_C || key == GLFW_KEY_K || key == GLFW_KEY_I)
+	{
+		m_scene->OnKeyPressed(key);
+	}
+}
+
+void StressScene::RunBvhBenchmark() const
+{
+	std::cout << "BVH over the stress scene entities (" << BVH_FRUSTUM_QUERIES << " frustums, " << BVH_RAYS << " rays per size):" << std::endl;
+	for (unsigned int objects : BVH_BENCHMARK_OBJECTS)
+	{
+		StressSceneSettings settings = m_settings;
+		settings.objects = objects;
+		SceneData scene;
+		Generate(settings, scene);
+
+		size_t count = scene.entities.size();
+		std::vector<glm::vec3> boxMin(count), boxMax(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			glm::vec3 localMin, localMax;
+			FileScene::GetShapeBox(scene.meshes[scene.entities[i].mesh].type, localMin, localMax);
+			Bvh::TransformBox(SceneFile::GetEntityMatrix(scene.entities[i]), localMin, localMax, boxMin[i], boxMax[i]);
+		}
+
+		Bvh bvh;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (int i = 0; i < BVH_BUILD_REPEATS; i++)
+			bvh.Build(boxMin, boxMax);
+		float buildMs = ElapsedMs(start) / BVH_BUILD_REPEATS;
+
+		start = BenchmarkClock::now();
+		for (int i = 0; i < BVH_BUILD_REPEATS; i++)
+			bvh.Refit(boxMin, boxMax);
+		float refitMs = ElapsedMs(start) / BVH_BUILD_REPEATS;
+
+		// views and rays from inside the scene volume, the same ones for the BVH and the linear scans
+		std::mt19937 random(settings.seed);
+		glm::vec3 sceneMin(FLT_MAX), sceneMax(-FLT_MAX);
+		for (size_t i = 0; i < count; i++)
+		{
+			sceneMin = glm::min(sceneMin, boxMin[i]);
+			sceneMax = glm::max(sceneMax, boxMax[i]);
+		}
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		auto randomPoint = [&]() { return sceneMin + (sceneMax - sceneMin) * glm::vec3(unit(random), unit(random), unit(random)); };
+		auto randomDirection = [&]() { return glm::normalize(randomPoint() - 0.5f * (sceneMin + sceneMax) + glm::vec3(1e-3f)); };
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+		std::vector<Frustum> frustums;
+		for (int i = 0; i < BVH_FRUSTUM_QUERIES; i++)
+		{
+			glm::vec3 position = randomPoint();
+			frustums.push_back(Frustum::FromMatrix(projection * glm::lookAt(position, position + randomDirection(), glm::vec3(0.0f, 1.0f, 0.0f))));
+		}
+		std::vector<glm::vec3> rayOrigins, rayDirections;
+		for (int i = 0; i < BVH_RAYS; i++)
+		{
+			rayOrigins.push_back(randomPoint());
+			rayDirections.push_back(randomDirection());
+		}
+
+		std::vector<unsigned int> visible;
+		size_t bvhVisible = 0;
+		start = BenchmarkClock::now();
+		for (const Frustum& frustum : frustums)
+		{
+			visible.clear();
+			bvh.QueryFrustum(frustum, visible);
+			bvhVisible += visible.size();
+		}
+		float frustumMs = ElapsedMs(start);
+
+		// what the scenes did so far: every bounding sphere against the frustum
+		size_t linearVisible = 0;
+		start = BenchmarkClock::now();
+		for (const Frustum& frustum : frustums)
+		{
+			for (size_t i = 0; i < count; i++)
+				linearVisible += frustum.IntersectsSphere(0.5f * (boxMin[i] + boxMax[i]), 0.5f * glm::length(boxMax[i] - boxMin[i])) ? 1 : 0;
+		}
+		float linearFrustumMs = ElapsedMs(start);
+
+		int hits = 0;
+		BvhRayHit hit;
+		start = BenchmarkClock::now();
+		for (int i = 0; i < BVH_RAYS; i++)
+			hits += bvh.RaycastNearest(rayOrigins[i], rayDirections[i], FLT_MAX, hit) ? 1 : 0;
+		float rayMs = ElapsedMs(start);
+
+		int linearHits = 0;
+		start = BenchmarkClock::now();
+		for (int i = 0; i < LINEAR_SCAN_RAYS; i++)
+		{
+			glm::vec3 inverseDirection = 1.0f / rayDirections[i];
+			float nearest = FLT_MAX, distance;
+			for (size_t j = 0; j < count; j++)
+			{
+				if (Bvh::IntersectRayBox(rayOrigins[i], inverseDirection, boxMin[j], boxMax[j], nearest, distance))
+					nearest = std::min(nearest, distance);
+			}
+			linearHits += nearest < FLT_MAX ? 1 : 0;
+		}
+		float linearRayMs = ElapsedMs(start) * ((float)BVH_RAYS / LINEAR_SCAN_RAYS);
+
+		std::cout << "  " << count << " entities: build " << buildMs << " ms, refit " << refitMs << " ms, "
+			<< bvh.GetNodes().size() << " nodes, depth " << bvh.GetDepth() << std::endl;
+		std::cout << "    frustum: " << BVH_FRUSTUM_QUERIES / frustumMs << " queries/ms (linear " << BVH_FRUSTUM_QUERIES / linearFrustumMs
+			<< "), " << (float)bvhVisible / BVH_FRUSTUM_QUERIES << " boxes visible on average (" << (float)linearVisible / BVH_FRUSTUM_QUERIES << " spheres)" << std::endl;
+		std::cout << "    nearest hit: " << BVH_RAYS / rayMs << " rays/ms, " << 100.0f * hits / BVH_RAYS << "% hit (linear "
+			<< BVH_RAYS / linearRayMs << " rays/ms, " << 100.0f * linearHits / LINEAR_SCAN_RAYS << "% hit)" << std::endl;
+	}
+}
+
+void StressScene::RunTriangleBvhBenchmark() const
+{
+	std::vector<MeshData> meshes;
+	std::vector<ModelNode> nodes;
+	if (!Model::ImportMeshData(BACKPACK_PATH, meshes, nodes))
+		return;
+
+	// every mesh's full detail level in one soup, the node transforms don't matter for timing
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	for (const MeshData& mesh : meshes)
+	{
+		unsigned int first = (unsigned int)positions.size();
+		for (const Vertex& vertex : mesh.vertices)
+			positions.push_back(vertex.Position);
+
+		unsigned int indexOffset = mesh.lods.empty() ? 0 : mesh.lods[0].indexOffset;
+		unsigned int indexCount = mesh.lods.empty() ? (unsigned int)mesh.indices.size() : mesh.lods[0].indexCount;
+		for (unsigned int i = indexOffset; i < indexOffset + indexCount; i++)
+			indices.push_back(first + mesh.indices[i]);
+	}
+
+	TriangleBvh bvh;
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	bvh.Build(positions, indices);
+	float buildMs = ElapsedMs(start);
+
+	// rays from a sphere around the model towards random points inside it
+	const std::vector<BvhNode>& bvhNodes = bvh.GetBvh().GetNodes();
+	if (bvhNodes.empty())
+		return;
+	glm::vec3 center = 0.5f * (bvhNodes[0].boundsMin + bvhNodes[0].boundsMax);
+	float radius = 0.5f * glm::length(bvhNodes[0].boundsMax - bvhNodes[0].boundsMin);
+	std::mt19937 random(m_settings.seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> rayOrigins, rayDirections;
+	for (int i = 0; i < BVH_RAYS; i++)
+	{
+		glm::vec3 onSphere = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-3f));
+		glm::vec3 target = center + 0.5f * radius * glm::vec3(unit(random), unit(random), unit(random));
+		rayOrigins.push_back(center + radius * onSphere);
+		rayDirections.push_back(glm::normalize(target - rayOrigins.back()));
+	}
+
+	int hits = 0;
+	BvhRayHit hit;
+	start = BenchmarkClock::now();
+	for (int i = 0; i < BVH_RAYS; i++)
+		hits += bvh.RaycastNearest(rayOrigins[i], rayDirections[i], FLT_MAX, hit) ? 1 : 0;
+	float rayMs = ElapsedMs(start);
+
+	int linearHits = 0;
+	start = BenchmarkClock::now();
+	for (int i = 0; i < LINEAR_SCAN_TRIANGLE_RAYS; i++)
+	{
+		float nearest = FLT_MAX;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			glm::vec3 a = positions[indices[t]];
+			glm::vec3 edge1 = positions[indices[t + 1]] - a;
+			glm::vec3 edge2 = positions[indices[t + 2]] - a;
+			glm::vec3 p = glm::cross(rayDirections[i], edge2);
+			float determinant = glm::dot(edge1, p);
+			if (determinant == 0.0f)
+				continue;
+
+			glm::vec3 toOrigin = rayOrigins[i] - a;
+			float u = glm::dot(toOrigin, p) / determinant;
+			glm::vec3 q = glm::cross(toOrigin, edge1);
+			float v = glm::dot(rayDirections[i], q) / determinant;
+			float distance = glm::dot(edge2, q) / determinant;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f)
+				nearest = std::min(nearest, distance);
+		}
+		linearHits += nearest < FLT_MAX ? 1 : 0;
+	}
+	float linearRayMs = ElapsedMs(start) * ((float)BVH_RAYS / LINEAR_SCAN_TRIANGLE_RAYS);
+
+	std::cout << "BVH over the backpack's " << bvh.GetTriangleCount() << " triangles: build " << buildMs << " ms, "
+		<< bvh.GetBvh().GetNodes().size() << " nodes, depth " << bvh.GetBvh().GetDepth() << std::endl;
+	std::cout << "  nearest hit: " << BVH_RAYS / rayMs << " rays/ms, " << 100.0f * hits / BVH_RAYS << "% hit (linear "
+		<< BVH_RAYS / linearRayMs << " rays/ms, " << 100.0f * linearHits / LINEAR_SCAN_TRIANGLE_RAYS << "% hit)" << std::endl;
+}
+
+void StressScene::StartBenchmark()
+{
+	// each dimension is swept with the others left at the current settings
+	m_benchmarkSteps.clear();
+	auto addSweep = [this](const char* dimension, unsigned int StressSceneSettings::* field, std::initializer_list<unsigned int> values)
+	{
+		for (unsigned int value : values)
+		{
+			BenchmarkStep step = { dimension, value, m_settings };
+			step.settings.*field = value;
+			m_benchmarkSteps.push_back(step);
+		}
+	};
+	addSweep("objects", &StressSceneSettings::objects, { 500, 1000, 2000, 4000, 8000, 16000 });
+	addSweep("lights", &StressSceneSettings::lights, { 1, 4, 16, 64, 256 });
+	addSweep("textures", &StressSceneSettings::textures, { 1, 2, 4, 8, 16, 32 });
+	addSweep("quads", &StressSceneSettings::quads, { 0, 64, 256, 1024, 4096 });
+
+	std::cout << "Benchmarking " << m_benchmarkSteps.size() << " stress scenes over " << BENCHMARK_FRAMES << " frames each..." << std::endl;
+	std::cout << "dimension,value,cpu ms,gpu ms" << std::endl;
+	m_benchmarkStep = 0;
+	m_benchmarkFrame = 0;
+	BuildScene(m_benchmarkSteps[0].settings);
+}
+
+void StressScene::UpdateBenchmark(float cpuMs)
+{
+	if (m_benchmarkFrame < 0)
+		return;
+
+	if (++m_benchmarkFrame <= BENCHMARK_WARMUP_FRAMES)
+	{
+		m_frameTimer.Reset();
+		m_benchmarkCpuMs = 0.0f;
+		return;
+	}
+	m_benchmarkCpuMs += cpuMs;
+	if (m_benchmarkFrame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES)
+		return;
+
+	const BenchmarkStep& step = m_benchmarkSteps[m_benchmarkStep];
+	std::cout << step.dimension << "," << step.value << "," << m_benchmarkCpuMs / BENCHMARK_FRAMES << "," << m_frameTimer.GetAverageMs() << std::endl;
+
+	m_benchmarkFrame = 0;
+	if (++m_benchmarkStep < m_benchmarkSteps.size())
+	{
+		BuildScene(m_benchmarkSteps[m_benchmarkStep].settings);
+		return;
+	}
+
+	std::cout << "Stress benchmark done" << std::endl;
+	m_benchmarkFrame = -1;
+	BuildScene(m_settings);
+}
@@ -0,0 +1,215 @@
+#include "TextureArray.h"
+#include <VirtualFileSystem.h>
+#include <JobSystem.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	// bilinear resampling of an RGBA8 image, only used when a texture doesn't match the layer size
+	std::vector<unsigned char> Resample(const unsigned char* image, int width, int height, int newWidth, int newHeight)
+	{
+		std::vector<unsigned char> out((size_t)newWidth * newHeight * 4);
+		for (int y = 0; y < newHeight; y++)
+		{
+			float sy = std::max(0.0f, (y + 0.5f) * height / newHeight - 0.5f);
+			int y0 = std::min((int)sy, height - 1);
+			int y1 = std::min(y0 + 1, height - 1);
+			float fy = sy - y0;
+
+			for (int x = 0; x < newWidth; x++)
+			{
+				float sx = std::max(0.0f, (x + 0.5f) * width / newWidth - 0.5f);
+				int x0 = std::min((int)sx, width - 1);
+				int x1 = std::min(x0 + 1, width - 1);
+				float fx = sx - x0;
+
+				for (int c = 0; c < 4; c++)
+				{
+					float top = image[((size_t)y0 * width + x0) * 4 + c] * (1.0f - fx) + image[((size_t)y0 * width + x1) * 4 + c] * fx;
+					float bottom = image[((size_t)y1 * width + x0) * 4 + c] * (1.0f - fx) + image[((size_t)y1 * width + x1) * 4 + c] * fx;
+					out[((size_t)y * newWidth + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+		return out;
+	}
+}
+
+TextureArray::TextureArray()
+{
+}
+
+void TextureArray::SetLayerSize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+}
+
+int TextureArray::AddTexture(const char* path, const std::string& directory)
+{
+	Layer layer;
+	layer.path = directory + '/' + std::string(path);
+	m_layers.push_back(layer);
+	return (int)m_layers.size() - 1;
+}
+
+unsigned int TextureArray::Build()
+{
+	if (m_layers.empty())
+		return 0;
+
+	if (m_id == 0)
+		glGenTextures(1, &m_id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+
+	if (!BuildCompressed())
+		BuildUncompressed();
+
+	// alpha layers are clamped in the shader, the array itself has to repeat for the others
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return m_id;
+}
+
+void TextureArray::Release()
+{
+	if (m_id != 0)
+		glDeleteTextures(1, &m_id);
+	m_id = 0;
+}
+
+bool TextureArray::BuildCompressed()
+{
+	std::vector<KtxData> layers(m_layers.size());
+	for (size_t i = 0; i < m_layers.size(); i++)
+	{
+		if (!KtxLoader::LoadTextureData(KtxLoader::GetSiblingPath(m_layers[i].path), layers[i])
+			&& !KtxLoader::LoadTextureData(KtxLoader::GetSiblingPath(m_layers[i].path, ".etc2.ktx2"), layers[i]))
+			return false;
+
+		const KtxData& first = layers[0];
+		if (layers[i].vkFormat != first.vkFormat || layers[i].width != first.width || layers[i].height != first.height
+			|| layers[i].levelCount != first.levelCount || (m_width != 0 && (int)first.width != m_width) || (m_height != 0 && (int)first.height != m_height))
+			return false;
+	}
+
+	const KtxData& first = layers[0];
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// one upload per level with every layer side by side, as glTexImage3D expects them
+	std::vector<unsigned char> levelData;
+	for (unsigned int level = 0; level < first.levelCount; level++)
+	{
+		GLsizei width = std::max(1u, first.width >> level);
+		GLsizei height = std::max(1u, first.height >> level);
+		size_t layerSize = first.GetFaceSize(level);
+
+		levelData.resize(layerSize * layers.size());
+		for (size_t i = 0; i < layers.size(); i++)
+		{
+			std::copy(layers[i].GetFaceData(level, 0), layers[i].GetFaceData(level, 0) + layerSize, levelData.begin() + i * layerSize);
+		}
+
+		if (first.compressed)
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.internalFormat, width, height, (GLsizei)layers.size(), 0, (GLsizei)levelData.size(), &levelData[0]);
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.internalFormat, width, height, (GLsizei)layers.size(), 0, first.format, GL_UNSIGNED_BYTE, &levelData[0]);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, first.levelCount - 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		m_layers[i].clampToEdge = layers[i].hasAlpha;
+	}
+	return true;
+}
+
+void TextureArray::BuildUncompressed()
+{
+	struct DecodedLayer
+	{
+		unsigned char* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		int nrComponents = 0;
+		std::vector<unsigned char> resampled;
+	};
+
+	// reading and decoding the layers is most of the build, only the uploads have to stay on the GL thread
+	std::vector<DecodedLayer> decoded(m_layers.size());
+	JobSystem::ParallelFor(m_layers.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			FileData file;
+			if (VirtualFileSystem::Read(m_layers[i].path, file))
+				decoded[i].pixels = stbi_load_from_memory(file.data, (int)file.size, &decoded[i].width, &decoded[i].height, &decoded[i].nrComponents, 4);
+		}
+	});
+
+	int layerWidth = m_width;
+	int layerHeight = m_height;
+	for (const DecodedLayer& layer : decoded)
+	{
+		if (layer.pixels && (layerWidth == 0 || layerHeight == 0))
+		{
+			layerWidth = layer.width;
+			layerHeight = layer.height;
+		}
+	}
+
+	JobSystem::ParallelFor(decoded.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			DecodedLayer& layer = decoded[i];
+			if (layer.pixels && (layer.width != layerWidth || layer.height != layerHeight))
+				layer.resampled = Resample(layer.pixels, layer.width, layer.height, layerWidth, layerHeight);
+		}
+	});
+
+	bool allocated = false;
+	for (size_t i = 0; i < m_layers.size(); i++)
+	{
+		DecodedLayer& layer = decoded[i];
+		if (!layer.pixels)
+		{
+			std::cout << "Texture failed to load at path: " << m_layers[i].path << std::endl;
+			continue;
+		}
+
+		if (!allocated)
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerWidth, layerHeight, (GLsizei)m_layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			allocated = true;
+		}
+
+		m_layers[i].clampToEdge = layer.nrComponents == 4;
+		const unsigned char* pixels = layer.resampled.empty() ? layer.pixels : &layer.resampled[0];
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)i, layerWidth, layerHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		stbi_image_free(layer.pixels);
+	}
+
+	if (allocated)
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+void TextureArray::Bind(unsigned int unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+}
+
+void TextureArray::SelectLayer(const Shader& shader, int layer) const
+{
+	shader.SetFloat("layer", (float)layer);
+	shader.SetBool("clampToEdge", m_layers[layer].clampToEdge);
+}
@@ -0,0 +1,310 @@
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+bool TextureCompressor::Compress(const std::vector<const unsigned char*>& faces, int width, int height, int channels, KtxData& outData)
+{
+	if (faces.empty() || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+		return false;
+
+	size_t texelCount = (size_t)width * height;
+	std::vector<std::vector<unsigned char>> images(faces.size());
+	for (size_t face = 0; face < faces.size(); face++)
+	{
+		if (channels != 2)
+		{
+			images[face].assign(faces[face], faces[face] + texelCount * channels);
+			continue;
+		}
+
+		// stb_image gives grey + alpha, sampled as .rg that would lose the alpha: expanded to RGBA instead
+		images[face].resize(texelCount * 4);
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			unsigned char grey = faces[face][i * 2];
+			images[face][i * 4 + 0] = grey;
+			images[face][i * 4 + 1] = grey;
+			images[face][i * 4 + 2] = grey;
+			images[face][i * 4 + 3] = faces[face][i * 2 + 1];
+		}
+	}
+	if (channels == 2)
+		channels = 4;
+
+	// opaque RGBA images don't need the alpha block, BC1 halves their size
+	bool hasAlpha = false;
+	if (channels == 4)
+	{
+		for (const std::vector<unsigned char>& image : images)
+		{
+			for (size_t i = 3; i < image.size() && !hasAlpha; i += 4)
+				hasAlpha = image[i] != 255;
+		}
+	}
+
+	switch (channels)
+	{
+		case 1: outData.vkFormat = VK_FORMAT_BC4_UNORM_BLOCK; outData.blockBytes = 8; break;
+		default:
+			outData.vkFormat = hasAlpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+			outData.blockBytes = hasAlpha ? 16 : 8;
+			break;
+	}
+	outData.compressed = true;
+	outData.hasAlpha = hasAlpha;
+	outData.width = width;
+	outData.height = height;
+	outData.faceCount = (unsigned int)faces.size();
+	outData.topDown = true;
+
+	unsigned int levelCount = 1;
+	while ((width >> levelCount) > 0 || (height >> levelCount) > 0)
+		levelCount++;
+	outData.levelCount = levelCount;
+	outData.levels.assign(levelCount, KtxLevel());
+	std::vector<unsigned char> bytes;
+
+	for (unsigned int level = 0; level < levelCount; level++)
+	{
+		int levelWidth = std::max(1, width >> level);
+		int levelHeight = std::max(1, height >> level);
+
+		outData.levels[level].offset = bytes.size();
+		for (size_t face = 0; face < images.size(); face++)
+		{
+			if (level > 0)
+				images[face] = Downsample(images[face], std::max(1, width >> (level - 1)), std::max(1, height >> (level - 1)), channels);
+
+			EncodeImage(images[face], levelWidth, levelHeight, channels, outData.vkFormat, bytes);
+		}
+		outData.levels[level].size = bytes.size() - outData.levels[level].offset;
+	}
+	outData.file.Assign(std::move(bytes));
+	return true;
+}
+
+std::vector<unsigned char> TextureCompressor::Downsample(const std::vector<unsigned char>& image, int width, int height, int channels)
+{
+	// 2x2 box filter, odd edges reuse the last row/column
+	int outWidth = std::max(1, width / 2);
+	int outHeight = std::max(1, height / 2);
+	std::vector<unsigned char> out((size_t)outWidth * outHeight * channels);
+
+	for (int y = 0; y < outHeight; y++)
+	{
+		int y0 = std::min(y * 2, height - 1);
+		int y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < outWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1);
+			int x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < channels; c++)
+			{
+				int sum = image[((size_t)y0 * width + x0) * channels + c] + image[((size_t)y0 * width + x1) * channels + c]
+					+ image[((size_t)y1 * width + x0) * channels + c] + image[((size_t)y1 * width + x1) * channels + c];
+				out[((size_t)y * outWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return out;
+}
+
+void TextureCompressor::EncodeImage(const std::vector<unsigned char>& image, int width, int height, int channels, unsigned int vkFormat, std::vector<unsigned char>& out)
+{
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+
+	unsigned char rgba[64];
+	unsigned char channel[2][16];
+	unsigned char block[16];
+
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			// gather the 4x4 texels, clamping at the image edge
+			for (int i = 0; i < 16; i++)
+			{
+				int x = std::min(bx * 4 + (i % 4), width - 1);
+				int y = std::min(by * 4 + (i / 4), height - 1);
+				const unsigned char* texel = &image[((size_t)y * width + x) * channels];
+
+				rgba[i * 4 + 0] = texel[0];
+				rgba[i * 4 + 1] = channels > 1 ? texel[1] : texel[0];
+				rgba[i * 4 + 2] = channels > 2 ? texel[2] : texel[0];
+				rgba[i * 4 + 3] = channels > 3 ? texel[3] : 255;
+				channel[0][i] = texel[0];
+				channel[1][i] = channels > 1 ? texel[1] : 0;
+			}
+
+			size_t blockBytes = 8;
+			switch (vkFormat)
+			{
+				case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+					EncodeBC1Block(rgba, block);
+					break;
+				case VK_FORMAT_BC3_UNORM_BLOCK:
+				{
+					unsigned char alpha[16];
+					for (int i = 0; i < 16; i++)
+						alpha[i] = rgba[i * 4 + 3];
+					EncodeBC4Block(alpha, block);
+					EncodeBC1Block(rgba, block + 8);
+					blockBytes = 16;
+					break;
+				}
+				case VK_FORMAT_BC4_UNORM_BLOCK:
+					EncodeBC4Block(channel[0], block);
+					break;
+				case VK_FORMAT_BC5_UNORM_BLOCK:
+					EncodeBC4Block(channel[0], block);
+					EncodeBC4Block(channel[1], block + 8);
+					blockBytes = 16;
+					break;
+			}
+			out.insert(out.end(), block, block + blockBytes);
+		}
+	}
+}
+
+void TextureCompressor::EncodeBC1Block(const unsigned char rgba[64], unsigned char outBlock[8])
+{
+	// endpoints are the extremes of the colors projected on their principal axis
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += rgba[i * 4 + c] / 16.0f;
+
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float r = rgba[i * 4 + 0] - mean[0];
+		float g = rgba[i * 4 + 1] - mean[1];
+		float b = rgba[i * 4 + 2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+		if (length == 0.0f)
+			break;
+		axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+	}
+
+	float minProj = 1e30f, maxProj = -1e30f;
+	for (int i = 0; i < 16; i++)
+	{
+		float proj = (rgba[i * 4 + 0] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+		minProj = std::min(minProj, proj);
+		maxProj = std::max(maxProj, proj);
+	}
+
+	float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	if (axisLengthSq > 0.0f)
+	{
+		minProj /= axisLengthSq;
+		maxProj /= axisLengthSq;
+	}
+
+	// inset the endpoints slightly, it lowers the error of the two interpolated colors
+	float inset = (maxProj - minProj) / 16.0f;
+	minProj += inset;
+	maxProj -= inset;
+
+	unsigned short endpoints[2];
+	float extremes[2] = { maxProj, minProj };
+	for (int e = 0; e < 2; e++)
+	{
+		int rgb[3];
+		for (int c = 0; c < 3; c++)
+			rgb[c] = std::min(255, std::max(0, (int)(mean[c] + axis[c] * extremes[e] + 0.5f)));
+
+		endpoints[e] = (unsigned short)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+	}
+
+	// four color mode needs color0 > color1
+	if (endpoints[0] < endpoints[1])
+		std::swap(endpoints[0], endpoints[1]);
+
+	int palette[4][3];
+	for (int e = 0; e < 2; e++)
+	{
+		int r = (endpoints[e] >> 11) & 31, g = (endpoints[e] >> 5) & 63, b = endpoints[e] & 31;
+		palette[e][0] = (r << 3) | (r >> 2);
+		palette[e][1] = (g << 2) | (g >> 4);
+		palette[e][2] = (b << 3) | (b >> 2);
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	unsigned int indices = 0;
+	if (endpoints[0] != endpoints[1])
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = rgba[i * 4 + 0] - palette[p][0];
+				int dg = rgba[i * 4 + 1] - palette[p][1];
+				int db = rgba[i * 4 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (unsigned int)best << (i * 2);
+		}
+	}
+
+	std::memcpy(outBlock, &endpoints[0], 2);
+	std::memcpy(outBlock + 2, &endpoints[1], 2);
+	std::memcpy(outBlock + 4, &indices, 4);
+}
+
+void TextureCompressor::EncodeBC4Block(const unsigned char values[16], unsigned char outBlock[8])
+{
+	unsigned char maxValue = *std::max_element(values, values + 16);
+	unsigned char minValue = *std::min_element(values, values + 16);
+
+	// eight value mode: value0 > value1, six values interpolated in between
+	int palette[8] = { maxValue, minValue };
+	for (int i = 1; i <= 6; i++)
+		palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7;
+
+	unsigned long long indices = 0;
+	if (maxValue != minValue)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = std::abs(values[i] - palette[p]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (i * 3);
+		}
+	}
+
+	outBlock[0] = maxValue;
+	outBlock[1] = minValue;
+	for (int i = 0; i < 6; i++)
+		outBlock[2 + i] = (unsigned char)(indices >> (i * 8));
+}
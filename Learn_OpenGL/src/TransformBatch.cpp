@@ -0,0 +1,86 @@
+#include "TransformBatch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define TRANSFORM_BATCH_SSE
+#endif
+
+TransformBatch::TransformBatch()
+{
+}
+
+void TransformBatch::SetModels(const std::vector<glm::mat4>& models)
+{
+	m_models = models;
+	m_mvps.resize(models.size());
+	m_normalMatrices.resize(models.size());
+
+	for (size_t i = 0; i < m_models.size(); i++)
+	{
+		m_normalMatrices[i] = ComputeNormalMatrix(m_models[i]);
+	}
+}
+
+void TransformBatch::SetModel(size_t index, const glm::mat4& model)
+{
+	m_models[index] = model;
+	m_normalMatrices[index] = ComputeNormalMatrix(model);
+}
+
+void TransformBatch::Update(const glm::mat4& viewProj)
+{
+	if (m_models.empty())
+		return;
+
+	MultiplyBatch(viewProj, &m_models[0], &m_mvps[0], m_models.size());
+}
+
+glm::mat3 TransformBatch::ComputeNormalMatrix(const glm::mat4& model)
+{
+	glm::vec3 c0 = glm::vec3(model[0]);
+	glm::vec3 c1 = glm::vec3(model[1]);
+	glm::vec3 c2 = glm::vec3(model[2]);
+
+	// rows of the inverse are the cross products of the columns, so they are the columns of its transpose
+	glm::vec3 r0 = glm::cross(c1, c2);
+	glm::vec3 r1 = glm::cross(c2, c0);
+	glm::vec3 r2 = glm::cross(c0, c1);
+
+	float det = glm::dot(c0, r0);
+	if (det == 0.0f)
+		return glm::mat3(1.0f);
+
+	float invDet = 1.0f / det;
+	return glm::mat3(r0 * invDet, r1 * invDet, r2 * invDet);
+}
+
+void TransformBatch::MultiplyBatch(const glm::mat4& lhs, const glm::mat4* rhs, glm::mat4* out, size_t count)
+{
+#ifdef TRANSFORM_BATCH_SSE
+	// glm matrices are column-major: out column j = sum over k of lhs column k * rhs[j][k]
+	const float* l = &lhs[0][0];
+	__m128 lc0 = _mm_loadu_ps(l);
+	__m128 lc1 = _mm_loadu_ps(l + 4);
+	__m128 lc2 = _mm_loadu_ps(l + 8);
+	__m128 lc3 = _mm_loadu_ps(l + 12);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float* r = &rhs[i][0][0];
+		float* o = &out[i][0][0];
+		for (int j = 0; j < 4; j++)
+		{
+			__m128 col = _mm_mul_ps(lc0, _mm_set1_ps(r[j * 4 + 0]));
+			col = _mm_add_ps(col, _mm_mul_ps(lc1, _mm_set1_ps(r[j * 4 + 1])));
+			col = _mm_add_ps(col, _mm_mul_ps(lc2, _mm_set1_ps(r[j * 4 + 2])));
+			col = _mm_add_ps(col, _mm_mul_ps(lc3, _mm_set1_ps(r[j * 4 + 3])));
+			_mm_storeu_ps(o + j * 4, col);
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = lhs * rhs[i];
+	}
+#endif
+}
@@ -0,0 +1,160 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <iostream>
+#include <JobSystem.h>
+
+namespace
+{
+	// below this many nodes to update, handing out jobs costs more than it saves
+	const size_t PARALLEL_UPDATE_NODES = 8192;
+}
+
+TransformHierarchy::TransformHierarchy() : m_firstDirty(0)
+{
+}
+
+int TransformHierarchy::AddNode(int parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	int node = (int)m_parents.size();
+
+	// every node from the last one up to the parent gets the new node in its subtree
+	if (parent != NO_PARENT)
+	{
+		int ancestor = node - 1;
+		while (ancestor != NO_PARENT && ancestor != parent)
+			ancestor = m_parents[ancestor];
+		if (ancestor == NO_PARENT)
+		{
+			std::cout << "ERROR::TRANSFORM_HIERARCHY::NODE_OUT_OF_ORDER: parent " << parent << " of node " << node << std::endl;
+			parent = NO_PARENT;
+		}
+		for (ancestor = parent; ancestor != NO_PARENT; ancestor = m_parents[ancestor])
+			m_subtreeEnds[ancestor] = node + 1;
+	}
+
+	m_positions.push_back(position);
+	m_rotations.push_back(rotation);
+	m_scales.push_back(scale);
+	m_parents.push_back(parent);
+	m_subtreeEnds.push_back(node + 1);
+	m_dirty.push_back(0);
+	m_worlds.push_back(glm::mat4(1.0f));
+	MarkDirty(node);
+	return node;
+}
+
+void TransformHierarchy::Clear()
+{
+	m_positions.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_parents.clear();
+	m_subtreeEnds.clear();
+	m_dirty.clear();
+	m_worlds.clear();
+	m_firstDirty = 0;
+}
+
+void TransformHierarchy::SetLocal(int node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	m_positions[node] = position;
+	m_rotations[node] = rotation;
+	m_scales[node] = scale;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetPosition(int node, const glm::vec3& position)
+{
+	m_positions[node] = position;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotation(int node, const glm::quat& rotation)
+{
+	m_rotations[node] = rotation;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetScale(int node, const glm::vec3& scale)
+{
+	m_scales[node] = scale;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::MarkDirty(int node)
+{
+	m_dirty[node] = 1;
+	m_firstDirty = std::min(m_firstDirty, (size_t)node);
+}
+
+bool TransformHierarchy::Update()
+{
+	size_t nodeCount = m_parents.size();
+	if (m_firstDirty >= nodeCount)
+	{
+		m_lastUpdateCount = 0;
+		return false;
+	}
+
+	// the pass starts at the root above the first dirty node, the subtrees from there on are independent
+	size_t begin = m_firstDirty;
+	while (m_parents[begin] != NO_PARENT)
+		begin = m_parents[begin];
+
+	unsigned int threadCount = m_threadCount > 0 ? m_threadCount : JobSystem::GetWorkerCount() + 1;
+	if (threadCount == 1 || nodeCount - begin < PARALLEL_UPDATE_NODES)
+	{
+		m_lastUpdateCount = UpdateRange(begin, nodeCount);
+	}
+	else
+	{
+		// one range per thread, each ending on a root subtree boundary
+		std::vector<size_t> boundaries(1, begin);
+		size_t rangeSize = (nodeCount - begin + threadCount - 1) / threadCount;
+		for (size_t root = begin; root < nodeCount; root = m_subtreeEnds[root])
+		{
+			if (root - boundaries.back() >= rangeSize)
+				boundaries.push_back(root);
+		}
+		boundaries.push_back(nodeCount);
+
+		std::vector<size_t> counts(boundaries.size() - 1, 0);
+		JobSystem::ParallelFor(counts.size(), 1, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				counts[i] = UpdateRange(boundaries[i], boundaries[i + 1]);
+		});
+
+		m_lastUpdateCount = 0;
+		for (size_t count : counts)
+			m_lastUpdateCount += count;
+	}
+
+	// the flags are only cleared once every child has seen its parent's
+	std::fill(m_dirty.begin() + begin, m_dirty.end(), 0);
+	m_firstDirty = nodeCount;
+	return true;
+}
+
+size_t TransformHierarchy::UpdateRange(size_t begin, size_t end)
+{
+	size_t count = 0;
+	for (size_t node = begin; node < end; node++)
+	{
+		int parent = m_parents[node];
+		if (parent != NO_PARENT && m_dirty[parent])
+			m_dirty[node] = 1;
+		if (!m_dirty[node])
+			continue;
+
+		glm::mat4 local = glm::mat4_cast(m_rotations[node]);
+		local[0] *= m_scales[node].x;
+		local[1] *= m_scales[node].y;
+		local[2] *= m_scales[node].z;
+		local[3] = glm::vec4(m_positions[node], 1.0f);
+
+		m_worlds[node] = parent != NO_PARENT ? m_worlds[parent] * local : local;
+		count++;
+	}
+	return count;
+}
@@ -386,6 +386,24 @@ void VertexArrayInitializer::SetupTransparent(unsigned int& VAO)
 	glBindVertexArray(0);
 }
 
+void VertexArrayInitializer::Release(unsigned int& VAO)
+{
+	if (VAO == 0)
+		return;
+
+	// the buffer ids aren't kept, the VAO still knows them: every shape has its vertices in attribute 0
+	GLint VBO = 0, EBO = 0;
+	glBindVertexArray(VAO);
+	glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &VBO);
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &EBO);
+	glBindVertexArray(0);
+
+	unsigned int buffers[2] = { (unsigned int)VBO, (unsigned int)EBO };
+	glDeleteBuffers(2, buffers);
+	glDeleteVertexArrays(1, &VAO);
+	VAO = 0;
+}
+
 unsigned int VertexArrayInitializer::setupEBO(const unsigned int* indices, unsigned int size)
 {
 	unsigned int EBO;
@@ -0,0 +1,139 @@
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+std::vector<std::unique_ptr<AssetPack>> VirtualFileSystem::s_packs;
+
+bool VirtualFileSystem::Mount(const std::string& packPath)
+{
+	std::unique_ptr<AssetPack> pack(new AssetPack);
+	if (!pack->Open(packPath))
+		return false;
+
+	s_packs.push_back(std::move(pack));
+	return true;
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+	s_packs.clear();
+}
+
+bool VirtualFileSystem::Exists(const std::string& path)
+{
+	std::string name = NormalizePath(path);
+	for (const std::unique_ptr<AssetPack>& pack : s_packs)
+	{
+		if (pack->Contains(name))
+			return true;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	return file.is_open();
+}
+
+bool VirtualFileSystem::Read(const std::string& path, FileData& outFile)
+{
+	if (!s_packs.empty())
+	{
+		std::string name = NormalizePath(path);
+		for (auto pack = s_packs.rbegin(); pack != s_packs.rend(); ++pack)
+		{
+			if ((*pack)->Read(name, outFile))
+				return true;
+		}
+	}
+	return ReadLooseFile(path, outFile);
+}
+
+bool VirtualFileSystem::Map(const std::string& path, FileData& outFile)
+{
+	if (!s_packs.empty())
+	{
+		std::string name = NormalizePath(path);
+		for (auto pack = s_packs.rbegin(); pack != s_packs.rend(); ++pack)
+		{
+			if ((*pack)->Read(name, outFile))
+				return true;
+		}
+	}
+
+	std::unique_ptr<MappedFile> mapping(new MappedFile);
+	if (!mapping->Open(path))
+		return false;
+
+	outFile.storage.clear();
+	outFile.data = mapping->GetData();
+	outFile.size = mapping->GetSize();
+	outFile.mapping = std::move(mapping);
+	return true;
+}
+
+bool VirtualFileSystem::ReadText(const std::string& path, std::string& outText)
+{
+	FileData file;
+	if (!Read(path, file))
+		return false;
+
+	outText.assign((const char*)file.data, file.size);
+	return true;
+}
+
+std::string VirtualFileSystem::NormalizePath(const std::string& path)
+{
+	std::vector<std::string> parts;
+	std::string part;
+	for (size_t i = 0; i <= path.size(); i++)
+	{
+		char c = i < path.size() ? path[i] : '/';
+		if (c != '/' && c != '\\')
+		{
+			part += (char)std::tolower((unsigned char)c);
+			continue;
+		}
+
+		if (part == "..")
+		{
+			if (!parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else
+				parts.push_back(part);
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back(part);
+		}
+		part.clear();
+	}
+
+	std::string name;
+	for (const std::string& p : parts)
+	{
+		if (!name.empty())
+			name += '/';
+		name += p;
+	}
+	return name;
+}
+
+bool VirtualFileSystem::ReadLooseFile(const std::string& path, FileData& outFile)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	std::vector<unsigned char> bytes((size_t)std::max<std::streamsize>(size, 0));
+	if (size > 0 && !file.read((char*)&bytes[0], size))
+	{
+		std::cout << "ERROR::VFS::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+		return false;
+	}
+
+	outFile.Assign(std::move(bytes));
+	return true;
+}